@@ -0,0 +1,464 @@
+#include "graphics_framework.h"
+#include "stb_image.h"
+#include "stb_image_write.h"
+using namespace std;
+using namespace std::chrono;
+using namespace graphics_framework;
+using namespace glm;
+
+/*
+Microbenchmarks for the framework hot paths.  Each benchmark is repeated a
+number of times and every repetition is timed.  Results are written as JSON so
+runs can be compared across releases.
+
+The global allocation functions are replaced so heap allocations can be
+counted.  A reference scene is rendered after warm-up and the run fails if any
+frame allocates.
+
+Usage: framework_bench [--out results.json] [--reps N] [--filter name]
+*/
+
+// Number of heap allocations made through operator new
+atomic<size_t> allocation_count(0);
+
+// Counting replacements of the global allocation functions
+void *operator new(size_t size) {
+  ++allocation_count;
+  if (auto p = malloc(size ? size : 1))
+    return p;
+  throw bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const nothrow_t &) noexcept {
+  ++allocation_count;
+  return malloc(size ? size : 1);
+}
+void *operator new[](size_t size, const nothrow_t &tag) noexcept { return operator new(size, tag); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// Timing results for a single benchmark
+struct bench_result {
+  // Name of the benchmark
+  string name;
+  // Number of operations timed in each repetition
+  unsigned int batch;
+  // Time per operation of each repetition in nanoseconds
+  vector<double> samples;
+};
+
+// All results collected by this run
+vector<bench_result> results;
+// Heap allocations made by each measured frame of the reference scene
+vector<size_t> frame_allocations;
+// Number of repetitions of each benchmark
+unsigned int reps = 10;
+// Only benchmarks containing this string are run
+string filter;
+
+// Times op reps times, calling teardown after each timed repetition
+template <typename Op, typename Teardown>
+void bench(const string &name, unsigned int batch, Op op, Teardown teardown) {
+  if (!filter.empty() && name.find(filter) == string::npos)
+    return;
+  bench_result result{name, batch, {}};
+  // Warm up caches and lazy initialisation once
+  op();
+  teardown();
+  for (unsigned int r = 0; r < reps; ++r) {
+    auto start = high_resolution_clock::now();
+    op();
+    auto end = high_resolution_clock::now();
+    teardown();
+    result.samples.push_back(static_cast<double>(duration_cast<nanoseconds>(end - start).count()) / batch);
+  }
+  clog << "BENCH - " << name << " done" << endl;
+  results.push_back(result);
+}
+
+// Times op with nothing to clean up
+template <typename Op> void bench(const string &name, unsigned int batch, Op op) {
+  bench(name, batch, op, [] {});
+}
+
+// Releases the OpenGL storage of a piece of geometry.  The framework leaves this to the application
+void release(const geometry &geom) {
+  for (GLuint idx = 0; idx < 16; ++idx) {
+    GLuint id = 0;
+    try {
+      id = geom.get_buffer(idx);
+    } catch (out_of_range &) {
+      continue;
+    }
+    glDeleteBuffers(1, &id);
+    gpu_memory::release_buffer(id);
+  }
+  auto idx_buffer = geom.get_idx_buffer();
+  if (idx_buffer != 0) {
+    glDeleteBuffers(1, &idx_buffer);
+    gpu_memory::release_buffer(idx_buffer);
+  }
+  auto vao = geom.get_array_object();
+  glDeleteVertexArrays(1, &vao);
+}
+
+// Releases the OpenGL storage of a texture
+void release(const texture &tex) {
+  auto id = tex.get_id();
+  glDeleteTextures(1, &id);
+  gpu_memory::release_texture(id);
+}
+
+// Writes an OBJ file containing a grid of the given size
+string write_grid_obj(unsigned int size) {
+  stringstream name;
+  name << "bench_grid_" << size << ".obj";
+  ofstream file(name.str());
+  for (unsigned int z = 0; z <= size; ++z)
+    for (unsigned int x = 0; x <= size; ++x)
+      file << "v " << x << " " << sinf(x * 0.1f) * cosf(z * 0.1f) << " " << z << "\n";
+  for (unsigned int z = 0; z <= size; ++z)
+    for (unsigned int x = 0; x <= size; ++x)
+      file << "vt " << static_cast<float>(x) / size << " " << static_cast<float>(z) / size << "\n";
+  for (unsigned int z = 0; z < size; ++z)
+    for (unsigned int x = 0; x < size; ++x) {
+      auto i = z * (size + 1) + x + 1;
+      auto j = i + size + 1;
+      file << "f " << i << "/" << i << " " << j << "/" << j << " " << i + 1 << "/" << i + 1 << "\n";
+      file << "f " << i + 1 << "/" << i + 1 << " " << j << "/" << j << " " << j + 1 << "/" << j + 1 << "\n";
+    }
+  return name.str();
+}
+
+// Writes a greyscale heightmap PNG of the given size
+string write_heightmap(unsigned int size) {
+  stringstream name;
+  name << "bench_heightmap_" << size << ".png";
+  vector<unsigned char> data(size * size);
+  for (unsigned int y = 0; y < size; ++y)
+    for (unsigned int x = 0; x < size; ++x)
+      data[y * size + x] = static_cast<unsigned char>(127.5f + 127.5f * sinf(x * 0.05f) * cosf(y * 0.07f));
+  stbi_write_png(name.str().c_str(), size, size, 1, &data[0], size);
+  return name.str();
+}
+
+// Benchmarks the geometry builder at various tessellations
+void bench_geometry_builder() {
+  geometry geom;
+  auto teardown = [&] { release(geom); };
+  bench("geometry_builder::create_box", 1, [&] { geom = geometry_builder::create_box(); }, teardown);
+  bench("geometry_builder::create_tetrahedron", 1, [&] { geom = geometry_builder::create_tetrahedron(); }, teardown);
+  bench("geometry_builder::create_pyramid", 1, [&] { geom = geometry_builder::create_pyramid(); }, teardown);
+  for (unsigned int t : {8u, 32u, 128u}) {
+    auto suffix = "/" + to_string(t);
+    bench("geometry_builder::create_disk" + suffix, 1, [&] { geom = geometry_builder::create_disk(t); }, teardown);
+    bench("geometry_builder::create_cylinder" + suffix, 1, [&] { geom = geometry_builder::create_cylinder(t, t); },
+          teardown);
+    bench("geometry_builder::create_sphere" + suffix, 1, [&] { geom = geometry_builder::create_sphere(t, t); },
+          teardown);
+    bench("geometry_builder::create_torus" + suffix, 1, [&] { geom = geometry_builder::create_torus(t, t); },
+          teardown);
+  }
+  for (unsigned int t : {10u, 100u, 300u})
+    bench("geometry_builder::create_plane/" + to_string(t), 1,
+          [&] { geom = geometry_builder::create_plane(t, t, true); }, teardown);
+}
+
+// Benchmarks building mesh data alone.  No OpenGL is involved, so this isolates the CPU side of the builder
+void bench_mesh_data() {
+  mesh_data data;
+  for (unsigned int t : {8u, 32u, 128u}) {
+    auto suffix = "/" + to_string(t);
+    bench("geometry_builder::build_sphere" + suffix, 1, [&] { data = geometry_builder::build_sphere(t, t); });
+    bench("geometry_builder::build_torus" + suffix, 1, [&] { data = geometry_builder::build_torus(t, t); });
+  }
+  for (unsigned int t : {10u, 100u, 300u})
+    bench("geometry_builder::build_plane/" + to_string(t), 1,
+          [&] { data = geometry_builder::build_plane(t, t, true); });
+  for (unsigned int size : {32u, 128u, 512u}) {
+    auto filename = write_grid_obj(size);
+    mesh_cache::set_enabled(false);
+    bench("mesh_data::mesh_data/" + filename, 1, [&] { data = mesh_data(filename); });
+    // The first cached import writes the entry, every later one maps it
+    mesh_cache::set_enabled(true);
+    data = mesh_data(filename);
+    bench("mesh_data::mesh_data/cached/" + filename, 1, [&] { data = mesh_data(filename); });
+  }
+}
+
+// Benchmarks model import.  The mesh cache is off so every run parses the file
+void bench_model_import() {
+  geometry geom;
+  auto teardown = [&] { release(geom); };
+  mesh_cache::set_enabled(false);
+  bench("geometry::geometry/models/box.obj", 1, [&] { geom = geometry("models/box.obj"); }, teardown);
+  for (unsigned int size : {32u, 128u, 512u}) {
+    auto filename = write_grid_obj(size);
+    bench("geometry::geometry/" + filename, 1, [&] { geom = geometry(filename); }, teardown);
+  }
+  mesh_cache::set_enabled(true);
+}
+
+// Benchmarks terrain construction
+void bench_terrain() {
+  terrain ter;
+  auto teardown = [&] { release(ter.get_geometry()); };
+  for (unsigned int size : {64u, 128u, 256u, 512u}) {
+    auto filename = write_heightmap(size);
+    bench("terrain::terrain/" + to_string(size), 1, [&] { ter = terrain(filename); }, teardown);
+  }
+}
+
+// Benchmarks texture decoding and upload
+void bench_textures() {
+  texture tex;
+  auto teardown = [&] { release(tex); };
+  for (auto &filename : {"textures/sahara_lf.jpg", "textures/uv_32.png"}) {
+    string name(filename);
+    bench("stbi_load/" + name, 1, [&] {
+      int width, height, bpp;
+      auto data = stbi_load(filename, &width, &height, &bpp, 4);
+      stbi_image_free(data);
+    });
+    bench("texture::texture/" + name, 1, [&] { tex = texture(name, true, true); }, teardown);
+    bench("texture::texture/no_mips/" + name, 1, [&] { tex = texture(name, false, false); }, teardown);
+  }
+  vector<string> mipnames = {"textures/uv_32.png", "textures/uv_16.png", "textures/uv_8.png",
+                             "textures/uv_4.png",  "textures/uv_2.png",  "textures/uv_1.png"};
+  bench("texture::texture/mip_chain", 1, [&] { tex = texture(mipnames, false); }, teardown);
+  for (unsigned int size : {64u, 256u, 1024u}) {
+    vector<vec4> data(size * size, vec4(0.5f, 0.25f, 1.0f, 1.0f));
+    bench("texture::texture/data/" + to_string(size), 1, [&] { tex = texture(data, size, size); }, teardown);
+  }
+}
+
+// Benchmarks binding materials and lights
+void bench_binding() {
+  effect eff;
+  eff.add_shader("shaders/phong.vert", GL_VERTEX_SHADER);
+  eff.add_shader("shaders/phong.frag", GL_FRAGMENT_SHADER);
+  eff.build();
+  renderer::bind(eff);
+  const unsigned int batch = 1000;
+  material mat(vec4(0.0f), vec4(0.8f), vec4(1.0f), 25.0f);
+  directional_light light(vec4(0.1f), vec4(1.0f), vec3(0.0f, -1.0f, 0.0f));
+  vector<point_light> points(4);
+  vector<spot_light> spots(4);
+  bench("renderer::bind/effect", batch, [&] {
+    for (unsigned int i = 0; i < batch; ++i)
+      renderer::bind(eff);
+  });
+  bench("renderer::bind/material", batch, [&] {
+    for (unsigned int i = 0; i < batch; ++i)
+      renderer::bind(mat, "mat");
+  });
+  bench("renderer::bind/directional_light", batch, [&] {
+    for (unsigned int i = 0; i < batch; ++i)
+      renderer::bind(light, "light");
+  });
+  bench("renderer::bind/point_lights[4]", batch, [&] {
+    for (unsigned int i = 0; i < batch; ++i)
+      renderer::bind(points, "points");
+  });
+  bench("renderer::bind/spot_lights[4]", batch, [&] {
+    for (unsigned int i = 0; i < batch; ++i)
+      renderer::bind(spots, "spots");
+  });
+  // Per draw cost.  Built with ENU_GFX_NULL_GL this is the framework overhead alone
+  auto box = geometry_builder::create_box();
+  bench("renderer::render/box", batch, [&] {
+    for (unsigned int i = 0; i < batch; ++i)
+      renderer::render(box);
+  });
+  release(box);
+}
+
+// Renders a reference scene, counting the heap allocations made by each frame after warm-up
+void check_frame_allocations() {
+  effect eff;
+  eff.add_shader("shaders/phong.vert", GL_VERTEX_SHADER);
+  eff.add_shader("shaders/phong.frag", GL_FRAGMENT_SHADER);
+  eff.build();
+  vector<geometry> geoms{geometry_builder::create_box(), geometry_builder::create_sphere(20, 20),
+                         geometry_builder::create_torus(20, 20, 1.0f, 5.0f), geometry_builder::create_plane()};
+  vector<mesh> meshes;
+  for (size_t i = 0; i < geoms.size(); ++i) {
+    meshes.emplace_back(geoms[i]);
+    meshes[i].get_transform().translate(vec3(5.0f * i, 0.0f, 0.0f));
+  }
+  material mat(vec4(0.0f), vec4(0.8f), vec4(1.0f), 25.0f);
+  directional_light light(vec4(0.1f), vec4(1.0f), vec3(0.0f, -1.0f, 0.0f));
+  vector<point_light> points(4);
+  vector<spot_light> spots(4);
+  texture tex(64, 64);
+  auto VP = perspective(quarter_pi<float>(), 16.0f / 9.0f, 0.1f, 1000.0f) *
+            lookAt(vec3(0.0f, 10.0f, 20.0f), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+  auto frame = [&] {
+    renderer::begin_render();
+    renderer::bind(eff);
+    renderer::bind(tex, 0);
+    glUniform1i(eff.get_uniform_location("tex"), 0);
+    renderer::bind(light, "light");
+    renderer::bind(points, "points");
+    renderer::bind(spots, "spots");
+    for (auto &m : meshes) {
+      auto M = m.get_transform().get_transform_matrix();
+      glUniformMatrix4fv(eff.get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(VP * M));
+      glUniformMatrix4fv(eff.get_uniform_location("M"), 1, GL_FALSE, value_ptr(M));
+      glUniformMatrix3fv(eff.get_uniform_location("N"), 1, GL_FALSE, value_ptr(m.get_transform().get_normal_matrix()));
+      renderer::bind(mat, "mat");
+      renderer::render(m);
+    }
+    renderer::end_render();
+  };
+  // Warm up so lazily built caches are populated
+  for (unsigned int i = 0; i < 10; ++i)
+    frame();
+  const unsigned int frames = 100;
+  frame_allocations.assign(frames, 0);
+  for (unsigned int i = 0; i < frames; ++i) {
+    auto before = allocation_count.load();
+    frame();
+    frame_allocations[i] = allocation_count.load() - before;
+  }
+  for (auto &g : geoms)
+    release(g);
+  release(tex);
+}
+
+// Benchmarks ray intersection against many boxes
+void bench_ray_oobb() {
+  const unsigned int count = 10000;
+  // Fixed seed so every run tests the same boxes
+  default_random_engine engine(42);
+  uniform_real_distribution<float> dist(-50.0f, 50.0f);
+  vector<mat4> models;
+  models.reserve(count);
+  for (unsigned int i = 0; i < count; ++i)
+    models.push_back(translate(mat4(1.0f), vec3(dist(engine), dist(engine), dist(engine))) *
+                     rotate(mat4(1.0f), dist(engine), normalize(vec3(1.0f, 1.0f, 0.0f))));
+  unsigned int hits = 0;
+  bench("test_ray_oobb/" + to_string(count), count, [&] {
+    float distance;
+    for (auto &m : models)
+      if (test_ray_oobb(vec3(0.0f), normalize(vec3(1.0f, 0.5f, 0.25f)), vec3(-1.0f), vec3(1.0f), m, distance))
+        ++hits;
+  });
+  // Keep the result alive
+  if (hits == 1)
+    clog << "BENCH - single hit" << endl;
+}
+
+// Benchmarks building transform matrices
+void bench_transforms() {
+  const unsigned int count = 10000;
+  vector<graphics_framework::transform> transforms(count);
+  for (unsigned int i = 0; i < count; ++i) {
+    transforms[i].translate(vec3(static_cast<float>(i), 0.0f, 0.0f));
+    transforms[i].rotate(vec3(0.1f * i, 0.2f, 0.0f));
+    transforms[i].scale = vec3(2.0f);
+  }
+  vector<mat4> matrices(count);
+  bench("transform::get_transform_matrix/" + to_string(count), count, [&] {
+    for (unsigned int i = 0; i < count; ++i)
+      matrices[i] = transforms[i].get_transform_matrix();
+  });
+  bench("transform::get_normal_matrix/" + to_string(count), count, [&] {
+    for (unsigned int i = 0; i < count; ++i)
+      matrices[i] = mat4(transforms[i].get_normal_matrix());
+  });
+}
+
+// Writes the collected results as JSON
+void write_json(ostream &os) {
+  os << "{\n";
+  os << "  \"context\": {\n";
+  os << "    \"gl_renderer\": \"" << glGetString(GL_RENDERER) << "\",\n";
+  os << "    \"gl_version\": \"" << glGetString(GL_VERSION) << "\",\n";
+#ifdef ENU_GFX_NULL_GL
+  os << "    \"null_gl\": true,\n";
+#endif
+  os << "    \"repetitions\": " << reps << ",\n";
+  os << "    \"unit\": \"ns\"\n";
+  os << "  },\n";
+  os << "  \"benchmarks\": [\n";
+  for (size_t n = 0; n < results.size(); ++n) {
+    auto samples = results[n].samples;
+    sort(samples.begin(), samples.end());
+    double mean = accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    double variance = 0.0;
+    for (auto s : samples)
+      variance += (s - mean) * (s - mean);
+    variance /= samples.size() > 1 ? samples.size() - 1 : 1;
+    auto mid = samples.size() / 2;
+    double median = samples.size() % 2 ? samples[mid] : 0.5 * (samples[mid - 1] + samples[mid]);
+    os << "    {\n";
+    os << "      \"name\": \"" << results[n].name << "\",\n";
+    os << "      \"batch\": " << results[n].batch << ",\n";
+    os << "      \"mean\": " << mean << ",\n";
+    os << "      \"median\": " << median << ",\n";
+    os << "      \"stddev\": " << sqrt(variance) << ",\n";
+    os << "      \"min\": " << samples.front() << ",\n";
+    os << "      \"max\": " << samples.back() << ",\n";
+    os << "      \"samples\": [";
+    for (size_t i = 0; i < results[n].samples.size(); ++i)
+      os << (i ? ", " : "") << results[n].samples[i];
+    os << "]\n";
+    os << "    }" << (n + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ],\n";
+  os << "  \"frame_allocations\": {\n";
+  os << "    \"frames\": " << frame_allocations.size() << ",\n";
+  os << "    \"total\": " << accumulate(frame_allocations.begin(), frame_allocations.end(), size_t(0)) << ",\n";
+  os << "    \"max\": "
+     << (frame_allocations.empty() ? 0 : *max_element(frame_allocations.begin(), frame_allocations.end())) << "\n";
+  os << "  }\n";
+  os << "}\n";
+}
+
+int main(int argc, char **argv) {
+  string out;
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    if (arg == "--out" && i + 1 < argc)
+      out = argv[++i];
+    else if (arg == "--reps" && i + 1 < argc)
+      reps = std::max(1, atoi(argv[++i]));
+    else if (arg == "--filter" && i + 1 < argc)
+      filter = argv[++i];
+  }
+  // Headless so the benchmarks run without a display
+  app application("Framework bench", renderer::headless);
+  if (!renderer::is_running())
+    return 1;
+  bench_geometry_builder();
+  bench_mesh_data();
+  bench_model_import();
+  bench_terrain();
+  bench_textures();
+  bench_binding();
+  bench_ray_oobb();
+  bench_transforms();
+  check_frame_allocations();
+#ifdef ENU_GFX_NULL_GL
+  // Show which entry points the benchmarks exercised
+  null_gl::dump(clog);
+#endif
+  // Output results
+  if (out.empty())
+    write_json(cout);
+  else {
+    ofstream file(out);
+    write_json(file);
+  }
+  // The render hot path must not touch the heap once warmed up
+  auto worst = max_element(frame_allocations.begin(), frame_allocations.end());
+  if (worst != frame_allocations.end() && *worst > 0) {
+    cerr << "ERROR - reference scene allocated after warm-up" << endl;
+    cerr << "Up to " << *worst << " allocations in a frame" << endl;
+    return 1;
+  }
+  return 0;
+}
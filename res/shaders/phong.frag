@@ -0,0 +1,101 @@
+#version 410
+
+// Directional light structure
+struct directional_light
+{
+	vec4 ambient_intensity;
+	vec4 light_colour;
+	vec3 light_dir;
+};
+
+// Point light information
+struct point_light
+{
+	vec4 light_colour;
+	vec3 position;
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+// Spot light data
+struct spot_light
+{
+	vec4 light_colour;
+	vec3 position;
+	vec3 direction;
+	float constant;
+	float linear;
+	float quadratic;
+	float power;
+};
+
+// Material data
+struct material
+{
+	vec4 emissive;
+	vec4 diffuse_reflection;
+	vec4 specular_reflection;
+	float shininess;
+};
+
+// Directional light for the scene
+uniform directional_light light;
+// Point lights being used in the scene
+uniform point_light points[4];
+// Spot lights being used in the scene
+uniform spot_light spots[4];
+// Material of the object being rendered
+uniform material mat;
+// Position of the eye
+uniform vec3 eye_pos;
+// Texture to sample from
+uniform sampler2D tex;
+
+// Incoming position
+layout (location = 0) in vec3 position;
+// Incoming normal
+layout (location = 1) in vec3 normal;
+// Incoming texture coordinate
+layout (location = 2) in vec2 tex_coord;
+
+// Outgoing colour
+layout (location = 0) out vec4 colour;
+
+// Calculates the lit colour contribution of a light
+vec4 shade(in vec4 light_colour, in vec3 light_dir, in vec3 view_dir, in vec3 n)
+{
+	vec4 diffuse = max(dot(n, light_dir), 0.0) * (mat.diffuse_reflection * light_colour);
+	vec3 half_vector = normalize(light_dir + view_dir);
+	vec4 specular = pow(max(dot(n, half_vector), 0.0), mat.shininess) * (mat.specular_reflection * light_colour);
+	return diffuse + specular;
+}
+
+void main()
+{
+	vec3 n = normalize(normal);
+	vec3 view_dir = normalize(eye_pos - position);
+	// Directional light
+	vec4 lit = light.ambient_intensity * mat.diffuse_reflection + mat.emissive;
+	lit += shade(light.light_colour, -light.light_dir, view_dir, n);
+	// Point lights
+	for (int i = 0; i < 4; ++i)
+	{
+		vec3 to_light = points[i].position - position;
+		float d = length(to_light);
+		float attenuation = 1.0 / (points[i].constant + points[i].linear * d + points[i].quadratic * d * d);
+		lit += attenuation * shade(points[i].light_colour, to_light / d, view_dir, n);
+	}
+	// Spot lights
+	for (int i = 0; i < 4; ++i)
+	{
+		vec3 to_light = spots[i].position - position;
+		float d = length(to_light);
+		vec3 light_dir = to_light / d;
+		float intensity = pow(max(dot(-spots[i].direction, light_dir), 0.0), spots[i].power);
+		float attenuation = intensity / (spots[i].constant + spots[i].linear * d + spots[i].quadratic * d * d);
+		lit += attenuation * shade(spots[i].light_colour, light_dir, view_dir, n);
+	}
+	colour = texture(tex, tex_coord) * lit;
+	colour.a = 1.0;
+}
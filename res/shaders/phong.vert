@@ -0,0 +1,26 @@
+#version 410
+
+// Model transformation matrix
+uniform mat4 M;
+// Transformation matrix
+uniform mat4 MVP;
+// Normal matrix
+uniform mat3 N;
+
+layout (location = 0) in vec3 position;
+layout (location = 2) in vec3 normal;
+layout (location = 10) in vec2 tex_coord_in;
+
+layout (location = 0) out vec3 vertex_position;
+layout (location = 1) out vec3 transformed_normal;
+layout (location = 2) out vec2 tex_coord_out;
+
+void main()
+{
+	// Calculate screen position
+	gl_Position = MVP * vec4(position, 1.0);
+	// Output other values to fragment shader
+	vertex_position = (M * vec4(position, 1.0)).xyz;
+	transformed_normal = N * normal;
+	tex_coord_out = tex_coord_in;
+}
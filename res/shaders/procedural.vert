@@ -0,0 +1,88 @@
+#version 410
+
+// Generates the shapes of procedural_shapes from gl_VertexID, with no vertex
+// buffers.  Each shape is a grid of quads, slices across and stacks down, two
+// triangles a quad.  The outputs match phong.vert, so pair with phong.frag
+
+// View projection matrix
+uniform mat4 VP;
+
+// The shape's model transformation matrix, one per instance
+layout (location = 5) in mat4 M;
+// The shape's kind, stacks, slices and torus ring ratio, one per instance
+layout (location = 9) in vec4 shape;
+// The shape's normal matrix, the inverse transpose of M's upper 3x3, one per instance
+layout (location = 10) in mat3 N;
+
+layout (location = 0) out vec3 vertex_position;
+layout (location = 1) out vec3 transformed_normal;
+layout (location = 2) out vec2 tex_coord_out;
+
+const float pi = 3.14159265;
+// The grid corners of each quad's two triangles, wound anticlockwise seen from outside
+const ivec2 corners[6] = ivec2[](ivec2(0, 0), ivec2(1, 1), ivec2(1, 0), ivec2(0, 0), ivec2(0, 1), ivec2(1, 1));
+
+void main()
+{
+	int kind = int(shape.x);
+	int stacks = int(shape.y);
+	int slices = int(shape.z);
+	// Cylinders have a row of quads for each cap as well
+	int rows = kind == 2 ? stacks + 2 : stacks;
+	int quad = gl_VertexID / 6;
+	int row = quad / slices;
+	ivec2 grid = ivec2(quad % slices, row) + corners[gl_VertexID % 6];
+	vec2 uv = vec2(grid) / vec2(slices, rows);
+	float theta = uv.x * 2.0 * pi;
+
+	vec3 position;
+	vec3 normal;
+	if (kind == 0)
+	{
+		// Sphere of radius 1, from the top pole down
+		float phi = uv.y * pi;
+		normal = vec3(sin(phi) * sin(theta), cos(phi), sin(phi) * cos(theta));
+		position = normal;
+	}
+	else if (kind == 1)
+	{
+		// Torus of ring radius 1 around y, the tube going outside first
+		float phi = uv.y * 2.0 * pi;
+		normal = vec3(sin(theta) * cos(phi), -sin(phi), cos(theta) * cos(phi));
+		position = vec3(sin(theta), 0.0, cos(theta)) + shape.w * normal;
+	}
+	else if (kind == 2)
+	{
+		// Cylinder of radius 0.5 and height 1.  The first and last rows of quads are the caps, each from a centre
+		vec3 rim = vec3(0.5 * sin(theta), 0.0, 0.5 * cos(theta));
+		if (row == 0)
+		{
+			position = vec3(0.0, 0.5, 0.0) + rim * float(grid.y);
+			normal = vec3(0.0, 1.0, 0.0);
+		}
+		else if (row == rows - 1)
+		{
+			position = vec3(0.0, -0.5, 0.0) + rim * float(rows - grid.y);
+			normal = vec3(0.0, -1.0, 0.0);
+		}
+		else
+		{
+			position = rim + vec3(0.0, 0.5 - float(grid.y - 1) / float(stacks), 0.0);
+			normal = normalize(rim);
+		}
+	}
+	else
+	{
+		// Plane of size 1 facing up
+		position = vec3(uv.x - 0.5, 0.0, uv.y - 0.5);
+		normal = vec3(0.0, 1.0, 0.0);
+	}
+
+	// Calculate screen position
+	vec4 world = M * vec4(position, 1.0);
+	gl_Position = VP * world;
+	// Output other values to fragment shader
+	vertex_position = world.xyz;
+	transformed_normal = N * normal;
+	tex_coord_out = uv;
+}
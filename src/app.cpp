@@ -1,10 +1,12 @@
 #include "stdafx.h"
 
 #include "app.h"
+#include "util.h"
 
 namespace graphics_framework {
 
-app::app(const std::string &title, renderer::ScreenMode sm, unsigned int width, unsigned int height) {
+app::app(const std::string &title, renderer::ScreenMode sm, unsigned int width, unsigned int height)
+    : _start_time(std::chrono::steady_clock::now()) {
   // Create renderer instance
   renderer::_instance = new renderer();
   // Initialise
@@ -15,23 +17,38 @@ app::app(const std::string &title, renderer::ScreenMode sm, unsigned int width,
 void app::run() {
   // Check if renderer intialised
   if (!renderer::is_running()) {
-    std::cerr << "ERROR - renderer did not initialise" << std::endl;
+    LOG_ERROR << "renderer did not initialise";
     return;
   }
   // Initialise the application if required
   if (_init_func && !_init_func()) {
-    std::cerr << "ERROR - could not initialise application" << std::endl;
+    LOG_ERROR << "could not initialise application";
     return;
   }
   // Load any content if required
+  auto content_start = std::chrono::steady_clock::now();
   if (_load_content_func && !_load_content_func()) {
     // Don't exit - not considered fatal
-    std::cerr << "ERROR - loading content" << std::endl;
+    LOG_ERROR << "loading content";
   }
+  // Run any content declared in the load graph
+  if (_loader.size() > 0 && !_loader.run()) {
+    // Also not fatal.  Failed tasks have been logged
+    LOG_ERROR << "loading content graph";
+  }
+  _content_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - content_start).count();
 
   // Check there is a render - if not no point running
   if (!_render_func) {
-    std::cerr << "ERROR - no render function defined" << std::endl;
+    LOG_ERROR << "no render function defined";
+    return;
+  }
+
+  // Benchmark mode replaces the interactive loop
+  if (is_benchmarking()) {
+    run_benchmark();
+    if (_shutdown_func)
+      _shutdown_func();
     return;
   }
 
@@ -50,7 +67,7 @@ void app::run() {
     // Check if escape is pressed or window should be closing
     if (glfwGetKey(renderer::get_window(), GLFW_KEY_ESCAPE) || glfwWindowShouldClose(renderer::get_window())) {
       // Display message
-      std::clog << "LOG - escape pressed or window closed.  Exiting" << std::endl;
+      LOG_INFO << "escape pressed or window closed.  Exiting";
       break;
     }
 
@@ -59,7 +76,7 @@ void app::run() {
       // Call update
       if (!_update_func(seconds)) {
         // Log update exit
-        std::clog << "LOG - update returned false.  Exiting" << std::endl;
+        LOG_INFO << "update returned false.  Exiting";
         break;
       }
     }
@@ -67,16 +84,18 @@ void app::run() {
     // Begin rendering
     if (!renderer::begin_render()) {
       // Display error and exit
-      std::cerr << "ERROR - could not begin render" << std::endl;
+      LOG_ERROR << "could not begin render";
       break;
     }
     // Call render function
     if (!_render_func()) {
       // Display error only
-      std::cerr << "ERROR - problem during render" << std::endl;
+      LOG_ERROR << "problem during render";
     }
     // End render
     renderer::end_render();
+    if (_first_frame_time == 0.0)
+      report_first_frame();
     // Update previous time stamp
     prev_time_stamp = current_time_stamp;
   }
@@ -87,4 +106,138 @@ void app::run() {
 
   // Application should now be exiting
 }
-}
\ No newline at end of file
+
+// Records and logs the time to first frame
+void app::report_first_frame() {
+  _first_frame_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start_time).count();
+  LOG_INFO << "time to first frame " << _first_frame_time << " ms, " << _content_time << " ms loading content";
+  if (_loader.size() > 0)
+    _loader.log_report();
+}
+
+// Summary statistics of a series of frame times
+struct frame_stats {
+  double average, p50, p95, p99, max;
+};
+
+// Calculates summary statistics of frame times.  Percentiles use the nearest rank
+static frame_stats calculate_stats(std::vector<double> times) {
+  frame_stats stats{0.0, 0.0, 0.0, 0.0, 0.0};
+  if (times.empty())
+    return stats;
+  std::sort(times.begin(), times.end());
+  auto rank = [&times](double p) {
+    auto idx = static_cast<size_t>(std::ceil(p * times.size()));
+    return times[std::min(std::max(idx, static_cast<size_t>(1)), times.size()) - 1];
+  };
+  stats.average = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+  stats.p50 = rank(0.5);
+  stats.p95 = rank(0.95);
+  stats.p99 = rank(0.99);
+  stats.max = times.back();
+  return stats;
+}
+
+// Writes the statistics and a histogram of frame times.  Bins are a fixed width so reports can be compared
+static void write_times(std::ostream &os, const std::string &name, const std::vector<double> &times) {
+  const double bin_width = 0.5;
+  const size_t max_bins = 64;
+  auto stats = calculate_stats(times);
+  os << name << " (ms): avg " << stats.average << "  p50 " << stats.p50 << "  p95 " << stats.p95 << "  p99 "
+     << stats.p99 << "  max " << stats.max << std::endl;
+  // Count the frames in each bin.  The last bin collects everything above the range
+  std::vector<size_t> bins(std::min(static_cast<size_t>(stats.max / bin_width) + 1, max_bins), 0);
+  for (auto t : times)
+    ++bins[std::min(static_cast<size_t>(t / bin_width), bins.size() - 1)];
+  auto largest = *std::max_element(bins.begin(), bins.end());
+  for (size_t i = 0; i < bins.size(); ++i) {
+    os << "  " << std::setw(6) << i * bin_width << (i + 1 == bins.size() && i + 1 == max_bins ? "+ " : "  ")
+       << std::setw(6) << bins[i] << " " << std::string(largest ? bins[i] * 50 / largest : 0, '#') << std::endl;
+  }
+  os << std::endl;
+}
+
+// Runs a fixed number of frames along the benchmark path, timing each one
+void app::run_benchmark() {
+  // Frame rate must not be limited by the display
+  renderer::toggle_vsync(false);
+  // A fixed time step keeps every run identical
+  const float delta_time = 1.0f / 60.0f;
+  // GPU timer queries are read back a few frames late to avoid stalling the pipeline
+  const unsigned int query_count = 4;
+  std::array<GLuint, query_count> queries;
+  glGenQueries(query_count, &queries[0]);
+  std::vector<double> cpu_times, gpu_times, frame_times;
+  cpu_times.reserve(_benchmark_frames);
+  gpu_times.reserve(_benchmark_frames);
+  frame_times.reserve(_benchmark_frames);
+  // Reads back a timer query, recording it if the frame is past warm up
+  auto read_query = [&](unsigned int frame) {
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(queries[frame % query_count], GL_QUERY_RESULT, &elapsed);
+    if (frame >= _benchmark_warmup)
+      gpu_times.push_back(static_cast<double>(elapsed) / 1000000.0);
+  };
+
+  LOG_INFO << "benchmark running " << _benchmark_frames << " frames";
+  auto total_frames = _benchmark_warmup + _benchmark_frames;
+  unsigned int frame = 0;
+  for (; frame < total_frames && renderer::is_running(); ++frame) {
+    // Collect the query about to be reused
+    if (frame >= query_count)
+      read_query(frame - query_count);
+    auto frame_start = std::chrono::high_resolution_clock::now();
+    // Update the application, then override the camera with the path
+    if (_update_func && !_update_func(delta_time)) {
+      LOG_INFO << "update returned false.  Ending benchmark";
+      break;
+    }
+    auto t = frame < _benchmark_warmup || _benchmark_frames == 1
+                 ? 0.0f
+                 : static_cast<float>(frame - _benchmark_warmup) / static_cast<float>(_benchmark_frames - 1);
+    _benchmark_func(t);
+    // Render the frame inside a timer query
+    glBeginQuery(GL_TIME_ELAPSED, queries[frame % query_count]);
+    if (!renderer::begin_render()) {
+      LOG_ERROR << "could not begin render";
+      glEndQuery(GL_TIME_ELAPSED);
+      break;
+    }
+    if (!_render_func())
+      LOG_ERROR << "problem during render";
+    glEndQuery(GL_TIME_ELAPSED);
+    auto cpu_end = std::chrono::high_resolution_clock::now();
+    renderer::end_render();
+    if (_first_frame_time == 0.0)
+      report_first_frame();
+    auto frame_end = std::chrono::high_resolution_clock::now();
+    // Record CPU submission time and whole frame time
+    if (frame >= _benchmark_warmup) {
+      cpu_times.push_back(std::chrono::duration<double, std::milli>(cpu_end - frame_start).count());
+      frame_times.push_back(std::chrono::duration<double, std::milli>(frame_end - frame_start).count());
+    }
+  }
+  // Collect the outstanding queries
+  for (auto f = frame > query_count ? frame - query_count : 0; f < frame; ++f)
+    read_query(f);
+  glDeleteQueries(query_count, &queries[0]);
+  if (CHECK_GL_ERROR)
+    LOG_ERROR << "GPU timer queries failed.  GPU times are not valid";
+
+  // Write the report
+  std::ofstream file(_benchmark_report);
+  if (!file) {
+    LOG_ERROR << "writing benchmark report " << _benchmark_report << ": Could not open file";
+    return;
+  }
+  file << std::fixed << std::setprecision(3);
+  file << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+  file << "Resolution: " << renderer::get_screen_width() << "x" << renderer::get_screen_height() << std::endl;
+  file << "Time to first frame: " << _first_frame_time << " ms (content " << _content_time << " ms)" << std::endl;
+  file << "Frames: " << frame_times.size() << " (warm up " << _benchmark_warmup << ")" << std::endl << std::endl;
+  write_times(file, "CPU", cpu_times);
+  write_times(file, "GPU", gpu_times);
+  write_times(file, "Frame", frame_times);
+  LOG_INFO << "benchmark report written to " << _benchmark_report;
+}
+}
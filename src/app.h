@@ -1,5 +1,7 @@
 #pragma once
 
+#include "camera_path.h"
+#include "load_graph.h"
 #include "renderer.h"
 #include "stdafx.h"
 
@@ -19,6 +21,26 @@ private:
   std::function<bool()> _render_func;
   // The shutdown function
   std::function<void()> _shutdown_func;
+  // Content declared by the load content function, run once it returns
+  load_graph _loader;
+  // When the application was created, for time to first frame
+  std::chrono::steady_clock::time_point _start_time;
+  // Time taken to load content in milliseconds
+  double _content_time = 0.0;
+  // Time from creation until the first frame was presented in milliseconds
+  double _first_frame_time = 0.0;
+  // Places the camera on the benchmark path.  Empty when not benchmarking
+  std::function<void(float)> _benchmark_func;
+  // The number of frames recorded in benchmark mode
+  unsigned int _benchmark_frames = 0;
+  // The number of frames run before recording starts
+  unsigned int _benchmark_warmup = 0;
+  // The file the benchmark report is written to
+  std::string _benchmark_report;
+  // Runs the main loop in benchmark mode
+  void run_benchmark();
+  // Records and logs the time to first frame with the content breakdown
+  void report_first_frame();
 
 public:
   // Creates rendering application.  Initialises the renderer
@@ -36,6 +58,10 @@ public:
   void set_initialise(const std::function<bool()> &f) { _init_func = f; }
   // Sets the load content function
   void set_load_content(const std::function<bool()> &f) { _load_content_func = f; }
+  // Gets the graph content can be declared in by the load content function.  Runs in parallel once it returns
+  load_graph &get_load_graph() { return _loader; }
+  // Gets the time from creation until the first frame was presented in milliseconds.  0 before then
+  double get_first_frame_time() const { return _first_frame_time; }
   // Sets the update function
   void set_update(const std::function<bool(float)> &f) { _update_func = f; }
   // Sets the render function
@@ -50,6 +76,22 @@ public:
   void set_mouseposition_callback(GLFWcursorposfun f) const { glfwSetCursorPosCallback(renderer::get_window(), f); }
   // Sets the mouse wheel scroll callback function.  This is handled by GLFW
   void set_scroll_callback(GLFWscrollfun f) const { glfwSetScrollCallback(renderer::get_window(), f); }
+  // Sets benchmark mode.  Input is ignored and the camera follows the path for a fixed number of frames with vsync
+  // off.  Frame time statistics are written to the report file
+  template <typename Camera>
+  void set_benchmark(const camera_path &path, Camera &cam, unsigned int frames, const std::string &report,
+                     unsigned int warmup = 10) {
+    assert(frames > 0 && path.get_key_count() > 0);
+    _benchmark_func = [path, &cam](float t) {
+      path.apply(cam, t);
+      cam.update(0.0f);
+    };
+    _benchmark_frames = frames;
+    _benchmark_warmup = warmup;
+    _benchmark_report = report;
+  }
+  // Checks if the application runs in benchmark mode
+  bool is_benchmarking() const { return static_cast<bool>(_benchmark_func); }
   // Runs the application
   void run();
 };
@@ -0,0 +1,230 @@
+#include "stdafx.h"
+
+#include "asset_pack.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+const uint32_t asset_pack::version;
+std::vector<asset_pack::mount_point> asset_pack::_mounts;
+
+// Marks a file as an asset pack.  "PACK" when read as bytes
+static const uint32_t pack_magic = 0x4b434150;
+// File contents start on a multiple of this
+static const size_t content_alignment = 16;
+
+// The fixed header at the start of a pack.  Followed by the index, the name blob and the contents
+struct pack_header {
+  // Always pack_magic
+  uint32_t magic;
+  // The pack format version
+  uint32_t version;
+  // The number of files
+  uint32_t count;
+  // Unused, keeps the index aligned
+  uint32_t reserved;
+  // The offset of the name blob
+  uint64_t names_offset;
+  // The size of the name blob
+  uint64_t names_size;
+};
+
+// One file in the index
+struct asset_pack::entry {
+  // The hash of the name
+  uint64_t hash;
+  // The offset of the contents
+  uint64_t offset;
+  // The size of the contents
+  uint64_t size;
+  // The offset of the name within the name blob
+  uint32_t name_offset;
+  // The length of the name
+  uint32_t name_length;
+};
+
+// Makes the separators of a name forward slashes and drops a leading ./
+static std::string normalise(const std::string &name) {
+  auto result = name;
+  std::replace(result.begin(), result.end(), '\\', '/');
+  while (result.compare(0, 2, "./") == 0)
+    result.erase(0, 2);
+  return result;
+}
+
+// Hashes a name with 64 bit FNV-1a
+static uint64_t fnv1a(const char *name, size_t length) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(name[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Hashes a file name as the index does
+uint64_t asset_pack::hash_name(const std::string &name) {
+  auto normalised = normalise(name);
+  return fnv1a(normalised.data(), normalised.size());
+}
+
+// Maps a pack, adding its files under the prefix
+bool asset_pack::mount(const std::string &path, const std::string &prefix) {
+  static_assert(sizeof(pack_header) == 32 && sizeof(entry) == 32, "Asset pack structures must not be padded");
+  std::shared_ptr<const mapped_file> file;
+  try {
+    file = std::make_shared<const mapped_file>(path);
+  } catch (std::exception &) {
+    return false;
+  }
+  auto bytes = file->get_data();
+  auto size = static_cast<uint64_t>(file->get_size());
+  // Checks a table or blob lies inside the file
+  auto inside = [=](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+
+  pack_header header;
+  if (!inside(0, sizeof(header))) {
+    LOG_ERROR << "mounting asset pack " << path << ": File is corrupt";
+    return false;
+  }
+  memcpy(&header, bytes, sizeof(header));
+  if (header.magic != pack_magic || header.version != version) {
+    LOG_ERROR << "mounting asset pack " << path << ": Wrong format version.  Build the pack again";
+    return false;
+  }
+  if (!inside(sizeof(header), uint64_t(header.count) * sizeof(entry)) ||
+      !inside(header.names_offset, header.names_size)) {
+    LOG_ERROR << "mounting asset pack " << path << ": File is corrupt";
+    return false;
+  }
+  // Every entry is checked once here, so lookups can trust the index
+  auto entries = reinterpret_cast<const entry *>(bytes + sizeof(header));
+  for (uint32_t i = 0; i < header.count; ++i) {
+    auto &e = entries[i];
+    if (!inside(e.offset, e.size) || uint64_t(e.name_offset) + e.name_length > header.names_size ||
+        (i > 0 && entries[i - 1].hash > e.hash)) {
+      LOG_ERROR << "mounting asset pack " << path << ": File is corrupt";
+      return false;
+    }
+  }
+
+  mount_point mount;
+  mount.file = file;
+  mount.prefix = normalise(prefix);
+  if (!mount.prefix.empty() && mount.prefix.back() != '/')
+    mount.prefix += '/';
+  mount.entries = entries;
+  mount.count = header.count;
+  mount.names = reinterpret_cast<const char *>(bytes + header.names_offset);
+  _mounts.push_back(std::move(mount));
+  LOG_INFO << "asset pack " << path << " mounted with " << header.count << " files";
+  return true;
+}
+
+// Finds the entry for a name
+const asset_pack::entry *asset_pack::lookup(const std::string &filename, const mount_point *&found) {
+  if (_mounts.empty())
+    return nullptr;
+  auto name = normalise(filename);
+  for (auto m = _mounts.rbegin(); m != _mounts.rend(); ++m) {
+    if (name.compare(0, m->prefix.size(), m->prefix) != 0)
+      continue;
+    auto relative = name.c_str() + m->prefix.size();
+    auto length = name.size() - m->prefix.size();
+    auto hash = fnv1a(relative, length);
+    auto first = std::lower_bound(m->entries, m->entries + m->count, hash,
+                                  [](const entry &e, uint64_t value) { return e.hash < value; });
+    // Names sharing a hash are adjacent
+    for (auto e = first; e != m->entries + m->count && e->hash == hash; ++e) {
+      if (e->name_length == length && memcmp(m->names + e->name_offset, relative, length) == 0) {
+        found = &*m;
+        return e;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// Checks if a mounted pack holds a file
+bool asset_pack::contains(const std::string &filename) {
+  const mount_point *mount;
+  return lookup(filename, mount) != nullptr;
+}
+
+// Opens a file from the mounted packs
+bool asset_pack::find(const std::string &filename, virtual_file &file) {
+  const mount_point *mount;
+  auto e = lookup(filename, mount);
+  if (!e)
+    return false;
+  file = virtual_file(mount->file, mount->file->get_data() + e->offset, static_cast<size_t>(e->size));
+  return true;
+}
+
+// Writes the named files below a directory into a pack
+bool asset_pack::write(const std::string &path, const std::string &directory,
+                       const std::vector<std::string> &names) {
+  // Sort by hash so lookups can binary search
+  std::vector<std::pair<uint64_t, std::string>> sorted;
+  for (auto &name : names)
+    sorted.emplace_back(hash_name(name), normalise(name));
+  std::sort(sorted.begin(), sorted.end());
+
+  // Lay out the index, the names and the contents
+  std::vector<mapped_file> files;
+  std::vector<entry> index;
+  std::string blob;
+  for (auto &s : sorted) {
+    try {
+      files.emplace_back(directory + "/" + s.second);
+    } catch (std::exception &) {
+      LOG_ERROR << "writing asset pack " << path << ": Could not read " << s.second;
+      return false;
+    }
+    index.push_back({s.first, 0, files.back().get_size(), static_cast<uint32_t>(blob.size()),
+                     static_cast<uint32_t>(s.second.size())});
+    blob += s.second;
+  }
+  pack_header header = {};
+  header.magic = pack_magic;
+  header.version = version;
+  header.count = static_cast<uint32_t>(index.size());
+  header.names_offset = sizeof(header) + index.size() * sizeof(entry);
+  header.names_size = blob.size();
+  uint64_t offset = header.names_offset + header.names_size;
+  for (auto &e : index) {
+    e.offset = (offset + content_alignment - 1) & ~uint64_t(content_alignment - 1);
+    offset = e.offset + e.size;
+  }
+
+  // Write to a temporary file first, so a reader never maps a partial pack
+  auto temp = path + ".tmp";
+  {
+    std::ofstream file(temp, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!index.empty())
+      file.write(reinterpret_cast<const char *>(&index[0]), index.size() * sizeof(entry));
+    file.write(blob.data(), blob.size());
+    for (size_t i = 0; i < index.size(); ++i) {
+      static const char zeros[content_alignment] = {};
+      auto position = static_cast<uint64_t>(file.tellp());
+      file.write(zeros, static_cast<std::streamsize>(index[i].offset - position));
+      file.write(reinterpret_cast<const char *>(files[i].get_data()), files[i].get_size());
+    }
+    if (!file.good()) {
+      file.close();
+      std::remove(temp.c_str());
+      LOG_ERROR << "writing asset pack " << path << ": Could not write file";
+      return false;
+    }
+  }
+  std::remove(path.c_str());
+  if (std::rename(temp.c_str(), path.c_str()) != 0) {
+    std::remove(temp.c_str());
+    LOG_ERROR << "writing asset pack " << path << ": Could not replace file";
+    return false;
+  }
+  LOG_INFO << "asset pack " << path << " written with " << index.size() << " files";
+  return true;
+}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "stdafx.h"
+#include "virtual_file.h"
+
+namespace graphics_framework {
+/*
+Static class mounting packed archives of resource files.  A pack is an index
+of names sorted by hash followed by the file contents, each aligned so it
+can be read in place.  Mounting maps the whole pack once, and from then on
+opening, reading or checking a file inside it is a binary search of the
+index, with no system calls.  Packs are mounted at a prefix, so a pack built
+from the contents of res/ and mounted at "res/" serves res/textures/x.png.
+Packs mounted later take precedence, and files in no pack are read from
+disk.  Mount packs before loading starts; lookups are then thread safe
+*/
+class asset_pack {
+public:
+  // The version of the pack format
+  static const uint32_t version = 1;
+
+private:
+  // One file in the index, defined with the format
+  struct entry;
+  // A mounted pack
+  struct mount_point {
+    // The pack mapping
+    std::shared_ptr<const mapped_file> file;
+    // The prefix the files appear under, ending in a slash unless empty
+    std::string prefix;
+    // The index, sorted by hash
+    const entry *entries;
+    // The number of files in the pack
+    uint32_t count;
+    // The name blob
+    const char *names;
+  };
+  // The mounted packs, the most recent last
+  static std::vector<mount_point> _mounts;
+  // Finds the entry for a name, or null if no pack holds it
+  static const entry *lookup(const std::string &filename, const mount_point *&found);
+
+public:
+  // Maps a pack, adding its files under the prefix.  Returns false if the pack is not valid
+  static bool mount(const std::string &path, const std::string &prefix = "");
+  // Unmounts every pack.  Files already opened stay valid
+  static void unmount_all() { _mounts.clear(); }
+  // Gets the number of mounted packs
+  static size_t get_mounted() { return _mounts.size(); }
+  // Checks if a mounted pack holds a file
+  static bool contains(const std::string &filename);
+  // Opens a file from the mounted packs.  Returns false if no pack holds it
+  static bool find(const std::string &filename, virtual_file &file);
+  // Writes the named files below a directory into a pack.  Returns false if the pack could not be written
+  static bool write(const std::string &path, const std::string &directory, const std::vector<std::string> &names);
+  // Hashes a file name as the index does, after making the separators forward slashes
+  static uint64_t hash_name(const std::string &name);
+};
+}
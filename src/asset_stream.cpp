@@ -0,0 +1,247 @@
+#include "stdafx.h"
+
+#include "asset_stream.h"
+#include "geometry_builder.h"
+#include "image_data.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+std::vector<std::thread> asset_stream::_workers;
+std::atomic<bool> asset_stream::_running(false);
+std::mutex asset_stream::_decode_mutex;
+std::condition_variable asset_stream::_decode_ready;
+std::deque<std::shared_ptr<asset_stream::job>> asset_stream::_decode_queue;
+std::mutex asset_stream::_upload_mutex;
+std::deque<std::shared_ptr<asset_stream::job>> asset_stream::_upload_queue;
+std::atomic<size_t> asset_stream::_pending(0);
+double asset_stream::_upload_budget = 2.0;
+
+// Starts the worker threads
+void asset_stream::initialise(unsigned int workers) {
+  std::lock_guard<std::mutex> lock(_decode_mutex);
+  if (_running)
+    return;
+  // Leave a hardware thread for the renderer
+  if (workers == 0)
+    workers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  _running = true;
+  for (unsigned int i = 0; i < workers; ++i)
+    _workers.emplace_back(work);
+  LOG_INFO << "asset stream started with " << workers << " workers";
+}
+
+// Starts the workers if they are not running
+void asset_stream::start() {
+  if (_workers.empty())
+    initialise();
+}
+
+// Stops the workers
+void asset_stream::shutdown() {
+  // Abandoned jobs are failed, so their handles do not stay pending.  The queues are taken under their locks, but
+  // failed outside them
+  std::deque<std::shared_ptr<job>> abandoned;
+  auto fail_abandoned = [&abandoned] {
+    for (auto &j : abandoned) {
+      LOG_WARNING << "streaming " << j->name << ": Abandoned as the stream stopped";
+      j->fail();
+      --_pending;
+    }
+    abandoned.clear();
+  };
+  {
+    std::lock_guard<std::mutex> lock(_decode_mutex);
+    if (!_running)
+      return;
+    _running = false;
+    abandoned.swap(_decode_queue);
+  }
+  _decode_ready.notify_all();
+  fail_abandoned();
+  // Workers finish the job they are decoding before exiting
+  for (auto &w : _workers)
+    w.join();
+  _workers.clear();
+  {
+    std::lock_guard<std::mutex> lock(_upload_mutex);
+    abandoned.swap(_upload_queue);
+  }
+  fail_abandoned();
+}
+
+// Body of a worker thread
+void asset_stream::work() {
+  for (;;) {
+    std::shared_ptr<job> j;
+    {
+      std::unique_lock<std::mutex> lock(_decode_mutex);
+      _decode_ready.wait(lock, [] { return !_running || !_decode_queue.empty(); });
+      if (!_running)
+        return;
+      j = _decode_queue.front();
+      _decode_queue.pop_front();
+    }
+    try {
+      j->decode();
+    } catch (std::exception &e) {
+      LOG_ERROR << "streaming " << j->name << ": " << e.what();
+      j->fail();
+      --_pending;
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(_upload_mutex);
+    _upload_queue.push_back(j);
+  }
+}
+
+// Queues a job for decoding
+void asset_stream::submit(std::shared_ptr<job> j) {
+  start();
+  ++_pending;
+  {
+    std::lock_guard<std::mutex> lock(_decode_mutex);
+    _decode_queue.push_back(j);
+  }
+  _decode_ready.notify_one();
+}
+
+// Loads a texture from file in the background
+asset<texture> asset_stream::load_texture(const std::string &filename, bool mipmaps, bool anisotropic) {
+  auto handle = create_handle<texture>(filename);
+  auto state = handle._state;
+  auto image = std::make_shared<image_data>();
+  auto j = std::make_shared<job>();
+  j->name = filename;
+  j->decode = [=] { *image = image_data(filename); };
+  j->upload = [=] {
+    state->resource = texture(image->get_pixels(), image->get_width(), image->get_height(), mipmaps, anisotropic,
+                              filename);
+    LOG_INFO << "texture " << filename << " streamed, " << image->get_width() << 'x' << image->get_height();
+    image->clear();
+    state->stage = asset<texture>::ready;
+  };
+  j->fail = [=] { state->stage = asset<texture>::failed; };
+  submit(j);
+  return handle;
+}
+
+// Loads a cubemap from six files in the background
+asset<cubemap> asset_stream::load_cubemap(const std::array<std::string, 6> &filenames) {
+  auto handle = create_handle<cubemap>(filenames[0]);
+  auto state = handle._state;
+  auto images = std::make_shared<std::array<image_data, 6>>();
+  auto j = std::make_shared<job>();
+  j->name = filenames[0];
+  j->decode = [=] {
+    for (size_t i = 0; i < 6; ++i) {
+      (*images)[i] = image_data(filenames[i]);
+      if ((*images)[i].get_width() != (*images)[0].get_width() ||
+          (*images)[i].get_height() != (*images)[0].get_height())
+        throw std::runtime_error("face " + filenames[i] + " differs in size from the first face");
+    }
+  };
+  j->upload = [=] {
+    std::array<const unsigned char *, 6> faces;
+    for (size_t i = 0; i < 6; ++i)
+      faces[i] = (*images)[i].get_pixels();
+    state->resource = cubemap(faces, (*images)[0].get_width(), (*images)[0].get_height(), filenames[0]);
+    for (auto &image : *images)
+      image.clear();
+    state->stage = asset<cubemap>::ready;
+    LOG_INFO << "cubemap " << filenames[0] << " streamed";
+  };
+  j->fail = [=] { state->stage = asset<cubemap>::failed; };
+  submit(j);
+  return handle;
+}
+
+// Loads a model from file in the background
+asset<geometry> asset_stream::load_geometry(const std::string &filename) {
+  auto handle = create_handle<geometry>(filename);
+  auto state = handle._state;
+  // Importing and conversion both happen on the worker
+  auto data = std::make_shared<mesh_data>();
+  auto j = std::make_shared<job>();
+  j->name = filename;
+  j->decode = [=] { *data = mesh_data(filename); };
+  j->upload = [=] {
+    state->resource = geometry(std::move(*data));
+    state->stage = asset<geometry>::ready;
+    LOG_INFO << "geometry " << filename << " streamed";
+  };
+  j->fail = [=] { state->stage = asset<geometry>::failed; };
+  submit(j);
+  return handle;
+}
+
+// Runs a custom load in the background
+void asset_stream::load_task(const std::string &name, std::function<void()> decode, std::function<void()> upload,
+                             std::function<void()> fail) {
+  auto j = std::make_shared<job>();
+  j->name = name;
+  j->decode = std::move(decode);
+  j->upload = std::move(upload);
+  j->fail = std::move(fail);
+  submit(j);
+}
+
+// Uploads decoded resources until the frame budget is spent
+void asset_stream::update() {
+  if (_pending.load() == 0)
+    return;
+  auto start_time = std::chrono::steady_clock::now();
+  for (;;) {
+    std::shared_ptr<job> j;
+    {
+      std::lock_guard<std::mutex> lock(_upload_mutex);
+      if (_upload_queue.empty())
+        return;
+      j = _upload_queue.front();
+      _upload_queue.pop_front();
+    }
+    try {
+      j->upload();
+    } catch (std::exception &e) {
+      LOG_ERROR << "uploading " << j->name << ": " << e.what();
+      j->fail();
+    }
+    --_pending;
+    // At least one upload is made so large resources still progress
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time;
+    if (elapsed.count() >= _upload_budget)
+      return;
+  }
+}
+
+// Blocks until every pending load has completed or failed
+void asset_stream::finish() {
+  auto budget = _upload_budget;
+  _upload_budget = std::numeric_limits<double>::max();
+  while (_pending.load() > 0 && _running) {
+    update();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  _upload_budget = budget;
+}
+
+// Magenta and grey checker shown while a texture loads
+template <> const texture &asset_stream::get_placeholder<texture>() {
+  static const unsigned char pixels[] = {255, 0, 255, 255, 128, 128, 128, 255, 128, 128, 128, 255, 255, 0, 255, 255};
+  static const texture placeholder(pixels, 2, 2, false, false, "placeholder");
+  return placeholder;
+}
+
+// Grey cubemap shown while a cubemap loads
+template <> const cubemap &asset_stream::get_placeholder<cubemap>() {
+  static const unsigned char pixel[] = {128, 128, 128, 255};
+  static const cubemap placeholder({{pixel, pixel, pixel, pixel, pixel, pixel}}, 1, 1, "placeholder");
+  return placeholder;
+}
+
+// Unit box shown while a model loads
+template <> const geometry &asset_stream::get_placeholder<geometry>() {
+  static const geometry placeholder = geometry_builder::create_box();
+  return placeholder;
+}
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "cubemap.h"
+#include "geometry.h"
+#include "stdafx.h"
+#include "texture.h"
+
+namespace graphics_framework {
+// Forward declaration of the streaming service
+class asset_stream;
+
+/*
+Handle to a resource being loaded by the asset stream.  Handles are cheap to
+copy and all copies see the resource once it is ready.  Until then get
+returns a placeholder, so a handle can be rendered from the frame it is
+requested.  Only use get on the thread running the renderer
+*/
+template <typename T> class asset {
+  // Declare friend class
+  friend class asset_stream;
+
+public:
+  // The stages of a load
+  enum status { pending, ready, failed };
+
+private:
+  // State shared between the handle copies and the stream
+  struct shared_state {
+    // The stage the load has reached
+    std::atomic<int> stage;
+    // The loaded resource.  Only valid when ready
+    T resource;
+    // The file the resource is loaded from
+    std::string name;
+  };
+  // The shared state of the load
+  std::shared_ptr<shared_state> _state;
+
+public:
+  // Creates an empty handle.  Always resolves to the placeholder
+  asset() {}
+  // Gets the stage the load has reached
+  status get_status() const { return _state ? static_cast<status>(_state->stage.load()) : failed; }
+  // Checks if the resource has loaded
+  bool is_ready() const { return get_status() == ready; }
+  // Gets the name of the file being loaded
+  const std::string &get_name() const {
+    static const std::string empty;
+    return _state ? _state->name : empty;
+  }
+  // Gets the resource if it has loaded, otherwise the placeholder
+  const T &get() const;
+};
+
+/*
+Static class that loads textures, cubemaps and geometry in the background.
+Worker threads read and decode files: stb_image for images and Assimp for
+models, which are converted to mesh data on the worker too.  Decoded data is then uploaded to OpenGL by update, which the
+renderer calls at the start of each frame and which stops once the upload
+budget for the frame is spent.  Requests return a handle straight away that
+resolves to a placeholder until the upload completes
+*/
+class asset_stream {
+private:
+  // A queued load
+  struct job {
+    // The file being loaded, for logging
+    std::string name;
+    // Reads and decodes the file.  Runs on a worker thread
+    std::function<void()> decode;
+    // Creates the OpenGL resource.  Runs on the renderer thread
+    std::function<void()> upload;
+    // Marks the handle as failed
+    std::function<void()> fail;
+  };
+  // The worker threads
+  static std::vector<std::thread> _workers;
+  // Flag determining if the workers should keep running.  Read by finish outside the lock
+  static std::atomic<bool> _running;
+  // Guards the decode queue
+  static std::mutex _decode_mutex;
+  // Signals the workers when jobs are queued or the stream stops
+  static std::condition_variable _decode_ready;
+  // Jobs waiting to be decoded
+  static std::deque<std::shared_ptr<job>> _decode_queue;
+  // Guards the upload queue
+  static std::mutex _upload_mutex;
+  // Decoded jobs waiting to be uploaded
+  static std::deque<std::shared_ptr<job>> _upload_queue;
+  // The number of jobs not yet uploaded or failed
+  static std::atomic<size_t> _pending;
+  // The time allowed for uploads each frame in milliseconds
+  static double _upload_budget;
+  // Starts the workers if they are not running
+  static void start();
+  // Body of a worker thread
+  static void work();
+  // Queues a job for decoding
+  static void submit(std::shared_ptr<job> j);
+  // Creates the shared state of a new handle
+  template <typename T> static asset<T> create_handle(const std::string &name) {
+    asset<T> handle;
+    handle._state = std::make_shared<typename asset<T>::shared_state>();
+    handle._state->stage = asset<T>::pending;
+    handle._state->name = name;
+    return handle;
+  }
+
+public:
+  // Starts the given number of worker threads.  0 uses one fewer than the hardware threads
+  static void initialise(unsigned int workers = 0);
+  // Stops the workers.  Queued loads are abandoned and failed, so their handles report failed.  Called by the
+  // renderer on shutdown
+  static void shutdown();
+  // Loads a texture from file in the background
+  static asset<texture> load_texture(const std::string &filename, bool mipmaps = true, bool anisotropic = true);
+  // Loads a cubemap from six files in the background
+  static asset<cubemap> load_cubemap(const std::array<std::string, 6> &filenames);
+  // Loads a model from file in the background
+  static asset<geometry> load_geometry(const std::string &filename);
+  // Runs a custom load in the background.  The decode function runs on a worker thread, then the upload function on
+  // the renderer thread within the frame budget.  The fail function runs on whichever thread threw
+  static void load_task(const std::string &name, std::function<void()> decode, std::function<void()> upload,
+                        std::function<void()> fail);
+  // Uploads decoded resources until the frame budget is spent.  At least one upload is made per call if ready
+  static void update();
+  // Blocks until every pending load has completed or failed.  Uploads are not budgeted
+  static void finish();
+  // Gets the number of loads not yet complete
+  static size_t get_pending() { return _pending.load(); }
+  // Gets the time allowed for uploads each frame in milliseconds
+  static double get_upload_budget() { return _upload_budget; }
+  // Sets the time allowed for uploads each frame in milliseconds
+  static void set_upload_budget(double ms) { _upload_budget = ms; }
+  // Gets the placeholder used for a resource type while it loads
+  template <typename T> static const T &get_placeholder();
+};
+
+// Placeholders for each supported resource type
+template <> const texture &asset_stream::get_placeholder<texture>();
+template <> const cubemap &asset_stream::get_placeholder<cubemap>();
+template <> const geometry &asset_stream::get_placeholder<geometry>();
+
+// Gets the resource if it has loaded, otherwise the placeholder
+template <typename T> const T &asset<T>::get() const {
+  if (is_ready())
+    return _state->resource;
+  return asset_stream::get_placeholder<T>();
+}
+}
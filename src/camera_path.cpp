@@ -0,0 +1,72 @@
+#include "stdafx.h"
+
+#include "camera_path.h"
+
+namespace graphics_framework {
+
+// Adds a key to the end of the path
+void camera_path::add_key(const glm::vec3 &position, const glm::vec3 &target) {
+  _positions.push_back(position);
+  _targets.push_back(target);
+}
+
+// Evaluates a Catmull-Rom spline through the given keys.  The end keys are repeated so the curve passes through them
+glm::vec3 camera_path::evaluate(const std::vector<glm::vec3> &keys, float t) {
+  assert(!keys.empty());
+  if (keys.size() == 1)
+    return keys[0];
+  // Find the segment and the position within it
+  t = glm::clamp(t, 0.0f, 1.0f) * static_cast<float>(keys.size() - 1);
+  auto segment = std::min(static_cast<size_t>(t), keys.size() - 2);
+  auto u = t - static_cast<float>(segment);
+  // Gather the four control points, clamping at the ends
+  auto &p0 = keys[segment == 0 ? 0 : segment - 1];
+  auto &p1 = keys[segment];
+  auto &p2 = keys[segment + 1];
+  auto &p3 = keys[std::min(segment + 2, keys.size() - 1)];
+  auto u2 = u * u;
+  auto u3 = u2 * u;
+  return 0.5f * ((2.0f * p1) + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+                 (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+}
+
+// Places a free camera on the path
+void camera_path::apply(free_camera &cam, float t) const {
+  auto position = get_position(t);
+  auto forward = glm::normalize(get_target(t) - position);
+  // Invert the spherical coordinates used by free_camera::get_forward
+  cam.set_position(position);
+  cam.set_pitch(asinf(glm::clamp(forward.y, -1.0f, 1.0f)));
+  cam.set_yaw(atan2f(-forward.x, -forward.z));
+}
+
+// Places a target camera on the path
+void camera_path::apply(target_camera &cam, float t) const {
+  cam.set_position(get_position(t));
+  cam.set_target(get_target(t));
+}
+
+// Places an arc ball camera on the path
+void camera_path::apply(arc_ball_camera &cam, float t) const {
+  auto target = get_target(t);
+  auto offset = get_position(t) - target;
+  auto distance = glm::length(offset);
+  cam.set_target(target);
+  cam.set_distance(distance);
+  // Invert the rotation applied in arc_ball_camera::update
+  if (distance > 0.0f) {
+    cam.set_rot_X(asinf(glm::clamp(-offset.y / distance, -1.0f, 1.0f)));
+    cam.set_rot_Y(atan2f(offset.x, offset.z));
+  }
+}
+
+// Creates a path that orbits the given centre once
+camera_path camera_path::create_orbit(const glm::vec3 &centre, float radius, float height, unsigned int keys) {
+  camera_path path;
+  for (unsigned int i = 0; i <= keys; ++i) {
+    auto angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(keys);
+    path.add_key(centre + glm::vec3(radius * cosf(angle), height, radius * sinf(angle)), centre);
+  }
+  return path;
+}
+}
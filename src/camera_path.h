@@ -0,0 +1,48 @@
+#pragma once
+
+#include "arc_ball_camera.h"
+#include "free_camera.h"
+#include "stdafx.h"
+#include "target_camera.h"
+
+namespace graphics_framework {
+/*
+A deterministic camera path.  Key positions and targets are interpolated with
+a Catmull-Rom spline so that the same path produces the same view on every
+machine.  Used to drive cameras in benchmark mode
+*/
+class camera_path {
+private:
+  // The key positions of the camera
+  std::vector<glm::vec3> _positions;
+  // The key targets of the camera
+  std::vector<glm::vec3> _targets;
+  // Evaluates a spline through the given keys
+  static glm::vec3 evaluate(const std::vector<glm::vec3> &keys, float t);
+
+public:
+  // Creates an empty camera path
+  camera_path() {}
+  // Default copy constructor and assignment operator
+  camera_path(const camera_path &other) = default;
+  camera_path &operator=(const camera_path &rhs) = default;
+  // Destroys the camera path
+  ~camera_path() {}
+  // Adds a key to the end of the path
+  void add_key(const glm::vec3 &position, const glm::vec3 &target);
+  // Gets the number of keys on the path
+  size_t get_key_count() const { return _positions.size(); }
+  // Gets the position along the path.  t runs from 0 to 1
+  glm::vec3 get_position(float t) const { return evaluate(_positions, t); }
+  // Gets the target along the path.  t runs from 0 to 1
+  glm::vec3 get_target(float t) const { return evaluate(_targets, t); }
+  // Places a free camera on the path
+  void apply(free_camera &cam, float t) const;
+  // Places a target camera on the path
+  void apply(target_camera &cam, float t) const;
+  // Places an arc ball camera on the path
+  void apply(arc_ball_camera &cam, float t) const;
+  // Creates a path that orbits the given centre once
+  static camera_path create_orbit(const glm::vec3 &centre, float radius, float height, unsigned int keys = 8);
+};
+}
@@ -1,18 +1,13 @@
 #include "stdafx.h"
 
 #include "cubemap.h"
-#include "stb_image.h"
+#include "gpu_memory.h"
+#include "image_data.h"
+#include "pixel_upload.h"
 #include "util.h"
 
 namespace graphics_framework {
 
-static auto stbi_load_smart = [](auto... args) {
-  auto closer_lambda = [](stbi_uc *rgbd) { stbi_image_free(rgbd); };
-  std::unique_ptr<stbi_uc, decltype(closer_lambda)> rgb(stbi_load(args...),
-                                                        closer_lambda);
-  return rgb;
-};
-
 // The 6 targets of the the cubemap
 std::array<GLenum, 6> targets = {
     GL_TEXTURE_CUBE_MAP_POSITIVE_X, GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
@@ -20,26 +15,52 @@ std::array<GLenum, 6> targets = {
     GL_TEXTURE_CUBE_MAP_POSITIVE_Z, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z};
 
 // Creates a cubemap object from an array of six file names
-cubemap::cubemap(const std::array<std::string, 6> &filenames) throw(...) {
+cubemap::cubemap(const std::array<std::string, 6> &filenames) {
   // Ensure that filenames are valid
   for (auto &file : filenames) {
     if (!check_file_exists(file)) {
       // Failed to read file.  Display error
-      std::cerr << "ERROR - could not load cubemap texture " << file
-                << std::endl;
-      std::cerr << "File Does Not Exist" << std::endl;
+      LOG_ERROR << "could not load cubemap texture " << file << ": File Does Not Exist";
       // Throw exception
       throw std::runtime_error("Error adding cubemap texture");
     }
   }
+  // Decode all six faces before touching OpenGL
+  std::array<image_data, 6> faces;
+  std::array<const unsigned char *, 6> pixels;
+  for (auto i = 0; i < 6; ++i) {
+    faces[i] = image_data(filenames[i]);
+    // Faces of a cubemap must match
+    if (i > 0 && (faces[i].get_width() != faces[0].get_width() || faces[i].get_height() != faces[0].get_height())) {
+      LOG_ERROR << "loading cubemap textures: " << filenames[i] << " differs in size from " << filenames[0];
+      throw std::runtime_error("Error loading cubemap textures");
+    }
+    pixels[i] = faces[i].get_pixels();
+  }
+
+  // Upload the decoded faces
+  create(pixels, faces[0].get_width(), faces[0].get_height(), filenames[0]);
+
+  // Log success
+  LOG_INFO << "cubemap created";
+}
+
+// Creates a cubemap from six decoded RGBA faces
+cubemap::cubemap(const std::array<const unsigned char *, 6> &faces, GLuint width, GLuint height,
+                 const std::string &name) {
+  create(faces, width, height, name);
+}
+
+// Creates the OpenGL cubemap from six decoded RGBA faces
+void cubemap::create(const std::array<const unsigned char *, 6> &faces, GLuint width, GLuint height,
+                     const std::string &name) {
   // Generate cubemap texture and bind
   glGenTextures(1, &_id);
   glBindTexture(GL_TEXTURE_CUBE_MAP, _id);
   // Check if OpenGL error.
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - creating cubemap" << std::endl;
-    std::cerr << "Could not allocate texture with OpenGL" << std::endl;
+    LOG_ERROR << "creating cubemap: Could not allocate texture with OpenGL";
     // Set ID to 0
     _id = 0;
     // Throw exception
@@ -58,28 +79,19 @@ cubemap::cubemap(const std::array<std::string, 6> &filenames) throw(...) {
                   max_anisotropy);
   CHECK_GL_ERROR; // non-fatal
   // Load in each image to OpenGL and assign it to the cubemap texture
-
   for (auto i = 0; i < 6; ++i) {
-    // Todo Refactor this to a common image place
-    int width, height, bpp;
-    auto rgb = stbi_load_smart(filenames[i].c_str(), &width, &height, &bpp, 4);
-
-    if (rgb == NULL || width == 0 || height == 0) {
-      throw std::runtime_error("Error reading texture");
-    }
-
-    // Load the image into OpenGL
+    // Allocate the face and fill it through the staging buffer
     glTexImage2D(targets[i], 0, GL_RGBA, width, height, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, rgb.get());
+                 GL_UNSIGNED_BYTE, nullptr);
+    pixel_upload::upload(targets[i], 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, faces[i]);
 
     // Check if loaded OK
     if (CHECK_GL_ERROR) {
       // Display error
-      std::cerr << "ERROR - loading cubemap textures" << std::endl;
-      std::cerr << "Could not load texture data for file " << filenames[i]
-                << std::endl;
+      LOG_ERROR << "loading cubemap textures: Could not load texture data for face " << i << " of " << name;
       // Delete the texture
       glDeleteTextures(1, &_id);
+      gpu_memory::release_texture(_id);
       _id = 0;
       // Throw an exception
       throw std::runtime_error("Error loading cubemap textures");
@@ -90,13 +102,14 @@ cubemap::cubemap(const std::array<std::string, 6> &filenames) throw(...) {
   glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
   CHECK_GL_ERROR; // non-fatal
 
-  // Log success
-  std::clog << "LOG - cubemap created" << std::endl;
+  // Record the storage of all six faces and their mip chains
+  gpu_memory::track_texture(_id, gpu_memory::calculate_texture_bytes(width, height, GL_RGBA, true, 6),
+                            gpu_memory::cubemap_texture, name);
 }
 
 // Sets one of the textures in the cubemap
 bool cubemap::set_texture(GLenum target,
-                          const std::string &filename) throw(...) {
+                          const std::string &filename) {
   // Check that cubemap has been generated
   if (_id == 0) {
     // Generate texture with OpenGL
@@ -104,8 +117,7 @@ bool cubemap::set_texture(GLenum target,
     // Check error
     if (CHECK_GL_ERROR) {
       // Display error
-      std::cerr << "ERROR - creating cubemap" << std::endl;
-      std::cerr << "Could not allocate texture with OpenGL" << std::endl;
+      LOG_ERROR << "creating cubemap: Could not allocate texture with OpenGL";
       // Set ID to 0
       _id = 0;
       // Throw exception
@@ -120,9 +132,7 @@ bool cubemap::set_texture(GLenum target,
 
   if (!check_file_exists(filename)) {
     // Failed to read file.  Display error
-    std::cerr << "ERROR - could not load cubemap texture " << filename
-              << std::endl;
-    std::cerr << "File Does Not Exist" << std::endl;
+    LOG_ERROR << "could not load cubemap texture " << filename << ": File Does Not Exist";
     // Throw exception
     throw std::runtime_error("Error adding cubemap texture");
   }
@@ -132,29 +142,21 @@ bool cubemap::set_texture(GLenum target,
   // Check if OpenGL error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - adding a texture to cubemap" << std::endl;
-    std::cerr << "Could not bind cubemap" << std::endl;
+    LOG_ERROR << "adding a texture to cubemap: Could not bind cubemap";
     // Throw exception
     throw std::runtime_error("Error binding cubemap");
   }
 
-  int width, height, bpp;
-  auto rgb = stbi_load_smart(filename.c_str(), &width, &height, &bpp, 4);
-
-  if (rgb == NULL || width == 0 || height == 0) {
-    throw std::runtime_error("Error reading texture");
-  }
+  image_data image(filename);
 
   // Load the image into OpenGL
-  glTexImage2D(target, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-               rgb.get());
+  glTexImage2D(target, 0, GL_RGBA, image.get_width(), image.get_height(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               image.get_pixels());
 
   // Check if error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - adding a texture to cubemap" << std::endl;
-    std::cerr << "Could not load texture data for file " << filename
-              << std::endl;
+    LOG_ERROR << "adding a texture to cubemap: Could not load texture data for file " << filename;
     // Throw exception
     throw std::runtime_error("Error loading texture");
   }
@@ -162,8 +164,13 @@ bool cubemap::set_texture(GLenum target,
   glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
   CHECK_GL_ERROR; // Non-fatal
 
+  // Record the storage.  A complete cubemap has six faces of the same size
+  gpu_memory::track_texture(
+      _id, gpu_memory::calculate_texture_bytes(image.get_width(), image.get_height(), GL_RGBA, true, 6),
+      gpu_memory::cubemap_texture, filename);
+
   // Log and return
-  std::clog << "LOG - texture added to cubemap" << std::endl;
+  LOG_INFO << "texture added to cubemap";
   return true;
 }
 } // namespace graphics_framework
\ No newline at end of file
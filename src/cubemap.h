@@ -10,12 +10,18 @@ class cubemap {
 private:
   // The id for the cubemap texture in OpenGL
   GLuint _id;
+  // Creates the OpenGL cubemap from six decoded RGBA faces
+  void create(const std::array<const unsigned char *, 6> &faces, GLuint width, GLuint height,
+              const std::string &name);
 
 public:
   // Creates a new cubemap
   cubemap() {}
   // Creates a new cubemap given six filenames
-  explicit cubemap(const std::array<std::string, 6> &filenames) throw(...);
+  explicit cubemap(const std::array<std::string, 6> &filenames);
+  // Creates a cubemap from six decoded 8 bit RGBA faces of the same size, ordered +X, -X, +Y, -Y, +Z, -Z
+  cubemap(const std::array<const unsigned char *, 6> &faces, GLuint width, GLuint height,
+          const std::string &name = "");
   // Default copy constructor and assignment operator
   cubemap(const cubemap &other) = default;
   cubemap &operator=(const cubemap &rhs) = default;
@@ -24,6 +30,6 @@ public:
   // Gets the OpenGL id for the cubemap texture
   GLuint get_id() const { return _id; }
   // Sets a texture for one part of the cubemap
-  bool set_texture(GLenum target, const std::string &filename) throw(...);
+  bool set_texture(GLenum target, const std::string &filename);
 };
 }
\ No newline at end of file
@@ -1,21 +1,21 @@
 #include "stdafx.h"
 
 #include "depth_buffer.h"
+#include "gpu_memory.h"
 #include "util.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
 namespace graphics_framework {
 // Creates a depth buffer object
-depth_buffer::depth_buffer(GLuint width, GLuint height) throw(...)
+depth_buffer::depth_buffer(GLuint width, GLuint height)
     : _width(width), _height(height), _depth(texture(width, height)) {
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, _depth.get_id());
   // Check for error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building depth buffer" << std::endl;
-    std::cerr << "Could not allocate depth texture with OpenGL" << std::endl;
+    LOG_ERROR << "building depth buffer: Could not allocate depth texture with OpenGL";
     // Throw exception
     throw std::runtime_error("Error creating depth texture with OpenGL");
   }
@@ -26,11 +26,14 @@ depth_buffer::depth_buffer(GLuint width, GLuint height) throw(...)
   // Check if error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building depth buffer" << std::endl;
-    std::cerr << "Could not create depth image data with OpenGL" << std::endl;
+    LOG_ERROR << "building depth buffer: Could not create depth image data with OpenGL";
     // Throw exception
     throw std::runtime_error("Error creating depth texture with OpenGL");
   }
+  // Record the depth storage
+  gpu_memory::track_texture(_depth.get_id(),
+                            gpu_memory::calculate_texture_bytes(width, height, GL_DEPTH_COMPONENT32F, false),
+                            gpu_memory::depth_target, "depth buffer");
 
   // Set texture properties
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -47,8 +50,7 @@ depth_buffer::depth_buffer(GLuint width, GLuint height) throw(...)
   // Check for errors
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building depth buffer" << std::endl;
-    std::cerr << "Could not allocate frame buffer with OpenGL" << std::endl;
+    LOG_ERROR << "building depth buffer: Could not allocate frame buffer with OpenGL";
     // Delete framebuffer
     glDeleteFramebuffers(1, &_buffer);
     // Throw exception
@@ -60,8 +62,7 @@ depth_buffer::depth_buffer(GLuint width, GLuint height) throw(...)
   // Check for errors
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building depth buffer" << std::endl;
-    std::cerr << "Could not attach texture to frame buffer" << std::endl;
+    LOG_ERROR << "building depth buffer: Could not attach texture to frame buffer";
     // Delete frame buffer
     glDeleteFramebuffers(1, &_buffer);
     // Throw exception
@@ -74,8 +75,7 @@ depth_buffer::depth_buffer(GLuint width, GLuint height) throw(...)
   // Check for errors
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building depth buffer" << std::endl;
-    std::cerr << "Could not set draw buffer" << std::endl;
+    LOG_ERROR << "building depth buffer: Could not set draw buffer";
     // Delete frame buffer
     glDeleteFramebuffers(1, &_buffer);
     // Throw exception
@@ -87,7 +87,7 @@ depth_buffer::depth_buffer(GLuint width, GLuint height) throw(...)
   CHECK_GL_ERROR; // Non-fatal here
 
   // Log
-  std::clog << "LOG - depth bufer built" << std::endl;
+  LOG_INFO << "depth bufer built";
 }
 
 // Saves the framebuffer
@@ -131,7 +131,7 @@ void depth_buffer::save(const std::string &filename, const bool linear) const {
 
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - Couldn't Read glReadPixels" << std::endl;
+    LOG_ERROR << "Couldn't Read glReadPixels";
     // Throw exception
     throw std::runtime_error("ERROR - Couldn't Read glReadPixel");
   }
@@ -139,7 +139,7 @@ void depth_buffer::save(const std::string &filename, const bool linear) const {
   const auto ret =
       stbi_write_bmp(filename.c_str(), _width, _height, 1, data.get());
   if (!ret) {
-    std::cerr << "ERROR - Can't save image" << std::endl;
+    LOG_ERROR << "Can't save image";
   }
 
   // Unbind framebuffer
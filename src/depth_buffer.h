@@ -23,7 +23,7 @@ public:
   // Default constructor - doesn't initialise depth buffer
   depth_buffer() {}
   // Creates a new depth buffer
-  depth_buffer(GLuint width, GLuint height) throw(...);
+  depth_buffer(GLuint width, GLuint height);
   // Default copy constructor and asignment operator
   depth_buffer(const depth_buffer &other) = default;
   depth_buffer &operator=(const depth_buffer &rhs) = default;
@@ -1,26 +1,21 @@
 #include "stdafx.h"
 
 #include "effect.h"
+#include "renderer.h"
 #include "util.h"
 
 namespace graphics_framework {
 // Helper function used to read in a file
 bool read_file(const std::string &filename, std::string &content) {
-  // Create filestream
-  std::ifstream file(filename, std::ios_base::in);
-  // Check that file exists.  If not, return false
-  if (file.bad())
+  // Open the file from a pack or map it from disk.  If it cannot be opened, return false
+  virtual_file file;
+  try {
+    file = virtual_file(filename);
+  } catch (std::exception &) {
     return false;
-
-  // File is good.  Read contents
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-
-  // Get contents from the file
-  content = buffer.str();
-
-  // Close file and return true
-  file.close();
+  }
+  // Copy the contents in one go
+  content.assign(reinterpret_cast<const char *>(file.get_data()), file.get_size());
   return true;
 }
 
@@ -28,12 +23,11 @@ bool read_file(const std::string &filename, std::string &content) {
 effect::effect() : _program(-1) {}
 
 // Adds a shader to the effect object
-void effect::add_shader(const std::string &filename, GLenum type) throw(...) {
+void effect::add_shader(const std::string &filename, GLenum type) {
   // Check file exists
   if (!check_file_exists(filename)) {
     // Failed to read file.  Display error
-    std::cerr << "ERROR - could not load shader " << filename << std::endl;
-    std::cerr << "File Does Not Exist" << std::endl;
+    LOG_ERROR << "could not load shader " << filename << ": File Does Not Exist";
     // Throw exception
     throw std::runtime_error("Error adding shader to effect");
   }
@@ -42,17 +36,21 @@ void effect::add_shader(const std::string &filename, GLenum type) throw(...) {
   // Read in contents - check if file read is OK
   if (!read_file(filename, content)) {
     // Failed to read file.  Display error
-    std::cerr << "ERROR - could not load shader " << filename << std::endl;
-    std::cerr << "Could not read shader file" << std::endl;
+    LOG_ERROR << "could not load shader " << filename << ": Could not read shader file";
     // Throw exception
     throw std::runtime_error("Error adding shader to effect");
   }
+  // Compile the source read in
+  add_shader_source(content, type, filename);
+}
+
+// Compiles shader source already read in and adds it to the effect
+void effect::add_shader_source(const std::string &content, GLenum type, const std::string &filename) {
   // Create shader with OpenGL
   auto id = glCreateShader(type);
   // Check if error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - loading shader " << filename << std::endl;
-    std::cerr << "Could not create shader object with OpenGL" << std::endl;
+    LOG_ERROR << "loading shader " << filename << ": Could not create shader object with OpenGL";
     // Throw exception
     throw std::runtime_error("Error adding shader to effect");
   }
@@ -64,8 +62,7 @@ void effect::add_shader(const std::string &filename, GLenum type) throw(...) {
   // Check if error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - could not load shader " << filename << std::endl;
-    std::cerr << "Problem attaching and compiling source" << std::endl;
+    LOG_ERROR << "could not load shader " << filename << ": Problem attaching and compiling source";
     // Throw exception
     throw std::runtime_error("Error adding shader to effect");
   }
@@ -86,9 +83,8 @@ void effect::add_shader(const std::string &filename, GLenum type) throw(...) {
     // Get the log
     glGetShaderInfoLog(id, length, &length, &log[0]);
     // Display error
-    std::cerr << "ERROR - could not load shader " << filename << std::endl;
-    std::cerr << "Could not compile shader file" << std::endl;
-    std::cerr << &log[0] << std::endl;
+    LOG_ERROR << "could not load shader " << filename << ": Could not compile shader file";
+    logger::push_lines(log_level::error, &log[0]);
     CHECK_GL_ERROR; // Not considered fatal here
     // Remove shader object from OpenGL
     glDeleteShader(id);
@@ -97,7 +93,7 @@ void effect::add_shader(const std::string &filename, GLenum type) throw(...) {
   }
 
   // Log and add to the effect shaders
-  std::clog << "LOG - " << filename << " added to effect" << std::endl;
+  LOG_INFO << filename << " added to effect";
   _shaders.push_back(id);
 }
 
@@ -109,8 +105,7 @@ void effect::add_shader(const std::vector<std::string> &filenames, GLenum type)
   for (auto &name : filenames) {
     if (!check_file_exists(name)) {
       // Failed to read file.  Display error
-      std::cerr << "ERROR - could not load shader " << name << std::endl;
-      std::cerr << "File Does Not Exist" << std::endl;
+      LOG_ERROR << "could not load shader " << name << ": File Does Not Exist";
       // Throw exception
       throw std::runtime_error("Error adding shader to effect");
     }
@@ -124,8 +119,7 @@ void effect::add_shader(const std::vector<std::string> &filenames, GLenum type)
     // Read in contents - check if file read is OK
     if (!read_file(name, content)) {
       // Failed to read file.  Display error
-      std::cerr << "ERROR - could not load shader " << name << std::endl;
-      std::cerr << "Could not read shader file" << std::endl;
+      LOG_ERROR << "could not load shader " << name << ": Could not read shader file";
       // Throw exception
       throw std::runtime_error("Error adding shader to effect");
     } else
@@ -136,10 +130,9 @@ void effect::add_shader(const std::vector<std::string> &filenames, GLenum type)
   auto id = glCreateShader(type);
   // Check if error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - loading shader:" << std::endl;
+    LOG_ERROR << "loading shader: Could not create shader object with OpenGL";
     for (auto &name : filenames)
-      std::cerr << "\t" << name << std::endl;
-    std::cerr << "Could not create shader object with OpenGL" << std::endl;
+      LOG_ERROR << "\t" << name;
     // Throw exception
     throw std::runtime_error("Error adding shader to effect");
   }
@@ -156,10 +149,9 @@ void effect::add_shader(const std::vector<std::string> &filenames, GLenum type)
   // Check if error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - loading shader:" << std::endl;
+    LOG_ERROR << "loading shader: Problem attaching and compiling source";
     for (auto &name : filenames)
-      std::cerr << "\t" << name << std::endl;
-    std::cerr << "Problem attaching and compiling source" << std::endl;
+      LOG_ERROR << "\t" << name;
     // Throw exception
     throw std::runtime_error("Error adding shader to effect");
   }
@@ -180,11 +172,10 @@ void effect::add_shader(const std::vector<std::string> &filenames, GLenum type)
     // Get the log
     glGetShaderInfoLog(id, length, &length, &log[0]);
     // Display error
-    std::cerr << "ERROR - loading shader:" << std::endl;
+    LOG_ERROR << "loading shader: Could not compile shader file";
     for (auto &name : filenames)
-      std::cerr << "\t" << name << std::endl;
-    std::cerr << "Could not compile shader file" << std::endl;
-    std::cerr << &log[0] << std::endl;
+      LOG_ERROR << "\t" << name;
+    logger::push_lines(log_level::error, &log[0]);
     CHECK_GL_ERROR; // Not considered fatal here
     // Remove shader object from OpenGL
     glDeleteShader(id);
@@ -193,25 +184,24 @@ void effect::add_shader(const std::vector<std::string> &filenames, GLenum type)
   }
 
   // Log and add to the effect shaders
-  std::clog << "LOG - " << std::endl;
   for (auto &name : filenames)
-    std::clog << "\t" << name << std::endl;
-  std::clog << " added to effect" << std::endl;
+    LOG_INFO << name << " added to effect";
   _shaders.push_back(id);
 }
 
 // Builds the effect program
-void effect::build() throw(...) {
+void effect::build() {
   // Create program
   _program = glCreateProgram();
   // Check if error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building effect" << std::endl;
-    std::cerr << "Could not create program object with OpenGL" << std::endl;
+    LOG_ERROR << "building effect: Could not create program object with OpenGL";
     // Throw exception
     throw std::runtime_error("Error creating effect with OpenGL");
   }
+  // The ID may be a deleted program's, whose uniform locations the renderer has cached
+  renderer::clear_uniform_cache(_program);
 
   for (auto &id : _shaders) {
     // Shader has been loaded.  Add to effect
@@ -219,8 +209,7 @@ void effect::build() throw(...) {
     // Check if error
     if (CHECK_GL_ERROR) {
       // Display error
-      std::cerr << "ERROR - adding shader to effect" << std::endl;
-      std::cerr << "Problem attaching shader to program" << std::endl;
+      LOG_ERROR << "adding shader to effect: Problem attaching shader to program";
       // Throw exception
       throw std::runtime_error("Error adding shader to effect");
     }
@@ -231,8 +220,7 @@ void effect::build() throw(...) {
   // Check if error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building effect " << std::endl;
-    std::cerr << "Problem linking program" << std::endl;
+    LOG_ERROR << "building effect: Problem linking program";
     // Detach and delete shaders
     for (auto &s : _shaders) {
       glDetachShader(_program, s);
@@ -259,9 +247,8 @@ void effect::build() throw(...) {
     // Get info log
     glGetProgramInfoLog(_program, length, &length, &log[0]);
     // Display error
-    std::cerr << "ERROR - building effect" << std::endl;
-    std::cerr << "Problem linking program" << std::endl;
-    std::cerr << &log[0] << std::endl;
+    LOG_ERROR << "building effect: Problem linking program";
+    logger::push_lines(log_level::error, &log[0]);
     // Detach shaders
     for (auto &s : _shaders) {
       glDetachShader(_program, s);
@@ -274,7 +261,7 @@ void effect::build() throw(...) {
   }
 
   // Effect built sucessfully.  Log
-  std::clog << "LOG - effect built" << std::endl;
+  LOG_INFO << "effect built";
 }
 
 // Gets the uniform location of the named
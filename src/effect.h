@@ -15,7 +15,7 @@ private:
 
 public:
   // Creates an effect object
-  effect() throw(...);
+  effect();
   // Default copy and assignment constructors
   effect(const effect &other) = default;
   effect &operator=(const effect &rhs) = default;
@@ -25,10 +25,13 @@ public:
   GLuint get_program() const { return _program; }
   // Adds a shader to the effect object
   void add_shader(const std::string &filename, GLenum type);
+  // Compiles shader source already read in, such as by a worker thread, and adds it to the effect.  The name is
+  // used for logging
+  void add_shader_source(const std::string &source, GLenum type, const std::string &name);
   // Adds a collection of shaders of a given type to the effect
   void add_shader(const std::vector<std::string> &filenames, GLenum type);
   // Builds the effect object
-  void build() throw(...);
+  void build();
   // Gets the location of the uniform in the shader
   GLint get_uniform_location(const std::string &name) const;
 };
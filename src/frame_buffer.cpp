@@ -1,11 +1,12 @@
 #include "stdafx.h"
 
 #include "frame_buffer.h"
+#include "gpu_memory.h"
+#include "stb_image_write.h"
 #include "util.h"
-//#include <FreeImage\FreeImage.h>
 
 namespace graphics_framework {
-frame_buffer::frame_buffer(GLuint width, GLuint height) throw(...)
+frame_buffer::frame_buffer(GLuint width, GLuint height)
     : _width(width), _height(height), _frame(texture(width, height)), _depth(texture(width, height)) {
   // The draw buffer
   static GLenum draw_buffer = GL_COLOR_ATTACHMENT0;
@@ -19,11 +20,13 @@ frame_buffer::frame_buffer(GLuint width, GLuint height) throw(...)
   // Check if any errors
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building frame buffer" << std::endl;
-    std::cerr << "Could not create image date with OpenGL" << std::endl;
+    LOG_ERROR << "building frame buffer: Could not create image date with OpenGL";
     // Throw exception
     throw std::runtime_error("Error creating texture with OpenGL");
   }
+  // Record the colour storage
+  gpu_memory::track_texture(_frame.get_id(), gpu_memory::calculate_texture_bytes(width, height, GL_RGBA, false),
+                            gpu_memory::render_target, "frame buffer colour");
 
   // Set texture properties
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -38,8 +41,7 @@ frame_buffer::frame_buffer(GLuint width, GLuint height) throw(...)
   // Check for error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building frame buffer" << std::endl;
-    std::cerr << "Could not allocate depth texture with OpenGL" << std::endl;
+    LOG_ERROR << "building frame buffer: Could not allocate depth texture with OpenGL";
     // Throw exception
     throw std::runtime_error("Error creating depth texture with OpenGL");
   }
@@ -48,11 +50,14 @@ frame_buffer::frame_buffer(GLuint width, GLuint height) throw(...)
   // Check if error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building frame buffer" << std::endl;
-    std::cerr << "Could not create depth image data with OpenGL" << std::endl;
+    LOG_ERROR << "building frame buffer: Could not create depth image data with OpenGL";
     // Throw exception
     throw std::runtime_error("Error creating depth texture with OpenGL");
   }
+  // Record the depth storage
+  gpu_memory::track_texture(_depth.get_id(),
+                            gpu_memory::calculate_texture_bytes(width, height, GL_DEPTH_COMPONENT, false),
+                            gpu_memory::depth_target, "frame buffer depth");
 
   // Set texture properties
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -68,8 +73,7 @@ frame_buffer::frame_buffer(GLuint width, GLuint height) throw(...)
   // Check for error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building frame buffer" << std::endl;
-    std::cerr << "Could not allocate frame buffer with OpenGL" << std::endl;
+    LOG_ERROR << "building frame buffer: Could not allocate frame buffer with OpenGL";
     // Delete frame buffer
     glDeleteFramebuffers(1, &_buffer);
     _buffer = 0;
@@ -83,8 +87,7 @@ frame_buffer::frame_buffer(GLuint width, GLuint height) throw(...)
   // Check for errors
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building frame buffer" << std::endl;
-    std::cerr << "Could not attach textures to frame buffer" << std::endl;
+    LOG_ERROR << "building frame buffer: Could not attach textures to frame buffer";
     // Delete frame buffer
     glDeleteFramebuffers(1, &_buffer);
     _buffer = 0;
@@ -97,8 +100,7 @@ frame_buffer::frame_buffer(GLuint width, GLuint height) throw(...)
   // Check for errors
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building frame buffer" << std::endl;
-    std::cerr << "Could not set draw buffer" << std::endl;
+    LOG_ERROR << "building frame buffer: Could not set draw buffer";
     // Delete frame buffer
     glDeleteFramebuffers(1, &_buffer);
     _buffer = 0;
@@ -111,35 +113,35 @@ frame_buffer::frame_buffer(GLuint width, GLuint height) throw(...)
   CHECK_GL_ERROR; // Non-fatal
 
   // Log
-  std::clog << "LOG - frame buffer built" << std::endl;
+  LOG_INFO << "frame buffer built";
 }
 
 // Saves the framebuffer
 void frame_buffer::save(const std::string &filename) const {
-
-  // TODO: Fix
-  return;
-  /*
-// Allocate memory to read image data into
-BYTE *data = new BYTE[4 * _width * _height];
-// Bind the frame
-glBindFramebuffer(GL_FRAMEBUFFER, _buffer);
-// Get the pixel data
-glPixelStorei(GL_PACK_ALIGNMENT, 4);
-glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, data);
-CHECK_GL_ERROR;
-// Create bitmap
-FIBITMAP *bitmap = FreeImage_ConvertFromRawBits(data, _width, _height, (unsigned
-int)(((_width * 24 + 31) / 32) * 4), 24, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK,
-FI_RGBA_BLUE_MASK);
-// Save image
-auto saved = FreeImage_Save(FIF_BMP, bitmap, filename.c_str());
-// Unload bitmap
-FreeImage_Unload(bitmap);
-// Unbind framebuffer
-glBindFramebuffer(GL_FRAMEBUFFER, 0);
-// Delete data
-delete[] data;
-*/
+  // Allocate memory to read image data into
+  std::unique_ptr<unsigned char[]> data(new unsigned char[4 * _width * _height]);
+  // Remember the current render target
+  GLint bound;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound);
+  // Bind the frame
+  glBindFramebuffer(GL_FRAMEBUFFER, _buffer);
+  // Get the pixel data
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, data.get());
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  if (CHECK_GL_ERROR) {
+    // Display error
+    LOG_ERROR << "Couldn't Read glReadPixels";
+    // Throw exception
+    throw std::runtime_error("ERROR - Couldn't Read glReadPixel");
+  }
+  // OpenGL origin is bottom left
+  stbi_flip_vertically_on_write(1);
+  const auto ret = stbi_write_png(filename.c_str(), _width, _height, 4, data.get(), 4 * _width);
+  if (!ret) {
+    LOG_ERROR << "Can't save image";
+  }
+  // Restore the previous render target
+  glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(bound));
+}
 }
-}
\ No newline at end of file
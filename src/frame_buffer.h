@@ -24,7 +24,7 @@ public:
   // Default constructor - doesn't initialise buffer
   frame_buffer() {}
   // Creates a frame buffer
-  frame_buffer(GLuint width, GLuint height) throw(...);
+  frame_buffer(GLuint width, GLuint height);
   // Default copy constructor and assignment operator
   frame_buffer(const frame_buffer &other) = default;
   frame_buffer &operator=(const frame_buffer &rhs) = default;
@@ -1,10 +1,10 @@
 #include "stdafx.h"
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
 
 #include "geometry.h"
+#include "gl_capture.h"
+#include "gpu_memory.h"
 #include "util.h"
+#include "vertex_stream.h"
 
 namespace graphics_framework {
 /*
@@ -15,113 +15,12 @@ geometry::geometry() : _type(GL_TRIANGLES), _vao(0), _index_buffer(0), _vertices
 /*
 Creates a piece of geometry by loading in a model
 */
-geometry::geometry(const std::string &filename) : geometry() {
+geometry::geometry(const std::string &filename) : geometry() { upload(mesh_data(filename)); }
 
-  // Check that file exists
-
-  if (!check_file_exists(filename)) {
-    // Failed to read file.  Display error
-    std::cerr << "ERROR - could not load model file " << filename << std::endl;
-    std::cerr << "File Does Not Exist" << std::endl;
-    // Throw exception
-    throw std::runtime_error("Error loading model file");
-  }
-
-  // Create model importer
-  Assimp::Importer model_importer;
-  // Read in the model data
-  auto sc = model_importer.ReadFile(filename,
-                                    aiProcess_Triangulate | aiProcess_GenSmoothNormals |
-                                        aiProcess_ValidateDataStructure | aiProcess_FindInvalidData);
-  // Check that data has been read in correctly
-  if (!sc) {
-    // Display error
-    std::cerr << "ERROR - loading geometry " << filename << std::endl;
-    std::cerr << model_importer.GetErrorString() << std::endl;
-    // Throw exception
-    throw std::runtime_error("Error reading in model file");
-  }
-  // TODO - read in multiple texture coordinates
-  // TODO - mesh hierarchy?
-  // TODO - bones
-  // TODO - multiple colour values
-  // Declare vectors to store data
-  std::vector<glm::vec3> positions;
-  std::vector<glm::vec4> colours;
-  std::vector<glm::vec3> normals;
-  std::vector<glm::vec2> tex_coords;
-  std::vector<GLuint> indices;
-  unsigned int vertex_begin = 0;
-  // Iterate through each sub-mesh in the model
-  for (unsigned int n = 0; n < sc->mNumMeshes; ++n) {
-    // Get the sub-mesh
-    auto mesh = sc->mMeshes[n];
-    // Iterate through all the vertices in the sub-mesh
-    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-      // Get position vertex
-      auto pos = mesh->mVertices[i];
-      // Add to positions data
-      positions.push_back(glm::vec3(pos.x, pos.y, pos.z));
-    }
-    // If we have colour data then iterate through them
-    if (mesh->HasVertexColors(0))
-      // Iterate through colour data
-      for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-        // Get the colour data from the mesh
-        auto col = mesh->mColors[0][i];
-        // Add to colour data vector
-        colours.push_back(glm::vec4(col.r, col.g, col.b, col.a));
-      }
-    // Otherwise just push back grey
-    else
-      for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
-        colours.push_back(glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
-    // If we have normals, then add to normal data
-    if (mesh->HasNormals())
-      for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-        auto norm = mesh->mNormals[i];
-        normals.push_back(glm::vec3(norm.x, norm.y, norm.z));
-      }
-    // If we have texture coordinates then add to texture coordinate data
-    if (mesh->HasTextureCoords(0))
-      for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-        auto tex_coord = mesh->mTextureCoords[0][i];
-        tex_coords.push_back(glm::vec2(tex_coord.x, tex_coord.y));
-      }
-    // If we have face information, then add to index buffer
-    if (mesh->HasFaces())
-      for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
-        auto face = mesh->mFaces[f];
-        for (auto i = 0; i < 3; ++i)
-          indices.push_back(vertex_begin + face.mIndices[i]);
-      }
-    vertex_begin += mesh->mNumVertices;
-  }
-
-  // Calculate the minimal and maximal
-  for (auto &v : positions) {
-    _minimal = glm::min(_minimal, v);
-    _maximal = glm::max(_maximal, v);
-  }
-
-  // Add the buffers to the geometry
-  add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  if (normals.size() != 0) {
-    add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-    generate_tb(normals);
-  }
-  if (tex_coords.size() != 0) {
-    add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
-  }
-  if (indices.size() != 0) {
-    add_index_buffer(indices);
-  }
-  // Log success
-  std::clog << "LOG - geometry " << filename << " loaded "
-            << (normals.size() ? "With normals & " : "With no normals & ")
-            << (tex_coords.size() ? "With UVs" : "With no UVs") << std::endl;
-}
+/*
+Creates a piece of geometry from mesh data, such as a model imported or generated on a worker thread
+*/
+geometry::geometry(mesh_data &&data) : geometry() { upload(std::move(data)); }
 
 // Move constructor
 geometry::geometry(geometry &&other) {
@@ -133,141 +32,46 @@ geometry::geometry(geometry &&other) {
   _indices = other._indices;
   _minimal = other._minimal;
   _maximal = other._maximal;
+  _components = std::move(other._components);
+  _streaming = other._streaming;
   other._buffers = std::map<GLuint, GLuint>();
 }
 
-// Adds a buffer to the geometry object
+// Adds a buffer of vec2 data to the geometry object
 bool geometry::add_buffer(const std::vector<glm::vec2> &buffer, GLuint index, GLenum buffer_type) {
-  // Check that index is viable
-  assert(index < 16);
-  // Check that buffer is not empty
   assert(buffer.size() > 0);
-  // Check if geometry initialised
-  if (_vao == 0) {
-    // Create the vertex array object
-    glGenVertexArrays(1, &_vao);
-    // Check for any OpenGL error
-    if (CHECK_GL_ERROR) {
-      // Display error
-      std::cerr << "ERROR - creating geometry" << std::endl;
-      std::cerr << "Could not generate vertex array object" << std::endl;
-      // Set vertex array object to 0
-      _vao = 0;
-      // Throw exception
-      throw std::runtime_error("Error creating vertex array object with OpenGL");
-    }
-  }
-  // If we have no vertices yet, set the vertices to the size of this buffer
-  if (_vertices == 0)
-    _vertices = static_cast<GLuint>(buffer.size());
-  // Otherwise ensure that the number of vertices matches
-  else if (_vertices != buffer.size()) {
-    std::cerr << "ERROR - adding buffer to geometry object" << std::endl;
-    std::cerr << "Buffer does not contain correct amount of vertices" << std::endl;
-    return false;
-  }
-  // Now add buffer to the vertex array object.  Bind the vertex array object
-  glBindVertexArray(_vao);
-  // Generate buffer with OpenGL
-  GLuint id;
-  glGenBuffers(1, &id);
-  glBindBuffer(GL_ARRAY_BUFFER, id);
-  // Set the buffer data
-  glBufferData(GL_ARRAY_BUFFER, buffer.size() * sizeof(glm::vec2), &buffer[0], buffer_type);
-  // Set the vertex pointer and enable
-  glVertexAttribPointer(index, 2, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(index);
-  // Check for OpenGL error
-  if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - adding buffer to geometry object" << std::endl;
-    std::cerr << "Could not create buffer with OpenGL" << std::endl;
-    return false;
-  }
-  // Add buffer to map
-  _buffers[index] = id;
-  return true;
+  return add_buffer(index, glm::value_ptr(buffer[0]), 2, static_cast<GLuint>(buffer.size()), buffer_type);
 }
 
-// Adds a buffer to the geometry object
+// Adds a buffer of vec3 data to the geometry object
 bool geometry::add_buffer(const std::vector<glm::vec3> &buffer, GLuint index, GLenum buffer_type) {
-  // Check that index is viable
-  assert(index < 16);
-  // Check that buffer is not empty
   assert(buffer.size() > 0);
-  // Check if geometry initialised
-  if (_vao == 0) {
-    // Create the vertex array object
-    glGenVertexArrays(1, &_vao);
-    // Check for any OpenGL error
-    if (CHECK_GL_ERROR) {
-      // Display error
-      std::cerr << "ERROR - creating geometry" << std::endl;
-      std::cerr << "Could not generate vertex array object" << std::endl;
-      // Set vertex array object to 0
-      _vao = 0;
-      // Throw exception
-      throw std::runtime_error("Error creating vertex array object with OpenGL");
-    }
-  }
-  // If we have no vertices yet, set the vertices to the size of this buffer
-  if (_vertices == 0)
-    _vertices = static_cast<GLuint>(buffer.size());
-  // Otherwise ensure that the number of vertices matches
-  else if (_vertices != buffer.size()) {
-    std::cerr << "ERROR - adding buffer to geometry object" << std::endl;
-    std::cerr << "Buffer does not contain correct amount of vertices" << std::endl;
-    return false;
-  }
-  // Now add buffer to the vertex array object.  Bind the vertex array object
-  glBindVertexArray(_vao);
-  // Generate buffer with OpenGL
-  GLuint id;
-  glGenBuffers(1, &id);
-  glBindBuffer(GL_ARRAY_BUFFER, id);
-  // Set the buffer data
-  glBufferData(GL_ARRAY_BUFFER, buffer.size() * sizeof(glm::vec3), &buffer[0], buffer_type);
-  // Set the vertex pointer and enable
-  glVertexAttribPointer(index, 3, GL_FLOAT, GL_FALSE, 0, 0);
-  glEnableVertexAttribArray(index);
-  // Check for OpenGL error
-  if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - adding buffer to geometry object" << std::endl;
-    std::cerr << "Could not create buffer with OpenGL" << std::endl;
-    return false;
-  }
-  // Add buffer to map
-  _buffers[index] = id;
-  return true;
+  return add_buffer(index, glm::value_ptr(buffer[0]), 3, static_cast<GLuint>(buffer.size()), buffer_type);
 }
 
-// Adds a buffer to the geometry object
+// Adds a buffer of vec4 data to the geometry object
 bool geometry::add_buffer(const std::vector<glm::vec4> &buffer, GLuint index, GLenum buffer_type) {
+  assert(buffer.size() > 0);
+  return add_buffer(index, glm::value_ptr(buffer[0]), 4, static_cast<GLuint>(buffer.size()), buffer_type);
+}
+
+// Adds a buffer of float data to the geometry object
+bool geometry::add_buffer(GLuint index, const float *data, GLint components, GLuint count, GLenum buffer_type) {
   // Check that index is viable
   assert(index < 16);
   // Check that buffer is not empty
-  assert(buffer.size() > 0);
+  assert(count > 0);
+  // Streaming data goes into this frame's section of the vertex stream
+  if (_streaming)
+    return write_stream(index, data, components, count);
   // Check if geometry initialised
-  if (_vao == 0) {
-    // Create the vertex array object
-    glGenVertexArrays(1, &_vao);
-    // Check for any OpenGL error
-    if (CHECK_GL_ERROR) {
-      // Display error
-      std::cerr << "ERROR - creating geometry" << std::endl;
-      std::cerr << "Could not generate vertex array object" << std::endl;
-      // Set vertex array object to 0
-      _vao = 0;
-      // Throw exception
-      throw std::runtime_error("Error creating vertex array object with OpenGL");
-    }
-  }
+  create_array_object();
   // If we have no vertices yet, set the vertices to the size of this buffer
   if (_vertices == 0)
-    _vertices = static_cast<GLuint>(buffer.size());
+    _vertices = count;
   // Otherwise ensure that the number of vertices matches
-  else if (_vertices != buffer.size()) {
-    std::cerr << "ERROR - adding buffer to geometry object" << std::endl;
-    std::cerr << "Buffer does not contain correct amount of vertices" << std::endl;
+  else if (_vertices != count) {
+    LOG_ERROR << "adding buffer to geometry object: Buffer does not contain correct amount of vertices";
     return false;
   }
   // Now add buffer to the vertex array object.  Bind the vertex array object
@@ -277,18 +81,23 @@ bool geometry::add_buffer(const std::vector<glm::vec4> &buffer, GLuint index, GL
   glGenBuffers(1, &id);
   glBindBuffer(GL_ARRAY_BUFFER, id);
   // Set the buffer data
-  glBufferData(GL_ARRAY_BUFFER, buffer.size() * sizeof(glm::vec4), &buffer[0], buffer_type);
+  glBufferData(GL_ARRAY_BUFFER, count * components * sizeof(float), data, buffer_type);
   // Set the vertex pointer and enable
-  glVertexAttribPointer(index, 4, GL_FLOAT, GL_FALSE, 0, 0);
+  glVertexAttribPointer(index, components, GL_FLOAT, GL_FALSE, 0, 0);
   glEnableVertexAttribArray(index);
   // Check for OpenGL error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - adding buffer to geometry object" << std::endl;
-    std::cerr << "Could not create buffer with OpenGL" << std::endl;
+    LOG_ERROR << "adding buffer to geometry object: Could not create buffer with OpenGL";
     return false;
   }
+  // Record the buffer storage
+  gpu_memory::track_buffer(id, count * components * sizeof(float), gpu_memory::vertex_buffer, get_debug_name());
+  // Let a running capture record the new buffer and layout
+  gl_capture::record_buffer_update(id);
+  gl_capture::record_layout_update(_vao);
   // Add buffer to map
   _buffers[index] = id;
+  _components[index] = components;
   return true;
 }
 
@@ -296,50 +105,189 @@ bool geometry::add_buffer(const std::vector<glm::vec4> &buffer, GLuint index, GL
 bool geometry::add_index_buffer(const std::vector<GLuint> &buffer) {
   // Check that buffer is not empty
   assert(buffer.size() > 0);
+  return add_index_buffer(&buffer[0], static_cast<GLuint>(buffer.size()));
+}
+
+// Adds an index buffer to the geometry
+bool geometry::add_index_buffer(const GLuint *data, GLuint count) {
   // Check if vertex array object is valid
   assert(_vao != 0);
   // Set indices to buffer size
-  _indices = static_cast<GLuint>(buffer.size());
+  _indices = count;
   // Bind vertex array object
   glBindVertexArray(_vao);
   // Add buffer
   glGenBuffers(1, &_index_buffer);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _index_buffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer.size() * sizeof(GLuint), &buffer[0], GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(GLuint), data, GL_STATIC_DRAW);
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "Error - adding index buffer to geometry object" << std::endl;
-    std::cerr << "Could not create buffer with OpenGL" << std::endl;
+    LOG_ERROR << "adding index buffer to geometry object: Could not create buffer with OpenGL";
     return false;
   }
+  // Record the buffer storage
+  gpu_memory::track_buffer(_index_buffer, count * sizeof(GLuint), gpu_memory::index_buffer, get_debug_name());
+  gl_capture::record_buffer_update(_index_buffer);
+  gl_capture::record_layout_update(_vao);
   return true;
 }
 
-// Generates tangents and binormals for geometry
-void geometry::generate_tb(const std::vector<glm::vec3> &normals) {
-  // Declare tangent and binormal buffers
-  std::vector<glm::vec3> tangent_data;
-  std::vector<glm::vec3> binormal_data;
-  // Iterate through each normal and generate
-  for (unsigned int i = 0; i < this->get_vertex_count(); ++i) {
-    // Determine if tangent value.  Get orthogonal with forward and up vectors
-    // Orthogonal to forward vector
-    glm::vec3 c1 = glm::cross(normals[i], glm::vec3(0.0f, 0.0f, 1.0f));
-    // Orthogonal to up vector
-    glm::vec3 c2 = glm::cross(normals[i], glm::vec3(0.0f, 1.0f, 0.0f));
-    // Determine which vector has greater length.  This will be the tangent
-    if (glm::length(c1) > glm::length(c2)) {
-      tangent_data.push_back(glm::normalize(c1));
-    } else {
-      tangent_data.push_back(glm::normalize(c2));
-    }
+// Moves mesh data to the GPU
+void geometry::upload(mesh_data &&data) {
+  assert(_buffers.empty());
+  _type = data.get_type();
+  _minimal = data.get_minimal_point();
+  _maximal = data.get_maximal_point();
+  bool ok = true;
+  // Buffers are filled straight from the mesh data, which may be a mapped cache file
+  for (auto &s : data.get_streams())
+    ok &= add_buffer(s.first, s.second.get(), s.second.components, data.get_vertex_count(), GL_STATIC_DRAW);
+  if (ok && data.get_index_count() > 0)
+    ok = add_index_buffer(data.get_index_data(), data.get_index_count());
+  if (!ok) {
+    LOG_ERROR << "uploading mesh data " << data.get_name() << ": Could not create buffers";
+    throw std::runtime_error("Error uploading mesh data");
+  }
+  if (!data.get_name().empty())
+    set_debug_name(data.get_name());
+  // The GPU holds the only copy now
+  data.clear();
+}
 
-    // Generate binormal from tangent and normal
-    binormal_data.push_back(glm::normalize(glm::cross(normals[i], tangent_data[i])));
+// Creates the vertex array object if it does not exist
+void geometry::create_array_object() {
+  if (_vao != 0)
+    return;
+  // Create the vertex array object
+  glGenVertexArrays(1, &_vao);
+  // Check for any OpenGL error
+  if (CHECK_GL_ERROR) {
+    // Display error
+    LOG_ERROR << "creating geometry: Could not generate vertex array object";
+    // Set vertex array object to 0
+    _vao = 0;
+    // Throw exception
+    throw std::runtime_error("Error creating vertex array object with OpenGL");
   }
+}
+
+// Replaces vec2 data in a buffer
+bool geometry::update_buffer(GLuint index, const std::vector<glm::vec2> &buffer, GLuint offset) {
+  assert(buffer.size() > 0);
+  return update_buffer(index, &buffer[0], 2, static_cast<GLuint>(buffer.size()), offset);
+}
+
+// Replaces vec3 data in a buffer
+bool geometry::update_buffer(GLuint index, const std::vector<glm::vec3> &buffer, GLuint offset) {
+  assert(buffer.size() > 0);
+  return update_buffer(index, &buffer[0], 3, static_cast<GLuint>(buffer.size()), offset);
+}
+
+// Replaces vec4 data in a buffer
+bool geometry::update_buffer(GLuint index, const std::vector<glm::vec4> &buffer, GLuint offset) {
+  assert(buffer.size() > 0);
+  return update_buffer(index, &buffer[0], 4, static_cast<GLuint>(buffer.size()), offset);
+}
 
+// Replaces part of a buffer with float data
+bool geometry::update_buffer(GLuint index, const void *data, GLint components, GLuint count, GLuint offset) {
+  // Check the buffer exists and holds the same type
+  auto found = _buffers.find(index);
+  if (found == _buffers.end()) {
+    LOG_ERROR << "updating geometry buffer: No buffer at index " << index;
+    return false;
+  }
+  if (_components[index] != components) {
+    LOG_ERROR << "updating geometry buffer: Buffer " << index << " has " << _components[index]
+              << " components, not " << components;
+    return false;
+  }
+  // Streaming buffers are rewritten whole each frame
+  if (_streaming) {
+    assert(offset == 0);
+    return write_stream(index, data, components, count);
+  }
+  // The update must fit in the existing buffer
+  if (offset + count > _vertices) {
+    LOG_ERROR << "updating geometry buffer: Vertices " << offset << " to " << offset + count
+              << " are past the end of the buffer";
+    return false;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, found->second);
+  glBufferSubData(GL_ARRAY_BUFFER, offset * components * sizeof(float), count * components * sizeof(float), data);
+  // Check for OpenGL error
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "updating geometry buffer: Could not update buffer with OpenGL";
+    return false;
+  }
+  gl_capture::record_buffer_update(found->second);
+  return true;
+}
+
+// Writes a buffer of float data for this frame of streaming geometry
+bool geometry::write_stream(GLuint index, const void *data, GLint components, GLuint count) {
+  create_array_object();
+  auto bytes = count * components * sizeof(float);
+  glBindVertexArray(_vao);
+  if (vertex_stream::is_available()) {
+    // Copy into the mapped ring and point the attribute at this frame's copy
+    GLuint buffer;
+    size_t offset;
+    auto target = vertex_stream::allocate(bytes, buffer, offset);
+    if (!target) {
+      LOG_ERROR << "streaming geometry: Vertex stream full.  " << bytes << " bytes do not fit in a "
+                << vertex_stream::get_section_size() << " byte frame";
+      return false;
+    }
+    memcpy(target, data, bytes);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(index, components, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<const void *>(offset));
+    _buffers[index] = buffer;
+  } else {
+    // Without buffer storage, orphan a buffer of the geometry's own so the driver does not wait for the last frame
+    auto &id = _buffers[index];
+    if (id == 0)
+      glGenBuffers(1, &id);
+    glBindBuffer(GL_ARRAY_BUFFER, id);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+    glVertexAttribPointer(index, components, GL_FLOAT, GL_FALSE, 0, 0);
+    gpu_memory::track_buffer(id, bytes, gpu_memory::vertex_buffer, get_debug_name());
+  }
+  gl_capture::record_buffer_update(_buffers[index]);
+  gl_capture::record_layout_update(_vao);
+  glEnableVertexAttribArray(index);
+  // Check for OpenGL error
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "streaming geometry: Could not write buffer with OpenGL";
+    return false;
+  }
+  _components[index] = components;
+  _vertices = count;
+  return true;
+}
+
+// Gets the name used to tag the geometry's buffers in the memory tracker
+std::string geometry::get_debug_name() const {
+  std::stringstream stream;
+  stream << "geometry " << _vao;
+  return stream.str();
+}
+
+// Names the buffers of the geometry in the memory tracker
+void geometry::set_debug_name(const std::string &name) {
+  for (auto &b : _buffers)
+    gpu_memory::set_buffer_name(b.second, name);
+  if (_index_buffer != 0)
+    gpu_memory::set_buffer_name(_index_buffer, name);
+}
+
+// Generates tangents and binormals for geometry
+void geometry::generate_tb(const std::vector<glm::vec3> &normals) {
+  std::vector<glm::vec3> tangent_data, binormal_data;
+  mesh_data::calculate_tb(normals, tangent_data, binormal_data);
   // Add the new buffers to the geometry
   this->add_buffer(tangent_data, BUFFER_INDEXES::TANGENT_BUFFER);
   this->add_buffer(binormal_data, BUFFER_INDEXES::BINORMAL_BUFFER);
 }
-}
\ No newline at end of file
+}
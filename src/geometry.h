@@ -1,37 +1,9 @@
 #pragma once
 
+#include "mesh_data.h"
 #include "stdafx.h"
 
 namespace graphics_framework {
-/*
-Enumeration describing the default buffer locations used by the render
-framework
-*/
-enum BUFFER_INDEXES {
-  // The position data
-  POSITION_BUFFER = 0,
-  // The colour data
-  COLOUR_BUFFER = 1,
-  // The surface normals
-  NORMAL_BUFFER = 2,
-  // The binormals for the surfaces
-  BINORMAL_BUFFER = 3,
-  // The tangents for the surfaces
-  TANGENT_BUFFER = 4,
-  // Texture coordinates 0
-  TEXTURE_COORDS_0 = 10,
-  // Texture coordinates 1
-  TEXTURE_COORDS_1 = 11,
-  // Texture coordinates 2
-  TEXTURE_COORDS_2 = 12,
-  // Texture coordinates 3
-  TEXTURE_COORDS_3 = 13,
-  // Texture coordinates 4
-  TEXTURE_COORDS_4 = 14,
-  // Texture coordinates 5
-  TEXTURE_COORDS_5 = 15
-};
-
 /*
 Object describing a piece of geometry
 */
@@ -53,12 +25,28 @@ private:
   glm::vec3 _minimal = glm::vec3(0.0f, 0.0f, 0.0f);
   // The maximal point of the geometry
   glm::vec3 _maximal = glm::vec3(0.0f, 0.0f, 0.0f);
+  // The number of float components of each buffer, keyed by attribute index
+  std::map<GLuint, GLint> _components;
+  // Flag determining if the vertex data is rewritten every frame
+  bool _streaming = false;
+  // Adds a buffer of float data
+  bool add_buffer(GLuint index, const float *data, GLint components, GLuint count, GLenum buffer_type);
+  // Adds an index buffer from an array
+  bool add_index_buffer(const GLuint *data, GLuint count);
+  // Creates the vertex array object if it does not exist
+  void create_array_object();
+  // Replaces part of a buffer with float data
+  bool update_buffer(GLuint index, const void *data, GLint components, GLuint count, GLuint offset);
+  // Writes a buffer of float data for this frame of streaming geometry
+  bool write_stream(GLuint index, const void *data, GLint components, GLuint count);
 
 public:
   // Creates a geometry object
-  geometry() throw(...);
+  geometry();
   // Creates a geometry object from a model file
-  explicit geometry(const std::string &filename) throw(...);
+  explicit geometry(const std::string &filename);
+  // Creates a geometry object from mesh data built on any thread
+  explicit geometry(mesh_data &&data);
   // Move constructor
   geometry(geometry &&other);
   // Default copy constructor and assignment operator
@@ -74,12 +62,16 @@ public:
   GLuint get_array_object() const { return _vao; }
   // Gets the OpenGL ID of the buffer with the given index in the geometry
   GLuint get_buffer(const GLuint idx) const { return _buffers.at(idx); }
+  // Gets the OpenGL IDs of all the buffers, keyed by attribute index
+  const std::map<GLuint, GLuint> &get_buffers() const { return _buffers; }
   // Gets the OpenGL ID of the index buffer
   GLuint get_idx_buffer() const { return _index_buffer; }
   // Gets the number of vertices in the geometry object
   GLuint get_vertex_count() const { return _vertices; }
   // Gets the number of indices in the index buffer
   GLuint get_index_count() const { return _indices; }
+  // Gets the number of float components of each buffer, keyed by attribute index
+  const std::map<GLuint, GLint> &get_components() const { return _components; }
   // Adds a buffer of vec2 data to the geometry object
   bool add_buffer(const std::vector<glm::vec2> &buffer, GLuint index, GLenum buffer_type = GL_STATIC_DRAW);
   // Adds a buffer of vec3 data to the geometry object
@@ -88,6 +80,23 @@ public:
   bool add_buffer(const std::vector<glm::vec4> &buffer, GLuint index, GLenum buffer_type = GL_STATIC_DRAW);
   // Adds an index buffer to the geometry object
   bool add_index_buffer(const std::vector<GLuint> &buffer);
+  // Moves mesh data to the GPU, adding its buffers to the geometry object.  The mesh data is left empty
+  void upload(mesh_data &&data);
+  // Replaces vec2 data in a buffer, starting at the given vertex.  The buffer keeps its size
+  bool update_buffer(GLuint index, const std::vector<glm::vec2> &buffer, GLuint offset = 0);
+  // Replaces vec3 data in a buffer, starting at the given vertex.  The buffer keeps its size
+  bool update_buffer(GLuint index, const std::vector<glm::vec3> &buffer, GLuint offset = 0);
+  // Replaces vec4 data in a buffer, starting at the given vertex.  The buffer keeps its size
+  bool update_buffer(GLuint index, const std::vector<glm::vec4> &buffer, GLuint offset = 0);
+  // Checks if the vertex data is rewritten every frame
+  bool is_streaming() const { return _streaming; }
+  // Marks the geometry as rewritten every frame, such as particles or debug lines.  Set before adding buffers.
+  // Buffers are written into the renderer's vertex stream, so every buffer must be updated each frame before the
+  // geometry is rendered.  Updates replace the whole buffer and may change the vertex count
+  void set_streaming(bool value) {
+    assert(_buffers.empty());
+    _streaming = value;
+  }
   // Gets the minimal point of the geometry
   glm::vec3 get_minimal_point() const { return _minimal; }
   // Sets the minimal point of the geometry
@@ -98,5 +107,9 @@ public:
   void set_maximal_point(const glm::vec3 &value) { _maximal = value; }
   // Recalualte tangent and binormal buffers
   void generate_tb(const std::vector<glm::vec3> &normals);
+  // Gets the default name used to tag the geometry's buffers in the memory tracker
+  std::string get_debug_name() const;
+  // Names the geometry's buffers in the memory tracker
+  void set_debug_name(const std::string &name);
 };
 }
\ No newline at end of file
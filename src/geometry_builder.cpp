@@ -43,21 +43,26 @@ glm::vec2 box_texcoords[] = {
     glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 0.0f),
     glm::vec2(0.0f, 1.0f)};
 
-// Creates box geometry
-geometry geometry_builder::create_box(const glm::vec3 &dims) {
+// Builds box mesh data
+mesh_data geometry_builder::build_box(const glm::vec3 &dims) {
   // Standard minimal and maximal
   glm::vec3 minimal(0.0f, 0.0f, 0.0f);
   glm::vec3 maximal(0.0f, 0.0f, 0.0f);
 
   // Type of geometry generated will be quads
-  geometry geom;
-  geom.set_type(GL_TRIANGLES);
+  mesh_data data;
+  data.set_type(GL_TRIANGLES);
   // Declare required buffers - positions, normals, texture coordinates and
   // colour
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> tex_coords;
   std::vector<glm::vec4> colours;
+  // Reserve the vertices generated
+  positions.reserve(36);
+  normals.reserve(36);
+  tex_coords.reserve(36);
+  colours.reserve(36);
 
   // Iterate through each position and add to buffer
   for (unsigned int i = 0; i < 36; ++i) {
@@ -73,20 +78,23 @@ geometry geometry_builder::create_box(const glm::vec3 &dims) {
     colours.push_back(glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
   }
   // Set minimal and maximal
-  geom.set_minimal_point(minimal);
-  geom.set_maximal_point(maximal);
+  data.set_minimal_point(minimal);
+  data.set_maximal_point(maximal);
 
-  // Add buffers to geometry
-  geom.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  geom.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-  geom.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  // Add buffers to the mesh
+  data.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  data.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+  data.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  data.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
   // Generate tangents and binormals
-  geom.generate_tb(normals);
+  data.generate_tb(normals);
 
-  // Return geometry
-  return std::move(geom);
+  // Name the buffers for the memory tracker
+  data.set_name("box");
+
+  // Return mesh data
+  return data;
 }
 
 // Tetrahedron data
@@ -106,17 +114,22 @@ glm::vec3 tetra_positions[12] = {
 // Texture coordinates for the tetrahedron geometry
 glm::vec2 tetra_texcoords[3] = {glm::vec2(1.0f, 0.0f), glm::vec2(0.5f, 1.0f), glm::vec2(0.0f, 0.0f)};
 
-// Creates tetrahedron geometry
-geometry geometry_builder::create_tetrahedron(const glm::vec3 &dims) {
+// Builds tetrahedron mesh data
+mesh_data geometry_builder::build_tetrahedron(const glm::vec3 &dims) {
   // Type of geometry generated will be triangles
-  geometry geom;
-  geom.set_type(GL_TRIANGLES);
+  mesh_data data;
+  data.set_type(GL_TRIANGLES);
   // Declare required buffers - positions, normals, texture coordinates and
   // colour
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> tex_coords;
   std::vector<glm::vec4> colours;
+  // Reserve the vertices generated
+  positions.reserve(12);
+  normals.reserve(12);
+  tex_coords.reserve(12);
+  colours.reserve(12);
 
   // The minimal and maximal values
   glm::vec3 minimal(0.0f, 0.0f, 0.0f);
@@ -136,8 +149,8 @@ geometry geometry_builder::create_tetrahedron(const glm::vec3 &dims) {
   }
 
   // Set minimal and maximal
-  geom.set_minimal_point(minimal);
-  geom.set_maximal_point(maximal);
+  data.set_minimal_point(minimal);
+  data.set_maximal_point(maximal);
 
   // For normals use cross product (dimensional scaling)
   for (unsigned int i = 0; i < 12; i += 3) {
@@ -159,17 +172,20 @@ geometry geometry_builder::create_tetrahedron(const glm::vec3 &dims) {
   for (unsigned int i = 0; i < 3; ++i)
     tex_coords.push_back(tetra_texcoords[i] * glm::vec2(dims.z, dims.x));
 
-  // Add buffers to geometry
-  geom.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  geom.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-  geom.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  // Add buffers to the mesh
+  data.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  data.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+  data.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  data.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
   // Generate tangent and binormal data
-  geom.generate_tb(normals);
+  data.generate_tb(normals);
+
+  // Name the buffers for the memory tracker
+  data.set_name("tetrahedron");
 
-  // Return geometry
-  return std::move(geom);
+  // Return mesh data
+  return data;
 }
 
 // Pyramid data
@@ -187,17 +203,22 @@ glm::vec3 pyramid_positions[18] = {
     // Bottom 2
     glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f)};
 
-// Creates pyramid geometry
-geometry geometry_builder::create_pyramid(const glm::vec3 &dims) {
+// Builds pyramid mesh data
+mesh_data geometry_builder::build_pyramid(const glm::vec3 &dims) {
   // Type of geometry generated will be triangles
-  geometry geom;
-  geom.set_type(GL_TRIANGLES);
+  mesh_data data;
+  data.set_type(GL_TRIANGLES);
   // Declare required buffers - positions, normals, texture coordinates and
   // colour
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> tex_coords;
   std::vector<glm::vec4> colours;
+  // Reserve the vertices generated
+  positions.reserve(18);
+  normals.reserve(18);
+  tex_coords.reserve(18);
+  colours.reserve(18);
 
   // The minimal and maximal points
   glm::vec3 minimal(0.0f, 0.0f, 0.0f);
@@ -216,8 +237,8 @@ geometry geometry_builder::create_pyramid(const glm::vec3 &dims) {
     colours.push_back(glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
   }
   // Set minimal and maximal
-  geom.set_minimal_point(minimal);
-  geom.set_maximal_point(maximal);
+  data.set_minimal_point(minimal);
+  data.set_maximal_point(maximal);
   // For normals use the cross product because of dimensional scaling
   for (unsigned int i = 0; i < 18; i += 3) {
     auto v1 = positions[i + 1] - positions[i];
@@ -244,30 +265,38 @@ geometry geometry_builder::create_pyramid(const glm::vec3 &dims) {
   tex_coords.push_back(box_texcoords[2] * glm::vec2(dims.x, dims.z));
   tex_coords.push_back(box_texcoords[3] * glm::vec2(dims.x, dims.z));
 
-  // Add buffers to geometry
-  geom.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  geom.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-  geom.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  // Add buffers to the mesh
+  data.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  data.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+  data.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  data.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
   // Generate tangent and binormal data
-  geom.generate_tb(normals);
+  data.generate_tb(normals);
 
-  // Return geometry
-  return std::move(geom);
+  // Name the buffers for the memory tracker
+  data.set_name("pyramid");
+
+  // Return mesh data
+  return data;
 }
 
-// Creates disk geometry
-geometry geometry_builder::create_disk(const unsigned int slices, const glm::vec2 &dims) {
+// Builds disk mesh data
+mesh_data geometry_builder::build_disk(const unsigned int slices, const glm::vec2 &dims) {
   // Type of geometry generated will be triangles
-  geometry geom;
-  geom.set_type(GL_TRIANGLE_FAN);
+  mesh_data data;
+  data.set_type(GL_TRIANGLE_FAN);
   // Declare required buffers - positions, normals, texture coordinates and
   // colour
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> tex_coords;
   std::vector<glm::vec4> colours;
+  // Reserve the vertices generated
+  positions.reserve(slices + 2);
+  normals.reserve(slices + 2);
+  tex_coords.reserve(slices + 2);
+  colours.reserve(slices + 2);
 
   // Minimal and maximal points
   glm::vec3 minimal(0.0f, 0.0f, 0.0f);
@@ -309,34 +338,42 @@ geometry geometry_builder::create_disk(const unsigned int slices, const glm::vec
     colours.push_back(glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
   }
   // Set minimal and maximal points
-  geom.set_minimal_point(minimal);
-  geom.set_maximal_point(maximal);
+  data.set_minimal_point(minimal);
+  data.set_maximal_point(maximal);
 
-  // Add buffers to geometry
-  geom.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  geom.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-  geom.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  // Add buffers to the mesh
+  data.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  data.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+  data.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  data.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
   // Generate tangent and binormal data
-  geom.generate_tb(normals);
+  data.generate_tb(normals);
+
+  // Name the buffers for the memory tracker
+  data.set_name("disk");
 
-  // Return geometry
-  return std::move(geom);
+  // Return mesh data
+  return data;
 }
 
-// Creates cylinder geometry
-geometry geometry_builder::create_cylinder(const unsigned int stacks, const unsigned int slices,
-                                           const glm::vec3 &dims) {
+// Builds cylinder mesh data
+mesh_data geometry_builder::build_cylinder(const unsigned int stacks, const unsigned int slices,
+                                          const glm::vec3 &dims) {
   // Type of geometry generated will be triangles
-  geometry geom;
-  geom.set_type(GL_TRIANGLES);
+  mesh_data data;
+  data.set_type(GL_TRIANGLES);
   // Declare required buffers - positions, normals, texture coordinates and
   // colour
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> tex_coords;
   std::vector<glm::vec4> colours;
+  // Reserve the vertices generated - top and bottom fans plus the sides
+  positions.reserve(6 * slices * (stacks + 1));
+  normals.reserve(6 * slices * (stacks + 1));
+  tex_coords.reserve(6 * slices * (stacks + 1));
+  colours.reserve(6 * slices * (stacks + 1));
 
   // Minimal and maximal points
   glm::vec3 minimal(0.0f, 0.0f, 0.0f);
@@ -485,32 +522,40 @@ geometry geometry_builder::create_cylinder(const unsigned int stacks, const unsi
   }
 
   // Set minimal and maximal values
-  geom.set_minimal_point(minimal);
-  geom.set_maximal_point(maximal);
+  data.set_minimal_point(minimal);
+  data.set_maximal_point(maximal);
 
-  // Add buffers to geometry
-  geom.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  geom.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-  geom.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  // Add buffers to the mesh
+  data.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  data.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+  data.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  data.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
   // Generate tangent and binormal data
-  geom.generate_tb(normals);
+  data.generate_tb(normals);
 
-  return std::move(geom);
+  // Name the buffers for the memory tracker
+  data.set_name("cylinder");
+
+  return data;
 }
 
-// Creates sphere geometry
-geometry geometry_builder::create_sphere(const unsigned int stacks, const unsigned int slices, const glm::vec3 &dims) {
+// Builds sphere mesh data
+mesh_data geometry_builder::build_sphere(const unsigned int stacks, const unsigned int slices, const glm::vec3 &dims) {
   // Type of geometry generated will be triangles
-  geometry geom;
-  geom.set_type(GL_TRIANGLES);
+  mesh_data data;
+  data.set_type(GL_TRIANGLES);
   // Declare required buffers - positions, normals, texture coordinates and
   // colour
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> tex_coords;
   std::vector<glm::vec4> colours;
+  // Reserve the vertices generated
+  positions.reserve(6 * stacks * slices);
+  normals.reserve(6 * stacks * slices);
+  tex_coords.reserve(6 * stacks * slices);
+  colours.reserve(6 * stacks * slices);
   // Minimal and maximal points
   glm::vec3 minimal(0.0f, 0.0f, 0.0f);
   glm::vec3 maximal(0.0f, 0.0f, 0.0f);
@@ -581,37 +626,45 @@ geometry geometry_builder::create_sphere(const unsigned int stacks, const unsign
   }
 
   // Add minimal and maximal points
-  geom.set_minimal_point(minimal);
-  geom.set_maximal_point(maximal);
+  data.set_minimal_point(minimal);
+  data.set_maximal_point(maximal);
 
   // Add colour data
   for (auto &v : positions)
     colours.push_back(glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
 
-  // Add buffers to geometry
-  geom.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  geom.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-  geom.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  // Add buffers to the mesh
+  data.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  data.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+  data.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  data.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
   // Generate tangent and binormal data
-  geom.generate_tb(normals);
+  data.generate_tb(normals);
+
+  // Name the buffers for the memory tracker
+  data.set_name("sphere");
 
-  return std::move(geom);
+  return data;
 }
 
-// Creates torus geometry
-geometry geometry_builder::create_torus(const unsigned int stacks, const unsigned int slices, const float ring_radius,
-                                        const float outer_radius) {
+// Builds torus mesh data
+mesh_data geometry_builder::build_torus(const unsigned int stacks, const unsigned int slices, const float ring_radius,
+                                       const float outer_radius) {
   // Type of geometry generated will be triangles
-  geometry geom;
-  geom.set_type(GL_TRIANGLES);
+  mesh_data data;
+  data.set_type(GL_TRIANGLES);
   // Declare required buffers - positions, normals, texture coordinates and
   // colour
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> tex_coords;
   std::vector<glm::vec4> colours;
+  // Reserve the vertices generated
+  positions.reserve(6 * stacks * (slices + 1));
+  normals.reserve(6 * stacks * (slices + 1));
+  tex_coords.reserve(6 * stacks * (slices + 1));
+  colours.reserve(6 * stacks * (slices + 1));
 
   // The minimal and maximal points
   glm::vec3 minimal(0.0f, 0.0f, 0.0f);
@@ -699,26 +752,29 @@ geometry geometry_builder::create_torus(const unsigned int stacks, const unsigne
   }
 
   // Set minimal and maximal values
-  geom.set_minimal_point(minimal);
-  geom.set_maximal_point(maximal);
+  data.set_minimal_point(minimal);
+  data.set_maximal_point(maximal);
 
-  // Add buffers to geometry
-  geom.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  geom.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-  geom.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  // Add buffers to the mesh
+  data.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  data.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+  data.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  data.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
   // Generate tangent and binormal data
-  geom.generate_tb(normals);
+  data.generate_tb(normals);
 
-  return std::move(geom);
+  // Name the buffers for the memory tracker
+  data.set_name("torus");
+
+  return data;
 }
 
-// Create plane geometry
-geometry geometry_builder::create_plane(const unsigned int width, const unsigned int depth, const bool subdivide) {
+// Builds plane mesh data
+mesh_data geometry_builder::build_plane(const unsigned int width, const unsigned int depth, const bool subdivide) {
   // Type of geometry generated will be triangles
-  geometry geom;
-  geom.set_type(GL_TRIANGLES);
+  mesh_data data;
+  data.set_type(GL_TRIANGLES);
   // Declare required buffers - positions, normals, texture coordinates and
   // colour
   std::vector<glm::vec3> positions;
@@ -801,19 +857,22 @@ geometry geometry_builder::create_plane(const unsigned int width, const unsigned
     }
 
     // Set minimal and maximal values
-    geom.set_minimal_point(minimal);
-    geom.set_maximal_point(maximal);
+    data.set_minimal_point(minimal);
+    data.set_maximal_point(maximal);
   }
 
-  // Add buffers to geometry
-  geom.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
-  geom.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
-  geom.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
-  geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  // Add buffers to the mesh
+  data.add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  data.add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+  data.add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  data.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
   // Generate tangent and binormal data
-  geom.generate_tb(normals);
+  data.generate_tb(normals);
+
+  // Name the buffers for the memory tracker
+  data.set_name("plane");
 
-  return std::move(geom);
+  return data;
 }
 }
\ No newline at end of file
@@ -1,32 +1,71 @@
 #pragma once
 
 #include "geometry.h"
+#include "mesh_data.h"
 #include "stdafx.h"
 
 namespace graphics_framework {
 /*
-Utility class to build basic geometry types
+Utility class to build basic geometry types.  The build functions need no
+OpenGL context, so can run on worker threads.  The create functions build
+and upload in one step.  For many spheres, tori, cylinders or planes,
+procedural_shapes generates them in the vertex shader instead
 */
 class geometry_builder {
 public:
+  // Builds box mesh data
+  static mesh_data build_box(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+  // Builds tetrahedron mesh data
+  static mesh_data build_tetrahedron(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+  // Builds pyramid mesh data
+  static mesh_data build_pyramid(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+  // Builds disk mesh data
+  static mesh_data build_disk(const unsigned int slices = 10, const glm::vec2 &dims = glm::vec2(1.0f, 1.0f));
+  // Builds cylinder mesh data
+  static mesh_data build_cylinder(const unsigned int stacks = 10, const unsigned int slices = 10,
+                                  const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+  // Builds sphere mesh data
+  static mesh_data build_sphere(const unsigned int stacks = 10, const unsigned int slices = 10,
+                                const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+  // Builds torus mesh data
+  static mesh_data build_torus(const unsigned int stacks = 10, const unsigned int slices = 10,
+                               const float ring_radius = 1.0f, const float outer_radius = 3.0f);
+  // Builds plane mesh data
+  static mesh_data build_plane(const unsigned int width = 100, const unsigned int depth = 100,
+                               const bool subdivide = false);
   // Creates box geometry
-  static geometry create_box(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+  static geometry create_box(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f)) { return geometry(build_box(dims)); }
   // Creates tetrahedron geometry
-  static geometry create_tetrahedron(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+  static geometry create_tetrahedron(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f)) {
+    return geometry(build_tetrahedron(dims));
+  }
   // Creates pyramid geometry
-  static geometry create_pyramid(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+  static geometry create_pyramid(const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f)) {
+    return geometry(build_pyramid(dims));
+  }
   // Creates disk geometry
-  static geometry create_disk(const unsigned int slices = 10, const glm::vec2 &dims = glm::vec2(1.0f, 1.0f));
+  static geometry create_disk(const unsigned int slices = 10, const glm::vec2 &dims = glm::vec2(1.0f, 1.0f)) {
+    return geometry(build_disk(slices, dims));
+  }
   // Creates cylinder geometry
   static geometry create_cylinder(const unsigned int stacks = 10, const unsigned int slices = 10,
-                                  const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+                                  const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f)) {
+    return geometry(build_cylinder(stacks, slices, dims));
+  }
   // Creates sphere geometry
   static geometry create_sphere(const unsigned int stacks = 10, const unsigned int slices = 10,
-                                const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f));
+                                const glm::vec3 &dims = glm::vec3(1.0f, 1.0f, 1.0f)) {
+    return geometry(build_sphere(stacks, slices, dims));
+  }
   // Creates torus geometry
   static geometry create_torus(const unsigned int stacks = 10, const unsigned int slices = 10,
-                               const float ring_radius = 1.0f, const float outer_radius = 3.0f);
+                               const float ring_radius = 1.0f, const float outer_radius = 3.0f) {
+    return geometry(build_torus(stacks, slices, ring_radius, outer_radius));
+  }
   // Creates plane geometry
-  static geometry create_plane(const unsigned int width = 100, const unsigned int depth = 100, const bool subdivide = false);
+  static geometry create_plane(const unsigned int width = 100, const unsigned int depth = 100,
+                               const bool subdivide = false) {
+    return geometry(build_plane(width, depth, subdivide));
+  }
 };
-}
\ No newline at end of file
+}
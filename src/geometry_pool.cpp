@@ -0,0 +1,428 @@
+#include "stdafx.h"
+
+#include "geometry_pool.h"
+#include "gl_capture.h"
+#include "gpu_memory.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+std::vector<geometry_pool::format> geometry_pool::_formats;
+size_t geometry_pool::_rebuilds = 0;
+size_t geometry_pool::_initial_vertices = 1 << 18;
+
+// Resets the allocator to a buffer with the first elements in use
+void geometry_pool::range_allocator::reset(size_t capacity, size_t used) {
+  assert(used <= capacity);
+  _free.clear();
+  _capacity = capacity;
+  _used = used;
+  if (used < capacity)
+    _free[used] = capacity - used;
+}
+
+// Allocates the first free range large enough
+bool geometry_pool::range_allocator::allocate(size_t size, size_t &start) {
+  if (size == 0) {
+    start = 0;
+    return true;
+  }
+  for (auto it = _free.begin(); it != _free.end(); ++it) {
+    if (it->second < size)
+      continue;
+    start = it->first;
+    auto remaining = it->second - size;
+    _free.erase(it);
+    if (remaining > 0)
+      _free[start + size] = remaining;
+    _used += size;
+    return true;
+  }
+  return false;
+}
+
+// Returns a range to the free list, merging it with its neighbours
+void geometry_pool::range_allocator::release(size_t start, size_t size) {
+  if (size == 0)
+    return;
+  assert(size <= _used);
+  _used -= size;
+  auto next = _free.lower_bound(start);
+  // Merge with the following range
+  if (next != _free.end() && start + size == next->first) {
+    size += next->second;
+    next = _free.erase(next);
+  }
+  // Merge with the preceding range
+  if (next != _free.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == start) {
+      prev->second += size;
+      return;
+    }
+  }
+  _free[start] = size;
+}
+
+// Gets the size of the largest free range
+size_t geometry_pool::range_allocator::get_largest_free() const {
+  size_t largest = 0;
+  for (auto &r : _free)
+    largest = std::max(largest, r.second);
+  return largest;
+}
+
+// Finds the format with the given attributes, creating it if required
+size_t geometry_pool::find_format(const std::map<GLuint, GLint> &components) {
+  for (size_t i = 0; i < _formats.size(); ++i) {
+    if (_formats[i].components == components)
+      return i;
+  }
+  format f;
+  f.components = components;
+  glGenVertexArrays(1, &f.vao);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "creating geometry pool format: Could not generate vertex array object";
+    throw std::runtime_error("Error creating vertex array object with OpenGL");
+  }
+  _formats.push_back(std::move(f));
+  auto &added = _formats.back();
+  try {
+    rebuild(added, _initial_vertices, 2 * _initial_vertices);
+  } catch (...) {
+    glDeleteVertexArrays(1, &added.vao);
+    _formats.pop_back();
+    throw;
+  }
+  LOG_DEBUG << "geometry pool format " << _formats.size() - 1 << " created with " << components.size()
+            << " attributes";
+  return _formats.size() - 1;
+}
+
+// Rebuilds a format's buffers at the given capacity, packing the live entries at the start
+void geometry_pool::rebuild(format &f, size_t vertex_capacity, size_t index_capacity) {
+  std::stringstream name;
+  name << "geometry pool " << &f - &_formats[0];
+  // Pack the live entries in their current order, keeping neighbouring geometry together
+  std::vector<entry *> by_vertex, by_index;
+  for (auto &e : f.entries) {
+    if (e.live) {
+      by_vertex.push_back(&e);
+      if (e.indices > 0)
+        by_index.push_back(&e);
+    }
+  }
+  std::sort(by_vertex.begin(), by_vertex.end(),
+            [](const entry *a, const entry *b) { return a->first_vertex < b->first_vertex; });
+  std::sort(by_index.begin(), by_index.end(),
+            [](const entry *a, const entry *b) { return a->first_index < b->first_index; });
+
+  // Copy each attribute into a new buffer.  The copies stay on the GPU
+  std::map<GLuint, GLuint> buffers;
+  size_t vertices = 0;
+  for (auto &c : f.components) {
+    auto stride = c.second * sizeof(float);
+    GLuint id;
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertex_capacity * stride, nullptr, GL_STATIC_DRAW);
+    auto old = f.buffers.find(c.first);
+    if (old != f.buffers.end()) {
+      glBindBuffer(GL_COPY_READ_BUFFER, old->second);
+      vertices = 0;
+      for (auto e : by_vertex) {
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, e->first_vertex * stride, vertices * stride,
+                            e->vertices * stride);
+        vertices += e->vertices;
+      }
+    }
+    buffers[c.first] = id;
+  }
+  GLuint index_buffer;
+  glGenBuffers(1, &index_buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, index_buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, index_capacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+  size_t indices = 0;
+  if (f.index_buffer != 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, f.index_buffer);
+    for (auto e : by_index) {
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, e->first_index * sizeof(GLuint),
+                          indices * sizeof(GLuint), e->indices * sizeof(GLuint));
+      indices += e->indices;
+    }
+  }
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rebuilding " << name.str() << ": Could not copy buffers with OpenGL";
+    for (auto &b : buffers)
+      glDeleteBuffers(1, &b.second);
+    glDeleteBuffers(1, &index_buffer);
+    throw std::runtime_error("Error rebuilding geometry pool");
+  }
+
+  // Only move the entries once the copies have succeeded
+  vertices = 0;
+  for (auto e : by_vertex) {
+    e->first_vertex = vertices;
+    vertices += e->vertices;
+  }
+  indices = 0;
+  for (auto e : by_index) {
+    e->first_index = indices;
+    indices += e->indices;
+  }
+  for (auto &b : f.buffers) {
+    glDeleteBuffers(1, &b.second);
+    gpu_memory::release_buffer(b.second);
+  }
+  if (f.index_buffer != 0) {
+    glDeleteBuffers(1, &f.index_buffer);
+    gpu_memory::release_buffer(f.index_buffer);
+  }
+  f.buffers = buffers;
+  f.index_buffer = index_buffer;
+  f.vertex_ranges.reset(vertex_capacity, vertices);
+  f.index_ranges.reset(index_capacity, indices);
+
+  // Point the shared vertex array object at the new buffers
+  glBindVertexArray(f.vao);
+  for (auto &c : f.components) {
+    glBindBuffer(GL_ARRAY_BUFFER, f.buffers[c.first]);
+    glVertexAttribPointer(c.first, c.second, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(c.first);
+    gpu_memory::track_buffer(f.buffers[c.first], vertex_capacity * c.second * sizeof(float),
+                             gpu_memory::vertex_buffer, name.str());
+  }
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, f.index_buffer);
+  // Unbind so later buffer binds do not change the shared state
+  glBindVertexArray(0);
+  gpu_memory::track_buffer(f.index_buffer, index_capacity * sizeof(GLuint), gpu_memory::index_buffer, name.str());
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rebuilding " << name.str() << ": Could not set up vertex array object";
+    throw std::runtime_error("Error rebuilding geometry pool");
+  }
+  // Let a running capture record the new buffers and layout
+  for (auto &b : f.buffers)
+    gl_capture::record_buffer_update(b.second);
+  gl_capture::record_buffer_update(f.index_buffer);
+  gl_capture::record_layout_update(f.vao);
+  ++_rebuilds;
+  LOG_DEBUG << name.str() << " rebuilt: " << vertices << " of " << vertex_capacity << " vertices, " << indices
+            << " of " << index_capacity << " indices";
+}
+
+// Allocates vertex and index ranges for an entry, rebuilding the format if required
+void geometry_pool::allocate(format &f, entry &e) {
+  if (f.vertex_ranges.allocate(e.vertices, e.first_vertex)) {
+    if (f.index_ranges.allocate(e.indices, e.first_index))
+      return;
+    f.vertex_ranges.release(e.first_vertex, e.vertices);
+  }
+  // No contiguous space.  Packing the live entries together is enough if the total free space fits, otherwise grow
+  auto grow = [](const range_allocator &r, size_t needed) {
+    if (r.get_used() + needed <= r.get_capacity())
+      return r.get_capacity();
+    return std::max(2 * r.get_capacity(), r.get_used() + needed);
+  };
+  rebuild(f, grow(f.vertex_ranges, e.vertices), grow(f.index_ranges, e.indices));
+  if (f.vertex_ranges.allocate(e.vertices, e.first_vertex)) {
+    if (f.index_ranges.allocate(e.indices, e.first_index))
+      return;
+    f.vertex_ranges.release(e.first_vertex, e.vertices);
+  }
+  LOG_ERROR << "adding geometry to pool: Could not allocate ranges after rebuilding";
+  throw std::runtime_error("Error adding geometry to pool");
+}
+
+// Gets an entry from a handle
+const geometry_pool::entry &geometry_pool::get_entry(const handle &h) {
+  if (h.format >= _formats.size() || h.entry >= _formats[h.format].entries.size() ||
+      !_formats[h.format].entries[h.entry].live) {
+    LOG_ERROR << "using pooled geometry: Handle does not refer to geometry in the pool";
+    throw std::runtime_error("Error using pooled geometry");
+  }
+  return _formats[h.format].entries[h.entry];
+}
+
+// Copies a piece of geometry into the pool
+geometry_pool::handle geometry_pool::add(const geometry &geom) {
+  if (geom.get_array_object() == 0 || geom.get_vertex_count() == 0 || geom.is_streaming()) {
+    LOG_ERROR << "adding geometry to pool: Geometry has no static buffers";
+    throw std::runtime_error("Error adding geometry to pool");
+  }
+  handle h;
+  h.format = find_format(geom.get_components());
+  auto &f = _formats[h.format];
+  entry e;
+  e.type = geom.get_type();
+  e.vertices = geom.get_vertex_count();
+  e.indices = geom.get_idx_buffer() != 0 ? geom.get_index_count() : 0;
+  allocate(f, e);
+
+  // Copy the geometry's buffers into its ranges
+  for (auto &c : f.components) {
+    auto stride = c.second * sizeof(float);
+    glBindBuffer(GL_COPY_READ_BUFFER, geom.get_buffer(c.first));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, f.buffers[c.first]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, e.first_vertex * stride, e.vertices * stride);
+  }
+  if (e.indices > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, geom.get_idx_buffer());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, f.index_buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, e.first_index * sizeof(GLuint),
+                        e.indices * sizeof(GLuint));
+  }
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "adding geometry to pool: Could not copy buffers with OpenGL";
+    f.vertex_ranges.release(e.first_vertex, e.vertices);
+    f.index_ranges.release(e.first_index, e.indices);
+    throw std::runtime_error("Error adding geometry to pool");
+  }
+  for (auto &b : f.buffers)
+    gl_capture::record_buffer_update(b.second);
+  if (e.indices > 0)
+    gl_capture::record_buffer_update(f.index_buffer);
+
+  // Reuse a removed entry if there is one
+  e.live = true;
+  if (f.free_entries.empty()) {
+    h.entry = f.entries.size();
+    f.entries.push_back(e);
+  } else {
+    h.entry = f.free_entries.back();
+    f.free_entries.pop_back();
+    f.entries[h.entry] = e;
+  }
+  return h;
+}
+
+// Releases a piece of geometry's ranges
+void geometry_pool::remove(handle &h) {
+  if (h.format >= _formats.size() || h.entry >= _formats[h.format].entries.size())
+    return;
+  auto &f = _formats[h.format];
+  auto &e = f.entries[h.entry];
+  if (e.live) {
+    f.vertex_ranges.release(e.first_vertex, e.vertices);
+    f.index_ranges.release(e.first_index, e.indices);
+    e.live = false;
+    f.free_entries.push_back(h.entry);
+  }
+  h = handle();
+}
+
+// Draws a piece of geometry
+void geometry_pool::draw(const handle &h) {
+  auto &e = get_entry(h);
+  auto &f = _formats[h.format];
+  glBindVertexArray(f.vao);
+  // Record the draw if capturing
+  if (gl_capture::is_recording())
+    gl_capture::record_draw(f.vao, f.buffers, e.indices > 0 ? f.index_buffer : 0, e.type,
+                            static_cast<GLuint>(e.indices > 0 ? e.first_index : e.first_vertex),
+                            static_cast<GLuint>(e.indices > 0 ? e.indices : e.vertices),
+                            static_cast<GLint>(e.indices > 0 ? e.first_vertex : 0));
+  if (e.indices > 0)
+    glDrawElementsBaseVertex(e.type, static_cast<GLsizei>(e.indices), GL_UNSIGNED_INT,
+                             reinterpret_cast<const void *>(e.first_index * sizeof(GLuint)),
+                             static_cast<GLint>(e.first_vertex));
+  else
+    glDrawArrays(e.type, static_cast<GLint>(e.first_vertex), static_cast<GLsizei>(e.vertices));
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rendering pooled geometry: Could not draw";
+    throw std::runtime_error("Error rendering geometry");
+  }
+}
+
+// Draws many pieces of geometry with one call per format and primitive type
+void geometry_pool::draw(const std::vector<handle> &handles) {
+  // Empty the batches.  Their storage is kept, so only a draw larger than any before allocates
+  for (auto &f : _formats)
+    for (auto &b : f.batches) {
+      b.counts.clear();
+      b.offsets.clear();
+      b.base_vertices.clear();
+    }
+  for (auto &h : handles) {
+    auto &e = get_entry(h);
+    // Geometry without indices cannot join a batch
+    if (e.indices == 0) {
+      draw(h);
+      continue;
+    }
+    // Formats rarely draw more than one primitive type, so a search is cheaper than a map
+    auto &batches = _formats[h.format].batches;
+    auto found = std::find_if(batches.begin(), batches.end(), [&](const batch &b) { return b.type == e.type; });
+    if (found == batches.end()) {
+      batch b{};
+      b.type = e.type;
+      batches.push_back(b);
+      found = batches.end() - 1;
+    }
+    found->counts.push_back(static_cast<GLsizei>(e.indices));
+    found->offsets.push_back(reinterpret_cast<const void *>(e.first_index * sizeof(GLuint)));
+    found->base_vertices.push_back(static_cast<GLint>(e.first_vertex));
+  }
+  for (auto &f : _formats)
+    for (auto &b : f.batches) {
+      if (b.counts.empty())
+        continue;
+      glBindVertexArray(f.vao);
+      // Record each piece as a draw if capturing
+      if (gl_capture::is_recording())
+        for (size_t i = 0; i < b.counts.size(); ++i)
+          gl_capture::record_draw(f.vao, f.buffers, f.index_buffer, b.type,
+                                  static_cast<GLuint>(reinterpret_cast<size_t>(b.offsets[i]) / sizeof(GLuint)),
+                                  static_cast<GLuint>(b.counts[i]), b.base_vertices[i]);
+      glMultiDrawElementsBaseVertex(b.type, &b.counts[0], GL_UNSIGNED_INT, &b.offsets[0],
+                                    static_cast<GLsizei>(b.counts.size()), &b.base_vertices[0]);
+    }
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rendering pooled geometry: Could not multi-draw";
+    throw std::runtime_error("Error rendering geometry");
+  }
+}
+
+// Packs every format's live ranges together
+void geometry_pool::compact() {
+  for (auto &f : _formats) {
+    auto &v = f.vertex_ranges;
+    auto &i = f.index_ranges;
+    // Already packed if all the free space is in one range
+    if (v.get_largest_free() == v.get_capacity() - v.get_used() &&
+        i.get_largest_free() == i.get_capacity() - i.get_used())
+      continue;
+    rebuild(f, v.get_capacity(), i.get_capacity());
+  }
+}
+
+// Deletes every buffer in the pool
+void geometry_pool::shutdown() {
+  for (auto &f : _formats) {
+    for (auto &b : f.buffers) {
+      glDeleteBuffers(1, &b.second);
+      gpu_memory::release_buffer(b.second);
+    }
+    glDeleteBuffers(1, &f.index_buffer);
+    gpu_memory::release_buffer(f.index_buffer);
+    glDeleteVertexArrays(1, &f.vao);
+  }
+  _formats.clear();
+  CHECK_GL_ERROR; // Non-fatal
+}
+
+// Gets the number of vertices in use across every format
+size_t geometry_pool::get_used_vertices() {
+  size_t total = 0;
+  for (auto &f : _formats)
+    total += f.vertex_ranges.get_used();
+  return total;
+}
+
+// Gets the number of vertices allocated across every format
+size_t geometry_pool::get_vertex_capacity() {
+  size_t total = 0;
+  for (auto &f : _formats)
+    total += f.vertex_ranges.get_capacity();
+  return total;
+}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "geometry.h"
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Static class that packs many pieces of geometry into a few large buffers.
+Geometry with the same vertex format (the same attributes with the same
+number of components) shares one buffer per attribute, one index buffer and
+one vertex array object.  Each piece is given a range of vertices and a range
+of indices from a free list, and is drawn with glDrawElementsBaseVertex, so
+draws from one format never switch vertex array object.  When a format runs
+out of contiguous space its buffers are rebuilt, packing the live ranges
+together and growing if required
+*/
+class geometry_pool {
+public:
+  // Refers to a piece of geometry in the pool.  Copyable; only the pool owns the storage
+  struct handle {
+    // The vertex format of the geometry
+    size_t format = SIZE_MAX;
+    // The entry of the geometry within its format
+    size_t entry = SIZE_MAX;
+    // Checks if the handle refers to geometry
+    bool is_valid() const { return format != SIZE_MAX; }
+  };
+
+private:
+  // Hands out ranges of a buffer, first fit, merging ranges as they are freed
+  class range_allocator {
+  private:
+    // The free ranges, size keyed by start
+    std::map<size_t, size_t> _free;
+    // The size of the buffer
+    size_t _capacity = 0;
+    // The number of elements handed out
+    size_t _used = 0;
+
+  public:
+    // Resets the allocator to a buffer with the first elements in use
+    void reset(size_t capacity, size_t used);
+    // Allocates a range.  Returns false if no free range is large enough
+    bool allocate(size_t size, size_t &start);
+    // Returns a range to the free list
+    void release(size_t start, size_t size);
+    // Gets the size of the buffer
+    size_t get_capacity() const { return _capacity; }
+    // Gets the number of elements handed out
+    size_t get_used() const { return _used; }
+    // Gets the size of the largest free range
+    size_t get_largest_free() const;
+  };
+
+  // A piece of geometry in a format's buffers
+  struct entry {
+    // The primitive type drawn
+    GLenum type = GL_TRIANGLES;
+    // The first vertex of the range, used as the base vertex
+    size_t first_vertex = 0;
+    // The number of vertices
+    size_t vertices = 0;
+    // The first index of the range
+    size_t first_index = 0;
+    // The number of indices.  0 if drawn as arrays
+    size_t indices = 0;
+    // Flag determining if the entry is in use
+    bool live = false;
+  };
+
+  // The arguments of one multi-draw, kept between draws so building them does not allocate
+  struct batch {
+    // The primitive type drawn
+    GLenum type;
+    // The number of indices of each piece
+    std::vector<GLsizei> counts;
+    // The byte offset of each piece's first index
+    std::vector<const void *> offsets;
+    // The base vertex of each piece
+    std::vector<GLint> base_vertices;
+  };
+
+  // The shared buffers of one vertex format
+  struct format {
+    // The number of float components of each attribute, keyed by attribute index
+    std::map<GLuint, GLint> components;
+    // The vertex array object shared by every entry
+    GLuint vao = 0;
+    // The attribute buffers, keyed by attribute index
+    std::map<GLuint, GLuint> buffers;
+    // The shared index buffer
+    GLuint index_buffer = 0;
+    // Hands out vertex ranges
+    range_allocator vertex_ranges;
+    // Hands out index ranges
+    range_allocator index_ranges;
+    // The entries, indexed by handle
+    std::vector<entry> entries;
+    // Entries released for reuse
+    std::vector<size_t> free_entries;
+    // The multi-draws of each primitive type, reused by every call to draw
+    std::vector<batch> batches;
+  };
+
+  // The vertex formats in use
+  static std::vector<format> _formats;
+  // The number of times buffers were rebuilt
+  static size_t _rebuilds;
+  // The vertices reserved by a new format
+  static size_t _initial_vertices;
+  // Finds the format with the given attributes, creating it if required
+  static size_t find_format(const std::map<GLuint, GLint> &components);
+  // Rebuilds a format's buffers at the given capacity, packing the live entries at the start
+  static void rebuild(format &f, size_t vertex_capacity, size_t index_capacity);
+  // Allocates vertex and index ranges for an entry, rebuilding the format if required
+  static void allocate(format &f, entry &e);
+  // Gets an entry from a handle
+  static const entry &get_entry(const handle &h);
+
+public:
+  // Copies a piece of geometry into the pool.  The copy is made on the GPU, so the geometry may be destroyed afterwards
+  static handle add(const geometry &geom);
+  // Releases a piece of geometry's ranges.  The handle is no longer valid
+  static void remove(handle &h);
+  // Binds the shared vertex array object and draws a piece of geometry
+  static void draw(const handle &h);
+  // Draws many pieces of geometry, with one glMultiDrawElementsBaseVertex per format and primitive type.  Every
+  // piece is drawn with the uniforms currently set
+  static void draw(const std::vector<handle> &handles);
+  // Packs every format's live ranges together, returning the space freed by removals to one range
+  static void compact();
+  // Deletes every buffer in the pool.  Called by the renderer on shutdown
+  static void shutdown();
+  // Sets the vertices reserved by each new format.  Indices are reserved at twice this
+  static void set_initial_vertices(size_t value) { _initial_vertices = value; }
+  // Gets the number of vertex formats in the pool
+  static size_t get_format_count() { return _formats.size(); }
+  // Gets the number of vertices in use across every format
+  static size_t get_used_vertices();
+  // Gets the number of vertices allocated across every format
+  static size_t get_vertex_capacity();
+  // Gets the number of times buffers were rebuilt to compact or grow
+  static size_t get_rebuilds() { return _rebuilds; }
+};
+}
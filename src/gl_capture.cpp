@@ -0,0 +1,501 @@
+#include "stdafx.h"
+
+#include "gl_capture.h"
+#include "renderer.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise the static capture data
+const char gl_capture::magic[8] = {'E', 'N', 'U', 'C', 'A', 'P', '\0', '\0'};
+std::string gl_capture::_filename;
+unsigned int gl_capture::_frames_remaining = 0;
+unsigned int gl_capture::_frames_recorded = 0;
+bool gl_capture::_recording = false;
+std::vector<char> gl_capture::_data;
+std::set<std::pair<GLenum, GLuint>> gl_capture::_written;
+std::set<GLuint> gl_capture::_updated;
+std::map<GLuint, std::vector<gl_capture::uniform>> gl_capture::_uniforms;
+std::map<GLuint, std::vector<GLuint>> gl_capture::_values;
+
+// Appends raw bytes to the recorded data
+void gl_capture::write(const void *data, size_t bytes) {
+  auto start = static_cast<const char *>(data);
+  _data.insert(_data.end(), start, start + bytes);
+}
+
+// Appends a length prefixed string to the recorded data
+void gl_capture::write_string(const std::string &value) {
+  write(static_cast<GLuint>(value.size()));
+  write(value.data(), value.size());
+}
+
+// Starts a capture
+void gl_capture::start(const std::string &filename, unsigned int frames) {
+  assert(frames > 0);
+  // Ignore requests while a capture is running
+  if (is_active())
+    return;
+  _filename = filename;
+  _frames_remaining = frames;
+  _frames_recorded = 0;
+  _data.clear();
+  _written.clear();
+  _updated.clear();
+  _uniforms.clear();
+  _values.clear();
+  LOG_INFO << "capturing " << frames << " frames to " << filename;
+}
+
+// Records the start of a frame
+void gl_capture::record_begin_frame() {
+  if (_frames_remaining == 0)
+    return;
+  _recording = true;
+  write(op_begin_frame);
+  // The frame starts on whatever target is currently bound
+  GLint buffer;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &buffer);
+  record_target(static_cast<GLuint>(buffer));
+}
+
+// Records the end of a frame
+void gl_capture::record_end_frame() {
+  if (!_recording)
+    return;
+  write(op_end_frame);
+  _recording = false;
+  ++_frames_recorded;
+  if (--_frames_remaining == 0)
+    finish();
+}
+
+// Records a clear of the current render target
+void gl_capture::record_clear(GLbitfield mask) {
+  GLfloat colour[4];
+  GLfloat depth;
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, colour);
+  glGetFloatv(GL_DEPTH_CLEAR_VALUE, &depth);
+  write(op_clear);
+  write(static_cast<GLuint>(mask));
+  write(colour, sizeof(colour));
+  write(depth);
+}
+
+// Records a change of render target.  The screen, or the headless target standing in for it, is recorded as 0
+void gl_capture::record_target(GLuint buffer) {
+  if (renderer::is_headless() && buffer == renderer::get_headless_target().get_buffer())
+    buffer = 0;
+  if (buffer != 0)
+    capture_frame_buffer(buffer);
+  write(op_target);
+  write(buffer);
+}
+
+// Records a draw of a piece of geometry
+void gl_capture::record_draw(const geometry &geom) {
+  auto indexed = geom.get_idx_buffer() != 0;
+  record_draw(geom.get_array_object(), geom.get_buffers(), geom.get_idx_buffer(), geom.get_type(), 0,
+              indexed ? geom.get_index_count() : geom.get_vertex_count());
+}
+
+// Records a draw of a range from a vertex array object
+void gl_capture::record_draw(GLuint vao, const std::map<GLuint, GLuint> &buffers, GLuint index_buffer, GLenum mode,
+                             GLuint first, GLuint count, GLint base_vertex) {
+  // Resources are written before the draw that uses them
+  GLint program;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+  capture_program(static_cast<GLuint>(program));
+  capture_geometry(vao, buffers, index_buffer);
+
+  // Read the current uniform values
+  auto &uniforms = _uniforms[program];
+  std::vector<GLuint> values;
+  std::vector<std::pair<GLuint, std::pair<GLenum, GLuint>>> textures;
+  GLint active_texture;
+  glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture);
+  for (auto &u : uniforms) {
+    GLuint data[16];
+    switch (get_uniform_base_type(u.type)) {
+    case GL_FLOAT:
+      glGetUniformfv(program, u.location, reinterpret_cast<GLfloat *>(data));
+      break;
+    case GL_UNSIGNED_INT:
+      glGetUniformuiv(program, u.location, data);
+      break;
+    default:
+      glGetUniformiv(program, u.location, reinterpret_cast<GLint *>(data));
+      break;
+    }
+    values.insert(values.end(), data, data + get_uniform_components(u.type));
+    // Samplers tell us which texture units the draw reads
+    auto target = get_sampler_target(u.type);
+    if (target != 0) {
+      GLint texture;
+      glActiveTexture(GL_TEXTURE0 + data[0]);
+      glGetIntegerv(target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D, &texture);
+      if (texture != 0) {
+        capture_texture(target, static_cast<GLuint>(texture));
+        textures.push_back(std::make_pair(data[0], std::make_pair(target, static_cast<GLuint>(texture))));
+      }
+    }
+  }
+  glActiveTexture(active_texture);
+
+  // Read the fixed function state
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  GLboolean depth_mask;
+  glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+  GLint cull_mode, depth_func, blend_src, blend_dst;
+  glGetIntegerv(GL_CULL_FACE_MODE, &cull_mode);
+  glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+  glGetIntegerv(GL_BLEND_SRC_RGB, &blend_src);
+  glGetIntegerv(GL_BLEND_DST_RGB, &blend_dst);
+
+  // Write the draw
+  write(op_draw);
+  write(static_cast<GLuint>(program));
+  write(vao);
+  write(mode);
+  write(static_cast<unsigned char>(index_buffer != 0));
+  write(count);
+  write(first);
+  write(base_vertex);
+  write(viewport, sizeof(viewport));
+  write(static_cast<unsigned char>(glIsEnabled(GL_DEPTH_TEST)));
+  write(static_cast<unsigned char>(glIsEnabled(GL_CULL_FACE)));
+  write(static_cast<unsigned char>(glIsEnabled(GL_BLEND)));
+  write(static_cast<unsigned char>(depth_mask));
+  write(cull_mode);
+  write(depth_func);
+  write(blend_src);
+  write(blend_dst);
+  write(static_cast<GLuint>(textures.size()));
+  for (auto &t : textures) {
+    write(t.first);
+    write(t.second.first);
+    write(t.second.second);
+  }
+  // Uniform values are only written when they have changed since the program's last draw
+  auto &last = _values[program];
+  auto changed = static_cast<unsigned char>(values != last);
+  write(changed);
+  if (changed) {
+    write(static_cast<GLuint>(values.size()));
+    if (!values.empty())
+      write(&values[0], values.size() * sizeof(GLuint));
+    last = values;
+  }
+}
+
+// Marks a buffer's contents as changed
+void gl_capture::record_buffer_update(GLuint buffer) {
+  // Buffers not yet written are read back in full when first referenced
+  if (_frames_remaining > 0 && _written.count(std::make_pair(GLenum(GL_BUFFER), buffer)))
+    _updated.insert(buffer);
+}
+
+// Marks a vertex array object's layout as changed
+void gl_capture::record_layout_update(GLuint vao) {
+  if (_frames_remaining > 0)
+    _written.erase(std::make_pair(GLenum(GL_VERTEX_ARRAY), vao));
+}
+
+// Abandons the capture
+void gl_capture::record_unsupported(const std::string &what) {
+  LOG_ERROR << "capturing to " << _filename << ": " << what << " cannot be captured.  The capture is abandoned";
+  _recording = false;
+  _frames_remaining = 0;
+  std::vector<char>().swap(_data);
+}
+
+// Records a program and its uniform table
+void gl_capture::capture_program(GLuint program) {
+  if (!_written.insert(std::make_pair(GL_PROGRAM, program)).second)
+    return;
+  // Read the shader sources
+  GLint count;
+  glGetProgramiv(program, GL_ATTACHED_SHADERS, &count);
+  std::vector<GLuint> shaders(count);
+  if (count > 0)
+    glGetAttachedShaders(program, count, &count, &shaders[0]);
+  write(op_program);
+  write(program);
+  write(static_cast<GLuint>(shaders.size()));
+  for (auto shader : shaders) {
+    GLint type, length;
+    glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+    glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &length);
+    std::vector<char> source(std::max(length, 1));
+    glGetShaderSource(shader, static_cast<GLsizei>(source.size()), &length, &source[0]);
+    write(static_cast<GLuint>(type));
+    write_string(std::string(&source[0], length));
+  }
+  // Build the uniform table, expanding arrays into their elements
+  auto &uniforms = _uniforms[program];
+  GLint active, max_length;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &active);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  std::vector<char> name(std::max(max_length, 1));
+  for (GLint i = 0; i < active; ++i) {
+    GLint size;
+    GLenum type;
+    GLsizei length;
+    glGetActiveUniform(program, i, static_cast<GLsizei>(name.size()), &length, &size, &type, &name[0]);
+    if (get_uniform_components(type) == 0)
+      continue;
+    std::string base(&name[0], length);
+    // Array names are reported as name[0]
+    auto bracket = base.rfind("[0]");
+    if (bracket != std::string::npos && bracket + 3 == base.size())
+      base = base.substr(0, bracket);
+    for (GLint element = 0; element < size; ++element) {
+      auto element_name = size > 1 ? base + "[" + std::to_string(element) + "]" : base;
+      auto location = glGetUniformLocation(program, element_name.c_str());
+      if (location != -1)
+        uniforms.push_back(uniform{element_name, type, location});
+    }
+  }
+  write(static_cast<GLuint>(uniforms.size()));
+  for (auto &u : uniforms) {
+    write_string(u.name);
+    write(u.type);
+  }
+  CHECK_GL_ERROR; // Non-fatal
+}
+
+// Records the contents of a buffer
+void gl_capture::capture_buffer(GLuint buffer) {
+  if (buffer == 0)
+    return;
+  // A buffer written before is only recorded again if it has been updated, as an update in the frame
+  auto update = !_written.insert(std::make_pair(GL_BUFFER, buffer)).second;
+  if (update && _updated.erase(buffer) == 0)
+    return;
+  // Read through the copy target so no other binding is disturbed
+  GLint previous, size;
+  glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &previous);
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+  glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+  std::vector<char> contents(size);
+  if (size > 0)
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, &contents[0]);
+  glBindBuffer(GL_COPY_READ_BUFFER, previous);
+  write(update ? op_buffer_data : op_buffer);
+  write(buffer);
+  write(static_cast<GLuint>(size));
+  if (size > 0)
+    write(&contents[0], contents.size());
+  CHECK_GL_ERROR; // Non-fatal
+}
+
+// Records the layout of a vertex array object
+void gl_capture::capture_geometry(GLuint vao, const std::map<GLuint, GLuint> &buffers, GLuint index_buffer) {
+  // A layout written before still has its buffers checked for updates
+  auto first = _written.insert(std::make_pair(GL_VERTEX_ARRAY, vao)).second;
+  if (!first && _updated.empty())
+    return;
+  for (auto &b : buffers)
+    capture_buffer(b.second);
+  capture_buffer(index_buffer);
+  if (!first)
+    return;
+  write(op_geometry);
+  write(vao);
+  write(index_buffer);
+  write(static_cast<GLuint>(buffers.size()));
+  for (auto &b : buffers) {
+    // Component count comes from the bound vertex array object
+    GLint components;
+    glGetVertexAttribiv(b.first, GL_VERTEX_ATTRIB_ARRAY_SIZE, &components);
+    write(b.first);
+    write(b.second);
+    write(static_cast<GLuint>(components));
+  }
+}
+
+// Records the contents of a texture
+void gl_capture::capture_texture(GLenum target, GLuint texture) {
+  if (!_written.insert(std::make_pair(GL_TEXTURE, texture)).second)
+    return;
+  GLint previous;
+  glGetIntegerv(target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D, &previous);
+  glBindTexture(target, texture);
+  // Level 0 describes the storage
+  auto level_target = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+  GLint width, height, internal_format;
+  glGetTexLevelParameteriv(level_target, 0, GL_TEXTURE_WIDTH, &width);
+  glGetTexLevelParameteriv(level_target, 0, GL_TEXTURE_HEIGHT, &height);
+  glGetTexLevelParameteriv(level_target, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+  GLint min_filter, mag_filter, wrap_s, wrap_t, compare_mode, compare_func;
+  glGetTexParameteriv(target, GL_TEXTURE_MIN_FILTER, &min_filter);
+  glGetTexParameteriv(target, GL_TEXTURE_MAG_FILTER, &mag_filter);
+  glGetTexParameteriv(target, GL_TEXTURE_WRAP_S, &wrap_s);
+  glGetTexParameteriv(target, GL_TEXTURE_WRAP_T, &wrap_t);
+  glGetTexParameteriv(target, GL_TEXTURE_COMPARE_MODE, &compare_mode);
+  glGetTexParameteriv(target, GL_TEXTURE_COMPARE_FUNC, &compare_func);
+  // Choose a read back format that keeps the precision of the texture
+  GLenum format = GL_RGBA, type = GL_UNSIGNED_BYTE;
+  size_t texel = 4;
+  switch (internal_format) {
+  case GL_DEPTH_COMPONENT:
+  case GL_DEPTH_COMPONENT16:
+  case GL_DEPTH_COMPONENT24:
+  case GL_DEPTH_COMPONENT32:
+  case GL_DEPTH_COMPONENT32F:
+    format = GL_DEPTH_COMPONENT;
+    type = GL_FLOAT;
+    break;
+  case GL_R16F:
+  case GL_R32F:
+  case GL_RG16F:
+  case GL_RG32F:
+  case GL_RGB16F:
+  case GL_RGB32F:
+  case GL_RGBA16F:
+  case GL_RGBA32F:
+    type = GL_FLOAT;
+    texel = 16;
+    break;
+  }
+  auto mipmaps = static_cast<unsigned char>(min_filter != GL_NEAREST && min_filter != GL_LINEAR);
+  GLuint faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+  write(op_texture);
+  write(texture);
+  write(target);
+  write(static_cast<GLuint>(internal_format));
+  write(static_cast<GLuint>(width));
+  write(static_cast<GLuint>(height));
+  write(format);
+  write(type);
+  write(mipmaps);
+  write(min_filter);
+  write(mag_filter);
+  write(wrap_s);
+  write(wrap_t);
+  write(compare_mode);
+  write(compare_func);
+  write(faces);
+  std::vector<char> pixels(static_cast<size_t>(width) * height * texel);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  for (GLuint face = 0; face < faces; ++face) {
+    if (!pixels.empty())
+      glGetTexImage(faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target, 0, format, type, &pixels[0]);
+    write(static_cast<GLuint>(pixels.size()));
+    if (!pixels.empty())
+      write(&pixels[0], pixels.size());
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glBindTexture(target, previous);
+  CHECK_GL_ERROR; // Non-fatal
+}
+
+// Records a frame buffer and its attachments.  The frame buffer must be bound
+void gl_capture::capture_frame_buffer(GLuint buffer) {
+  if (!_written.insert(std::make_pair(GL_FRAMEBUFFER, buffer)).second)
+    return;
+  // Find the attached textures
+  GLuint attachments[2] = {0, 0};
+  GLenum points[2] = {GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT};
+  for (int i = 0; i < 2; ++i) {
+    GLint type, name;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, points[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+    if (type != GL_TEXTURE)
+      continue;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, points[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &name);
+    attachments[i] = static_cast<GLuint>(name);
+    capture_texture(GL_TEXTURE_2D, attachments[i]);
+  }
+  write(op_frame_buffer);
+  write(buffer);
+  write(attachments[0]);
+  write(attachments[1]);
+}
+
+// Writes the capture file
+void gl_capture::finish() {
+  std::ofstream file(_filename, std::ios_base::out | std::ios_base::binary);
+  if (!file) {
+    LOG_ERROR << "writing capture " << _filename << ": Could not open file";
+    return;
+  }
+  GLuint header[4] = {version, _frames_recorded, renderer::get_screen_width(), renderer::get_screen_height()};
+  file.write(magic, sizeof(magic));
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  if (!_data.empty())
+    file.write(_data.data(), _data.size());
+  LOG_INFO << "captured " << _frames_recorded << " frames (" << _data.size() << " bytes) to " << _filename;
+  // Release the recorded data
+  std::vector<char>().swap(_data);
+}
+
+// Gets the number of 32 bit values held by a uniform type
+unsigned int gl_capture::get_uniform_components(GLenum type) {
+  switch (type) {
+  case GL_FLOAT:
+  case GL_INT:
+  case GL_UNSIGNED_INT:
+  case GL_BOOL:
+  case GL_SAMPLER_2D:
+  case GL_SAMPLER_2D_SHADOW:
+  case GL_SAMPLER_CUBE:
+    return 1;
+  case GL_FLOAT_VEC2:
+  case GL_INT_VEC2:
+  case GL_UNSIGNED_INT_VEC2:
+  case GL_BOOL_VEC2:
+    return 2;
+  case GL_FLOAT_VEC3:
+  case GL_INT_VEC3:
+  case GL_UNSIGNED_INT_VEC3:
+  case GL_BOOL_VEC3:
+    return 3;
+  case GL_FLOAT_VEC4:
+  case GL_INT_VEC4:
+  case GL_UNSIGNED_INT_VEC4:
+  case GL_BOOL_VEC4:
+  case GL_FLOAT_MAT2:
+    return 4;
+  case GL_FLOAT_MAT3:
+    return 9;
+  case GL_FLOAT_MAT4:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+// Gets the base type of a uniform type
+GLenum gl_capture::get_uniform_base_type(GLenum type) {
+  switch (type) {
+  case GL_FLOAT:
+  case GL_FLOAT_VEC2:
+  case GL_FLOAT_VEC3:
+  case GL_FLOAT_VEC4:
+  case GL_FLOAT_MAT2:
+  case GL_FLOAT_MAT3:
+  case GL_FLOAT_MAT4:
+    return GL_FLOAT;
+  case GL_UNSIGNED_INT:
+  case GL_UNSIGNED_INT_VEC2:
+  case GL_UNSIGNED_INT_VEC3:
+  case GL_UNSIGNED_INT_VEC4:
+    return GL_UNSIGNED_INT;
+  default:
+    return GL_INT;
+  }
+}
+
+// Gets the texture target sampled by a uniform type
+GLenum gl_capture::get_sampler_target(GLenum type) {
+  switch (type) {
+  case GL_SAMPLER_2D:
+  case GL_SAMPLER_2D_SHADOW:
+    return GL_TEXTURE_2D;
+  case GL_SAMPLER_CUBE:
+    return GL_TEXTURE_CUBE_MAP;
+  default:
+    return 0;
+  }
+}
+}
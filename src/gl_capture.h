@@ -0,0 +1,124 @@
+#pragma once
+
+#include "geometry.h"
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Static class that records the OpenGL work issued through the renderer to a
+compact binary file.  Every draw is stored with a snapshot of the program
+uniforms, bound textures and fixed function state it used.  Programs, buffers,
+textures and frame buffers are read back from OpenGL and written the first
+time a draw references them.  Buffers the framework updates during a capture
+are read back again at the next draw that references them.  Textures keep the
+contents first written.  State set by calling OpenGL directly is picked up by
+the snapshot at each draw, but clears and buffer updates made outside the
+framework are not recorded.  Captures are played back with gl_replay
+*/
+class gl_capture {
+public:
+  // The record types in a capture file
+  enum opcode : unsigned char {
+    op_program = 1,
+    op_buffer,
+    op_geometry,
+    op_texture,
+    op_frame_buffer,
+    op_begin_frame,
+    op_end_frame,
+    op_clear,
+    op_target,
+    op_draw,
+    op_buffer_data
+  };
+  // The magic number at the start of a capture file
+  static const char magic[8];
+  // The version of the capture file format.  Version 2 added draws of ranges, version 3 buffer updates
+  static const unsigned int version = 3;
+
+private:
+  // A uniform recorded from a program
+  struct uniform {
+    // The name of the uniform.  Array elements are recorded separately
+    std::string name;
+    // The type of the uniform
+    GLenum type;
+    // The location of the uniform in the captured program
+    GLint location;
+  };
+  // The file being captured to
+  static std::string _filename;
+  // The number of frames still to record
+  static unsigned int _frames_remaining;
+  // The number of frames recorded so far
+  static unsigned int _frames_recorded;
+  // Flag determining if a frame is being recorded
+  static bool _recording;
+  // The recorded data, written out when the capture completes
+  static std::vector<char> _data;
+  // The resources already written, keyed by object namespace and ID
+  static std::set<std::pair<GLenum, GLuint>> _written;
+  // The written buffers updated since, read back again when next referenced
+  static std::set<GLuint> _updated;
+  // The uniforms of each captured program
+  static std::map<GLuint, std::vector<uniform>> _uniforms;
+  // The uniform values last written for each program
+  static std::map<GLuint, std::vector<GLuint>> _values;
+  // Appends a value to the recorded data
+  template <typename T> static void write(const T &value) { write(&value, sizeof(T)); }
+  // Appends raw bytes to the recorded data
+  static void write(const void *data, size_t bytes);
+  // Appends a length prefixed string to the recorded data
+  static void write_string(const std::string &value);
+  // Records a program and its uniform table if not already written
+  static void capture_program(GLuint program);
+  // Records the contents of a buffer if not already written, or again if updated since
+  static void capture_buffer(GLuint buffer);
+  // Records the layout of a vertex array object if not already written, and any of its buffers updated since.  The
+  // vertex array object must be bound
+  static void capture_geometry(GLuint vao, const std::map<GLuint, GLuint> &buffers, GLuint index_buffer);
+  // Records the contents of a texture if not already written
+  static void capture_texture(GLenum target, GLuint texture);
+  // Records a frame buffer and its attachments if not already written
+  static void capture_frame_buffer(GLuint buffer);
+  // Writes the capture file
+  static void finish();
+
+public:
+  // Starts a capture of the given number of frames.  Recording begins with the next frame
+  static void start(const std::string &filename, unsigned int frames = 1);
+  // Checks if a capture is in progress or waiting for the next frame
+  static bool is_active() { return _frames_remaining > 0; }
+  // Checks if the current frame is being recorded
+  static bool is_recording() { return _recording; }
+  // Records the start of a frame.  Called by the renderer
+  static void record_begin_frame();
+  // Records the end of a frame.  Called by the renderer
+  static void record_end_frame();
+  // Records a clear of the current render target.  Called by the renderer
+  static void record_clear(GLbitfield mask);
+  // Records a change of render target.  Called by the renderer once the frame buffer is bound
+  static void record_target(GLuint buffer);
+  // Records a draw of a piece of geometry.  Called by the renderer once the vertex array object is bound
+  static void record_draw(const geometry &geom);
+  // Records a draw of a range from a vertex array object with one tightly packed float buffer per attribute.  Indexed
+  // draws read count indices from the first, offset by the base vertex.  Other draws read count vertices from the
+  // first.  The vertex array object must be bound.  Multi-draws are recorded as one draw per range
+  static void record_draw(GLuint vao, const std::map<GLuint, GLuint> &buffers, GLuint index_buffer, GLenum mode,
+                          GLuint first, GLuint count, GLint base_vertex = 0);
+  // Marks a buffer's contents as changed, so the next draw referencing it records them again.  Called wherever the
+  // framework creates or writes to a buffer, as OpenGL may reuse a deleted buffer's ID
+  static void record_buffer_update(GLuint buffer);
+  // Marks a vertex array object's layout as changed, so the next draw using it records the layout again.  Called
+  // wherever the framework creates or repoints a vertex array object
+  static void record_layout_update(GLuint vao);
+  // Abandons the capture, as a draw uses a vertex layout the capture format cannot describe
+  static void record_unsupported(const std::string &what);
+  // Gets the number of 32 bit values held by a uniform type.  0 if the type is not supported
+  static unsigned int get_uniform_components(GLenum type);
+  // Gets the base type of a uniform type: GL_FLOAT, GL_INT or GL_UNSIGNED_INT
+  static GLenum get_uniform_base_type(GLenum type);
+  // Gets the texture target sampled by a uniform type.  0 if the type is not a supported sampler
+  static GLenum get_sampler_target(GLenum type);
+};
+}
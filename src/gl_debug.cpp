@@ -0,0 +1,148 @@
+#include "stdafx.h"
+
+#include "gl_debug.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+#if defined(DEBUG) | defined(_DEBUG)
+gl_error_mode gl_debug::_mode = gl_error_mode::synchronous;
+#else
+gl_error_mode gl_debug::_mode = gl_error_mode::per_pass;
+#endif
+bool gl_debug::_context = false;
+const size_t gl_debug::trace_length;
+gl_debug::call_site gl_debug::_trace[gl_debug::trace_length];
+size_t gl_debug::_trace_count = 0;
+std::atomic<size_t> gl_debug::_error_count(0);
+
+// Names of the modes, for logging
+static const char *mode_name(gl_error_mode mode) {
+  switch (mode) {
+  case gl_error_mode::off:
+    return "off";
+  case gl_error_mode::callback:
+    return "callback";
+  case gl_error_mode::per_pass:
+    return "per pass";
+  default:
+    return "synchronous";
+  }
+}
+
+// Sets up error checking once a context exists
+void gl_debug::initialise() {
+  _context = true;
+  apply();
+}
+
+// Sets the mode
+void gl_debug::set_mode(gl_error_mode mode) {
+  _mode = mode;
+  if (_context)
+    apply();
+}
+
+// Sets up OpenGL debug output for the current mode
+void gl_debug::apply() {
+  // Discard errors raised before the switch so they are not blamed on the next check
+  for (unsigned int i = 0; i < 8 && glGetError() != GL_NO_ERROR; ++i)
+    ;
+  bool available = GLEW_KHR_debug || GLEW_VERSION_4_3;
+  // Debug output is used for the callback and synchronous modes
+  if (available && (_mode == gl_error_mode::callback || _mode == gl_error_mode::synchronous)) {
+    glEnable(GL_DEBUG_OUTPUT);
+    // Synchronous output delivers messages inside the offending call, so the trace is current
+    if (_mode == gl_error_mode::synchronous)
+      glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    else
+      glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(callback, nullptr);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+    // Notifications are informational and frequent
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+  } else if (available) {
+    glDebugMessageCallback(nullptr, nullptr);
+    glDisable(GL_DEBUG_OUTPUT);
+  }
+  if (!available && _mode == gl_error_mode::callback) {
+    LOG_WARNING << "KHR_debug is not available.  OpenGL errors are checked per pass instead";
+    _mode = gl_error_mode::per_pass;
+  }
+  LOG_INFO << "OpenGL error checking " << mode_name(_mode);
+}
+
+// Reads and reports every pending glGetError value
+bool gl_debug::read_errors(const char *where, const char *file, int line) {
+  bool found = false;
+  // Bounded, as a lost context can report errors indefinitely
+  for (unsigned int i = 0; i < 8; ++i) {
+    auto error = glGetError();
+    if (error == GL_NO_ERROR)
+      break;
+    if (!found) {
+      if (file)
+        LOG_ERROR << "OpenGL " << get_error_name(error) << " in " << where << " (" << file << ':' << line << ')';
+      else
+        LOG_ERROR << "OpenGL " << get_error_name(error) << " by the end of " << where;
+      log_trace(log_level::error);
+    } else
+      LOG_ERROR << "OpenGL " << get_error_name(error) << " also pending";
+    ++_error_count;
+    found = true;
+  }
+  return found;
+}
+
+// Checks for errors at a pass boundary
+bool gl_debug::check_pass(const char *pass) {
+  if (_mode != gl_error_mode::per_pass && _mode != gl_error_mode::synchronous)
+    return false;
+  return read_errors(pass, nullptr, 0);
+}
+
+// Logs the recent call sites, oldest first
+void gl_debug::log_trace(log_level level) {
+  auto count = std::min(_trace_count, trace_length);
+  if (count == 0)
+    return;
+  ENU_GFX_LOG(level) << "Recent framework OpenGL calls, oldest first:";
+  for (auto i = _trace_count - count; i < _trace_count; ++i) {
+    auto &site = _trace[i & (trace_length - 1)];
+    ENU_GFX_LOG(level) << "  " << site.function << " (" << site.file << ':' << site.line << ')';
+  }
+}
+
+// Receives KHR_debug messages
+void GLAPIENTRY gl_debug::callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                   const GLchar *message, const void *user_param) {
+  // Formatting is shared with the debug message callback
+  opengl_debug_callback(source, type, id, severity, length, message, user_param);
+  // Synchronous mode counts and traces errors at the following check instead.  Asynchronous messages may arrive on
+  // a driver thread long after the call, so the trace would not match
+  if (_mode == gl_error_mode::callback && (type == GL_DEBUG_TYPE_ERROR || type == GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR))
+    ++_error_count;
+}
+
+// Gets the name of an OpenGL error code
+const char *gl_debug::get_error_name(GLenum error) {
+  switch (error) {
+  case GL_INVALID_ENUM:
+    return "GL_INVALID_ENUM";
+  case GL_INVALID_VALUE:
+    return "GL_INVALID_VALUE";
+  case GL_INVALID_OPERATION:
+    return "GL_INVALID_OPERATION";
+  case GL_INVALID_FRAMEBUFFER_OPERATION:
+    return "GL_INVALID_FRAMEBUFFER_OPERATION";
+  case GL_OUT_OF_MEMORY:
+    return "GL_OUT_OF_MEMORY";
+  case GL_STACK_UNDERFLOW:
+    return "GL_STACK_UNDERFLOW";
+  case GL_STACK_OVERFLOW:
+    return "GL_STACK_OVERFLOW";
+  default:
+    return "unknown error";
+  }
+}
+}
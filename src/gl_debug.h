@@ -0,0 +1,85 @@
+#pragma once
+
+#include "log.h"
+#include "stdafx.h"
+
+namespace graphics_framework {
+// How OpenGL errors are detected
+enum class gl_error_mode {
+  // No checking at all
+  off,
+  // KHR_debug messages delivered asynchronously by the driver.  No glGetError calls
+  callback,
+  // glGetError once at each pass boundary: frame start, render target changes and frame end
+  per_pass,
+  // glGetError after every framework call, with synchronous debug output.  Errors throw at the call site
+  synchronous
+};
+
+/*
+Static class that selects how OpenGL errors are detected at runtime.  Every
+CHECK_GL_ERROR records its call site in a small ring so an error can be
+reported with the framework calls that led up to it.  Only synchronous mode
+calls glGetError at each check.  The other modes report errors without
+throwing, so they are safe to leave on in optimised builds.  Debug builds
+start in synchronous mode and release builds in per pass mode.  The ring is
+written by the render thread only
+*/
+class gl_debug {
+public:
+  // The number of recent call sites kept.  Must be a power of two
+  static const size_t trace_length = 32;
+
+private:
+  // A recorded call site
+  struct call_site {
+    // The function containing the check
+    const char *function;
+    // The source file containing the check
+    const char *file;
+    // The line of the check
+    int line;
+  };
+  // The current mode
+  static gl_error_mode _mode;
+  // Flag determining if a context is available to apply the mode to
+  static bool _context;
+  // The recent call sites
+  static call_site _trace[trace_length];
+  // The total number of call sites recorded
+  static size_t _trace_count;
+  // The number of errors reported
+  static std::atomic<size_t> _error_count;
+  // Sets up OpenGL debug output for the current mode
+  static void apply();
+  // Reads and reports every pending glGetError value.  Returns true if there were any
+  static bool read_errors(const char *where, const char *file, int line);
+  // Receives KHR_debug messages
+  static void GLAPIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                  const GLchar *message, const void *user_param);
+
+public:
+  // Sets up error checking once a context exists.  Called by the renderer
+  static void initialise();
+  // Gets the current mode
+  static gl_error_mode get_mode() { return _mode; }
+  // Sets the mode.  Takes effect immediately if the renderer is running
+  static void set_mode(gl_error_mode mode);
+  // Gets the number of OpenGL errors reported so far
+  static size_t get_error_count() { return _error_count.load(std::memory_order_relaxed); }
+  // Records a call site, checking for errors in synchronous mode.  Used through CHECK_GL_ERROR
+  static bool check(const char *function, const char *file, int line) {
+    auto &site = _trace[_trace_count++ & (trace_length - 1)];
+    site.function = function;
+    site.file = file;
+    site.line = line;
+    return _mode == gl_error_mode::synchronous && read_errors(function, file, line);
+  }
+  // Checks for errors at a pass boundary in per pass and synchronous modes.  Errors are logged, not thrown
+  static bool check_pass(const char *pass);
+  // Logs the recent call sites, oldest first
+  static void log_trace(log_level level);
+  // Gets the name of an OpenGL error code
+  static const char *get_error_name(GLenum error);
+};
+}
@@ -0,0 +1,421 @@
+#include "stdafx.h"
+
+#include "gl_capture.h"
+#include "gl_replay.h"
+#include "renderer.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Helper used to read values from a capture, throwing if the data runs out
+struct capture_reader {
+  // The capture data
+  const std::vector<char> &data;
+  // The current read position
+  size_t pos;
+  // Gets a pointer to the next bytes, advancing the read position
+  const char *take(size_t bytes) {
+    if (bytes > data.size() - pos) {
+      LOG_ERROR << "reading capture: Capture is truncated";
+      throw std::runtime_error("Error reading capture");
+    }
+    auto result = &data[0] + pos;
+    pos += bytes;
+    return result;
+  }
+  // Reads a value
+  template <typename T> T read() {
+    T value;
+    memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+  // Reads a length prefixed string
+  std::string read_string() {
+    auto length = read<GLuint>();
+    return std::string(take(length), length);
+  }
+  // Checks if all the data has been read
+  bool done() const { return pos >= data.size(); }
+};
+
+// Loads a capture file
+gl_replay::gl_replay(const std::string &filename) {
+  std::ifstream file(filename, std::ios_base::in | std::ios_base::binary);
+  if (!file) {
+    LOG_ERROR << "loading capture " << filename << ": File Does Not Exist";
+    throw std::runtime_error("Error loading capture");
+  }
+  std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  // Check the header
+  if (data.size() < sizeof(gl_capture::magic) ||
+      memcmp(&data[0], gl_capture::magic, sizeof(gl_capture::magic)) != 0) {
+    LOG_ERROR << "loading capture " << filename << ": File is not a capture";
+    throw std::runtime_error("Error loading capture");
+  }
+  load(data);
+  LOG_INFO << "loaded capture " << filename << " (" << get_frame_count() << " frames, " << _draws.size() << " draws)";
+}
+
+// Parses a capture, creating its resources
+void gl_replay::load(const std::vector<char> &data) {
+  capture_reader reader{data, sizeof(gl_capture::magic)};
+  auto file_version = reader.read<GLuint>();
+  if (file_version != gl_capture::version) {
+    LOG_ERROR << "loading capture: Unsupported capture version " << file_version;
+    throw std::runtime_error("Error loading capture");
+  }
+  auto frame_count = reader.read<GLuint>();
+  _width = reader.read<GLuint>();
+  _height = reader.read<GLuint>();
+  _frames.reserve(frame_count + 1);
+  // Captured program IDs map to indices into _programs
+  std::unordered_map<GLuint, size_t> program_index;
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  while (!reader.done()) {
+    auto op = reader.read<unsigned char>();
+    switch (op) {
+    case gl_capture::op_program: {
+      auto captured = reader.read<GLuint>();
+      program prog;
+      prog.id = glCreateProgram();
+      auto shader_count = reader.read<GLuint>();
+      std::vector<GLuint> shaders;
+      for (GLuint i = 0; i < shader_count; ++i) {
+        auto type = reader.read<GLuint>();
+        auto source = reader.read_string();
+        auto shader = glCreateShader(type);
+        auto source_ptr = source.c_str();
+        glShaderSource(shader, 1, &source_ptr, 0);
+        glCompileShader(shader);
+        glAttachShader(prog.id, shader);
+        shaders.push_back(shader);
+      }
+      glLinkProgram(prog.id);
+      // The program keeps the compiled code, so the shaders can go
+      for (auto shader : shaders) {
+        glDetachShader(prog.id, shader);
+        glDeleteShader(shader);
+      }
+      GLint linked;
+      glGetProgramiv(prog.id, GL_LINK_STATUS, &linked);
+      if (!linked) {
+        LOG_ERROR << "loading capture: Could not rebuild captured program " << captured;
+        throw std::runtime_error("Error loading capture");
+      }
+      auto uniform_count = reader.read<GLuint>();
+      for (GLuint i = 0; i < uniform_count; ++i) {
+        auto name = reader.read_string();
+        prog.types.push_back(reader.read<GLenum>());
+        prog.locations.push_back(glGetUniformLocation(prog.id, name.c_str()));
+      }
+      _program_ids[captured] = prog.id;
+      program_index[captured] = _programs.size();
+      _programs.push_back(prog);
+      break;
+    }
+    case gl_capture::op_buffer: {
+      auto captured = reader.read<GLuint>();
+      auto size = reader.read<GLuint>();
+      auto contents = reader.take(size);
+      GLuint id;
+      glGenBuffers(1, &id);
+      glBindBuffer(GL_ARRAY_BUFFER, id);
+      glBufferData(GL_ARRAY_BUFFER, size, contents, GL_STATIC_DRAW);
+      _buffer_ids[captured] = id;
+      break;
+    }
+    case gl_capture::op_buffer_data: {
+      buffer_update u;
+      u.id = _buffer_ids.at(reader.read<GLuint>());
+      u.size = reader.read<GLuint>();
+      u.offset = _update_data.size();
+      auto contents = reader.take(u.size);
+      _update_data.insert(_update_data.end(), contents, contents + u.size);
+      _commands.push_back(command{op, _buffer_updates.size()});
+      _buffer_updates.push_back(u);
+      break;
+    }
+    case gl_capture::op_geometry: {
+      auto captured = reader.read<GLuint>();
+      auto index_buffer = reader.read<GLuint>();
+      auto attribute_count = reader.read<GLuint>();
+      GLuint vao;
+      glGenVertexArrays(1, &vao);
+      glBindVertexArray(vao);
+      for (GLuint i = 0; i < attribute_count; ++i) {
+        auto index = reader.read<GLuint>();
+        auto buffer = reader.read<GLuint>();
+        auto components = reader.read<GLuint>();
+        glBindBuffer(GL_ARRAY_BUFFER, _buffer_ids[buffer]);
+        glVertexAttribPointer(index, components, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(index);
+      }
+      if (index_buffer != 0)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _buffer_ids[index_buffer]);
+      glBindVertexArray(0);
+      auto &mapped = _vao_ids[captured];
+      if (mapped != 0)
+        _replaced_vaos.push_back(mapped);
+      mapped = vao;
+      break;
+    }
+    case gl_capture::op_texture: {
+      auto captured = reader.read<GLuint>();
+      auto target = reader.read<GLenum>();
+      auto internal_format = reader.read<GLuint>();
+      auto width = reader.read<GLuint>();
+      auto height = reader.read<GLuint>();
+      auto format = reader.read<GLenum>();
+      auto type = reader.read<GLenum>();
+      auto mipmaps = reader.read<unsigned char>();
+      GLint params[6];
+      for (auto &p : params)
+        p = reader.read<GLint>();
+      auto faces = reader.read<GLuint>();
+      GLuint id;
+      glGenTextures(1, &id);
+      glBindTexture(target, id);
+      for (GLuint face = 0; face < faces; ++face) {
+        auto size = reader.read<GLuint>();
+        auto pixels = reader.take(size);
+        glTexImage2D(faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target, 0, internal_format, width, height, 0,
+                     format, type, size > 0 ? pixels : nullptr);
+      }
+      glTexParameteri(target, GL_TEXTURE_MIN_FILTER, params[0]);
+      glTexParameteri(target, GL_TEXTURE_MAG_FILTER, params[1]);
+      glTexParameteri(target, GL_TEXTURE_WRAP_S, params[2]);
+      glTexParameteri(target, GL_TEXTURE_WRAP_T, params[3]);
+      glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, params[4]);
+      glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, params[5]);
+      if (mipmaps)
+        glGenerateMipmap(target);
+      _texture_ids[captured] = id;
+      break;
+    }
+    case gl_capture::op_frame_buffer: {
+      auto captured = reader.read<GLuint>();
+      auto colour = reader.read<GLuint>();
+      auto depth = reader.read<GLuint>();
+      GLuint id;
+      glGenFramebuffers(1, &id);
+      glBindFramebuffer(GL_FRAMEBUFFER, id);
+      if (colour != 0)
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _texture_ids[colour], 0);
+      else {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+      }
+      if (depth != 0)
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _texture_ids[depth], 0);
+      if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        LOG_ERROR << "captured frame buffer " << captured << " is incomplete";
+      renderer::set_render_target();
+      _frame_buffer_ids[captured] = id;
+      break;
+    }
+    case gl_capture::op_begin_frame:
+      _frames.push_back(_commands.size());
+      break;
+    case gl_capture::op_end_frame:
+      break;
+    case gl_capture::op_clear: {
+      clear_call c;
+      c.mask = reader.read<GLuint>();
+      for (auto &component : c.colour)
+        component = reader.read<GLfloat>();
+      c.depth = reader.read<GLfloat>();
+      _commands.push_back(command{op, _clears.size()});
+      _clears.push_back(c);
+      break;
+    }
+    case gl_capture::op_target: {
+      auto captured = reader.read<GLuint>();
+      _commands.push_back(command{op, captured == 0 ? 0 : _frame_buffer_ids[captured]});
+      break;
+    }
+    case gl_capture::op_draw: {
+      draw_call d;
+      d.program = program_index.at(reader.read<GLuint>());
+      d.vao = _vao_ids[reader.read<GLuint>()];
+      d.mode = reader.read<GLenum>();
+      d.indexed = reader.read<unsigned char>() != 0;
+      d.count = reader.read<GLuint>();
+      d.first = reader.read<GLuint>();
+      d.base_vertex = reader.read<GLint>();
+      for (auto &v : d.viewport)
+        v = reader.read<GLint>();
+      d.depth_test = reader.read<unsigned char>() != 0;
+      d.cull_face = reader.read<unsigned char>() != 0;
+      d.blend = reader.read<unsigned char>() != 0;
+      d.depth_mask = reader.read<unsigned char>() != 0;
+      d.cull_mode = reader.read<GLint>();
+      d.depth_func = reader.read<GLint>();
+      d.blend_src = reader.read<GLint>();
+      d.blend_dst = reader.read<GLint>();
+      d.first_texture = _textures.size();
+      d.texture_count = reader.read<GLuint>();
+      for (size_t i = 0; i < d.texture_count; ++i) {
+        texture_binding t;
+        t.unit = reader.read<GLuint>();
+        t.target = reader.read<GLenum>();
+        t.id = _texture_ids[reader.read<GLuint>()];
+        _textures.push_back(t);
+      }
+      d.uniforms = -1;
+      if (reader.read<unsigned char>()) {
+        auto count = reader.read<GLuint>();
+        d.uniforms = static_cast<long long>(_values.size());
+        for (GLuint i = 0; i < count; ++i)
+          _values.push_back(reader.read<GLuint>());
+      }
+      _commands.push_back(command{op, _draws.size()});
+      _draws.push_back(d);
+      break;
+    }
+    default:
+      LOG_ERROR << "loading capture: Unknown record type " << static_cast<int>(op);
+      throw std::runtime_error("Error loading capture");
+    }
+  }
+  _frames.push_back(_commands.size());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "loading capture: Could not recreate captured resources";
+    throw std::runtime_error("Error loading capture");
+  }
+}
+
+// Deletes the recreated OpenGL objects
+gl_replay::~gl_replay() {
+  for (auto &p : _program_ids)
+    glDeleteProgram(p.second);
+  for (auto &b : _buffer_ids)
+    glDeleteBuffers(1, &b.second);
+  for (auto &v : _vao_ids)
+    glDeleteVertexArrays(1, &v.second);
+  for (auto &v : _replaced_vaos)
+    glDeleteVertexArrays(1, &v);
+  for (auto &t : _texture_ids)
+    glDeleteTextures(1, &t.second);
+  for (auto &f : _frame_buffer_ids)
+    glDeleteFramebuffers(1, &f.second);
+}
+
+// Sets the uniform values of a draw
+void gl_replay::apply_uniforms(const program &prog, const GLuint *values) const {
+  for (size_t i = 0; i < prog.types.size(); ++i) {
+    auto location = prog.locations[i];
+    auto f = reinterpret_cast<const GLfloat *>(values);
+    auto n = reinterpret_cast<const GLint *>(values);
+    switch (prog.types[i]) {
+    case GL_FLOAT:
+      glUniform1fv(location, 1, f);
+      break;
+    case GL_FLOAT_VEC2:
+      glUniform2fv(location, 1, f);
+      break;
+    case GL_FLOAT_VEC3:
+      glUniform3fv(location, 1, f);
+      break;
+    case GL_FLOAT_VEC4:
+      glUniform4fv(location, 1, f);
+      break;
+    case GL_FLOAT_MAT2:
+      glUniformMatrix2fv(location, 1, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT3:
+      glUniformMatrix3fv(location, 1, GL_FALSE, f);
+      break;
+    case GL_FLOAT_MAT4:
+      glUniformMatrix4fv(location, 1, GL_FALSE, f);
+      break;
+    case GL_UNSIGNED_INT:
+      glUniform1uiv(location, 1, values);
+      break;
+    case GL_UNSIGNED_INT_VEC2:
+      glUniform2uiv(location, 1, values);
+      break;
+    case GL_UNSIGNED_INT_VEC3:
+      glUniform3uiv(location, 1, values);
+      break;
+    case GL_UNSIGNED_INT_VEC4:
+      glUniform4uiv(location, 1, values);
+      break;
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:
+      glUniform2iv(location, 1, n);
+      break;
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:
+      glUniform3iv(location, 1, n);
+      break;
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:
+      glUniform4iv(location, 1, n);
+      break;
+    default:
+      // Ints, bools and samplers
+      glUniform1iv(location, 1, n);
+      break;
+    }
+    values += gl_capture::get_uniform_components(prog.types[i]);
+  }
+}
+
+// Plays a single frame
+void gl_replay::play_frame(size_t frame) const {
+  assert(frame < get_frame_count());
+  for (auto c = _frames[frame]; c < _frames[frame + 1]; ++c) {
+    auto &cmd = _commands[c];
+    switch (cmd.op) {
+    case gl_capture::op_clear: {
+      auto &clear = _clears[cmd.index];
+      glClearColor(clear.colour[0], clear.colour[1], clear.colour[2], clear.colour[3]);
+      glClearDepth(clear.depth);
+      glDepthMask(GL_TRUE);
+      glClear(clear.mask);
+      break;
+    }
+    case gl_capture::op_target:
+      if (cmd.index == 0)
+        renderer::set_render_target();
+      else
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(cmd.index));
+      break;
+    case gl_capture::op_buffer_data: {
+      // Respecified whole, as the size may have changed
+      auto &u = _buffer_updates[cmd.index];
+      glBindBuffer(GL_COPY_WRITE_BUFFER, u.id);
+      glBufferData(GL_COPY_WRITE_BUFFER, u.size, u.size > 0 ? &_update_data[u.offset] : nullptr, GL_DYNAMIC_DRAW);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      break;
+    }
+    case gl_capture::op_draw: {
+      auto &d = _draws[cmd.index];
+      auto &prog = _programs[d.program];
+      glUseProgram(prog.id);
+      if (d.uniforms >= 0)
+        apply_uniforms(prog, &_values[static_cast<size_t>(d.uniforms)]);
+      glViewport(d.viewport[0], d.viewport[1], d.viewport[2], d.viewport[3]);
+      d.depth_test ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+      d.cull_face ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+      d.blend ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+      glDepthMask(d.depth_mask ? GL_TRUE : GL_FALSE);
+      glCullFace(d.cull_mode);
+      glDepthFunc(d.depth_func);
+      glBlendFunc(d.blend_src, d.blend_dst);
+      for (auto t = d.first_texture; t < d.first_texture + d.texture_count; ++t) {
+        glActiveTexture(GL_TEXTURE0 + _textures[t].unit);
+        glBindTexture(_textures[t].target, _textures[t].id);
+      }
+      glBindVertexArray(d.vao);
+      if (d.indexed)
+        glDrawElementsBaseVertex(d.mode, d.count, GL_UNSIGNED_INT,
+                                 reinterpret_cast<const void *>(size_t(d.first) * sizeof(GLuint)), d.base_vertex);
+      else
+        glDrawArrays(d.mode, static_cast<GLint>(d.first), d.count);
+      break;
+    }
+    }
+  }
+}
+}
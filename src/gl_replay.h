@@ -0,0 +1,135 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Plays back a capture written by gl_capture.  Loading recreates every captured
+program, buffer, texture and frame buffer, so playing a frame issues only the
+recorded state changes, clears, buffer updates and draws.  Screen targets are
+redirected to the renderer's current screen target.  Buffer updates stay in
+place once played, so a frame played after a later one draws with the later
+contents of any buffer updated in between
+*/
+class gl_replay {
+private:
+  // A program recreated from the capture
+  struct program {
+    // The OpenGL ID of the program
+    GLuint id;
+    // The location of each recorded uniform
+    std::vector<GLint> locations;
+    // The type of each recorded uniform
+    std::vector<GLenum> types;
+  };
+  // A recorded clear
+  struct clear_call {
+    // The buffers cleared
+    GLbitfield mask;
+    // The clear colour
+    GLfloat colour[4];
+    // The clear depth
+    GLfloat depth;
+  };
+  // A texture bound for a draw
+  struct texture_binding {
+    // The texture unit
+    GLuint unit;
+    // The texture target
+    GLenum target;
+    // The OpenGL ID of the texture
+    GLuint id;
+  };
+  // A recorded draw
+  struct draw_call {
+    // Index of the program used
+    size_t program;
+    // The OpenGL ID of the vertex array object
+    GLuint vao;
+    // The primitive type drawn
+    GLenum mode;
+    // The number of indices or vertices drawn
+    GLsizei count;
+    // The first index or vertex drawn
+    GLuint first;
+    // The value added to each index
+    GLint base_vertex;
+    // Whether the draw uses an index buffer
+    bool indexed;
+    // The viewport
+    GLint viewport[4];
+    // Enabled state
+    bool depth_test, cull_face, blend, depth_mask;
+    // Fixed function parameters
+    GLenum cull_mode, depth_func, blend_src, blend_dst;
+    // Range of texture bindings used
+    size_t first_texture, texture_count;
+    // Offset of the uniform values to set, or -1 if unchanged
+    long long uniforms;
+  };
+  // A recorded buffer update
+  struct buffer_update {
+    // The OpenGL ID of the buffer
+    GLuint id;
+    // Offset of the new contents in the update data
+    size_t offset;
+    // The size of the new contents in bytes
+    GLuint size;
+  };
+  // A command in a frame
+  struct command {
+    // The type of the command
+    unsigned char op;
+    // Index of the command data, or the frame buffer ID for target changes
+    size_t index;
+  };
+  // The dimensions the capture was made at
+  GLuint _width = 0, _height = 0;
+  // The recreated programs
+  std::vector<program> _programs;
+  // The commands in all frames
+  std::vector<command> _commands;
+  // Index of the first command of each frame, plus the end
+  std::vector<size_t> _frames;
+  // The recorded clears
+  std::vector<clear_call> _clears;
+  // The recorded draws
+  std::vector<draw_call> _draws;
+  // The recorded buffer updates
+  std::vector<buffer_update> _buffer_updates;
+  // The contents of all buffer updates
+  std::vector<char> _update_data;
+  // The texture bindings of all draws
+  std::vector<texture_binding> _textures;
+  // The uniform values of all draws
+  std::vector<GLuint> _values;
+  // Mappings from captured IDs to recreated IDs
+  std::unordered_map<GLuint, GLuint> _program_ids, _buffer_ids, _vao_ids, _texture_ids, _frame_buffer_ids;
+  // Recreated vertex array objects whose captured ID was given a new layout later in the capture.  Earlier draws
+  // still use them
+  std::vector<GLuint> _replaced_vaos;
+  // Parses a capture, creating its resources
+  void load(const std::vector<char> &data);
+  // Sets the uniform values of a draw
+  void apply_uniforms(const program &prog, const GLuint *values) const;
+
+public:
+  // Loads a capture file.  Requires a running renderer
+  explicit gl_replay(const std::string &filename);
+  // Copying would share the recreated OpenGL objects
+  gl_replay(const gl_replay &other) = delete;
+  gl_replay &operator=(const gl_replay &rhs) = delete;
+  // Destroys the replay, deleting the recreated OpenGL objects
+  ~gl_replay();
+  // Gets the number of frames in the capture
+  size_t get_frame_count() const { return _frames.empty() ? 0 : _frames.size() - 1; }
+  // Gets the number of draws in the capture
+  size_t get_draw_count() const { return _draws.size(); }
+  // Gets the width of the screen the capture was made on
+  GLuint get_width() const { return _width; }
+  // Gets the height of the screen the capture was made on
+  GLuint get_height() const { return _height; }
+  // Plays a single frame
+  void play_frame(size_t frame) const;
+};
+}
@@ -0,0 +1,171 @@
+#include "stdafx.h"
+
+#include "gpu_memory.h"
+
+namespace graphics_framework {
+// Initialise the static tracking data
+std::map<std::pair<GLenum, GLuint>, gpu_memory::allocation> gpu_memory::_allocations;
+std::array<size_t, gpu_memory::num_categories> gpu_memory::_totals = {};
+std::array<size_t, gpu_memory::num_categories> gpu_memory::_peaks = {};
+size_t gpu_memory::_total = 0;
+size_t gpu_memory::_peak = 0;
+
+// Records an allocation
+void gpu_memory::record(GLenum object_type, GLuint id, size_t bytes, category cat, const std::string &name) {
+  // Storage can be respecified for an existing ID, so remove the old size first
+  auto key = std::make_pair(object_type, id);
+  auto found = _allocations.find(key);
+  if (found != _allocations.end()) {
+    _totals[found->second.cat] -= found->second.bytes;
+    _total -= found->second.bytes;
+    // Keep the existing name if none provided
+    auto old_name = found->second.name;
+    found->second = allocation{object_type, id, bytes, cat, name.empty() ? old_name : name};
+  } else
+    _allocations[key] = allocation{object_type, id, bytes, cat, name};
+  // Update totals and peaks
+  _totals[cat] += bytes;
+  _total += bytes;
+  _peaks[cat] = std::max(_peaks[cat], _totals[cat]);
+  _peak = std::max(_peak, _total);
+}
+
+// Helper function to remove an allocation
+static void release(std::map<std::pair<GLenum, GLuint>, gpu_memory::allocation> &allocations,
+                    std::array<size_t, gpu_memory::num_categories> &totals, size_t &total, GLenum object_type,
+                    GLuint id) {
+  auto found = allocations.find(std::make_pair(object_type, id));
+  if (found == allocations.end())
+    return;
+  totals[found->second.cat] -= found->second.bytes;
+  total -= found->second.bytes;
+  allocations.erase(found);
+}
+
+// Removes a buffer object from the tracker
+void gpu_memory::release_buffer(GLuint id) { release(_allocations, _totals, _total, GL_BUFFER, id); }
+
+// Removes a texture object from the tracker
+void gpu_memory::release_texture(GLuint id) { release(_allocations, _totals, _total, GL_TEXTURE, id); }
+
+// Renames a tracked buffer object
+void gpu_memory::set_buffer_name(GLuint id, const std::string &name) {
+  auto found = _allocations.find(std::make_pair(GL_BUFFER, id));
+  if (found != _allocations.end())
+    found->second.name = name;
+}
+
+// Renames a tracked texture object
+void gpu_memory::set_texture_name(GLuint id, const std::string &name) {
+  auto found = _allocations.find(std::make_pair(GL_TEXTURE, id));
+  if (found != _allocations.end())
+    found->second.name = name;
+}
+
+// Gets the size of a tracked texture
+size_t gpu_memory::get_texture_bytes(GLuint id) {
+  auto found = _allocations.find(std::make_pair(GL_TEXTURE, id));
+  return found == _allocations.end() ? 0 : found->second.bytes;
+}
+
+// Gets the live allocations sorted by size
+std::vector<gpu_memory::allocation> gpu_memory::get_allocations() {
+  std::vector<allocation> result;
+  result.reserve(_allocations.size());
+  for (auto &a : _allocations)
+    result.push_back(a.second);
+  std::sort(result.begin(), result.end(),
+            [](const allocation &lhs, const allocation &rhs) { return lhs.bytes > rhs.bytes; });
+  return result;
+}
+
+// Writes a report of the tracked memory
+void gpu_memory::dump(std::ostream &os) {
+  const double mb = 1024.0 * 1024.0;
+  os << std::fixed << std::setprecision(2);
+  os << "GPU memory: " << _total / mb << " MB allocated, " << _peak / mb << " MB peak" << std::endl;
+  for (int c = 0; c < num_categories; ++c)
+    os << "  " << std::left << std::setw(16) << get_category_name(static_cast<category>(c)) << std::right
+       << std::setw(10) << _totals[c] / mb << " MB  (peak " << _peaks[c] / mb << " MB)" << std::endl;
+  os << "Allocations:" << std::endl;
+  for (auto &a : get_allocations())
+    os << "  " << std::setw(10) << a.bytes / mb << " MB  " << std::left << std::setw(16)
+       << get_category_name(a.cat) << std::right << (a.object_type == GL_BUFFER ? "buffer " : "texture ") << a.id
+       << "  " << a.name << std::endl;
+}
+
+// Gets the printable name of a category
+const char *gpu_memory::get_category_name(category cat) {
+  switch (cat) {
+  case vertex_buffer:
+    return "vertex buffer";
+  case index_buffer:
+    return "index buffer";
+  case texture_2d:
+    return "texture";
+  case cubemap_texture:
+    return "cubemap";
+  case render_target:
+    return "render target";
+  case depth_target:
+    return "depth target";
+  case staging_buffer:
+    return "staging buffer";
+  default:
+    return "unknown";
+  }
+}
+
+// Gets the number of bytes per texel for the internal formats used by the framework
+size_t gpu_memory::get_bytes_per_texel(GLenum internal_format) {
+  switch (internal_format) {
+  case GL_R8:
+  case GL_RED:
+    return 1;
+  case GL_RG8:
+  case GL_R16F:
+  case GL_DEPTH_COMPONENT16:
+    return 2;
+  case GL_RGB8:
+  case GL_RGB:
+    return 3;
+  case GL_RGBA8:
+  case GL_RGBA:
+  case GL_R32F:
+  case GL_RG16F:
+  case GL_DEPTH_COMPONENT32F:
+  case GL_DEPTH24_STENCIL8:
+    return 4;
+  // Unsized depth formats are allocated as 24 bit depth, padded to 32 bits
+  case GL_DEPTH_COMPONENT:
+  case GL_DEPTH_COMPONENT24:
+    return 4;
+  case GL_DEPTH32F_STENCIL8:
+    return 8;
+  case GL_RGBA16F:
+    return 8;
+  case GL_RGB32F:
+    return 12;
+  case GL_RGBA32F:
+    return 16;
+  default:
+    return 4;
+  }
+}
+
+// Calculates the size of a texture including its mip chain
+size_t gpu_memory::calculate_texture_bytes(GLuint width, GLuint height, GLenum internal_format, bool mipmaps,
+                                           unsigned int faces) {
+  auto texel = get_bytes_per_texel(internal_format);
+  size_t bytes = 0;
+  // Iterate down the mip chain until 1x1 is reached
+  while (true) {
+    bytes += static_cast<size_t>(width) * static_cast<size_t>(height) * texel;
+    if (!mipmaps || (width == 1 && height == 1))
+      break;
+    width = std::max(1u, width / 2);
+    height = std::max(1u, height / 2);
+  }
+  return bytes * faces;
+}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Static class used to account for the GPU memory allocated by the framework.
+Every buffer and texture allocation is recorded with its size, category and a
+debug name so that VRAM usage can be inspected per asset
+*/
+class gpu_memory {
+public:
+  // The categories allocations are tagged with
+  enum category { vertex_buffer, index_buffer, texture_2d, cubemap_texture, render_target, depth_target, staging_buffer,
+                  num_categories };
+
+  // A single tracked allocation
+  struct allocation {
+    // The OpenGL object namespace of the allocation (GL_BUFFER or GL_TEXTURE)
+    GLenum object_type;
+    // The OpenGL ID of the allocation
+    GLuint id;
+    // The size of the allocation in bytes
+    size_t bytes;
+    // The category of the allocation
+    category cat;
+    // The debug name of the allocation
+    std::string name;
+  };
+
+private:
+  // The live allocations, keyed by object namespace and ID
+  static std::map<std::pair<GLenum, GLuint>, allocation> _allocations;
+  // The currently allocated bytes for each category
+  static std::array<size_t, num_categories> _totals;
+  // The peak allocated bytes for each category
+  static std::array<size_t, num_categories> _peaks;
+  // The current total across all categories
+  static size_t _total;
+  // The peak total across all categories
+  static size_t _peak;
+  // Records an allocation, replacing any previous allocation with the same ID
+  static void record(GLenum object_type, GLuint id, size_t bytes, category cat, const std::string &name);
+
+public:
+  // Records the storage of a buffer object
+  static void track_buffer(GLuint id, size_t bytes, category cat, const std::string &name) {
+    record(GL_BUFFER, id, bytes, cat, name);
+  }
+  // Records the storage of a texture object
+  static void track_texture(GLuint id, size_t bytes, category cat, const std::string &name) {
+    record(GL_TEXTURE, id, bytes, cat, name);
+  }
+  // Removes a buffer object from the tracker
+  static void release_buffer(GLuint id);
+  // Removes a texture object from the tracker
+  static void release_texture(GLuint id);
+  // Renames a tracked buffer object
+  static void set_buffer_name(GLuint id, const std::string &name);
+  // Renames a tracked texture object
+  static void set_texture_name(GLuint id, const std::string &name);
+  // Gets the size in bytes of a tracked texture.  Returns 0 if not tracked
+  static size_t get_texture_bytes(GLuint id);
+  // Gets the number of bytes currently allocated
+  static size_t get_total() { return _total; }
+  // Gets the number of bytes currently allocated in a category
+  static size_t get_total(category cat) { return _totals[cat]; }
+  // Gets the highest number of bytes allocated at any one time
+  static size_t get_peak() { return _peak; }
+  // Gets the highest number of bytes allocated in a category at any one time
+  static size_t get_peak(category cat) { return _peaks[cat]; }
+  // Gets the live allocations, largest first
+  static std::vector<allocation> get_allocations();
+  // Writes totals, peaks and a per-asset breakdown to the given stream
+  static void dump(std::ostream &os);
+  // Gets the printable name of a category
+  static const char *get_category_name(category cat);
+  // Gets the number of bytes per texel of an internal format
+  static size_t get_bytes_per_texel(GLenum internal_format);
+  // Calculates the size of a texture, including its mip chain if required
+  static size_t calculate_texture_bytes(GLuint width, GLuint height, GLenum internal_format, bool mipmaps,
+                                        unsigned int faces = 1);
+};
+}
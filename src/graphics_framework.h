@@ -2,7 +2,10 @@
 
 #include "app.h"
 #include "arc_ball_camera.h"
+#include "asset_pack.h"
+#include "asset_stream.h"
 #include "camera.h"
+#include "camera_path.h"
 #include "chase_camera.h"
 #include "cubemap.h"
 #include "depth_buffer.h"
@@ -12,14 +15,35 @@
 #include "free_camera.h"
 #include "geometry.h"
 #include "geometry_builder.h"
+#include "geometry_pool.h"
+#include "gl_capture.h"
+#include "gl_debug.h"
+#include "gl_replay.h"
+#include "gpu_memory.h"
+#include "image_data.h"
+#include "load_graph.h"
+#include "log.h"
+#include "mapped_file.h"
 #include "material.h"
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_data.h"
+#include "meshlet_geometry.h"
+#include "model.h"
+#include "paged_geometry.h"
+#include "pixel_upload.h"
+#include "point_cloud.h"
 #include "point_light.h"
+#include "procedural_shapes.h"
 #include "renderer.h"
 #include "shadow_map.h"
 #include "spot_light.h"
+#include "static_batch.h"
 #include "target_camera.h"
 #include "terrain.h"
 #include "texture.h"
+#include "texture_container.h"
+#include "texture_manager.h"
 #include "transform.h"
-#include "util.h"
\ No newline at end of file
+#include "util.h"
+#include "virtual_file.h"
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "stdafx.h"
+
+#include "image_data.h"
+#include "stb_image.h"
+#include "texture_container.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Creates an empty image
+image_data::image_data() : _pixels(nullptr, stbi_image_free) {}
+
+// Reads and decodes an image file
+image_data::image_data(const std::string &filename) : image_data() {
+  // Check if file exists
+  if (!check_file_exists(filename)) {
+    // Deployments ship baked containers in place of the source images.  Only the largest level is read
+    virtual_file file;
+    std::vector<texture_container::level> levels;
+    if (check_file_exists(filename + ".tex") && texture_container::read(filename + ".tex", file, levels)) {
+      auto bytes = size_t(levels[0].width) * levels[0].height * 4;
+      _pixels = decltype(_pixels)(static_cast<unsigned char *>(malloc(bytes)), free);
+      memcpy(_pixels.get(), levels[0].pixels, bytes);
+      _width = levels[0].width;
+      _height = levels[0].height;
+      return;
+    }
+    // Failed to read file.  Display error
+    LOG_ERROR << "could not load image " << filename << ": File Does Not Exist";
+    // Throw exception
+    throw std::runtime_error("Error reading image");
+  }
+  // Decode to four channels whatever the source format, straight from the pack or the mapped file
+  virtual_file file(filename);
+  int width, height, bpp;
+  _pixels.reset(stbi_load_from_memory(file.get_data(), static_cast<int>(file.get_size()), &width, &height, &bpp, 4));
+  if (!_pixels || width == 0 || height == 0) {
+    LOG_ERROR << "could not load image " << filename << ": " << stbi_failure_reason();
+    throw std::runtime_error("Error reading image");
+  }
+  _width = width;
+  _height = height;
+}
+
+// Frees the pixels
+void image_data::clear() {
+  _pixels.reset();
+  _width = 0;
+  _height = 0;
+}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+A decoded 8 bit RGBA image held in memory.  Decoding needs no OpenGL context,
+so images can be read on worker threads and handed to a texture or cubemap
+on the render thread.  Image data can be moved but not copied
+*/
+class image_data {
+private:
+  // The width of the image
+  GLuint _width = 0;
+  // The height of the image
+  GLuint _height = 0;
+  // The RGBA pixels, freed by stb_image or, when read from a baked container, by free
+  std::unique_ptr<unsigned char, void (*)(void *)> _pixels;
+
+public:
+  // Creates an empty image
+  image_data();
+  // Reads and decodes an image file.  Thread safe
+  explicit image_data(const std::string &filename);
+  // Image data can be moved but not copied
+  image_data(image_data &&other) = default;
+  image_data &operator=(image_data &&rhs) = default;
+  image_data(const image_data &other) = delete;
+  image_data &operator=(const image_data &rhs) = delete;
+  // Destroys the image, freeing the pixels
+  ~image_data() {}
+  // Gets the width of the image
+  GLuint get_width() const { return _width; }
+  // Gets the height of the image
+  GLuint get_height() const { return _height; }
+  // Gets the RGBA pixels.  Null if empty
+  const unsigned char *get_pixels() const { return _pixels.get(); }
+  // Frees the pixels once they have been uploaded
+  void clear();
+};
+}
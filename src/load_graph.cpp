@@ -0,0 +1,254 @@
+#include "stdafx.h"
+
+#include "image_data.h"
+#include "load_graph.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Adds a task
+load_graph::task load_graph::add(const std::string &name, const std::function<void()> &work,
+                                 const std::function<void()> &upload,
+                                 std::initializer_list<task> dependencies) {
+  return add(name, work, upload, std::vector<task>(dependencies));
+}
+
+// Adds a task depending on a list of tasks
+load_graph::task load_graph::add(const std::string &name, const std::function<void()> &work,
+                                 const std::function<void()> &upload,
+                                 const std::vector<task> &dependencies) {
+  auto id = _nodes.size();
+  for (auto d : dependencies) {
+    if (d >= id) {
+      LOG_ERROR << "adding load task " << name << ": Dependency " << d << " is not in the graph";
+      throw std::runtime_error("Error adding load task");
+    }
+  }
+  node n;
+  n.name = name;
+  n.work = work;
+  n.upload = upload;
+  n.dependencies = dependencies.size();
+  _nodes.push_back(n);
+  for (auto d : dependencies)
+    _nodes[d].dependents.push_back(id);
+  return id;
+}
+
+// Loads a texture
+load_graph::task load_graph::add_texture(texture &target, const std::string &filename, bool mipmaps,
+                                         bool anisotropic) {
+  auto image = std::make_shared<image_data>();
+  return add(filename, [=] { *image = image_data(filename); },
+             [=, &target] {
+               target = texture(image->get_pixels(), image->get_width(), image->get_height(), mipmaps, anisotropic,
+                                filename);
+               image->clear();
+             });
+}
+
+// Loads a texture from a mip chain of files
+load_graph::task load_graph::add_texture(texture &target, const std::vector<std::string> &filenames,
+                                         bool anisotropic) {
+  auto levels = std::make_shared<std::vector<image_data>>();
+  return add(filenames[0],
+             [=] {
+               for (auto &name : filenames)
+                 levels->emplace_back(name);
+             },
+             [=, &target] {
+               target = texture(*levels, anisotropic, filenames[0]);
+               levels->clear();
+             });
+}
+
+// Loads a cubemap
+load_graph::task load_graph::add_cubemap(cubemap &target, const std::array<std::string, 6> &filenames) {
+  // A task per face lets the decodes run in parallel
+  auto faces = std::make_shared<std::array<image_data, 6>>();
+  std::vector<task> decodes;
+  for (size_t i = 0; i < 6; ++i)
+    decodes.push_back(add(filenames[i], [=] { (*faces)[i] = image_data(filenames[i]); }, nullptr));
+  return add("cubemap " + filenames[0], nullptr,
+             [=, &target] {
+               std::array<const unsigned char *, 6> pixels;
+               for (size_t i = 0; i < 6; ++i) {
+                 if ((*faces)[i].get_width() != (*faces)[0].get_width() ||
+                     (*faces)[i].get_height() != (*faces)[0].get_height()) {
+                   LOG_ERROR << "loading cubemap textures: " << filenames[i] << " differs in size from "
+                             << filenames[0];
+                   throw std::runtime_error("Error loading cubemap textures");
+                 }
+                 pixels[i] = (*faces)[i].get_pixels();
+               }
+               target = cubemap(pixels, (*faces)[0].get_width(), (*faces)[0].get_height(), filenames[0]);
+               for (auto &face : *faces)
+                 face.clear();
+             },
+             decodes);
+}
+
+// Loads a model
+load_graph::task load_graph::add_geometry(geometry &target, const std::string &filename) {
+  // Importing and conversion both happen on the worker
+  auto data = std::make_shared<mesh_data>();
+  return add(filename, [=] { *data = mesh_data(filename); }, [=, &target] { target = geometry(std::move(*data)); });
+}
+
+// Builds geometry
+load_graph::task load_graph::add_geometry(geometry &target, const std::string &name,
+                                          const std::function<mesh_data()> &build) {
+  auto data = std::make_shared<mesh_data>();
+  return add(name, [=] { *data = build(); }, [=, &target] { target = geometry(std::move(*data)); });
+}
+
+// Builds an effect
+load_graph::task load_graph::add_effect(effect &target, const std::vector<std::pair<std::string, GLenum>> &shaders) {
+  std::vector<task> compiles;
+  for (auto &shader : shaders) {
+    auto source = std::make_shared<std::string>();
+    auto filename = shader.first;
+    auto type = shader.second;
+    compiles.push_back(add(filename,
+                           [=] {
+                             if (!check_file_exists(filename) || !read_file(filename, *source)) {
+                               LOG_ERROR << "could not load shader " << filename << ": Could not read shader file";
+                               throw std::runtime_error("Error adding shader to effect");
+                             }
+                           },
+                           [=, &target] {
+                             target.add_shader_source(*source, type, filename);
+                             source->clear();
+                           }));
+  }
+  return add("effect " + (shaders.empty() ? std::string() : shaders[0].first), nullptr, [&target] { target.build(); },
+             compiles);
+}
+
+// Runs every task
+bool load_graph::run(unsigned int workers) {
+  if (_nodes.empty())
+    return true;
+  // Leave a hardware thread for the context thread
+  if (workers == 0)
+    workers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  _worker_count = workers;
+  auto start = std::chrono::steady_clock::now();
+  auto since = [](std::chrono::steady_clock::time_point from) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - from).count();
+  };
+
+  // Scheduling state.  All guarded by the mutex
+  std::mutex m;
+  std::condition_variable work_ready, upload_ready;
+  std::deque<task> work_queue, upload_queue;
+  auto remaining = _nodes.size();
+  bool failed = false;
+  for (size_t i = 0; i < _nodes.size(); ++i) {
+    _nodes[i].waiting = _nodes[i].dependencies;
+    _nodes[i].failed = false;
+    _nodes[i].work_time = _nodes[i].upload_time = _nodes[i].finish_time = 0.0;
+    if (_nodes[i].waiting == 0)
+      work_queue.push_back(i);
+  }
+  // Releases the tasks waiting on a finished one.  Failure passes to every dependent
+  auto finish = [&](task t) {
+    auto &n = _nodes[t];
+    n.finish_time = since(start);
+    failed |= n.failed;
+    --remaining;
+    for (auto d : n.dependents) {
+      _nodes[d].failed |= n.failed;
+      if (--_nodes[d].waiting == 0)
+        work_queue.push_back(d);
+    }
+    work_ready.notify_all();
+    if (remaining == 0)
+      upload_ready.notify_all();
+  };
+
+  // Worker threads run the work steps and queue the uploads
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < workers; ++i) {
+    threads.emplace_back([&] {
+      std::unique_lock<std::mutex> lock(m);
+      for (;;) {
+        work_ready.wait(lock, [&] { return !work_queue.empty() || remaining == 0; });
+        if (work_queue.empty())
+          return;
+        auto t = work_queue.front();
+        work_queue.pop_front();
+        auto &n = _nodes[t];
+        if (n.failed) {
+          LOG_ERROR << "skipping " << n.name << ": A dependency failed to load";
+          finish(t);
+          continue;
+        }
+        if (n.work) {
+          lock.unlock();
+          auto work_start = std::chrono::steady_clock::now();
+          bool ok = true;
+          try {
+            n.work();
+          } catch (std::exception &e) {
+            LOG_ERROR << "loading " << n.name << ": " << e.what();
+            ok = false;
+          }
+          n.work_time = since(work_start);
+          lock.lock();
+          n.failed = !ok;
+        }
+        if (!n.failed && n.upload) {
+          upload_queue.push_back(t);
+          upload_ready.notify_one();
+        } else
+          finish(t);
+      }
+    });
+  }
+
+  // This thread owns the context, so it runs the upload steps
+  {
+    std::unique_lock<std::mutex> lock(m);
+    for (;;) {
+      upload_ready.wait(lock, [&] { return !upload_queue.empty() || remaining == 0; });
+      if (upload_queue.empty())
+        break;
+      auto t = upload_queue.front();
+      upload_queue.pop_front();
+      auto &n = _nodes[t];
+      lock.unlock();
+      auto upload_start = std::chrono::steady_clock::now();
+      try {
+        n.upload();
+      } catch (std::exception &e) {
+        LOG_ERROR << "loading " << n.name << ": " << e.what();
+        n.failed = true;
+      }
+      n.upload_time = since(upload_start);
+      lock.lock();
+      finish(t);
+    }
+  }
+  for (auto &t : threads)
+    t.join();
+  _elapsed = since(start);
+  return !failed;
+}
+
+// Logs the timings of the last run
+void load_graph::log_report(log_level level) const {
+  double work = 0.0, upload = 0.0;
+  std::vector<const node *> order;
+  for (auto &n : _nodes) {
+    work += n.work_time;
+    upload += n.upload_time;
+    order.push_back(&n);
+  }
+  std::sort(order.begin(), order.end(), [](const node *a, const node *b) { return a->finish_time < b->finish_time; });
+  ENU_GFX_LOG(level) << "content loaded in " << _elapsed << " ms: " << _nodes.size() << " tasks, " << work
+                     << " ms of work on " << _worker_count << " workers, " << upload << " ms on the context thread";
+  for (auto n : order)
+    ENU_GFX_LOG(level) << "  " << n->name << ": work " << n->work_time << " ms, upload " << n->upload_time
+                       << " ms, done at " << n->finish_time << " ms" << (n->failed ? " (failed)" : "");
+}
+}
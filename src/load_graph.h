@@ -0,0 +1,86 @@
+#pragma once
+
+#include "cubemap.h"
+#include "effect.h"
+#include "geometry.h"
+#include "log.h"
+#include "stdafx.h"
+#include "texture.h"
+
+namespace graphics_framework {
+/*
+Loads content as a graph of tasks.  Each task has a work step that runs on a
+pool of worker threads and an upload step that runs on the thread owning the
+OpenGL context, either of which may be empty.  A task starts once every task
+it depends on has finished, so work spreads across all cores while OpenGL
+calls stay on one thread.  Work steps must not call OpenGL.  Targets passed
+to the helpers are written on the context thread and must outlive run
+*/
+class load_graph {
+public:
+  // Identifies a task in the graph
+  typedef size_t task;
+
+private:
+  // A task and its timings
+  struct node {
+    // The name shown in the report
+    std::string name;
+    // Runs on a worker thread
+    std::function<void()> work;
+    // Runs on the context thread once the work is done
+    std::function<void()> upload;
+    // The tasks waiting on this one
+    std::vector<task> dependents;
+    // The number of tasks this one depends on
+    size_t dependencies = 0;
+    // The number of dependencies not yet finished.  Only valid during run
+    size_t waiting = 0;
+    // Flag determining if the task or one of its dependencies failed
+    bool failed = false;
+    // Time spent in the work step in milliseconds
+    double work_time = 0.0;
+    // Time spent in the upload step in milliseconds
+    double upload_time = 0.0;
+    // Time from the start of run until the task finished in milliseconds
+    double finish_time = 0.0;
+  };
+  // The tasks, in the order added
+  std::vector<node> _nodes;
+  // The number of worker threads used by the last run
+  unsigned int _worker_count = 0;
+  // Time taken by the last run in milliseconds
+  double _elapsed = 0.0;
+
+public:
+  // Adds a task.  Dependencies must already be in the graph, so the graph cannot contain a cycle
+  task add(const std::string &name, const std::function<void()> &work, const std::function<void()> &upload,
+           std::initializer_list<task> dependencies = {});
+  // Adds a task depending on a list of tasks built at runtime
+  task add(const std::string &name, const std::function<void()> &work, const std::function<void()> &upload,
+           const std::vector<task> &dependencies);
+  // Loads a texture.  The image is decoded on a worker
+  task add_texture(texture &target, const std::string &filename, bool mipmaps = true, bool anisotropic = true);
+  // Loads a texture from a mip chain of files, largest first.  The levels are decoded on a worker
+  task add_texture(texture &target, const std::vector<std::string> &filenames, bool anisotropic);
+  // Loads a cubemap.  The six faces are decoded in parallel
+  task add_cubemap(cubemap &target, const std::array<std::string, 6> &filenames);
+  // Loads a model.  The file is imported on a worker
+  task add_geometry(geometry &target, const std::string &filename);
+  // Builds geometry, such as from geometry_builder.  The build function runs on a worker
+  task add_geometry(geometry &target, const std::string &name, const std::function<mesh_data()> &build);
+  // Builds an effect.  Each shader is read on a worker and compiled once read.  The build task depends on them all
+  task add_effect(effect &target, const std::vector<std::pair<std::string, GLenum>> &shaders);
+  // Runs every task, blocking until all have finished.  Call on the context thread.  0 workers uses all but one
+  // hardware thread.  Returns false if any task failed
+  bool run(unsigned int workers = 0);
+  // Gets the number of tasks in the graph
+  size_t size() const { return _nodes.size(); }
+  // Gets the time taken by the last run in milliseconds
+  double get_elapsed() const { return _elapsed; }
+  // Logs the timings of the last run with a line per task, in the order they finished
+  void log_report(log_level level = log_level::info) const;
+  // Removes every task
+  void clear() { _nodes.clear(); }
+};
+}
@@ -0,0 +1,208 @@
+#include "stdafx.h"
+
+#include "log.h"
+
+namespace graphics_framework {
+// Initialise static members
+const size_t logger::line_length;
+const size_t logger::capacity;
+logger::cell logger::_cells[logger::capacity];
+std::atomic<size_t> logger::_enqueue_pos(0);
+size_t logger::_dequeue_pos = 0;
+std::atomic<size_t> logger::_written(0);
+std::atomic<size_t> logger::_dropped(0);
+std::atomic<log_level> logger::_level(static_cast<log_level>(ENU_GFX_LOG_LEVEL));
+std::atomic<bool> logger::_running(false);
+std::thread logger::_thread;
+std::mutex logger::_file_mutex;
+std::ofstream logger::_file;
+
+// Guards starting and stopping the writer thread
+static std::once_flag start_flag;
+// The terminate handler in place before the logger started
+static std::terminate_handler previous_terminate = nullptr;
+
+// Prefix written before each line of a level
+static const char *level_prefix(log_level level) {
+  switch (level) {
+  case log_level::debug:
+    return "DEBUG - ";
+  case log_level::info:
+    return "LOG - ";
+  case log_level::warning:
+    return "WARNING - ";
+  default:
+    return "ERROR - ";
+  }
+}
+
+// Starts the writer thread
+void logger::start() {
+  std::call_once(start_flag, [] {
+    // Each slot starts free for the producer claiming its position
+    for (size_t i = 0; i < capacity; ++i)
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    _running = true;
+    _thread = std::thread(run);
+    std::atexit(shutdown);
+    // Write out pending lines if an exception escapes, as they usually explain it
+    previous_terminate = std::set_terminate([] {
+      shutdown();
+      if (previous_terminate)
+        previous_terminate();
+      std::abort();
+    });
+  });
+}
+
+// Pushes a line into the ring
+bool logger::push(log_level level, const char *text, size_t length) {
+  start();
+  // Claim a position.  Fails rather than waits if the writer has fallen a full ring behind
+  auto pos = _enqueue_pos.load(std::memory_order_relaxed);
+  cell *c;
+  for (;;) {
+    c = &_cells[pos & (capacity - 1)];
+    auto seq = c->sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+    if (diff == 0) {
+      if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      ++_dropped;
+      return false;
+    } else
+      pos = _enqueue_pos.load(std::memory_order_relaxed);
+  }
+  // Fill the slot and hand it to the writer
+  length = std::min(length, line_length);
+  memcpy(c->text, text, length);
+  c->length = static_cast<unsigned short>(length);
+  c->level = level;
+  c->sequence.store(pos + 1, std::memory_order_release);
+  // Once the writer has stopped, lines are written on the calling thread
+  if (!_running.load(std::memory_order_relaxed))
+    drain();
+  return true;
+}
+
+// Pushes each line of a block of text
+void logger::push_lines(log_level level, const char *text) {
+  while (text && *text) {
+    auto end = strchr(text, '\n');
+    auto length = end ? static_cast<size_t>(end - text) : strlen(text);
+    // Skip blank lines and carriage returns
+    auto trimmed = length;
+    while (trimmed > 0 && text[trimmed - 1] == '\r')
+      --trimmed;
+    if (trimmed > 0)
+      push(level, text, trimmed);
+    text = end ? end + 1 : nullptr;
+  }
+}
+
+// Writes every line currently in the ring
+size_t logger::drain() {
+  std::lock_guard<std::mutex> lock(_file_mutex);
+  size_t count = 0;
+  bool errors = false, output = false;
+  for (;;) {
+    auto &c = _cells[_dequeue_pos & (capacity - 1)];
+    if (c.sequence.load(std::memory_order_acquire) != _dequeue_pos + 1)
+      break;
+    // Errors and warnings go to the error stream as before
+    auto &os = _file.is_open() ? static_cast<std::ostream &>(_file)
+                               : (c.level >= log_level::warning ? std::cerr : std::clog);
+    errors |= &os == &std::cerr;
+    os << level_prefix(c.level);
+    os.write(c.text, c.length);
+    os << '\n';
+    // Release the slot for the producer a full ring ahead
+    c.sequence.store(_dequeue_pos + capacity, std::memory_order_release);
+    ++_dequeue_pos;
+    ++count;
+  }
+  // Report lines lost since the last batch
+  static size_t reported = 0;
+  auto dropped = _dropped.load(std::memory_order_relaxed);
+  if (dropped != reported) {
+    auto &os = _file.is_open() ? static_cast<std::ostream &>(_file) : std::cerr;
+    os << level_prefix(log_level::warning) << dropped - reported << " log lines dropped, ring full\n";
+    errors |= &os == &std::cerr;
+    reported = dropped;
+    output = true;
+  }
+  // One flush per batch rather than per line
+  if (count > 0 || output) {
+    if (_file.is_open())
+      _file.flush();
+    else {
+      std::clog.flush();
+      if (errors)
+        std::cerr.flush();
+    }
+  }
+  _written += count;
+  return count;
+}
+
+// Body of the writer thread
+void logger::run() {
+  while (_running.load()) {
+    // Sleep briefly when idle.  Producers never wait on the writer
+    if (drain() == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  drain();
+}
+
+// Writes lines to a file instead of the console
+bool logger::set_file(const std::string &filename) {
+  // Make sure lines logged so far reach the old output
+  flush();
+  std::lock_guard<std::mutex> lock(_file_mutex);
+  if (_file.is_open())
+    _file.close();
+  if (filename.empty())
+    return true;
+  _file.open(filename);
+  if (!_file.is_open()) {
+    std::cerr << "ERROR - could not open log file " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Waits until every line logged before the call has been written
+void logger::flush() {
+  auto target = _enqueue_pos.load();
+  // Without a writer thread drain on the calling thread
+  if (!_running.load()) {
+    drain();
+    return;
+  }
+  while (_written.load() < target && _running.load())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+// Writes any remaining lines and stops the writer thread
+void logger::shutdown() {
+  if (_running.exchange(false) && _thread.joinable()) {
+    // The writer drains once more before returning
+    if (_thread.get_id() != std::this_thread::get_id())
+      _thread.join();
+    else
+      _thread.detach();
+  }
+  drain();
+}
+
+// Appends raw characters to a line, truncating at the buffer size
+void log_line::append(const char *text, size_t length) {
+  auto space = logger::line_length - _length;
+  if (length > space)
+    length = space;
+  memcpy(_text + _length, text, length);
+  _length += length;
+}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "stdafx.h"
+
+// Lowest level compiled in.  0 debug, 1 info, 2 warning, 3 error.  Lines below it cost nothing
+#ifndef ENU_GFX_LOG_LEVEL
+#if defined(DEBUG) | defined(_DEBUG)
+#define ENU_GFX_LOG_LEVEL 0
+#else
+#define ENU_GFX_LOG_LEVEL 1
+#endif
+#endif
+
+namespace graphics_framework {
+// Severity of a log line
+enum class log_level : unsigned char { debug = 0, info = 1, warning = 2, error = 3 };
+
+/*
+Static class that writes log lines on a background thread.  Lines are pushed
+into a fixed size lock-free ring shared by all threads, so logging never
+blocks or allocates.  If the ring is full the line is dropped and counted.
+The writer thread starts with the first line logged and drains the ring to
+the console, or to a file once one is set
+*/
+class logger {
+public:
+  // The longest line stored.  Longer lines are truncated
+  static const size_t line_length = 496;
+  // The number of lines the ring can hold.  Must be a power of two
+  static const size_t capacity = 1024;
+
+private:
+  // A slot in the ring
+  struct cell {
+    // Position of the line held, used to hand the slot between producers and the writer
+    std::atomic<size_t> sequence;
+    // Severity of the line
+    log_level level;
+    // Number of characters in the line
+    unsigned short length;
+    // The text of the line
+    char text[line_length];
+  };
+  // The ring of lines
+  static cell _cells[capacity];
+  // The next position a producer claims
+  static std::atomic<size_t> _enqueue_pos;
+  // The next position the writer reads.  Only touched by the writer
+  static size_t _dequeue_pos;
+  // The number of lines written out, used by flush
+  static std::atomic<size_t> _written;
+  // The number of lines dropped because the ring was full
+  static std::atomic<size_t> _dropped;
+  // The lowest level accepted at runtime
+  static std::atomic<log_level> _level;
+  // Flag determining if the writer thread should keep running
+  static std::atomic<bool> _running;
+  // The writer thread
+  static std::thread _thread;
+  // Guards the output file.  Only taken by the writer and set_file
+  static std::mutex _file_mutex;
+  // The file written to, if any
+  static std::ofstream _file;
+  // Starts the writer thread on first use
+  static void start();
+  // Body of the writer thread
+  static void run();
+  // Writes every line currently in the ring.  Returns the number written
+  static size_t drain();
+
+public:
+  // Pushes a line into the ring.  Never blocks.  Returns false if the line was dropped
+  static bool push(log_level level, const char *text, size_t length);
+  // Pushes each line of a multi-line block of text, such as a shader info log
+  static void push_lines(log_level level, const char *text);
+  // Checks if a level is written at runtime
+  static bool is_enabled(log_level level) { return level >= _level.load(std::memory_order_relaxed); }
+  // Sets the lowest level written at runtime.  Levels below ENU_GFX_LOG_LEVEL are compiled out regardless
+  static void set_level(log_level level) { _level.store(level, std::memory_order_relaxed); }
+  // Writes lines to a file instead of the console.  An empty name returns to the console
+  static bool set_file(const std::string &filename);
+  // Gets the number of lines dropped because the ring was full
+  static size_t get_dropped() { return _dropped.load(std::memory_order_relaxed); }
+  // Waits until every line logged before the call has been written.  Blocks, so avoid on the render thread
+  static void flush();
+  // Writes any remaining lines and stops the writer thread.  Called at exit
+  static void shutdown();
+};
+
+/*
+A single line being built.  Values are formatted into a fixed buffer on the
+stack and the line is pushed to the logger when the statement ends.  Use
+through the LOG_ macros rather than directly
+*/
+class log_line {
+private:
+  // Severity of the line
+  log_level _level;
+  // Number of characters written
+  size_t _length = 0;
+  // The text of the line
+  char _text[logger::line_length];
+  // Appends raw characters, truncating at the buffer size
+  void append(const char *text, size_t length);
+  // Appends a value formatted with snprintf
+  template <typename T> log_line &format(const char *spec, T value) {
+    char buffer[32];
+    auto n = snprintf(buffer, sizeof(buffer), spec, value);
+    append(buffer, n > 0 ? static_cast<size_t>(n) : 0);
+    return *this;
+  }
+
+public:
+  // Starts a line at the given level
+  explicit log_line(log_level level) : _level(level) {}
+  // Lines cannot be copied
+  log_line(const log_line &other) = delete;
+  log_line &operator=(const log_line &rhs) = delete;
+  // Pushes the line to the logger
+  ~log_line() { logger::push(_level, _text, _length); }
+  log_line &operator<<(const char *value) {
+    append(value ? value : "(null)", value ? strlen(value) : 6);
+    return *this;
+  }
+  log_line &operator<<(const unsigned char *value) { return *this << reinterpret_cast<const char *>(value); }
+  log_line &operator<<(const std::string &value) {
+    append(value.data(), value.size());
+    return *this;
+  }
+  log_line &operator<<(char value) {
+    append(&value, 1);
+    return *this;
+  }
+  log_line &operator<<(bool value) { return format("%d", static_cast<int>(value)); }
+  log_line &operator<<(int value) { return format("%d", value); }
+  log_line &operator<<(unsigned int value) { return format("%u", value); }
+  log_line &operator<<(long value) { return format("%ld", value); }
+  log_line &operator<<(unsigned long value) { return format("%lu", value); }
+  log_line &operator<<(long long value) { return format("%lld", value); }
+  log_line &operator<<(unsigned long long value) { return format("%llu", value); }
+  log_line &operator<<(float value) { return format("%g", static_cast<double>(value)); }
+  log_line &operator<<(double value) { return format("%g", value); }
+  log_line &operator<<(const void *value) { return format("%p", value); }
+};
+}
+
+// Logs a line at the given level.  Compiled out below ENU_GFX_LOG_LEVEL, skipped below the runtime level.  Usage:
+// LOG_ERROR << "could not load " << filename;
+// The line is the body of a loop run at most once, so the macro has no else to capture when used in an unbraced if
+#define ENU_GFX_LOG(level)                                                                                             \
+  for (bool enu_gfx_log_enabled =                                                                                      \
+           static_cast<int>(level) >= ENU_GFX_LOG_LEVEL && ::graphics_framework::logger::is_enabled(level);            \
+       enu_gfx_log_enabled; enu_gfx_log_enabled = false)                                                               \
+    ::graphics_framework::log_line(level)
+#define LOG_DEBUG ENU_GFX_LOG(::graphics_framework::log_level::debug)
+#define LOG_INFO ENU_GFX_LOG(::graphics_framework::log_level::info)
+#define LOG_WARNING ENU_GFX_LOG(::graphics_framework::log_level::warning)
+#define LOG_ERROR ENU_GFX_LOG(::graphics_framework::log_level::error)
@@ -0,0 +1,97 @@
+#include "stdafx.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Maps a file
+mapped_file::mapped_file(const std::string &filename) {
+#ifdef _WIN32
+  auto file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL, nullptr);
+  LARGE_INTEGER size;
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    LOG_ERROR << "mapping file " << filename << ": Could not open file";
+    throw std::runtime_error("Error mapping file");
+  }
+  _file = file;
+  _size = static_cast<size_t>(size.QuadPart);
+  // Empty files cannot be mapped, but are still valid
+  if (_size == 0)
+    return;
+  _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (_mapping)
+    _data = static_cast<const unsigned char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+  _fd = open(filename.c_str(), O_RDONLY);
+  struct stat info;
+  if (_fd < 0 || fstat(_fd, &info) != 0) {
+    close();
+    LOG_ERROR << "mapping file " << filename << ": Could not open file";
+    throw std::runtime_error("Error mapping file");
+  }
+  _size = static_cast<size_t>(info.st_size);
+  // Empty files cannot be mapped, but are still valid
+  if (_size == 0)
+    return;
+  auto data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+  if (data != MAP_FAILED)
+    _data = static_cast<const unsigned char *>(data);
+#endif
+  if (!_data) {
+    close();
+    LOG_ERROR << "mapping file " << filename << ": Could not map file into memory";
+    throw std::runtime_error("Error mapping file");
+  }
+}
+
+// Move constructor
+mapped_file::mapped_file(mapped_file &&other) { *this = std::move(other); }
+
+// Move assignment operator
+mapped_file &mapped_file::operator=(mapped_file &&rhs) {
+  if (this == &rhs)
+    return *this;
+  close();
+  std::swap(_data, rhs._data);
+  std::swap(_size, rhs._size);
+#ifdef _WIN32
+  std::swap(_file, rhs._file);
+  std::swap(_mapping, rhs._mapping);
+#else
+  std::swap(_fd, rhs._fd);
+#endif
+  return *this;
+}
+
+// Unmaps the file
+void mapped_file::close() {
+#ifdef _WIN32
+  if (_data)
+    UnmapViewOfFile(_data);
+  if (_mapping)
+    CloseHandle(_mapping);
+  if (_file)
+    CloseHandle(_file);
+  _file = _mapping = nullptr;
+#else
+  if (_data)
+    munmap(const_cast<unsigned char *>(_data), _size);
+  if (_fd >= 0)
+    ::close(_fd);
+  _fd = -1;
+#endif
+  _data = nullptr;
+  _size = 0;
+}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+A file mapped read-only into memory.  The operating system pages the
+contents in as they are read, so large binary assets can be handed to
+OpenGL straight from the mapping without being read into a buffer first.
+The mapping can be moved but not copied, and is unmapped when destroyed
+*/
+class mapped_file {
+private:
+  // The mapped contents.  Null if empty
+  const unsigned char *_data = nullptr;
+  // The size of the file in bytes
+  size_t _size = 0;
+#ifdef _WIN32
+  // The file handle
+  void *_file = nullptr;
+  // The file mapping handle
+  void *_mapping = nullptr;
+#else
+  // The file descriptor
+  int _fd = -1;
+#endif
+
+public:
+  // Creates an empty mapping
+  mapped_file() {}
+  // Maps a file.  Thread safe
+  explicit mapped_file(const std::string &filename);
+  // Mappings can be moved but not copied
+  mapped_file(mapped_file &&other);
+  mapped_file &operator=(mapped_file &&rhs);
+  mapped_file(const mapped_file &other) = delete;
+  mapped_file &operator=(const mapped_file &rhs) = delete;
+  // Destroys the mapping
+  ~mapped_file() { close(); }
+  // Gets the mapped contents.  Null if empty
+  const unsigned char *get_data() const { return _data; }
+  // Gets the size of the file in bytes
+  size_t get_size() const { return _size; }
+  // Unmaps the file
+  void close();
+};
+}
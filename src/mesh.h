@@ -31,7 +31,7 @@ public:
       : _geometry(geom), _minimal(geom.get_minimal_point()), _maximal(geom.get_maximal_point()) {}
   // Creates a mesh object with the provided geometry and material
   mesh(geometry &geom, material &mat)
-      : _geometry(geom), _minimal(geom.get_minimal_point()), _maximal(geom.get_maximal_point()) {}
+      : _geometry(geom), _material(mat), _minimal(geom.get_minimal_point()), _maximal(geom.get_maximal_point()) {}
   // Default copy constructor and assignment operator
   mesh(const mesh &other) = default;
   mesh &operator=(const mesh &rhs) = default;
@@ -39,12 +39,16 @@ public:
   ~mesh() {}
   // Gets the transform object for the mesh
   transform &get_transform() { return _transform; }
+  // Gets the transform object for the mesh
+  const transform &get_transform() const { return _transform; }
   // Gets the geometry object for the mesh
   const geometry &get_geometry() const { return _geometry; }
   // Sets the geometry object for the mesh
   void set_geometry(const geometry &value) { _geometry = value; }
   // Gets the material object for the mesh
   material &get_material() { return _material; }
+  // Gets the material object for the mesh
+  const material &get_material() const { return _material; }
   // Sets the material object for the mesh
   void set_material(const material &value) { _material = value; }
   // Gets the minimal point of the AABB defining the mesh
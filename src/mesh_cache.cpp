@@ -0,0 +1,276 @@
+#include "stdafx.h"
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "mesh_cache.h"
+#include "util.h"
+#include "virtual_file.h"
+
+namespace graphics_framework {
+// Initialise static members
+const uint32_t mesh_cache::version;
+std::string mesh_cache::_directory = "cache";
+bool mesh_cache::_enabled = true;
+bool mesh_cache::_compress_indices = false;
+std::atomic<size_t> mesh_cache::_hits(0);
+std::atomic<size_t> mesh_cache::_misses(0);
+
+// Marks a file as a mesh cache entry.  "MESH" when read as bytes
+static const uint32_t entry_magic = 0x4853454d;
+// Set in the header flags when indices are stored in 16 bits
+static const uint32_t flag_short_indices = 1;
+// Blobs start on a multiple of this, so they can be read in place
+static const size_t blob_alignment = 16;
+
+// The fixed header at the start of an entry.  Followed by the stream table, the submesh table and the blobs
+struct entry_header {
+  // Always entry_magic
+  uint32_t magic;
+  // The cache format version
+  uint32_t version;
+  // The hash of the source file
+  uint64_t source_hash;
+  // Storage flags
+  uint32_t flags;
+  // The primitive type
+  uint32_t type;
+  // The number of vertices
+  uint32_t vertex_count;
+  // The number of indices
+  uint32_t index_count;
+  // The number of attribute streams
+  uint32_t stream_count;
+  // The number of submeshes
+  uint32_t submesh_count;
+  // The minimal point
+  float minimal[3];
+  // The maximal point
+  float maximal[3];
+  // The offset of the index blob
+  uint64_t index_offset;
+};
+
+// Describes one attribute stream in an entry
+struct entry_stream {
+  // The attribute index
+  uint32_t index;
+  // The number of float components per vertex
+  uint32_t components;
+  // The offset of the attribute blob
+  uint64_t offset;
+};
+
+static_assert(sizeof(entry_header) == 72 && sizeof(entry_stream) == 16, "Mesh cache structures must not be padded");
+
+// Rounds an offset up to the blob alignment
+static uint64_t align_blob(uint64_t offset) { return (offset + blob_alignment - 1) & ~uint64_t(blob_alignment - 1); }
+
+// Creates a directory if it does not exist
+static void make_directory(const std::string &path) {
+#ifdef _WIN32
+  _mkdir(path.c_str());
+#else
+  mkdir(path.c_str(), 0755);
+#endif
+}
+
+// Gets the path of the entry for a source hash
+std::string mesh_cache::get_path(uint64_t hash) {
+  std::stringstream path;
+  path << _directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".mesh";
+  return path.str();
+}
+
+// Hashes the contents of a file with 64 bit FNV-1a
+uint64_t mesh_cache::hash_file(const std::string &filename) {
+  try {
+    virtual_file file(filename);
+    uint64_t hash = 14695981039346656037ull;
+    auto data = file.get_data();
+    for (size_t i = 0; i < file.get_size(); ++i) {
+      hash ^= data[i];
+      hash *= 1099511628211ull;
+    }
+    return hash == 0 ? 1 : hash;
+  } catch (std::exception &) {
+    return 0;
+  }
+}
+
+// Fills mesh data from the entry for a source hash
+bool mesh_cache::load(uint64_t hash, const std::string &name, mesh_data &data) {
+  if (!_enabled || hash == 0)
+    return false;
+  auto path = get_path(hash);
+  if (!check_file_exists(path) || !read_entry(path, hash, name, data))
+    return false;
+  ++_hits;
+  return true;
+}
+
+// Fills mesh data from an entry file
+bool mesh_cache::read_entry(const std::string &path, uint64_t hash, const std::string &name, mesh_data &data) {
+  virtual_file file;
+  try {
+    file = virtual_file(path);
+  } catch (std::exception &) {
+    return false;
+  }
+  auto bytes = file.get_data();
+  auto size = static_cast<uint64_t>(file.get_size());
+  // Checks a table or blob lies inside the file
+  auto inside = [=](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+
+  entry_header header;
+  if (!inside(0, sizeof(header))) {
+    LOG_WARNING << "mesh entry " << path << " is corrupt.  Ignored for " << name;
+    return false;
+  }
+  memcpy(&header, bytes, sizeof(header));
+  if (header.magic != entry_magic || header.version != version || (hash != 0 && header.source_hash != hash)) {
+    LOG_WARNING << "mesh entry " << path << " is out of date.  Ignored for " << name;
+    return false;
+  }
+  auto tables = sizeof(header) + uint64_t(header.stream_count) * sizeof(entry_stream) +
+                uint64_t(header.submesh_count) * sizeof(mesh_data::submesh);
+  if (!inside(0, tables)) {
+    LOG_WARNING << "mesh entry " << path << " is corrupt.  Ignored for " << name;
+    return false;
+  }
+
+  // Point the streams into the mapping
+  mesh_data result;
+  auto streams = reinterpret_cast<const entry_stream *>(bytes + sizeof(header));
+  for (uint32_t i = 0; i < header.stream_count; ++i) {
+    auto &s = streams[i];
+    if (s.index >= 16 || s.components < 1 || s.components > 4 || s.offset % sizeof(float) != 0 ||
+        !inside(s.offset, uint64_t(header.vertex_count) * s.components * sizeof(float))) {
+      LOG_WARNING << "mesh entry " << path << " is corrupt.  Ignored for " << name;
+      return false;
+    }
+    auto &target = result._streams[s.index];
+    target.components = static_cast<GLint>(s.components);
+    target.mapped = reinterpret_cast<const float *>(bytes + s.offset);
+  }
+  auto submeshes = reinterpret_cast<const mesh_data::submesh *>(streams + header.stream_count);
+  result._submeshes.assign(submeshes, submeshes + header.submesh_count);
+
+  // Indices are read in place unless they were narrowed
+  if (header.index_count > 0) {
+    auto short_indices = (header.flags & flag_short_indices) != 0;
+    auto index_size = short_indices ? sizeof(uint16_t) : sizeof(GLuint);
+    if (header.index_offset % index_size != 0 ||
+        !inside(header.index_offset, uint64_t(header.index_count) * index_size)) {
+      LOG_WARNING << "mesh entry " << path << " is corrupt.  Ignored for " << name;
+      return false;
+    }
+    if (short_indices) {
+      auto narrow = reinterpret_cast<const uint16_t *>(bytes + header.index_offset);
+      result._indices.assign(narrow, narrow + header.index_count);
+    } else
+      result._mapped_indices = reinterpret_cast<const GLuint *>(bytes + header.index_offset);
+  }
+  result._index_count = header.index_count;
+  result._vertices = header.vertex_count;
+  result._type = header.type;
+  result._minimal = glm::vec3(header.minimal[0], header.minimal[1], header.minimal[2]);
+  result._maximal = glm::vec3(header.maximal[0], header.maximal[1], header.maximal[2]);
+  result._name = name;
+  result._mapping = file;
+  data = std::move(result);
+  LOG_INFO << "mesh " << name << " loaded from " << path;
+  return true;
+}
+
+// Writes mesh data as the entry for a source hash
+bool mesh_cache::store(uint64_t hash, const mesh_data &data) {
+  if (!_enabled || hash == 0)
+    return false;
+  make_directory(_directory);
+  if (!write_entry(get_path(hash), hash, data))
+    return false;
+  ++_misses;
+  return true;
+}
+
+// Writes mesh data to an entry file
+bool mesh_cache::write_entry(const std::string &path, uint64_t hash, const mesh_data &data) {
+  auto vertices = uint64_t(data.get_vertex_count());
+  entry_header header = {};
+  header.magic = entry_magic;
+  header.version = version;
+  header.source_hash = hash;
+  header.type = data.get_type();
+  header.vertex_count = data.get_vertex_count();
+  header.index_count = data.get_index_count();
+  header.stream_count = static_cast<uint32_t>(data.get_streams().size());
+  header.submesh_count = static_cast<uint32_t>(data.get_submeshes().size());
+  for (int i = 0; i < 3; ++i) {
+    header.minimal[i] = data.get_minimal_point()[i];
+    header.maximal[i] = data.get_maximal_point()[i];
+  }
+  // Every index fits in 16 bits if there are few enough vertices
+  auto short_indices = _compress_indices && vertices <= 65536;
+  if (short_indices)
+    header.flags |= flag_short_indices;
+
+  // Lay out the blobs after the tables
+  auto offset = sizeof(header) + uint64_t(header.stream_count) * sizeof(entry_stream) +
+                uint64_t(header.submesh_count) * sizeof(mesh_data::submesh);
+  std::vector<entry_stream> streams;
+  for (auto &s : data.get_streams()) {
+    offset = align_blob(offset);
+    streams.push_back({s.first, static_cast<uint32_t>(s.second.components), offset});
+    offset += vertices * s.second.components * sizeof(float);
+  }
+  header.index_offset = align_blob(offset);
+
+  // Write to a temporary file first, so a reader never maps a partial entry
+  std::stringstream temp;
+  temp << path << "." << std::this_thread::get_id() << ".tmp";
+  {
+    std::ofstream file(temp.str(), std::ios::binary);
+    // Pads the file up to a blob offset
+    auto pad_to = [&](uint64_t target) {
+      static const char zeros[blob_alignment] = {};
+      auto position = static_cast<uint64_t>(file.tellp());
+      file.write(zeros, static_cast<std::streamsize>(target - position));
+    };
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!streams.empty())
+      file.write(reinterpret_cast<const char *>(&streams[0]), streams.size() * sizeof(entry_stream));
+    if (!data.get_submeshes().empty())
+      file.write(reinterpret_cast<const char *>(&data.get_submeshes()[0]),
+                 data.get_submeshes().size() * sizeof(mesh_data::submesh));
+    size_t i = 0;
+    for (auto &s : data.get_streams()) {
+      pad_to(streams[i++].offset);
+      file.write(reinterpret_cast<const char *>(s.second.get()), vertices * s.second.components * sizeof(float));
+    }
+    pad_to(header.index_offset);
+    if (short_indices) {
+      std::vector<uint16_t> narrow(data.get_index_data(), data.get_index_data() + data.get_index_count());
+      if (!narrow.empty())
+        file.write(reinterpret_cast<const char *>(&narrow[0]), narrow.size() * sizeof(uint16_t));
+    } else if (data.get_index_count() > 0)
+      file.write(reinterpret_cast<const char *>(data.get_index_data()), data.get_index_count() * sizeof(GLuint));
+    if (!file.good()) {
+      file.close();
+      std::remove(temp.str().c_str());
+      LOG_WARNING << "could not write mesh cache entry " << path << " for " << data.get_name();
+      return false;
+    }
+  }
+  // Replace an out of date entry.  If another thread has written the same entry first that is just as good
+  if (std::rename(temp.str().c_str(), path.c_str()) != 0) {
+    std::remove(path.c_str());
+    if (std::rename(temp.str().c_str(), path.c_str()) != 0)
+      std::remove(temp.str().c_str());
+  }
+  LOG_DEBUG << "mesh entry " << path << " written for " << data.get_name();
+  return true;
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "mesh_data.h"
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Static class caching imported models in a binary format, so text formats
+such as OBJ are only parsed once.  The first import of a model writes its
+mesh data to the cache directory, named by a hash of the source file's
+contents.  Later imports of an unchanged file map the cache entry and point
+the mesh data straight at its attribute and index blobs, which are uploaded
+without being copied.  Entries are versioned, and any entry that does not
+match the source hash or version is ignored and rewritten.  All functions
+are thread safe once the settings are made
+*/
+class mesh_cache {
+public:
+  // The version of the cache format.  Increase when the format or the import processing changes
+  static const uint32_t version = 1;
+
+private:
+  // The directory cache entries are written to
+  static std::string _directory;
+  // Flag determining if the cache is used
+  static bool _enabled;
+  // Flag determining if indices are narrowed to 16 bits where possible
+  static bool _compress_indices;
+  // The number of imports served from the cache
+  static std::atomic<size_t> _hits;
+  // The number of imports that wrote a new entry
+  static std::atomic<size_t> _misses;
+  // Gets the path of the entry for a source hash
+  static std::string get_path(uint64_t hash);
+
+public:
+  // Hashes the contents of a file.  Returns 0 if the file cannot be read
+  static uint64_t hash_file(const std::string &filename);
+  // Fills mesh data from the entry for a source hash.  Returns false if there is no valid entry
+  static bool load(uint64_t hash, const std::string &name, mesh_data &data);
+  // Writes mesh data as the entry for a source hash.  Returns false if the entry could not be written
+  static bool store(uint64_t hash, const mesh_data &data);
+  // Fills mesh data from an entry file, such as one written by the asset baker.  The source hash is only checked if
+  // it is not 0.  Ignores the cache settings
+  static bool read_entry(const std::string &path, uint64_t hash, const std::string &name, mesh_data &data);
+  // Writes mesh data to an entry file.  Ignores the cache settings
+  static bool write_entry(const std::string &path, uint64_t hash, const mesh_data &data);
+  // Checks if the cache is used
+  static bool is_enabled() { return _enabled; }
+  // Sets if the cache is used
+  static void set_enabled(bool value) { _enabled = value; }
+  // Gets the directory cache entries are written to
+  static const std::string &get_directory() { return _directory; }
+  // Sets the directory cache entries are written to
+  static void set_directory(const std::string &value) { _directory = value; }
+  // Sets if new entries store indices in 16 bits when every index fits.  Smaller files, but the indices are widened
+  // on load rather than uploaded from the mapping
+  static void set_compress_indices(bool value) { _compress_indices = value; }
+  // Gets the number of imports served from the cache
+  static size_t get_hits() { return _hits; }
+  // Gets the number of imports that wrote a new entry
+  static size_t get_misses() { return _misses; }
+};
+}
@@ -0,0 +1,265 @@
+#include "stdafx.h"
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include "asset_pack.h"
+#include "mesh_cache.h"
+#include "mesh_data.h"
+#include "util.h"
+
+namespace graphics_framework {
+/*
+Imports a model file.  Needs no OpenGL context
+*/
+mesh_data::mesh_data(const std::string &filename) {
+
+  // Check that file exists
+
+  if (!check_file_exists(filename)) {
+    // Deployments ship baked entries in place of the source models
+    if (check_file_exists(filename + ".mesh") && mesh_cache::read_entry(filename + ".mesh", 0, filename, *this))
+      return;
+    // Failed to read file.  Display error
+    LOG_ERROR << "could not load model file " << filename << ": File Does Not Exist";
+    // Throw exception
+    throw std::runtime_error("Error loading model file");
+  }
+
+  // Unchanged models are read from the binary cache rather than parsed again
+  auto hash = mesh_cache::is_enabled() ? mesh_cache::hash_file(filename) : 0;
+  if (mesh_cache::load(hash, filename, *this))
+    return;
+
+  // Read in the model data, then build the attributes from the imported scene
+  Assimp::Importer model_importer;
+  load_scene(import_scene(filename, model_importer), filename);
+  // Write the cache entry for next time
+  mesh_cache::store(hash, *this);
+}
+
+// Imports a model file with the framework's processing
+const aiScene *mesh_data::import_scene(const std::string &filename, Assimp::Importer &importer) {
+  auto flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_ValidateDataStructure |
+               aiProcess_FindInvalidData;
+  // A model in an asset pack is parsed from the pack, with its extension as the format hint.  Files it references,
+  // such as OBJ materials, cannot be followed there
+  const aiScene *sc;
+  virtual_file packed;
+  if (asset_pack::find(filename, packed)) {
+    auto dot = filename.find_last_of('.');
+    auto hint = dot == std::string::npos ? std::string() : filename.substr(dot + 1);
+    sc = importer.ReadFileFromMemory(packed.get_data(), packed.get_size(), flags, hint.c_str());
+  } else
+    sc = importer.ReadFile(filename, flags);
+  // Check that data has been read in correctly
+  if (!sc) {
+    // Display error
+    LOG_ERROR << "loading geometry " << filename << ": " << importer.GetErrorString();
+    // Throw exception
+    throw std::runtime_error("Error reading in model file");
+  }
+  return sc;
+}
+
+/*
+Builds mesh data from a model already imported, such as one read by Assimp on a worker thread
+*/
+mesh_data::mesh_data(const aiScene *scene, const std::string &name) { load_scene(scene, name); }
+
+// Builds the mesh from an imported scene
+void mesh_data::load_scene(const aiScene *sc, const std::string &filename) {
+  // TODO - read in multiple texture coordinates
+  // TODO - mesh hierarchy?
+  // TODO - bones
+  // TODO - multiple colour values
+  // Declare vectors to store data
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec4> colours;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> tex_coords;
+  std::vector<GLuint> indices;
+  unsigned int vertex_begin = 0;
+  // Reserve the totals across all sub-meshes up front
+  size_t vertex_total = 0, face_total = 0;
+  for (unsigned int n = 0; n < sc->mNumMeshes; ++n) {
+    vertex_total += sc->mMeshes[n]->mNumVertices;
+    face_total += sc->mMeshes[n]->mNumFaces;
+  }
+  positions.reserve(vertex_total);
+  colours.reserve(vertex_total);
+  normals.reserve(vertex_total);
+  tex_coords.reserve(vertex_total);
+  indices.reserve(3 * face_total);
+  _submeshes.reserve(sc->mNumMeshes);
+  // Iterate through each sub-mesh in the model
+  for (unsigned int n = 0; n < sc->mNumMeshes; ++n) {
+    // Get the sub-mesh
+    auto mesh = sc->mMeshes[n];
+    // Record where the sub-mesh starts
+    submesh range = {static_cast<GLuint>(indices.size()), 0, vertex_begin, mesh->mNumVertices};
+    // Iterate through all the vertices in the sub-mesh
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+      // Get position vertex
+      auto pos = mesh->mVertices[i];
+      // Add to positions data
+      positions.push_back(glm::vec3(pos.x, pos.y, pos.z));
+    }
+    // If we have colour data then iterate through them
+    if (mesh->HasVertexColors(0))
+      // Iterate through colour data
+      for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        // Get the colour data from the mesh
+        auto col = mesh->mColors[0][i];
+        // Add to colour data vector
+        colours.push_back(glm::vec4(col.r, col.g, col.b, col.a));
+      }
+    // Otherwise just push back grey
+    else
+      for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
+        colours.push_back(glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
+    // If we have normals, then add to normal data
+    if (mesh->HasNormals())
+      for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        auto norm = mesh->mNormals[i];
+        normals.push_back(glm::vec3(norm.x, norm.y, norm.z));
+      }
+    // If we have texture coordinates then add to texture coordinate data
+    if (mesh->HasTextureCoords(0))
+      for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        auto tex_coord = mesh->mTextureCoords[0][i];
+        tex_coords.push_back(glm::vec2(tex_coord.x, tex_coord.y));
+      }
+    // If we have face information, then add to index buffer
+    if (mesh->HasFaces())
+      for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        auto face = mesh->mFaces[f];
+        for (auto i = 0; i < 3; ++i)
+          indices.push_back(vertex_begin + face.mIndices[i]);
+      }
+    range.index_count = static_cast<GLuint>(indices.size()) - range.first_index;
+    _submeshes.push_back(range);
+    vertex_begin += mesh->mNumVertices;
+  }
+
+  // Calculate the minimal and maximal
+  for (auto &v : positions) {
+    _minimal = glm::min(_minimal, v);
+    _maximal = glm::max(_maximal, v);
+  }
+
+  // Add the buffers to the mesh
+  add_buffer(positions, BUFFER_INDEXES::POSITION_BUFFER);
+  add_buffer(colours, BUFFER_INDEXES::COLOUR_BUFFER);
+  if (normals.size() != 0) {
+    add_buffer(normals, BUFFER_INDEXES::NORMAL_BUFFER);
+    generate_tb(normals);
+  }
+  if (tex_coords.size() != 0) {
+    add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+  }
+  if (indices.size() != 0) {
+    add_index_buffer(std::move(indices));
+  }
+  // Name the buffers after the model file
+  _name = filename;
+  // Log success
+  LOG_INFO << "mesh " << filename << " loaded " << (normals.size() ? "With normals & " : "With no normals & ")
+           << (tex_coords.size() ? "With UVs" : "With no UVs");
+}
+
+// Adds a buffer of vec2 data
+bool mesh_data::add_buffer(const std::vector<glm::vec2> &buffer, GLuint index) {
+  assert(buffer.size() > 0);
+  return add_buffer(index, glm::value_ptr(buffer[0]), 2, static_cast<GLuint>(buffer.size()));
+}
+
+// Adds a buffer of vec3 data
+bool mesh_data::add_buffer(const std::vector<glm::vec3> &buffer, GLuint index) {
+  assert(buffer.size() > 0);
+  return add_buffer(index, glm::value_ptr(buffer[0]), 3, static_cast<GLuint>(buffer.size()));
+}
+
+// Adds a buffer of vec4 data
+bool mesh_data::add_buffer(const std::vector<glm::vec4> &buffer, GLuint index) {
+  assert(buffer.size() > 0);
+  return add_buffer(index, glm::value_ptr(buffer[0]), 4, static_cast<GLuint>(buffer.size()));
+}
+
+// Adds a stream of float data
+bool mesh_data::add_buffer(GLuint index, const float *data, GLint components, GLuint count) {
+  // Check that index is viable
+  assert(index < 16);
+  // Every stream must hold the same number of vertices
+  if (!_streams.empty() && _vertices != count) {
+    LOG_ERROR << "adding buffer to mesh data: Buffer does not contain correct amount of vertices";
+    return false;
+  }
+  _vertices = count;
+  auto &s = _streams[index];
+  s.components = components;
+  s.data.assign(data, data + count * components);
+  s.mapped = nullptr;
+  return true;
+}
+
+// Sets the indices
+void mesh_data::add_index_buffer(std::vector<GLuint> buffer) {
+  _indices = std::move(buffer);
+  _mapped_indices = nullptr;
+  _index_count = static_cast<GLuint>(_indices.size());
+}
+
+// Calculates tangent and binormal buffers from the normals
+void mesh_data::generate_tb(const std::vector<glm::vec3> &normals) {
+  std::vector<glm::vec3> tangents, binormals;
+  calculate_tb(normals, tangents, binormals);
+  add_buffer(tangents, BUFFER_INDEXES::TANGENT_BUFFER);
+  add_buffer(binormals, BUFFER_INDEXES::BINORMAL_BUFFER);
+}
+
+// Calculates a tangent and binormal for each normal
+void mesh_data::calculate_tb(const std::vector<glm::vec3> &normals, std::vector<glm::vec3> &tangents,
+                             std::vector<glm::vec3> &binormals) {
+  tangents.clear();
+  binormals.clear();
+  tangents.reserve(normals.size());
+  binormals.reserve(normals.size());
+  // Iterate through each normal and generate
+  for (auto &n : normals) {
+    // Determine if tangent value.  Get orthogonal with forward and up vectors
+    // Orthogonal to forward vector
+    glm::vec3 c1 = glm::cross(n, glm::vec3(0.0f, 0.0f, 1.0f));
+    // Orthogonal to up vector
+    glm::vec3 c2 = glm::cross(n, glm::vec3(0.0f, 1.0f, 0.0f));
+    // Determine which vector has greater length.  This will be the tangent
+    if (glm::length(c1) > glm::length(c2))
+      tangents.push_back(glm::normalize(c1));
+    else
+      tangents.push_back(glm::normalize(c2));
+    // Generate binormal from tangent and normal
+    binormals.push_back(glm::normalize(glm::cross(n, tangents.back())));
+  }
+}
+
+// Gets the number of bytes the mesh will use on the GPU
+size_t mesh_data::get_bytes() const {
+  auto bytes = _index_count * sizeof(GLuint);
+  for (auto &s : _streams)
+    bytes += _vertices * s.second.components * sizeof(float);
+  return bytes;
+}
+
+// Frees the data once it has been uploaded
+void mesh_data::clear() {
+  _streams.clear();
+  _indices.clear();
+  _indices.shrink_to_fit();
+  _mapped_indices = nullptr;
+  _index_count = 0;
+  _vertices = 0;
+  _submeshes.clear();
+  // Unmaps the cache file once nothing else shares it
+  _mapping = virtual_file();
+}
+}
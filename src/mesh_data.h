@@ -0,0 +1,166 @@
+#pragma once
+
+#include "stdafx.h"
+#include "virtual_file.h"
+
+// Forward declarations of the Assimp scene and importer, so Assimp stays out of the public headers
+struct aiScene;
+namespace Assimp {
+class Importer;
+}
+
+namespace graphics_framework {
+/*
+Enumeration describing the default buffer locations used by the render
+framework
+*/
+enum BUFFER_INDEXES {
+  // The position data
+  POSITION_BUFFER = 0,
+  // The colour data
+  COLOUR_BUFFER = 1,
+  // The surface normals
+  NORMAL_BUFFER = 2,
+  // The binormals for the surfaces
+  BINORMAL_BUFFER = 3,
+  // The tangents for the surfaces
+  TANGENT_BUFFER = 4,
+  // Texture coordinates 0
+  TEXTURE_COORDS_0 = 10,
+  // Texture coordinates 1
+  TEXTURE_COORDS_1 = 11,
+  // Texture coordinates 2
+  TEXTURE_COORDS_2 = 12,
+  // Texture coordinates 3
+  TEXTURE_COORDS_3 = 13,
+  // Texture coordinates 4
+  TEXTURE_COORDS_4 = 14,
+  // Texture coordinates 5
+  TEXTURE_COORDS_5 = 15
+};
+
+/*
+The vertex attributes, indices and bounds of a mesh held in memory.  Building
+mesh data needs no OpenGL context, so models can be imported and procedural
+geometry generated on worker threads.  The data is moved to the GPU with
+geometry::upload on the render thread.  Mesh data read from the mesh cache
+points straight into the mapped cache file rather than holding its own copy
+*/
+class mesh_data {
+  // The mesh cache fills mesh data from its mapped files
+  friend class mesh_cache;
+
+public:
+  // One vertex attribute stored as tightly packed floats
+  struct stream {
+    // The number of float components per vertex
+    GLint components = 0;
+    // The attribute data, unless mapped
+    std::vector<float> data;
+    // The attribute data within a mapped file.  Null if held in data
+    const float *mapped = nullptr;
+    // Gets the attribute data
+    const float *get() const { return mapped ? mapped : data.data(); }
+  };
+
+  // A range of the mesh imported from one mesh in the source file
+  struct submesh {
+    // The first index of the range
+    GLuint first_index;
+    // The number of indices in the range
+    GLuint index_count;
+    // The first vertex of the range
+    GLuint first_vertex;
+    // The number of vertices in the range
+    GLuint vertex_count;
+  };
+
+private:
+  // The primitive geometry type of the mesh
+  GLenum _type = GL_TRIANGLES;
+  // The vertex attributes, keyed by attribute index
+  std::map<GLuint, stream> _streams;
+  // The indices, unless mapped
+  std::vector<GLuint> _indices;
+  // The indices within a mapped file.  Null if held in _indices
+  const GLuint *_mapped_indices = nullptr;
+  // The number of indices.  0 if the mesh is drawn as arrays
+  GLuint _index_count = 0;
+  // The ranges imported from each mesh in the source file.  Empty if the mesh was not imported
+  std::vector<submesh> _submeshes;
+  // The cache file the data points into, kept open while the data is in use
+  virtual_file _mapping;
+  // The number of vertices in the mesh
+  GLuint _vertices = 0;
+  // The minimal point of the mesh
+  glm::vec3 _minimal = glm::vec3(0.0f, 0.0f, 0.0f);
+  // The maximal point of the mesh
+  glm::vec3 _maximal = glm::vec3(0.0f, 0.0f, 0.0f);
+  // The name given to the GPU buffers, such as the model file
+  std::string _name;
+  // Builds the mesh from an imported scene
+  void load_scene(const aiScene *scene, const std::string &name);
+
+public:
+  // Creates empty mesh data
+  mesh_data() {}
+  // Imports a model file.  Thread safe
+  explicit mesh_data(const std::string &filename);
+  // Builds mesh data from a scene already imported by Assimp
+  mesh_data(const aiScene *scene, const std::string &name);
+  // Default copy and move constructors and assignment operators
+  mesh_data(const mesh_data &other) = default;
+  mesh_data(mesh_data &&other) = default;
+  mesh_data &operator=(const mesh_data &rhs) = default;
+  mesh_data &operator=(mesh_data &&rhs) = default;
+  // Destroys the mesh data
+  ~mesh_data() {}
+  // Gets the type of the mesh
+  GLenum get_type() const { return _type; }
+  // Sets the type of the mesh
+  void set_type(GLenum value) { _type = value; }
+  // Gets the vertex attributes, keyed by attribute index
+  const std::map<GLuint, stream> &get_streams() const { return _streams; }
+  // Gets the indices.  Null if the mesh is drawn as arrays
+  const GLuint *get_index_data() const { return _mapped_indices ? _mapped_indices : _indices.data(); }
+  // Gets the number of indices.  0 if the mesh is drawn as arrays
+  GLuint get_index_count() const { return _index_count; }
+  // Gets the ranges imported from each mesh in the source file
+  const std::vector<submesh> &get_submeshes() const { return _submeshes; }
+  // Gets the number of vertices in the mesh
+  GLuint get_vertex_count() const { return _vertices; }
+  // Gets the minimal point of the mesh
+  glm::vec3 get_minimal_point() const { return _minimal; }
+  // Sets the minimal point of the mesh
+  void set_minimal_point(const glm::vec3 &value) { _minimal = value; }
+  // Gets the maximal point of the mesh
+  glm::vec3 get_maximal_point() const { return _maximal; }
+  // Sets the maximal point of the mesh
+  void set_maximal_point(const glm::vec3 &value) { _maximal = value; }
+  // Gets the name given to the GPU buffers
+  const std::string &get_name() const { return _name; }
+  // Sets the name given to the GPU buffers
+  void set_name(const std::string &value) { _name = value; }
+  // Adds a stream of tightly packed float data, replacing any at the same index
+  bool add_buffer(GLuint index, const float *data, GLint components, GLuint count);
+  // Adds a buffer of vec2 data, replacing any at the same index
+  bool add_buffer(const std::vector<glm::vec2> &buffer, GLuint index);
+  // Adds a buffer of vec3 data, replacing any at the same index
+  bool add_buffer(const std::vector<glm::vec3> &buffer, GLuint index);
+  // Adds a buffer of vec4 data, replacing any at the same index
+  bool add_buffer(const std::vector<glm::vec4> &buffer, GLuint index);
+  // Sets the indices
+  void add_index_buffer(std::vector<GLuint> buffer);
+  // Calculates tangent and binormal buffers from the normals
+  void generate_tb(const std::vector<glm::vec3> &normals);
+  // Gets the number of bytes the mesh will use on the GPU
+  size_t get_bytes() const;
+  // Frees the data once it has been uploaded
+  void clear();
+  // Imports a model file with the framework's processing.  The scene is owned by the importer.  Thread safe
+  static const aiScene *import_scene(const std::string &filename, Assimp::Importer &importer);
+  // Calculates a tangent and binormal for each normal
+  static void calculate_tb(const std::vector<glm::vec3> &normals, std::vector<glm::vec3> &tangents,
+                           std::vector<glm::vec3> &binormals);
+};
+}
@@ -0,0 +1,363 @@
+#include "stdafx.h"
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MESHLET_CULL_SSE
+#endif
+
+#include "gpu_memory.h"
+#include "meshlet_geometry.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+const GLuint meshlet_geometry::max_vertices;
+const GLuint meshlet_geometry::max_triangles;
+effect meshlet_geometry::_cull_effect;
+
+// The bounds of one meshlet as read by the culling shader, matching the std430 layout
+struct gpu_meshlet {
+  // The centre and radius of the bounding sphere
+  float sphere[4];
+  // The cone axis and cutoff
+  float cone[4];
+  // The index count and first index, then padding
+  GLuint draw[4];
+};
+
+// One indirect draw, as read by glMultiDrawElementsIndirect
+struct draw_command {
+  // The number of indices
+  GLuint count;
+  // The number of instances.  0 if culled
+  GLuint instance_count;
+  // The first index
+  GLuint first_index;
+  // Added to every index
+  GLint base_vertex;
+  // The first instance
+  GLuint base_instance;
+};
+
+static_assert(sizeof(gpu_meshlet) == 48 && sizeof(draw_command) == 20,
+              "Meshlet culling structures must not be padded");
+
+// Culls one meshlet per invocation, writing a draw with one instance if visible and none if not
+static const char *cull_shader = R"(#version 430
+layout(local_size_x = 64) in;
+struct meshlet { vec4 sphere; vec4 cone; uvec4 draw; };
+struct draw_command { uint count; uint instance_count; uint first_index; int base_vertex; uint base_instance; };
+layout(std430, binding = 0) readonly buffer meshlet_buffer { meshlet meshlets[]; };
+layout(std430, binding = 1) writeonly buffer command_buffer { draw_command commands[]; };
+uniform vec4 planes[6];
+uniform vec3 eye;
+uniform uint meshlet_count;
+void main() {
+  uint i = gl_GlobalInvocationID.x;
+  if (i >= meshlet_count)
+    return;
+  meshlet m = meshlets[i];
+  bool visible = true;
+  for (int p = 0; p < 6; ++p)
+    visible = visible && dot(planes[p].xyz, m.sphere.xyz) + planes[p].w >= -m.sphere.w;
+  vec3 d = m.sphere.xyz - eye;
+  visible = visible && dot(d, m.cone.xyz) < m.cone.w * length(d) + m.sphere.w;
+  commands[i] = draw_command(m.draw.x, visible ? 1u : 0u, m.draw.y, 0, 0u);
+}
+)";
+
+// Sets a meshlet's sphere and cone from its triangles
+static void meshlet_bounds(meshlet_geometry::meshlet &m, const GLuint *indices, const float *positions,
+                           const std::vector<GLuint> &vertices) {
+  auto position = [&](GLuint v) { return glm::vec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]); };
+  // The sphere is centred on the box around the vertices
+  auto minimal = position(vertices[0]), maximal = minimal;
+  for (auto v : vertices) {
+    minimal = glm::min(minimal, position(v));
+    maximal = glm::max(maximal, position(v));
+  }
+  m.centre = (minimal + maximal) * 0.5f;
+  m.radius = 0.0f;
+  for (auto v : vertices)
+    m.radius = std::max(m.radius, glm::distance(m.centre, position(v)));
+
+  // The cone is centred on the average normal, and must hold every normal within 90 degrees to be useful
+  std::vector<glm::vec3> normals;
+  auto sum = glm::vec3(0.0f);
+  for (GLuint t = 0; t < m.triangle_count; ++t) {
+    auto tri = indices + m.first_index + t * 3;
+    auto p0 = position(tri[0]);
+    auto n = glm::cross(position(tri[1]) - p0, position(tri[2]) - p0);
+    auto length = glm::length(n);
+    // Degenerate triangles face nowhere
+    if (length > 0.0f) {
+      normals.push_back(n / length);
+      sum += normals.back();
+    }
+  }
+  m.cone_axis = glm::vec3(0.0f);
+  m.cone_cutoff = 1.0f;
+  auto length = glm::length(sum);
+  if (normals.empty() || length <= 0.0f)
+    return;
+  auto axis = sum / length;
+  auto min_dot = 1.0f;
+  for (auto &n : normals)
+    min_dot = std::min(min_dot, glm::dot(axis, n));
+  if (min_dot <= 0.0f)
+    return;
+  m.cone_axis = axis;
+  // The eye sees only back faces within 90 degrees minus the spread of the axis, behind the meshlet
+  m.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+
+// Reorders triangle list indices into meshlets
+bool meshlet_geometry::build_meshlets(mesh_data &data, std::vector<meshlet> &meshlets) {
+  meshlets.clear();
+  auto position = data.get_streams().find(POSITION_BUFFER);
+  if (data.get_type() != GL_TRIANGLES || data.get_index_count() < 3 || position == data.get_streams().end() ||
+      position->second.components != 3)
+    return false;
+  auto vertex_count = data.get_vertex_count();
+  auto triangle_count = data.get_index_count() / 3;
+  auto indices = data.get_index_data();
+  auto positions = position->second.get();
+
+  // The triangles using each vertex.  Triangles are removed as they are placed, leaving live[v] in the list
+  std::vector<GLuint> first(vertex_count + 1, 0), live(vertex_count, 0), adjacency(size_t(triangle_count) * 3);
+  for (GLuint i = 0; i < triangle_count * 3; ++i) {
+    if (indices[i] >= vertex_count)
+      return false;
+    ++live[indices[i]];
+  }
+  for (GLuint v = 0; v < vertex_count; ++v)
+    first[v + 1] = first[v] + live[v];
+  {
+    std::vector<GLuint> fill(first.begin(), first.end() - 1);
+    for (GLuint t = 0; t < triangle_count; ++t)
+      for (GLuint k = 0; k < 3; ++k)
+        adjacency[fill[indices[t * 3 + k]]++] = t;
+  }
+
+  std::vector<GLuint> result;
+  result.reserve(size_t(triangle_count) * 3);
+  std::vector<bool> placed(triangle_count, false);
+  // The vertices of the meshlet being built, and a flag for each vertex in it
+  std::vector<GLuint> members;
+  std::vector<unsigned char> member(vertex_count, 0);
+  // Counts the vertices of a triangle not yet in the meshlet
+  auto extra_vertices = [&](GLuint t) {
+    auto a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+    return GLuint(!member[a]) + GLuint(!member[b] && b != a) + GLuint(!member[c] && c != a && c != b);
+  };
+  meshlet current = {};
+  auto finish = [&]() {
+    current.vertex_count = static_cast<GLuint>(members.size());
+    meshlet_bounds(current, result.data(), positions, members);
+    meshlets.push_back(current);
+    for (auto v : members)
+      member[v] = 0;
+    members.clear();
+    current = meshlet();
+    current.first_index = static_cast<GLuint>(result.size());
+  };
+
+  GLuint scan = 0;
+  for (GLuint done = 0; done < triangle_count; ++done) {
+    // Take the triangle sharing the most vertices with the meshlet, so it grows as a compact patch
+    auto best = triangle_count;
+    GLuint best_extra = 4;
+    for (size_t i = 0; i < members.size() && best_extra > 0; ++i) {
+      auto v = members[i];
+      for (auto a = first[v]; a < first[v] + live[v]; ++a) {
+        auto extra = extra_vertices(adjacency[a]);
+        if (extra < best_extra) {
+          best = adjacency[a];
+          best_extra = extra;
+        }
+      }
+    }
+    // Nothing shares a vertex, so start afresh from the next triangle in index order
+    if (best == triangle_count) {
+      while (placed[scan])
+        ++scan;
+      best = scan;
+      best_extra = extra_vertices(best);
+    }
+    if (current.triangle_count == max_triangles || members.size() + best_extra > max_vertices) {
+      finish();
+      best_extra = extra_vertices(best);
+    }
+
+    // Place the triangle and remove it from its vertices' lists
+    placed[best] = true;
+    for (GLuint k = 0; k < 3; ++k) {
+      auto v = indices[best * 3 + k];
+      result.push_back(v);
+      if (!member[v]) {
+        member[v] = 1;
+        members.push_back(v);
+      }
+      auto begin = adjacency.begin() + first[v], end = begin + live[v];
+      auto found = std::find(begin, end, best);
+      if (found != end) {
+        std::iter_swap(found, end - 1);
+        --live[v];
+      }
+    }
+    ++current.triangle_count;
+  }
+  finish();
+  data.add_index_buffer(std::move(result));
+  return true;
+}
+
+// Loads a model file and splits it into meshlets
+meshlet_geometry::meshlet_geometry(const std::string &filename) : meshlet_geometry(mesh_data(filename)) {}
+
+// Splits mesh data into meshlets and uploads it
+meshlet_geometry::meshlet_geometry(mesh_data &&data) : _name(data.get_name()) {
+  if (!build_meshlets(data, _meshlets)) {
+    LOG_ERROR << "building meshlets for " << _name << ": Mesh must be an indexed triangle list with positions";
+    throw std::runtime_error("Error building meshlet geometry");
+  }
+  // Lay the bounds out four to a block, padding the last with meshlets that are never reported
+  _blocks.assign((_meshlets.size() + 3) / 4, bounds_block());
+  for (size_t i = 0; i < _meshlets.size(); ++i) {
+    auto &m = _meshlets[i];
+    auto &b = _blocks[i / 4];
+    auto lane = i % 4;
+    b.centre_x[lane] = m.centre.x;
+    b.centre_y[lane] = m.centre.y;
+    b.centre_z[lane] = m.centre.z;
+    b.radius[lane] = m.radius;
+    b.axis_x[lane] = m.cone_axis.x;
+    b.axis_y[lane] = m.cone_axis.y;
+    b.axis_z[lane] = m.cone_axis.z;
+    b.cutoff[lane] = m.cone_cutoff;
+  }
+  _geometry = geometry(std::move(data));
+  if (is_gpu_culling_supported())
+    create_gpu_buffers();
+  LOG_INFO << "meshlet geometry " << _name << " built with " << _meshlets.size() << " meshlets, culled on the "
+           << (has_gpu_culling() ? "GPU" : "CPU");
+}
+
+// Creates the GPU culling buffers
+bool meshlet_geometry::create_gpu_buffers() {
+  std::vector<gpu_meshlet> bounds(_meshlets.size());
+  // Every meshlet is drawn until the first cull
+  std::vector<draw_command> commands(_meshlets.size());
+  for (size_t i = 0; i < _meshlets.size(); ++i) {
+    auto &m = _meshlets[i];
+    bounds[i] = {{m.centre.x, m.centre.y, m.centre.z, m.radius},
+                 {m.cone_axis.x, m.cone_axis.y, m.cone_axis.z, m.cone_cutoff},
+                 {m.triangle_count * 3, m.first_index, 0, 0}};
+    commands[i] = {m.triangle_count * 3, 1, m.first_index, 0, 0};
+  }
+  auto bounds_size = bounds.size() * sizeof(gpu_meshlet);
+  auto command_size = commands.size() * sizeof(draw_command);
+  glGenBuffers(1, &_bounds_buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, _bounds_buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, bounds_size, bounds.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glGenBuffers(1, &_command_buffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _command_buffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, command_size, commands.data(), GL_DYNAMIC_COPY);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  if (CHECK_GL_ERROR) {
+    // Not fatal.  Meshlets are culled on the CPU
+    LOG_ERROR << "creating meshlet culling buffers for " << _name << ": Could not create buffers";
+    glDeleteBuffers(1, &_bounds_buffer);
+    glDeleteBuffers(1, &_command_buffer);
+    _bounds_buffer = _command_buffer = 0;
+    return false;
+  }
+  gpu_memory::track_buffer(_bounds_buffer, bounds_size, gpu_memory::vertex_buffer, _name + " meshlet bounds");
+  gpu_memory::track_buffer(_command_buffer, command_size, gpu_memory::vertex_buffer, _name + " meshlet draws");
+  return true;
+}
+
+// Culls the meshlets on the CPU
+size_t meshlet_geometry::cull(const glm::mat4 &mvp, const glm::vec3 &eye, std::vector<GLuint> &visible) const {
+  visible.clear();
+  glm::vec4 planes[6];
+  get_frustum_planes(mvp, planes);
+  for (size_t i = 0; i < _blocks.size(); ++i) {
+    auto &b = _blocks[i];
+    int mask = 0;
+#ifdef MESHLET_CULL_SSE
+    auto cx = _mm_loadu_ps(b.centre_x), cy = _mm_loadu_ps(b.centre_y), cz = _mm_loadu_ps(b.centre_z);
+    auto radius = _mm_loadu_ps(b.radius);
+    // Outside if behind any plane by more than the radius
+    auto inside = _mm_cmpeq_ps(radius, radius);
+    auto negative_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+    for (auto &p : planes) {
+      auto distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(p.x)), _mm_mul_ps(cy, _mm_set1_ps(p.y))),
+                                 _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+    }
+    // Facing away if the direction from the eye lies far enough along the cone axis
+    auto dx = _mm_sub_ps(cx, _mm_set1_ps(eye.x)), dy = _mm_sub_ps(cy, _mm_set1_ps(eye.y)),
+         dz = _mm_sub_ps(cz, _mm_set1_ps(eye.z));
+    auto along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(b.axis_x)), _mm_mul_ps(dy, _mm_loadu_ps(b.axis_y))),
+                            _mm_mul_ps(dz, _mm_loadu_ps(b.axis_z)));
+    auto distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+    auto away = _mm_cmpge_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(b.cutoff), distance), radius));
+    mask = _mm_movemask_ps(_mm_andnot_ps(away, inside));
+#else
+    for (int lane = 0; lane < 4; ++lane) {
+      auto centre = glm::vec3(b.centre_x[lane], b.centre_y[lane], b.centre_z[lane]);
+      auto inside = true;
+      for (auto &p : planes)
+        inside = inside && glm::dot(glm::vec3(p), centre) + p.w >= -b.radius[lane];
+      auto d = centre - eye;
+      auto axis = glm::vec3(b.axis_x[lane], b.axis_y[lane], b.axis_z[lane]);
+      if (inside && glm::dot(d, axis) < b.cutoff[lane] * glm::length(d) + b.radius[lane])
+        mask |= 1 << lane;
+    }
+#endif
+    for (int lane = 0; lane < 4; ++lane)
+      if ((mask & (1 << lane)) && i * 4 + lane < _meshlets.size())
+        visible.push_back(static_cast<GLuint>(i * 4 + lane));
+  }
+  return visible.size();
+}
+
+// Culls the meshlets in the compute shader
+void meshlet_geometry::cull_on_gpu(const glm::mat4 &mvp, const glm::vec3 &eye) const {
+  assert(has_gpu_culling());
+  // Build the shared program the first time it is used
+  if (_cull_effect.get_program() == static_cast<GLuint>(-1)) {
+    effect eff;
+    eff.add_shader_source(cull_shader, GL_COMPUTE_SHADER, "meshlet culling");
+    eff.build();
+    _cull_effect = eff;
+  }
+  glm::vec4 planes[6];
+  get_frustum_planes(mvp, planes);
+  auto count = static_cast<GLuint>(_meshlets.size());
+  glUseProgram(_cull_effect.get_program());
+  glUniform4fv(_cull_effect.get_uniform_location("planes"), 6, glm::value_ptr(planes[0]));
+  glUniform3fv(_cull_effect.get_uniform_location("eye"), 1, glm::value_ptr(eye));
+  glUniform1uiv(_cull_effect.get_uniform_location("meshlet_count"), 1, &count);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, _bounds_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, _command_buffer);
+  glDispatchCompute((count + 63) / 64, 1, 1);
+  // The commands are read by the next indirect draw
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "culling meshlets of " << _name << ": Could not dispatch culling shader";
+    throw std::runtime_error("Error culling meshlets");
+  }
+}
+
+// Checks if the current context can cull meshlets in a compute shader
+bool meshlet_geometry::is_gpu_culling_supported() { return GLEW_VERSION_4_3 != 0; }
+
+// Deletes the culling shader
+void meshlet_geometry::shutdown() {
+  if (_cull_effect.get_program() != static_cast<GLuint>(-1))
+    glDeleteProgram(_cull_effect.get_program());
+  _cull_effect = effect();
+}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "effect.h"
+#include "geometry.h"
+#include "mesh_data.h"
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Geometry split into meshlets, small clusters of at most 64 vertices and 124
+triangles.  Each meshlet's indices are stored together, and each has a
+bounding sphere and a cone bounding its triangles' normals.  Before drawing,
+meshlets outside the view frustum, or whose every triangle faces away from
+the eye, are culled.  Culling runs on the CPU four meshlets at a time, or in a
+compute shader writing indirect draw commands when OpenGL 4.3 is available,
+so only the visible fraction of a dense scan is drawn.  Bounds are in mesh
+space
+*/
+class meshlet_geometry {
+public:
+  // The most vertices a meshlet refers to
+  static const GLuint max_vertices = 64;
+  // The most triangles in a meshlet
+  static const GLuint max_triangles = 124;
+
+  // A cluster of triangles
+  struct meshlet {
+    // The first index of the meshlet
+    GLuint first_index;
+    // The number of triangles
+    GLuint triangle_count;
+    // The number of distinct vertices the triangles refer to
+    GLuint vertex_count;
+    // The centre of the bounding sphere
+    glm::vec3 centre;
+    // The radius of the bounding sphere
+    float radius;
+    // The average direction of the triangles' normals
+    glm::vec3 cone_axis;
+    // The sine of the cone's half angle, which the cone test compares against.  1 if the normals are spread too far
+    // for the meshlet ever to be culled as facing away
+    float cone_cutoff;
+  };
+
+private:
+  // The bounds of four meshlets, laid out so one test covers all four
+  struct bounds_block {
+    // The sphere centres, one array per coordinate
+    float centre_x[4];
+    float centre_y[4];
+    float centre_z[4];
+    // The sphere radii
+    float radius[4];
+    // The cone axes, one array per coordinate
+    float axis_x[4];
+    float axis_y[4];
+    float axis_z[4];
+    // The cone cutoffs
+    float cutoff[4];
+  };
+  // The vertex buffers and the meshlet ordered indices
+  geometry _geometry;
+  // The meshlets, in index order
+  std::vector<meshlet> _meshlets;
+  // The meshlet bounds in blocks of four.  The last block is padded
+  std::vector<bounds_block> _blocks;
+  // The OpenGL ID of the storage buffer of bounds read by the culling shader.  0 without GPU culling
+  GLuint _bounds_buffer = 0;
+  // The OpenGL ID of the indirect draw commands written by the culling shader.  0 without GPU culling
+  GLuint _command_buffer = 0;
+  // The name used for logging, such as the model file
+  std::string _name;
+  // The compute shader shared by every meshlet geometry
+  static effect _cull_effect;
+  // Creates the GPU culling buffers.  Returns false if they could not be created, leaving culling on the CPU
+  bool create_gpu_buffers();
+
+public:
+  // Creates an empty meshlet geometry
+  meshlet_geometry() {}
+  // Loads a model file and splits it into meshlets
+  explicit meshlet_geometry(const std::string &filename);
+  // Splits mesh data into meshlets and uploads it.  The mesh data is left empty
+  explicit meshlet_geometry(mesh_data &&data);
+  // Default copy constructor and assignment operator
+  meshlet_geometry(const meshlet_geometry &other) = default;
+  meshlet_geometry &operator=(const meshlet_geometry &rhs) = default;
+  // Destroys the meshlet geometry
+  ~meshlet_geometry() {}
+  // Gets the vertex buffers and the meshlet ordered indices
+  const geometry &get_geometry() const { return _geometry; }
+  // Gets the meshlets, in index order
+  const std::vector<meshlet> &get_meshlets() const { return _meshlets; }
+  // Gets the name used for logging
+  const std::string &get_name() const { return _name; }
+  // Checks if meshlets are culled by a compute shader
+  bool has_gpu_culling() const { return _command_buffer != 0; }
+  // Gets the OpenGL ID of the indirect draw commands written by the culling shader
+  GLuint get_command_buffer() const { return _command_buffer; }
+  // Culls the meshlets on the CPU, given the model-view-projection matrix and the eye position in mesh space.  The
+  // indices of the visible meshlets are written out, in order.  Returns the number visible
+  size_t cull(const glm::mat4 &mvp, const glm::vec3 &eye, std::vector<GLuint> &visible) const;
+  // Culls the meshlets in the compute shader, filling the command buffer with one draw per meshlet.  Culled
+  // meshlets are drawn with no instances.  Binds the culling program, so the caller's effect must be bound again
+  void cull_on_gpu(const glm::mat4 &mvp, const glm::vec3 &eye) const;
+  // Reorders triangle list indices so each meshlet's are together, and finds the meshlets.  Needs no OpenGL
+  // context.  Triangles are gathered by shared vertices, so meshlets stay compact whatever the index order
+  static bool build_meshlets(mesh_data &data, std::vector<meshlet> &meshlets);
+  // Checks if the current context can cull meshlets in a compute shader
+  static bool is_gpu_culling_supported();
+  // Deletes the culling shader.  Called by the renderer before the context goes
+  static void shutdown();
+};
+}
@@ -0,0 +1,134 @@
+#include "stdafx.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include "mesh_data.h"
+#include "model.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Converts an Assimp matrix, stored by rows, to a glm matrix, stored by columns
+static glm::mat4 to_mat4(const aiMatrix4x4 &m) {
+  return glm::mat4(m.a1, m.b1, m.c1, m.d1, m.a2, m.b2, m.c2, m.d2, m.a3, m.b3, m.c3, m.d3, m.a4, m.b4, m.c4, m.d4);
+}
+
+// Loads a model file with its materials, textures and hierarchy
+model::model(const std::string &filename) : _name(filename) {
+  // Check that file exists
+  if (!check_file_exists(filename)) {
+    // Failed to read file.  Display error
+    LOG_ERROR << "could not load model " << filename << ": File Does Not Exist";
+    // Throw exception
+    throw std::runtime_error("Error loading model file");
+  }
+  Assimp::Importer importer;
+  auto sc = mesh_data::import_scene(filename, importer);
+  // All meshes go into the one set of buffers, with a submesh recorded for each
+  mesh_data data(sc, filename);
+  if (data.get_index_count() == 0 || data.get_submeshes().size() != sc->mNumMeshes) {
+    LOG_ERROR << "loading model " << filename << ": Model has no faces";
+    throw std::runtime_error("Error loading model file");
+  }
+
+  // Read the materials.  Textures are found relative to the model
+  auto slash = filename.find_last_of("/\\");
+  auto directory = slash == std::string::npos ? std::string() : filename.substr(0, slash + 1);
+  std::map<std::string, int> loaded;
+  for (unsigned int i = 0; i < sc->mNumMaterials; ++i) {
+    auto mat = sc->mMaterials[i];
+    material_slot slot;
+    aiString name;
+    if (mat->Get(AI_MATKEY_NAME, name) == aiReturn_SUCCESS)
+      slot.name = name.C_Str();
+    aiColor4D colour;
+    if (mat->Get(AI_MATKEY_COLOR_EMISSIVE, colour) == aiReturn_SUCCESS)
+      slot.properties.set_emissive(glm::vec4(colour.r, colour.g, colour.b, 1.0f));
+    if (mat->Get(AI_MATKEY_COLOR_DIFFUSE, colour) == aiReturn_SUCCESS)
+      slot.properties.set_diffuse(glm::vec4(colour.r, colour.g, colour.b, 1.0f));
+    if (mat->Get(AI_MATKEY_COLOR_SPECULAR, colour) == aiReturn_SUCCESS)
+      slot.properties.set_specular(glm::vec4(colour.r, colour.g, colour.b, 1.0f));
+    float shininess;
+    if (mat->Get(AI_MATKEY_SHININESS, shininess) == aiReturn_SUCCESS && shininess > 0.0f)
+      slot.properties.set_shininess(shininess);
+    // Embedded textures, named *0 and so on, are not supported
+    aiString path;
+    if (mat->GetTextureCount(aiTextureType_DIFFUSE) > 0 &&
+        mat->GetTexture(aiTextureType_DIFFUSE, 0, &path) == aiReturn_SUCCESS && path.C_Str()[0] != '*') {
+      slot.diffuse_map = directory + path.C_Str();
+      std::replace(slot.diffuse_map.begin(), slot.diffuse_map.end(), '\\', '/');
+      auto found = loaded.find(slot.diffuse_map);
+      if (found != loaded.end())
+        slot.diffuse_texture = found->second;
+      else {
+        // A missing texture leaves the material untextured rather than failing the model
+        try {
+          _textures.emplace_back(slot.diffuse_map);
+          slot.diffuse_texture = static_cast<int>(_textures.size()) - 1;
+        } catch (std::exception &) {
+          LOG_WARNING << "model " << filename << ": Could not load texture " << slot.diffuse_map;
+        }
+        loaded[slot.diffuse_map] = slot.diffuse_texture;
+      }
+    }
+    _materials.push_back(slot);
+  }
+  // A model with no materials still needs one to draw with
+  if (_materials.empty())
+    _materials.push_back(material_slot());
+
+  // Sort the ranges by material, remembering where each mesh went so the nodes can refer to them
+  std::vector<GLuint> order(sc->mNumMeshes);
+  std::iota(order.begin(), order.end(), 0);
+  auto material_of = [&](GLuint mesh) {
+    return std::min<GLuint>(sc->mMeshes[mesh]->mMaterialIndex, static_cast<GLuint>(_materials.size()) - 1);
+  };
+  std::stable_sort(order.begin(), order.end(), [&](GLuint a, GLuint b) { return material_of(a) < material_of(b); });
+  std::vector<GLuint> range_of(sc->mNumMeshes);
+  for (auto mesh : order) {
+    auto &sub = data.get_submeshes()[mesh];
+    range_of[mesh] = static_cast<GLuint>(_ranges.size());
+    _ranges.push_back({sc->mMeshes[mesh]->mName.C_Str(), sub.first_index, sub.index_count, material_of(mesh)});
+  }
+  // Lay out one multi-draw for each material used
+  for (auto &r : _ranges) {
+    if (r.index_count == 0)
+      continue;
+    if (_groups.empty() || _groups.back().material != r.material)
+      _groups.push_back({r.material, {}, {}});
+    _groups.back().counts.push_back(static_cast<GLsizei>(r.index_count));
+    _groups.back().offsets.push_back(reinterpret_cast<const void *>(size_t(r.first_index) * sizeof(GLuint)));
+  }
+
+  // Flatten the hierarchy, parents first
+  std::vector<std::pair<const aiNode *, int>> pending;
+  if (sc->mRootNode)
+    pending.emplace_back(sc->mRootNode, -1);
+  while (!pending.empty()) {
+    auto current = pending.back();
+    pending.pop_back();
+    node n;
+    n.name = current.first->mName.C_Str();
+    n.parent = current.second;
+    n.local = to_mat4(current.first->mTransformation);
+    n.world = n.parent < 0 ? n.local : _nodes[n.parent].world * n.local;
+    for (unsigned int i = 0; i < current.first->mNumMeshes; ++i)
+      n.ranges.push_back(range_of[current.first->mMeshes[i]]);
+    _nodes.push_back(n);
+    for (unsigned int i = current.first->mNumChildren; i > 0; --i)
+      pending.emplace_back(current.first->mChildren[i - 1], static_cast<int>(_nodes.size()) - 1);
+  }
+
+  // Upload the shared buffers
+  _geometry = geometry(std::move(data));
+  LOG_INFO << "model " << filename << " loaded with " << _ranges.size() << " ranges, " << _groups.size()
+           << " materials used and " << _nodes.size() << " nodes";
+}
+
+// Finds a node by name
+int model::find_node(const std::string &name) const {
+  for (size_t i = 0; i < _nodes.size(); ++i)
+    if (_nodes[i].name == name)
+      return static_cast<int>(i);
+  return -1;
+}
+}
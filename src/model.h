@@ -0,0 +1,113 @@
+#pragma once
+
+#include "geometry.h"
+#include "material.h"
+#include "stdafx.h"
+#include "texture.h"
+
+namespace graphics_framework {
+/*
+A model imported with its structure intact.  Every mesh in the file shares
+one set of vertex and index buffers, and becomes a range of the indices
+drawn with the material it was authored with.  Ranges are sorted by
+material, so the renderer draws a whole model with one vertex array bind and
+one multi-draw per material.  The node hierarchy is kept, with each node's
+transform and the ranges it places.  Ranges are drawn in mesh space, as
+geometry loaded from a file always has been
+*/
+class model {
+public:
+  // A range of the shared indices drawn with one material
+  struct range {
+    // The name of the mesh in the source file
+    std::string name;
+    // The first index of the range
+    GLuint first_index;
+    // The number of indices in the range
+    GLuint index_count;
+    // The material slot the range is drawn with
+    GLuint material;
+  };
+
+  // A material authored in the source file
+  struct material_slot {
+    // The name of the material in the source file
+    std::string name;
+    // The colour properties, bound to the effect when drawing
+    material properties;
+    // The diffuse texture file, resolved against the model's directory.  Empty if there is none
+    std::string diffuse_map;
+    // The index of the loaded diffuse texture.  -1 if there is none or it could not be loaded
+    int diffuse_texture = -1;
+  };
+
+  // A node of the model's hierarchy
+  struct node {
+    // The name of the node in the source file
+    std::string name;
+    // The index of the parent node.  -1 for the root
+    int parent;
+    // The transform relative to the parent
+    glm::mat4 local;
+    // The transform relative to the model
+    glm::mat4 world;
+    // The ranges the node places
+    std::vector<GLuint> ranges;
+  };
+
+  // The ranges drawn with one material, laid out for a single multi-draw
+  struct draw_group {
+    // The material slot of the group
+    GLuint material;
+    // The index count of each range
+    std::vector<GLsizei> counts;
+    // The byte offset of each range in the index buffer
+    std::vector<const void *> offsets;
+  };
+
+private:
+  // The shared buffers of every range
+  geometry _geometry;
+  // The ranges, sorted by material
+  std::vector<range> _ranges;
+  // The materials the ranges refer to
+  std::vector<material_slot> _materials;
+  // The textures the materials refer to, each loaded once
+  std::vector<texture> _textures;
+  // The node hierarchy, parents before their children
+  std::vector<node> _nodes;
+  // The draws for each material used
+  std::vector<draw_group> _groups;
+  // The file the model was loaded from
+  std::string _name;
+
+public:
+  // Creates an empty model
+  model() {}
+  // Loads a model file with its materials, textures and hierarchy
+  explicit model(const std::string &filename);
+  // Default copy constructor and assignment operator
+  model(const model &other) = default;
+  model &operator=(const model &rhs) = default;
+  // Destroys the model
+  ~model() {}
+  // Gets the shared buffers of every range
+  const geometry &get_geometry() const { return _geometry; }
+  // Gets the ranges, sorted by material
+  const std::vector<range> &get_ranges() const { return _ranges; }
+  // Gets the materials the ranges refer to
+  const std::vector<material_slot> &get_materials() const { return _materials; }
+  // Gets a material slot so its properties can be changed
+  material_slot &get_material(size_t index) { return _materials[index]; }
+  // Gets the textures the materials refer to
+  const std::vector<texture> &get_textures() const { return _textures; }
+  // Gets the node hierarchy, parents before their children
+  const std::vector<node> &get_nodes() const { return _nodes; }
+  // Gets the draws for each material used
+  const std::vector<draw_group> &get_draw_groups() const { return _groups; }
+  // Gets the file the model was loaded from
+  const std::string &get_name() const { return _name; }
+  // Finds a node by name.  Returns -1 if there is none
+  int find_node(const std::string &name) const;
+};
+}
@@ -0,0 +1,1423 @@
+#define ENU_NULL_GL_NO_REDIRECT
+#include "stdafx.h"
+
+#ifdef ENU_GFX_NULL_GL
+
+#include "log.h"
+
+namespace graphics_framework {
+namespace null_gl {
+// The entry points implemented, used to index the call counts
+#define ENU_NULL_GL_ENTRY_POINTS(X)                                                                                   \
+  X(glActiveTexture)                                                                                                   \
+  X(glAttachShader)                                                                                                    \
+  X(glBeginQuery)                                                                                                      \
+  X(glBindBuffer)                                                                                                      \
+  X(glBindBufferBase)                                                                                                  \
+  X(glBindFramebuffer)                                                                                                 \
+  X(glBindTexture)                                                                                                     \
+  X(glBindVertexArray)                                                                                                 \
+  X(glBlendFunc)                                                                                                       \
+  X(glBufferData)                                                                                                      \
+  X(glBufferStorage)                                                                                                   \
+  X(glBufferSubData)                                                                                                   \
+  X(glCheckFramebufferStatus)                                                                                          \
+  X(glClear)                                                                                                           \
+  X(glClearColor)                                                                                                      \
+  X(glClearDepth)                                                                                                      \
+  X(glClientWaitSync)                                                                                                  \
+  X(glCompileShader)                                                                                                   \
+  X(glCopyBufferSubData)                                                                                               \
+  X(glCreateProgram)                                                                                                   \
+  X(glCreateShader)                                                                                                    \
+  X(glCullFace)                                                                                                        \
+  X(glDebugMessageCallback)                                                                                            \
+  X(glDebugMessageControl)                                                                                             \
+  X(glDeleteBuffers)                                                                                                   \
+  X(glDeleteFramebuffers)                                                                                              \
+  X(glDeleteProgram)                                                                                                   \
+  X(glDeleteQueries)                                                                                                   \
+  X(glDeleteShader)                                                                                                    \
+  X(glDeleteSync)                                                                                                      \
+  X(glDeleteTextures)                                                                                                  \
+  X(glDeleteVertexArrays)                                                                                              \
+  X(glDepthFunc)                                                                                                       \
+  X(glDepthMask)                                                                                                       \
+  X(glDetachShader)                                                                                                    \
+  X(glDisable)                                                                                                         \
+  X(glDispatchCompute)                                                                                                 \
+  X(glDrawArrays)                                                                                                      \
+  X(glDrawArraysInstanced)                                                                                             \
+  X(glDrawBuffer)                                                                                                      \
+  X(glDrawBuffers)                                                                                                     \
+  X(glDrawElements)                                                                                                    \
+  X(glDrawElementsBaseVertex)                                                                                          \
+  X(glEnable)                                                                                                          \
+  X(glEnableVertexAttribArray)                                                                                         \
+  X(glEndQuery)                                                                                                        \
+  X(glFenceSync)                                                                                                       \
+  X(glFinish)                                                                                                          \
+  X(glFramebufferTexture)                                                                                              \
+  X(glFramebufferTexture2D)                                                                                            \
+  X(glGenBuffers)                                                                                                      \
+  X(glGenFramebuffers)                                                                                                 \
+  X(glGenQueries)                                                                                                      \
+  X(glGenTextures)                                                                                                     \
+  X(glGenVertexArrays)                                                                                                 \
+  X(glGenerateMipmap)                                                                                                  \
+  X(glGetActiveUniform)                                                                                                \
+  X(glGetAttachedShaders)                                                                                              \
+  X(glGetBooleanv)                                                                                                     \
+  X(glGetBufferParameteriv)                                                                                            \
+  X(glGetBufferSubData)                                                                                                \
+  X(glGetError)                                                                                                        \
+  X(glGetFloatv)                                                                                                       \
+  X(glGetFramebufferAttachmentParameteriv)                                                                             \
+  X(glGetIntegerv)                                                                                                     \
+  X(glGetProgramInfoLog)                                                                                               \
+  X(glGetProgramiv)                                                                                                    \
+  X(glGetQueryObjectui64v)                                                                                             \
+  X(glGetShaderInfoLog)                                                                                                \
+  X(glGetShaderSource)                                                                                                 \
+  X(glGetShaderiv)                                                                                                     \
+  X(glGetString)                                                                                                       \
+  X(glGetTexImage)                                                                                                     \
+  X(glGetTexLevelParameteriv)                                                                                          \
+  X(glGetTexParameteriv)                                                                                               \
+  X(glGetUniformLocation)                                                                                              \
+  X(glGetUniformfv)                                                                                                    \
+  X(glGetUniformiv)                                                                                                    \
+  X(glGetUniformuiv)                                                                                                   \
+  X(glGetVertexAttribiv)                                                                                               \
+  X(glHint)                                                                                                            \
+  X(glIsEnabled)                                                                                                       \
+  X(glLinkProgram)                                                                                                     \
+  X(glMapBufferRange)                                                                                                  \
+  X(glMemoryBarrier)                                                                                                   \
+  X(glMultiDrawArrays)                                                                                                 \
+  X(glMultiDrawElements)                                                                                               \
+  X(glMultiDrawElementsBaseVertex)                                                                                     \
+  X(glMultiDrawElementsIndirect)                                                                                       \
+  X(glPixelStorei)                                                                                                     \
+  X(glPolygonOffset)                                                                                                   \
+  X(glReadBuffer)                                                                                                      \
+  X(glReadPixels)                                                                                                      \
+  X(glShaderSource)                                                                                                    \
+  X(glTexImage1D)                                                                                                      \
+  X(glTexImage2D)                                                                                                      \
+  X(glTexParameterf)                                                                                                   \
+  X(glTexParameterfv)                                                                                                  \
+  X(glTexParameteri)                                                                                                   \
+  X(glTexSubImage2D)                                                                                                   \
+  X(glUniform)                                                                                                         \
+  X(glUnmapBuffer)                                                                                                     \
+  X(glUseProgram)                                                                                                      \
+  X(glVertexAttribDivisor)                                                                                             \
+  X(glVertexAttribPointer)                                                                                             \
+  X(glViewport)                                                                                                        \
+  X(glfwCreateWindow)                                                                                                  \
+  X(glfwGetKey)                                                                                                        \
+  X(glfwGetPrimaryMonitor)                                                                                             \
+  X(glfwGetVideoMode)                                                                                                  \
+  X(glfwInit)                                                                                                          \
+  X(glfwInitHint)                                                                                                      \
+  X(glfwMakeContextCurrent)                                                                                            \
+  X(glfwPollEvents)                                                                                                    \
+  X(glfwSetCallback)                                                                                                   \
+  X(glfwSetWindowMonitor)                                                                                              \
+  X(glfwSetWindowPos)                                                                                                  \
+  X(glfwSwapBuffers)                                                                                                   \
+  X(glfwSwapInterval)                                                                                                  \
+  X(glfwTerminate)                                                                                                     \
+  X(glfwWindowHint)                                                                                                    \
+  X(glfwWindowShouldClose)                                                                                             \
+  X(glewGetErrorString)                                                                                                \
+  X(glewInit)
+
+// Index of each entry point in the call counts
+enum entry_point {
+#define ENU_NULL_GL_ENUM(name) call_##name,
+  ENU_NULL_GL_ENTRY_POINTS(ENU_NULL_GL_ENUM)
+#undef ENU_NULL_GL_ENUM
+      num_entry_points
+};
+
+// Name of each entry point
+static const char *entry_point_names[] = {
+#define ENU_NULL_GL_NAME(name) #name,
+    ENU_NULL_GL_ENTRY_POINTS(ENU_NULL_GL_NAME)
+#undef ENU_NULL_GL_NAME
+};
+
+// A buffer object
+struct buffer_object {
+  // The contents of the buffer
+  std::vector<char> data;
+  // Whether the storage was created with glBufferStorage and cannot be respecified
+  bool immutable = false;
+  // Whether the buffer is mapped
+  bool mapped = false;
+};
+
+// A texture object
+struct texture_object {
+  // The target the texture was first bound to
+  GLenum target = 0;
+  // The dimensions of level 0
+  GLint width = 0, height = 0;
+  // The internal format of level 0
+  GLint internal_format = 0;
+  // Parameters set on the texture
+  std::map<GLenum, GLint> params;
+};
+
+// A vertex array object
+struct vertex_array_object {
+  // The bound index buffer
+  GLuint element_buffer = 0;
+  // The component count of each attribute
+  std::map<GLuint, GLint> sizes;
+};
+
+// A shader object
+struct shader_object {
+  // The type of shader
+  GLenum type;
+  // The source code
+  std::string source;
+};
+
+// A program object
+struct program_object {
+  // The attached shaders
+  std::vector<GLuint> shaders;
+  // Whether the program has been linked
+  bool linked = false;
+  // The uniform locations handed out, by name
+  std::unordered_map<std::string, GLint> locations;
+};
+
+// A frame buffer object
+struct frame_buffer_object {
+  // The attached textures, by attachment point
+  std::map<GLenum, GLuint> attachments;
+};
+
+// The state of the null context
+static struct {
+  // The next object ID.  IDs are unique across object types so mix ups are caught
+  GLuint next_id = 1;
+  // The live objects
+  std::unordered_map<GLuint, buffer_object> buffers;
+  std::unordered_map<GLuint, texture_object> textures;
+  std::unordered_map<GLuint, vertex_array_object> vertex_arrays;
+  std::unordered_map<GLuint, shader_object> shaders;
+  std::unordered_map<GLuint, program_object> programs;
+  std::unordered_map<GLuint, frame_buffer_object> frame_buffers;
+  std::set<GLuint> queries;
+  std::set<GLsync> syncs;
+  // Buffer bindings other than the index buffer, which belongs to the vertex array object
+  std::map<GLenum, GLuint> buffer_bindings;
+  // Texture bindings by unit and target
+  std::map<std::pair<GLuint, GLenum>, GLuint> texture_bindings;
+  // The active texture unit
+  GLuint active_unit = 0;
+  // The bound vertex array object, program and frame buffer
+  GLuint vertex_array = 0, program = 0, frame_buffer = 0;
+  // The enabled capabilities
+  std::set<GLenum> enabled;
+  // Fixed function state
+  GLint viewport[4] = {0, 0, 0, 0};
+  GLfloat clear_colour[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  GLfloat clear_depth = 1.0f;
+  GLboolean depth_mask = GL_TRUE;
+  GLenum cull_mode = GL_BACK, depth_func = GL_LESS, blend_src = GL_ONE, blend_dst = GL_ZERO;
+  GLint pack_alignment = 4, unpack_alignment = 4;
+  // The first error since the last glGetError
+  GLenum error = GL_NO_ERROR;
+  // The call counts
+  std::array<unsigned long long, num_entry_points> counts = {};
+  // The number of draw calls
+  unsigned long long draws = 0;
+  // The number of invalid calls
+  unsigned long long validation_errors = 0;
+} state;
+
+// Counts a call
+static void count(entry_point e) { ++state.counts[e]; }
+
+// Records an invalid call.  Always returns false so callers can return the result
+static bool fail(entry_point e, const char *message, GLenum error = GL_INVALID_OPERATION) {
+  ++state.validation_errors;
+  if (state.error == GL_NO_ERROR)
+    state.error = error;
+  LOG_ERROR << "null GL " << entry_point_names[e] << ": " << message;
+  return false;
+}
+
+// Hands out a new object ID
+static GLuint new_id() { return state.next_id++; }
+
+// Gets the texture binding target for a texture image target
+static GLenum binding_target(GLenum target) {
+  if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+    return GL_TEXTURE_CUBE_MAP;
+  return target;
+}
+
+// Gets the buffer bound to a target
+static GLuint bound_buffer(GLenum target) {
+  if (target == GL_ELEMENT_ARRAY_BUFFER)
+    return state.vertex_arrays[state.vertex_array].element_buffer;
+  auto found = state.buffer_bindings.find(target);
+  return found == state.buffer_bindings.end() ? 0 : found->second;
+}
+
+// Gets the texture bound to a target on the active unit
+static GLuint bound_texture(GLenum target) {
+  auto found = state.texture_bindings.find(std::make_pair(state.active_unit, binding_target(target)));
+  return found == state.texture_bindings.end() ? 0 : found->second;
+}
+
+// Gets the size of pixel data
+static size_t pixel_bytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+  size_t components = 4;
+  switch (format) {
+  case GL_RED:
+  case GL_DEPTH_COMPONENT:
+    components = 1;
+    break;
+  case GL_RG:
+    components = 2;
+    break;
+  case GL_RGB:
+  case GL_BGR:
+    components = 3;
+    break;
+  }
+  size_t bytes = type == GL_UNSIGNED_BYTE || type == GL_BYTE ? 1 : (type == GL_HALF_FLOAT ? 2 : 4);
+  return static_cast<size_t>(width) * height * components * bytes;
+}
+
+// Checks a uniform can be set
+static void uniform(GLint location) {
+  count(call_glUniform);
+  if (state.program == 0)
+    fail(call_glUniform, "no program bound");
+  else if (location < -1)
+    fail(call_glUniform, "invalid location", GL_INVALID_VALUE);
+}
+
+// Checks a draw can be made
+static bool check_draw(entry_point e) {
+  ++state.draws;
+  if (state.program == 0)
+    return fail(e, "no program bound");
+  if (!state.programs[state.program].linked)
+    return fail(e, "program not linked");
+  if (state.vertex_array == 0)
+    return fail(e, "no vertex array object bound");
+  return true;
+}
+
+// Generates object IDs of one kind
+template <typename Map> static void gen(entry_point e, Map &objects, GLsizei n, GLuint *ids) {
+  count(e);
+  for (GLsizei i = 0; i < n; ++i) {
+    ids[i] = new_id();
+    objects[ids[i]];
+  }
+}
+
+// Deletes object IDs of one kind.  0 and unknown IDs are silently ignored, as in OpenGL
+template <typename Map> static void del(entry_point e, Map &objects, GLsizei n, const GLuint *ids) {
+  count(e);
+  for (GLsizei i = 0; i < n; ++i)
+    objects.erase(ids[i]);
+}
+
+unsigned long long get_call_count(const std::string &name) {
+  for (int i = 0; i < num_entry_points; ++i)
+    if (name == entry_point_names[i])
+      return state.counts[i];
+  return 0;
+}
+
+unsigned long long get_total_calls() {
+  return std::accumulate(state.counts.begin(), state.counts.end(), 0ull);
+}
+
+unsigned long long get_draw_calls() { return state.draws; }
+
+unsigned long long get_validation_errors() { return state.validation_errors; }
+
+void reset_counts() {
+  state.counts.fill(0);
+  state.draws = 0;
+  state.validation_errors = 0;
+}
+
+void dump(std::ostream &os) {
+  os << "Null GL: " << get_total_calls() << " calls, " << state.draws << " draws, " << state.validation_errors
+     << " invalid calls" << std::endl;
+  for (int i = 0; i < num_entry_points; ++i)
+    if (state.counts[i] > 0)
+      os << "  " << std::left << std::setw(40) << entry_point_names[i] << std::right << state.counts[i] << std::endl;
+}
+
+// OpenGL entry points
+
+void glActiveTexture(GLenum texture) {
+  count(call_glActiveTexture);
+  if (texture < GL_TEXTURE0 || texture >= GL_TEXTURE0 + 32)
+    fail(call_glActiveTexture, "invalid texture unit", GL_INVALID_ENUM);
+  else
+    state.active_unit = texture - GL_TEXTURE0;
+}
+
+void glAttachShader(GLuint program, GLuint shader) {
+  count(call_glAttachShader);
+  if (!state.programs.count(program) || !state.shaders.count(shader))
+    fail(call_glAttachShader, "unknown program or shader", GL_INVALID_VALUE);
+  else
+    state.programs[program].shaders.push_back(shader);
+}
+
+void glBeginQuery(GLenum target, GLuint id) {
+  count(call_glBeginQuery);
+  if (!state.queries.count(id))
+    fail(call_glBeginQuery, "unknown query");
+}
+
+void glBindBuffer(GLenum target, GLuint buffer) {
+  count(call_glBindBuffer);
+  if (buffer != 0 && !state.buffers.count(buffer)) {
+    fail(call_glBindBuffer, "buffer was not generated or has been deleted");
+    return;
+  }
+  if (target == GL_ELEMENT_ARRAY_BUFFER)
+    state.vertex_arrays[state.vertex_array].element_buffer = buffer;
+  else
+    state.buffer_bindings[target] = buffer;
+}
+
+void glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+  count(call_glBindBufferBase);
+  if (buffer != 0 && !state.buffers.count(buffer)) {
+    fail(call_glBindBufferBase, "buffer was not generated or has been deleted");
+    return;
+  }
+  // Binding to an indexed target also binds the generic target
+  state.buffer_bindings[target] = buffer;
+}
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer) {
+  count(call_glBindFramebuffer);
+  if (framebuffer != 0 && !state.frame_buffers.count(framebuffer))
+    fail(call_glBindFramebuffer, "frame buffer was not generated or has been deleted");
+  else
+    state.frame_buffer = framebuffer;
+}
+
+void glBindTexture(GLenum target, GLuint texture) {
+  count(call_glBindTexture);
+  if (texture != 0) {
+    auto found = state.textures.find(texture);
+    if (found == state.textures.end()) {
+      fail(call_glBindTexture, "texture was not generated or has been deleted");
+      return;
+    }
+    // A texture keeps the target it was first bound to
+    if (found->second.target == 0)
+      found->second.target = target;
+    else if (found->second.target != target) {
+      fail(call_glBindTexture, "texture bound to a different target");
+      return;
+    }
+  }
+  state.texture_bindings[std::make_pair(state.active_unit, target)] = texture;
+}
+
+void glBindVertexArray(GLuint array) {
+  count(call_glBindVertexArray);
+  if (array != 0 && !state.vertex_arrays.count(array))
+    fail(call_glBindVertexArray, "vertex array object was not generated or has been deleted");
+  else
+    state.vertex_array = array;
+}
+
+void glBlendFunc(GLenum sfactor, GLenum dfactor) {
+  count(call_glBlendFunc);
+  state.blend_src = sfactor;
+  state.blend_dst = dfactor;
+}
+
+void glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+  count(call_glBufferData);
+  auto buffer = bound_buffer(target);
+  if (buffer == 0) {
+    fail(call_glBufferData, "no buffer bound to target");
+    return;
+  }
+  if (state.buffers[buffer].immutable) {
+    fail(call_glBufferData, "buffer storage is immutable");
+    return;
+  }
+  auto &contents = state.buffers[buffer].data;
+  if (data)
+    contents.assign(static_cast<const char *>(data), static_cast<const char *>(data) + size);
+  else
+    contents.assign(static_cast<size_t>(size), 0);
+}
+
+void glBufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) {
+  count(call_glBufferStorage);
+  auto buffer = bound_buffer(target);
+  if (buffer == 0) {
+    fail(call_glBufferStorage, "no buffer bound to target");
+    return;
+  }
+  auto &object = state.buffers[buffer];
+  if (object.immutable) {
+    fail(call_glBufferStorage, "buffer storage is immutable");
+    return;
+  }
+  if (data)
+    object.data.assign(static_cast<const char *>(data), static_cast<const char *>(data) + size);
+  else
+    object.data.assign(static_cast<size_t>(size), 0);
+  object.immutable = true;
+}
+
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+  count(call_glBufferSubData);
+  auto buffer = bound_buffer(target);
+  if (buffer == 0) {
+    fail(call_glBufferSubData, "no buffer bound to target");
+    return;
+  }
+  auto &contents = state.buffers[buffer].data;
+  if (offset < 0 || static_cast<size_t>(offset + size) > contents.size()) {
+    fail(call_glBufferSubData, "range outside buffer", GL_INVALID_VALUE);
+    return;
+  }
+  memcpy(&contents[0] + offset, data, static_cast<size_t>(size));
+}
+
+GLenum glCheckFramebufferStatus(GLenum target) {
+  count(call_glCheckFramebufferStatus);
+  if (state.frame_buffer != 0 && state.frame_buffers[state.frame_buffer].attachments.empty())
+    return GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT;
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void glClear(GLbitfield mask) { count(call_glClear); }
+
+void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+  count(call_glClearColor);
+  state.clear_colour[0] = red;
+  state.clear_colour[1] = green;
+  state.clear_colour[2] = blue;
+  state.clear_colour[3] = alpha;
+}
+
+void glClearDepth(GLdouble depth) {
+  count(call_glClearDepth);
+  state.clear_depth = static_cast<GLfloat>(depth);
+}
+
+// Nothing is ever in flight, so every fence has signalled
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+  count(call_glClientWaitSync);
+  if (!state.syncs.count(sync)) {
+    fail(call_glClientWaitSync, "unknown sync object", GL_INVALID_VALUE);
+    return GL_WAIT_FAILED;
+  }
+  return GL_ALREADY_SIGNALED;
+}
+
+void glCompileShader(GLuint shader) {
+  count(call_glCompileShader);
+  if (!state.shaders.count(shader))
+    fail(call_glCompileShader, "unknown shader", GL_INVALID_VALUE);
+}
+
+void glCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset,
+                         GLsizeiptr size) {
+  count(call_glCopyBufferSubData);
+  auto read = bound_buffer(readTarget), write = bound_buffer(writeTarget);
+  if (read == 0 || write == 0) {
+    fail(call_glCopyBufferSubData, "no buffer bound to target");
+    return;
+  }
+  auto &source = state.buffers[read].data;
+  auto &dest = state.buffers[write].data;
+  if (readOffset < 0 || writeOffset < 0 || static_cast<size_t>(readOffset + size) > source.size() ||
+      static_cast<size_t>(writeOffset + size) > dest.size()) {
+    fail(call_glCopyBufferSubData, "range outside buffer", GL_INVALID_VALUE);
+    return;
+  }
+  if (read == write && readOffset < writeOffset + size && writeOffset < readOffset + size) {
+    fail(call_glCopyBufferSubData, "source and destination ranges overlap", GL_INVALID_VALUE);
+    return;
+  }
+  memmove(&dest[0] + writeOffset, &source[0] + readOffset, static_cast<size_t>(size));
+}
+
+GLuint glCreateProgram() {
+  count(call_glCreateProgram);
+  auto id = new_id();
+  state.programs[id];
+  return id;
+}
+
+GLuint glCreateShader(GLenum type) {
+  count(call_glCreateShader);
+  auto id = new_id();
+  state.shaders[id].type = type;
+  return id;
+}
+
+void glCullFace(GLenum mode) {
+  count(call_glCullFace);
+  state.cull_mode = mode;
+}
+
+void glDebugMessageCallback(GLDEBUGPROC callback, const void *user_param) { count(call_glDebugMessageCallback); }
+
+void glDebugMessageControl(GLenum source, GLenum type, GLenum severity, GLsizei count_, const GLuint *ids,
+                           GLboolean enabled) {
+  count(call_glDebugMessageControl);
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint *buffers) { del(call_glDeleteBuffers, state.buffers, n, buffers); }
+
+void glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers) {
+  del(call_glDeleteFramebuffers, state.frame_buffers, n, framebuffers);
+}
+
+void glDeleteProgram(GLuint program) {
+  count(call_glDeleteProgram);
+  state.programs.erase(program);
+  if (state.program == program)
+    state.program = 0;
+}
+
+void glDeleteQueries(GLsizei n, const GLuint *ids) {
+  count(call_glDeleteQueries);
+  for (GLsizei i = 0; i < n; ++i)
+    state.queries.erase(ids[i]);
+}
+
+void glDeleteShader(GLuint shader) {
+  count(call_glDeleteShader);
+  state.shaders.erase(shader);
+}
+
+void glDeleteSync(GLsync sync) {
+  count(call_glDeleteSync);
+  state.syncs.erase(sync);
+}
+
+void glDeleteTextures(GLsizei n, const GLuint *textures) { del(call_glDeleteTextures, state.textures, n, textures); }
+
+void glDeleteVertexArrays(GLsizei n, const GLuint *arrays) {
+  count(call_glDeleteVertexArrays);
+  for (GLsizei i = 0; i < n; ++i) {
+    // The default vertex array object cannot be deleted
+    if (arrays[i] == 0)
+      continue;
+    state.vertex_arrays.erase(arrays[i]);
+    if (state.vertex_array == arrays[i])
+      state.vertex_array = 0;
+  }
+}
+
+void glDepthFunc(GLenum func) {
+  count(call_glDepthFunc);
+  state.depth_func = func;
+}
+
+void glDepthMask(GLboolean flag) {
+  count(call_glDepthMask);
+  state.depth_mask = flag;
+}
+
+void glDetachShader(GLuint program, GLuint shader) {
+  count(call_glDetachShader);
+  auto &shaders = state.programs[program].shaders;
+  shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+}
+
+void glDisable(GLenum cap) {
+  count(call_glDisable);
+  state.enabled.erase(cap);
+}
+
+void glDispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z) {
+  count(call_glDispatchCompute);
+  if (state.program == 0)
+    fail(call_glDispatchCompute, "no program bound");
+  else if (!state.programs[state.program].linked)
+    fail(call_glDispatchCompute, "program not linked");
+}
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count_) {
+  count(call_glDrawArrays);
+  check_draw(call_glDrawArrays);
+}
+
+void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count_, GLsizei instancecount) {
+  count(call_glDrawArraysInstanced);
+  check_draw(call_glDrawArraysInstanced);
+}
+
+void glDrawBuffer(GLenum buf) { count(call_glDrawBuffer); }
+
+void glDrawBuffers(GLsizei n, const GLenum *bufs) { count(call_glDrawBuffers); }
+
+void glDrawElements(GLenum mode, GLsizei count_, GLenum type, const void *indices) {
+  count(call_glDrawElements);
+  if (check_draw(call_glDrawElements) && state.vertex_arrays[state.vertex_array].element_buffer == 0)
+    fail(call_glDrawElements, "no index buffer bound");
+}
+
+void glDrawElementsBaseVertex(GLenum mode, GLsizei count_, GLenum type, const void *indices, GLint basevertex) {
+  count(call_glDrawElementsBaseVertex);
+  if (check_draw(call_glDrawElementsBaseVertex) && state.vertex_arrays[state.vertex_array].element_buffer == 0)
+    fail(call_glDrawElementsBaseVertex, "no index buffer bound");
+}
+
+void glEnable(GLenum cap) {
+  count(call_glEnable);
+  state.enabled.insert(cap);
+}
+
+void glEnableVertexAttribArray(GLuint index) {
+  count(call_glEnableVertexAttribArray);
+  if (state.vertex_array == 0)
+    fail(call_glEnableVertexAttribArray, "no vertex array object bound");
+}
+
+void glEndQuery(GLenum target) { count(call_glEndQuery); }
+
+GLsync glFenceSync(GLenum condition, GLbitfield flags) {
+  count(call_glFenceSync);
+  auto sync = reinterpret_cast<GLsync>(static_cast<uintptr_t>(new_id()));
+  state.syncs.insert(sync);
+  return sync;
+}
+
+void glFinish() { count(call_glFinish); }
+
+void glFramebufferTexture(GLenum target, GLenum attachment, GLuint texture, GLint level) {
+  count(call_glFramebufferTexture);
+  if (state.frame_buffer == 0)
+    fail(call_glFramebufferTexture, "no frame buffer bound");
+  else if (texture != 0 && !state.textures.count(texture))
+    fail(call_glFramebufferTexture, "unknown texture", GL_INVALID_VALUE);
+  else
+    state.frame_buffers[state.frame_buffer].attachments[attachment] = texture;
+}
+
+void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+  count(call_glFramebufferTexture2D);
+  if (state.frame_buffer == 0)
+    fail(call_glFramebufferTexture2D, "no frame buffer bound");
+  else if (texture != 0 && !state.textures.count(texture))
+    fail(call_glFramebufferTexture2D, "unknown texture", GL_INVALID_VALUE);
+  else
+    state.frame_buffers[state.frame_buffer].attachments[attachment] = texture;
+}
+
+void glGenBuffers(GLsizei n, GLuint *buffers) { gen(call_glGenBuffers, state.buffers, n, buffers); }
+
+void glGenFramebuffers(GLsizei n, GLuint *framebuffers) {
+  gen(call_glGenFramebuffers, state.frame_buffers, n, framebuffers);
+}
+
+void glGenQueries(GLsizei n, GLuint *ids) {
+  count(call_glGenQueries);
+  for (GLsizei i = 0; i < n; ++i) {
+    ids[i] = new_id();
+    state.queries.insert(ids[i]);
+  }
+}
+
+void glGenTextures(GLsizei n, GLuint *textures) { gen(call_glGenTextures, state.textures, n, textures); }
+
+void glGenVertexArrays(GLsizei n, GLuint *arrays) { gen(call_glGenVertexArrays, state.vertex_arrays, n, arrays); }
+
+void glGenerateMipmap(GLenum target) {
+  count(call_glGenerateMipmap);
+  if (bound_texture(target) == 0)
+    fail(call_glGenerateMipmap, "no texture bound");
+}
+
+void glGetActiveUniform(GLuint program, GLuint index, GLsizei buf_size, GLsizei *length, GLint *size, GLenum *type,
+                        GLchar *name) {
+  count(call_glGetActiveUniform);
+  // No uniforms are reported as active
+  fail(call_glGetActiveUniform, "index out of range", GL_INVALID_VALUE);
+}
+
+void glGetAttachedShaders(GLuint program, GLsizei max_count, GLsizei *count_, GLuint *shaders) {
+  count(call_glGetAttachedShaders);
+  auto &attached = state.programs[program].shaders;
+  auto n = std::min(static_cast<GLsizei>(attached.size()), max_count);
+  std::copy(attached.begin(), attached.begin() + n, shaders);
+  if (count_)
+    *count_ = n;
+}
+
+void glGetBooleanv(GLenum pname, GLboolean *data) {
+  count(call_glGetBooleanv);
+  *data = pname == GL_DEPTH_WRITEMASK ? state.depth_mask : GL_FALSE;
+}
+
+void glGetBufferParameteriv(GLenum target, GLenum pname, GLint *params) {
+  count(call_glGetBufferParameteriv);
+  auto buffer = bound_buffer(target);
+  if (buffer == 0) {
+    fail(call_glGetBufferParameteriv, "no buffer bound to target");
+    return;
+  }
+  *params = pname == GL_BUFFER_SIZE ? static_cast<GLint>(state.buffers[buffer].data.size()) : 0;
+}
+
+void glGetBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void *data) {
+  count(call_glGetBufferSubData);
+  auto buffer = bound_buffer(target);
+  if (buffer == 0) {
+    fail(call_glGetBufferSubData, "no buffer bound to target");
+    return;
+  }
+  auto &contents = state.buffers[buffer].data;
+  if (static_cast<size_t>(offset + size) > contents.size()) {
+    fail(call_glGetBufferSubData, "range outside buffer", GL_INVALID_VALUE);
+    return;
+  }
+  memcpy(data, &contents[0] + offset, static_cast<size_t>(size));
+}
+
+GLenum glGetError() {
+  count(call_glGetError);
+  auto error = state.error;
+  state.error = GL_NO_ERROR;
+  return error;
+}
+
+void glGetFloatv(GLenum pname, GLfloat *data) {
+  count(call_glGetFloatv);
+  switch (pname) {
+  case GL_COLOR_CLEAR_VALUE:
+    std::copy(state.clear_colour, state.clear_colour + 4, data);
+    break;
+  case GL_DEPTH_CLEAR_VALUE:
+    *data = state.clear_depth;
+    break;
+  case GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT:
+    *data = 16.0f;
+    break;
+  default:
+    *data = 0.0f;
+    break;
+  }
+}
+
+void glGetFramebufferAttachmentParameteriv(GLenum target, GLenum attachment, GLenum pname, GLint *params) {
+  count(call_glGetFramebufferAttachmentParameteriv);
+  auto &attachments = state.frame_buffers[state.frame_buffer].attachments;
+  auto found = attachments.find(attachment);
+  if (pname == GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE)
+    *params = found == attachments.end() || found->second == 0 ? GL_NONE : GL_TEXTURE;
+  else if (pname == GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME)
+    *params = found == attachments.end() ? 0 : static_cast<GLint>(found->second);
+  else
+    *params = 0;
+}
+
+void glGetIntegerv(GLenum pname, GLint *data) {
+  count(call_glGetIntegerv);
+  switch (pname) {
+  case GL_ACTIVE_TEXTURE:
+    *data = GL_TEXTURE0 + state.active_unit;
+    break;
+  case GL_CURRENT_PROGRAM:
+    *data = state.program;
+    break;
+  case GL_FRAMEBUFFER_BINDING:
+    *data = state.frame_buffer;
+    break;
+  case GL_VERTEX_ARRAY_BINDING:
+    *data = state.vertex_array;
+    break;
+  case GL_TEXTURE_BINDING_2D:
+    *data = bound_texture(GL_TEXTURE_2D);
+    break;
+  case GL_TEXTURE_BINDING_CUBE_MAP:
+    *data = bound_texture(GL_TEXTURE_CUBE_MAP);
+    break;
+  case GL_ARRAY_BUFFER_BINDING:
+    *data = bound_buffer(GL_ARRAY_BUFFER);
+    break;
+  case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+    *data = bound_buffer(GL_ELEMENT_ARRAY_BUFFER);
+    break;
+  case GL_COPY_READ_BUFFER_BINDING:
+    *data = bound_buffer(GL_COPY_READ_BUFFER);
+    break;
+  case GL_VIEWPORT:
+    std::copy(state.viewport, state.viewport + 4, data);
+    break;
+  case GL_CULL_FACE_MODE:
+    *data = state.cull_mode;
+    break;
+  case GL_DEPTH_FUNC:
+    *data = state.depth_func;
+    break;
+  case GL_BLEND_SRC_RGB:
+    *data = state.blend_src;
+    break;
+  case GL_BLEND_DST_RGB:
+    *data = state.blend_dst;
+    break;
+  case GL_MAX_TEXTURE_SIZE:
+    *data = 16384;
+    break;
+  case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:
+    *data = 32;
+    break;
+  default:
+    *data = 0;
+    break;
+  }
+}
+
+void glGetProgramInfoLog(GLuint program, GLsizei buf_size, GLsizei *length, GLchar *info_log) {
+  count(call_glGetProgramInfoLog);
+  if (buf_size > 0)
+    info_log[0] = '\0';
+  if (length)
+    *length = 0;
+}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint *params) {
+  count(call_glGetProgramiv);
+  auto found = state.programs.find(program);
+  if (found == state.programs.end()) {
+    fail(call_glGetProgramiv, "unknown program", GL_INVALID_VALUE);
+    return;
+  }
+  switch (pname) {
+  case GL_LINK_STATUS:
+    *params = found->second.linked ? GL_TRUE : GL_FALSE;
+    break;
+  case GL_ATTACHED_SHADERS:
+    *params = static_cast<GLint>(found->second.shaders.size());
+    break;
+  case GL_INFO_LOG_LENGTH:
+  case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+    *params = 1;
+    break;
+  default:
+    *params = 0;
+    break;
+  }
+}
+
+void glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params) {
+  count(call_glGetQueryObjectui64v);
+  *params = 0;
+}
+
+void glGetShaderInfoLog(GLuint shader, GLsizei buf_size, GLsizei *length, GLchar *info_log) {
+  count(call_glGetShaderInfoLog);
+  if (buf_size > 0)
+    info_log[0] = '\0';
+  if (length)
+    *length = 0;
+}
+
+void glGetShaderSource(GLuint shader, GLsizei buf_size, GLsizei *length, GLchar *source) {
+  count(call_glGetShaderSource);
+  auto &text = state.shaders[shader].source;
+  auto n = std::min(static_cast<GLsizei>(text.size()), buf_size - 1);
+  if (n < 0)
+    return;
+  std::copy(text.begin(), text.begin() + n, source);
+  source[n] = '\0';
+  if (length)
+    *length = n;
+}
+
+void glGetShaderiv(GLuint shader, GLenum pname, GLint *params) {
+  count(call_glGetShaderiv);
+  auto found = state.shaders.find(shader);
+  if (found == state.shaders.end()) {
+    fail(call_glGetShaderiv, "unknown shader", GL_INVALID_VALUE);
+    return;
+  }
+  switch (pname) {
+  case GL_COMPILE_STATUS:
+    *params = GL_TRUE;
+    break;
+  case GL_SHADER_TYPE:
+    *params = found->second.type;
+    break;
+  case GL_SHADER_SOURCE_LENGTH:
+    *params = static_cast<GLint>(found->second.source.size() + 1);
+    break;
+  case GL_INFO_LOG_LENGTH:
+    *params = 1;
+    break;
+  default:
+    *params = 0;
+    break;
+  }
+}
+
+const GLubyte *glGetString(GLenum name) {
+  count(call_glGetString);
+  switch (name) {
+  case GL_VENDOR:
+    return reinterpret_cast<const GLubyte *>("Null");
+  case GL_RENDERER:
+    return reinterpret_cast<const GLubyte *>("Null GL");
+  case GL_VERSION:
+    return reinterpret_cast<const GLubyte *>("4.1 Null");
+  case GL_SHADING_LANGUAGE_VERSION:
+    return reinterpret_cast<const GLubyte *>("4.10 Null");
+  default:
+    return reinterpret_cast<const GLubyte *>("");
+  }
+}
+
+void glGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void *pixels) {
+  count(call_glGetTexImage);
+  auto texture = bound_texture(target);
+  if (texture == 0) {
+    fail(call_glGetTexImage, "no texture bound");
+    return;
+  }
+  auto &t = state.textures[texture];
+  memset(pixels, 0, pixel_bytes(std::max(1, t.width >> level), std::max(1, t.height >> level), format, type));
+}
+
+void glGetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint *params) {
+  count(call_glGetTexLevelParameteriv);
+  auto texture = bound_texture(target);
+  if (texture == 0) {
+    fail(call_glGetTexLevelParameteriv, "no texture bound");
+    return;
+  }
+  auto &t = state.textures[texture];
+  switch (pname) {
+  case GL_TEXTURE_WIDTH:
+    *params = std::max(1, t.width >> level);
+    break;
+  case GL_TEXTURE_HEIGHT:
+    *params = std::max(1, t.height >> level);
+    break;
+  case GL_TEXTURE_INTERNAL_FORMAT:
+    *params = t.internal_format;
+    break;
+  default:
+    *params = 0;
+    break;
+  }
+}
+
+void glGetTexParameteriv(GLenum target, GLenum pname, GLint *params) {
+  count(call_glGetTexParameteriv);
+  auto texture = bound_texture(target);
+  if (texture == 0) {
+    fail(call_glGetTexParameteriv, "no texture bound");
+    return;
+  }
+  auto &p = state.textures[texture].params;
+  auto found = p.find(pname);
+  *params = found == p.end() ? 0 : found->second;
+}
+
+GLint glGetUniformLocation(GLuint program, const GLchar *name) {
+  count(call_glGetUniformLocation);
+  auto found = state.programs.find(program);
+  if (found == state.programs.end() || !found->second.linked) {
+    fail(call_glGetUniformLocation, "program not linked");
+    return -1;
+  }
+  // Every name is treated as an active uniform and keeps the location first handed out
+  auto &locations = found->second.locations;
+  // Look up before inserting so repeated queries do not allocate a node
+  auto existing = locations.find(name);
+  if (existing != locations.end())
+    return existing->second;
+  return locations.emplace(name, static_cast<GLint>(locations.size())).first->second;
+}
+
+void glGetUniformfv(GLuint program, GLint location, GLfloat *params) {
+  count(call_glGetUniformfv);
+  *params = 0.0f;
+}
+
+void glGetUniformiv(GLuint program, GLint location, GLint *params) {
+  count(call_glGetUniformiv);
+  *params = 0;
+}
+
+void glGetUniformuiv(GLuint program, GLint location, GLuint *params) {
+  count(call_glGetUniformuiv);
+  *params = 0;
+}
+
+void glGetVertexAttribiv(GLuint index, GLenum pname, GLint *params) {
+  count(call_glGetVertexAttribiv);
+  auto &sizes = state.vertex_arrays[state.vertex_array].sizes;
+  auto found = sizes.find(index);
+  if (pname == GL_VERTEX_ATTRIB_ARRAY_SIZE)
+    *params = found == sizes.end() ? 4 : found->second;
+  else if (pname == GL_VERTEX_ATTRIB_ARRAY_ENABLED)
+    *params = found == sizes.end() ? GL_FALSE : GL_TRUE;
+  else
+    *params = 0;
+}
+
+void glHint(GLenum target, GLenum mode) { count(call_glHint); }
+
+GLboolean glIsEnabled(GLenum cap) {
+  count(call_glIsEnabled);
+  return state.enabled.count(cap) ? GL_TRUE : GL_FALSE;
+}
+
+void glLinkProgram(GLuint program) {
+  count(call_glLinkProgram);
+  auto found = state.programs.find(program);
+  if (found == state.programs.end())
+    fail(call_glLinkProgram, "unknown program", GL_INVALID_VALUE);
+  else if (found->second.shaders.empty())
+    fail(call_glLinkProgram, "no shaders attached");
+  else
+    found->second.linked = true;
+}
+
+void *glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+  count(call_glMapBufferRange);
+  auto buffer = bound_buffer(target);
+  if (buffer == 0) {
+    fail(call_glMapBufferRange, "no buffer bound to target");
+    return nullptr;
+  }
+  auto &object = state.buffers[buffer];
+  if (object.mapped) {
+    fail(call_glMapBufferRange, "buffer already mapped");
+    return nullptr;
+  }
+  if (length <= 0 || static_cast<size_t>(offset + length) > object.data.size()) {
+    fail(call_glMapBufferRange, "range outside buffer", GL_INVALID_VALUE);
+    return nullptr;
+  }
+  object.mapped = true;
+  return &object.data[0] + offset;
+}
+
+void glMemoryBarrier(GLbitfield barriers) { count(call_glMemoryBarrier); }
+
+void glMultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count_, GLsizei drawcount) {
+  count(call_glMultiDrawArrays);
+  check_draw(call_glMultiDrawArrays);
+}
+
+void glMultiDrawElements(GLenum mode, const GLsizei *count_, GLenum type, const void *const *indices,
+                         GLsizei drawcount) {
+  count(call_glMultiDrawElements);
+  if (check_draw(call_glMultiDrawElements) && state.vertex_arrays[state.vertex_array].element_buffer == 0)
+    fail(call_glMultiDrawElements, "no index buffer bound");
+}
+
+void glMultiDrawElementsBaseVertex(GLenum mode, const GLsizei *count_, GLenum type, const void *const *indices,
+                                   GLsizei drawcount, const GLint *basevertex) {
+  count(call_glMultiDrawElementsBaseVertex);
+  if (check_draw(call_glMultiDrawElementsBaseVertex) && state.vertex_arrays[state.vertex_array].element_buffer == 0)
+    fail(call_glMultiDrawElementsBaseVertex, "no index buffer bound");
+}
+
+void glMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride) {
+  count(call_glMultiDrawElementsIndirect);
+  if (!check_draw(call_glMultiDrawElementsIndirect))
+    return;
+  if (state.vertex_arrays[state.vertex_array].element_buffer == 0)
+    fail(call_glMultiDrawElementsIndirect, "no index buffer bound");
+  else if (state.buffer_bindings[GL_DRAW_INDIRECT_BUFFER] == 0)
+    fail(call_glMultiDrawElementsIndirect, "no indirect buffer bound");
+}
+
+void glPixelStorei(GLenum pname, GLint param) {
+  count(call_glPixelStorei);
+  if (pname == GL_PACK_ALIGNMENT)
+    state.pack_alignment = param;
+  else if (pname == GL_UNPACK_ALIGNMENT)
+    state.unpack_alignment = param;
+}
+
+void glPolygonOffset(GLfloat factor, GLfloat units) { count(call_glPolygonOffset); }
+
+void glReadBuffer(GLenum src) { count(call_glReadBuffer); }
+
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels) {
+  count(call_glReadPixels);
+  memset(pixels, 0, pixel_bytes(width, height, format, type));
+}
+
+void glShaderSource(GLuint shader, GLsizei count_, const GLchar *const *string, const GLint *length) {
+  count(call_glShaderSource);
+  auto found = state.shaders.find(shader);
+  if (found == state.shaders.end()) {
+    fail(call_glShaderSource, "unknown shader", GL_INVALID_VALUE);
+    return;
+  }
+  found->second.source.clear();
+  for (GLsizei i = 0; i < count_; ++i)
+    found->second.source += length && length[i] >= 0 ? std::string(string[i], length[i]) : std::string(string[i]);
+}
+
+void glTexImage1D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLint border, GLenum format,
+                  GLenum type, const void *pixels) {
+  count(call_glTexImage1D);
+  auto texture = bound_texture(target);
+  if (texture == 0) {
+    fail(call_glTexImage1D, "no texture bound");
+    return;
+  }
+  if (level == 0) {
+    auto &t = state.textures[texture];
+    t.width = width;
+    t.height = 1;
+    t.internal_format = internal_format;
+  }
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border,
+                  GLenum format, GLenum type, const void *pixels) {
+  count(call_glTexImage2D);
+  auto texture = bound_texture(target);
+  if (texture == 0) {
+    fail(call_glTexImage2D, "no texture bound");
+    return;
+  }
+  if (level == 0) {
+    auto &t = state.textures[texture];
+    t.width = width;
+    t.height = height;
+    t.internal_format = internal_format;
+  }
+}
+
+void glTexParameterf(GLenum target, GLenum pname, GLfloat param) {
+  count(call_glTexParameterf);
+  auto texture = bound_texture(target);
+  if (texture == 0)
+    fail(call_glTexParameterf, "no texture bound");
+  else
+    state.textures[texture].params[pname] = static_cast<GLint>(param);
+}
+
+void glTexParameterfv(GLenum target, GLenum pname, const GLfloat *params) {
+  count(call_glTexParameterfv);
+  if (bound_texture(target) == 0)
+    fail(call_glTexParameterfv, "no texture bound");
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+  count(call_glTexParameteri);
+  auto texture = bound_texture(target);
+  if (texture == 0)
+    fail(call_glTexParameteri, "no texture bound");
+  else
+    state.textures[texture].params[pname] = param;
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                     GLenum format, GLenum type, const void *pixels) {
+  count(call_glTexSubImage2D);
+  auto texture = bound_texture(target);
+  if (texture == 0) {
+    fail(call_glTexSubImage2D, "no texture bound");
+    return;
+  }
+  auto &t = state.textures[texture];
+  if (level == 0 && (xoffset + width > t.width || yoffset + height > t.height)) {
+    fail(call_glTexSubImage2D, "region outside texture", GL_INVALID_VALUE);
+    return;
+  }
+  // With an unpack buffer bound the pointer is an offset into it
+  auto unpack = bound_buffer(GL_PIXEL_UNPACK_BUFFER);
+  if (unpack != 0 && reinterpret_cast<uintptr_t>(pixels) + pixel_bytes(width, height, format, type) >
+                         state.buffers[unpack].data.size())
+    fail(call_glTexSubImage2D, "read outside unpack buffer", GL_INVALID_OPERATION);
+}
+
+void glUniform1f(GLint location, GLfloat v0) { uniform(location); }
+void glUniform1fv(GLint location, GLsizei count_, const GLfloat *value) { uniform(location); }
+void glUniform1i(GLint location, GLint v0) { uniform(location); }
+void glUniform1iv(GLint location, GLsizei count_, const GLint *value) { uniform(location); }
+void glUniform1uiv(GLint location, GLsizei count_, const GLuint *value) { uniform(location); }
+void glUniform2fv(GLint location, GLsizei count_, const GLfloat *value) { uniform(location); }
+void glUniform2iv(GLint location, GLsizei count_, const GLint *value) { uniform(location); }
+void glUniform2uiv(GLint location, GLsizei count_, const GLuint *value) { uniform(location); }
+void glUniform3fv(GLint location, GLsizei count_, const GLfloat *value) { uniform(location); }
+void glUniform3iv(GLint location, GLsizei count_, const GLint *value) { uniform(location); }
+void glUniform3uiv(GLint location, GLsizei count_, const GLuint *value) { uniform(location); }
+void glUniform4fv(GLint location, GLsizei count_, const GLfloat *value) { uniform(location); }
+void glUniform4iv(GLint location, GLsizei count_, const GLint *value) { uniform(location); }
+void glUniform4uiv(GLint location, GLsizei count_, const GLuint *value) { uniform(location); }
+void glUniformMatrix2fv(GLint location, GLsizei count_, GLboolean transpose, const GLfloat *value) {
+  uniform(location);
+}
+void glUniformMatrix3fv(GLint location, GLsizei count_, GLboolean transpose, const GLfloat *value) {
+  uniform(location);
+}
+void glUniformMatrix4fv(GLint location, GLsizei count_, GLboolean transpose, const GLfloat *value) {
+  uniform(location);
+}
+
+GLboolean glUnmapBuffer(GLenum target) {
+  count(call_glUnmapBuffer);
+  auto buffer = bound_buffer(target);
+  if (buffer == 0 || !state.buffers[buffer].mapped) {
+    fail(call_glUnmapBuffer, "buffer not mapped");
+    return GL_FALSE;
+  }
+  state.buffers[buffer].mapped = false;
+  return GL_TRUE;
+}
+
+void glUseProgram(GLuint program) {
+  count(call_glUseProgram);
+  if (program != 0 && (!state.programs.count(program) || !state.programs[program].linked))
+    fail(call_glUseProgram, "program was not linked or has been deleted");
+  else
+    state.program = program;
+}
+
+void glVertexAttribDivisor(GLuint index, GLuint divisor) {
+  count(call_glVertexAttribDivisor);
+  if (state.vertex_array == 0)
+    fail(call_glVertexAttribDivisor, "no vertex array object bound");
+}
+
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                           const void *pointer) {
+  count(call_glVertexAttribPointer);
+  if (state.vertex_array == 0)
+    fail(call_glVertexAttribPointer, "no vertex array object bound");
+  else if (bound_buffer(GL_ARRAY_BUFFER) == 0)
+    fail(call_glVertexAttribPointer, "no array buffer bound");
+  else
+    state.vertex_arrays[state.vertex_array].sizes[index] = size;
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  count(call_glViewport);
+  state.viewport[0] = x;
+  state.viewport[1] = y;
+  state.viewport[2] = width;
+  state.viewport[3] = height;
+}
+
+// GLFW and GLEW entry points.  A single fake window and monitor stand in for the real ones
+
+static char fake_window, fake_monitor;
+
+GLFWwindow *glfwCreateWindow(int width, int height, const char *title, GLFWmonitor *monitor, GLFWwindow *share) {
+  count(call_glfwCreateWindow);
+  state.viewport[2] = width;
+  state.viewport[3] = height;
+  return reinterpret_cast<GLFWwindow *>(&fake_window);
+}
+
+int glfwGetKey(GLFWwindow *window, int key) {
+  count(call_glfwGetKey);
+  return GLFW_RELEASE;
+}
+
+GLFWmonitor *glfwGetPrimaryMonitor() {
+  count(call_glfwGetPrimaryMonitor);
+  return reinterpret_cast<GLFWmonitor *>(&fake_monitor);
+}
+
+const GLFWvidmode *glfwGetVideoMode(GLFWmonitor *monitor) {
+  count(call_glfwGetVideoMode);
+  static const GLFWvidmode mode = {1920, 1080, 8, 8, 8, 60};
+  return &mode;
+}
+
+int glfwInit() {
+  count(call_glfwInit);
+  return GLFW_TRUE;
+}
+
+void glfwInitHint(int hint, int value) { count(call_glfwInitHint); }
+
+void glfwMakeContextCurrent(GLFWwindow *window) { count(call_glfwMakeContextCurrent); }
+
+void glfwPollEvents() { count(call_glfwPollEvents); }
+
+GLFWcursorposfun glfwSetCursorPosCallback(GLFWwindow *window, GLFWcursorposfun callback) {
+  count(call_glfwSetCallback);
+  return nullptr;
+}
+
+GLFWerrorfun glfwSetErrorCallback(GLFWerrorfun callback) {
+  count(call_glfwSetCallback);
+  return nullptr;
+}
+
+GLFWkeyfun glfwSetKeyCallback(GLFWwindow *window, GLFWkeyfun callback) {
+  count(call_glfwSetCallback);
+  return nullptr;
+}
+
+GLFWmousebuttonfun glfwSetMouseButtonCallback(GLFWwindow *window, GLFWmousebuttonfun callback) {
+  count(call_glfwSetCallback);
+  return nullptr;
+}
+
+GLFWscrollfun glfwSetScrollCallback(GLFWwindow *window, GLFWscrollfun callback) {
+  count(call_glfwSetCallback);
+  return nullptr;
+}
+
+void glfwSetWindowMonitor(GLFWwindow *window, GLFWmonitor *monitor, int xpos, int ypos, int width, int height,
+                          int refresh_rate) {
+  count(call_glfwSetWindowMonitor);
+}
+
+void glfwSetWindowPos(GLFWwindow *window, int xpos, int ypos) { count(call_glfwSetWindowPos); }
+
+void glfwSwapBuffers(GLFWwindow *window) { count(call_glfwSwapBuffers); }
+
+void glfwSwapInterval(int interval) { count(call_glfwSwapInterval); }
+
+void glfwTerminate() { count(call_glfwTerminate); }
+
+void glfwWindowHint(int hint, int value) { count(call_glfwWindowHint); }
+
+int glfwWindowShouldClose(GLFWwindow *window) {
+  count(call_glfwWindowShouldClose);
+  return GLFW_FALSE;
+}
+
+GLenum glewInit() {
+  count(call_glewInit);
+  return GLEW_OK;
+}
+
+const GLubyte *glewGetErrorString(GLenum error) {
+  count(call_glewGetErrorString);
+  return reinterpret_cast<const GLubyte *>("No error");
+}
+}
+}
+
+#endif
@@ -0,0 +1,483 @@
+#pragma once
+
+// Included by stdafx.h after the OpenGL and GLFW headers when built with ENU_GFX_NULL_GL
+
+namespace graphics_framework {
+/*
+Null OpenGL backend.  Every OpenGL, GLEW and GLFW entry point the framework
+uses is routed here instead of to the driver.  Object IDs are handed out and
+tracked, bindings are validated and every call is counted, but nothing is
+drawn.  Lets the framework run on machines without a GL context and measures
+its CPU overhead separately from the driver
+*/
+namespace null_gl {
+// Gets the number of calls made to the named entry point since the last reset.  Uniform setters are counted together
+// as glUniform and GLFW callback setters as glfwSetCallback
+unsigned long long get_call_count(const std::string &name);
+// Gets the number of calls made to all entry points since the last reset
+unsigned long long get_total_calls();
+// Gets the number of draw calls made since the last reset
+unsigned long long get_draw_calls();
+// Gets the number of invalid calls detected since the last reset
+unsigned long long get_validation_errors();
+// Resets the call and error counts
+void reset_counts();
+// Writes the non-zero call counts to the given stream
+void dump(std::ostream &os);
+}
+}
+
+// Remove GLEW's function pointer macros so the entry points can be declared
+#undef glActiveTexture
+#undef glAttachShader
+#undef glBeginQuery
+#undef glBindBuffer
+#undef glBindBufferBase
+#undef glBindFramebuffer
+#undef glBindTexture
+#undef glBindVertexArray
+#undef glBlendFunc
+#undef glBufferData
+#undef glBufferStorage
+#undef glBufferSubData
+#undef glCheckFramebufferStatus
+#undef glClear
+#undef glClearColor
+#undef glClearDepth
+#undef glClientWaitSync
+#undef glCompileShader
+#undef glCopyBufferSubData
+#undef glCreateProgram
+#undef glCreateShader
+#undef glCullFace
+#undef glDebugMessageCallback
+#undef glDebugMessageControl
+#undef glDeleteBuffers
+#undef glDeleteFramebuffers
+#undef glDeleteProgram
+#undef glDeleteQueries
+#undef glDeleteShader
+#undef glDeleteSync
+#undef glDeleteTextures
+#undef glDeleteVertexArrays
+#undef glDepthFunc
+#undef glDepthMask
+#undef glDetachShader
+#undef glDisable
+#undef glDispatchCompute
+#undef glDrawArrays
+#undef glDrawArraysInstanced
+#undef glDrawBuffer
+#undef glDrawBuffers
+#undef glDrawElements
+#undef glDrawElementsBaseVertex
+#undef glEnable
+#undef glEnableVertexAttribArray
+#undef glEndQuery
+#undef glFenceSync
+#undef glFinish
+#undef glFramebufferTexture
+#undef glFramebufferTexture2D
+#undef glGenBuffers
+#undef glGenFramebuffers
+#undef glGenQueries
+#undef glGenTextures
+#undef glGenVertexArrays
+#undef glGenerateMipmap
+#undef glGetActiveUniform
+#undef glGetAttachedShaders
+#undef glGetBooleanv
+#undef glGetBufferParameteriv
+#undef glGetBufferSubData
+#undef glGetError
+#undef glGetFloatv
+#undef glGetFramebufferAttachmentParameteriv
+#undef glGetIntegerv
+#undef glGetProgramInfoLog
+#undef glGetProgramiv
+#undef glGetQueryObjectui64v
+#undef glGetShaderInfoLog
+#undef glGetShaderSource
+#undef glGetShaderiv
+#undef glGetString
+#undef glGetTexImage
+#undef glGetTexLevelParameteriv
+#undef glGetTexParameteriv
+#undef glGetUniformLocation
+#undef glGetUniformfv
+#undef glGetUniformiv
+#undef glGetUniformuiv
+#undef glGetVertexAttribiv
+#undef glHint
+#undef glIsEnabled
+#undef glLinkProgram
+#undef glMapBufferRange
+#undef glMemoryBarrier
+#undef glMultiDrawArrays
+#undef glMultiDrawElements
+#undef glMultiDrawElementsBaseVertex
+#undef glMultiDrawElementsIndirect
+#undef glPixelStorei
+#undef glPolygonOffset
+#undef glReadBuffer
+#undef glReadPixels
+#undef glShaderSource
+#undef glTexImage1D
+#undef glTexImage2D
+#undef glTexParameterf
+#undef glTexParameterfv
+#undef glTexParameteri
+#undef glTexSubImage2D
+#undef glUniform1f
+#undef glUniform1fv
+#undef glUniform1i
+#undef glUniform1iv
+#undef glUniform1uiv
+#undef glUniform2fv
+#undef glUniform2iv
+#undef glUniform2uiv
+#undef glUniform3fv
+#undef glUniform3iv
+#undef glUniform3uiv
+#undef glUniform4fv
+#undef glUniform4iv
+#undef glUniform4uiv
+#undef glUniformMatrix2fv
+#undef glUniformMatrix3fv
+#undef glUniformMatrix4fv
+#undef glUnmapBuffer
+#undef glUseProgram
+#undef glVertexAttribDivisor
+#undef glVertexAttribPointer
+#undef glViewport
+#undef glfwCreateWindow
+#undef glfwGetKey
+#undef glfwGetPrimaryMonitor
+#undef glfwGetVideoMode
+#undef glfwInit
+#undef glfwInitHint
+#undef glfwMakeContextCurrent
+#undef glfwPollEvents
+#undef glfwSetCursorPosCallback
+#undef glfwSetErrorCallback
+#undef glfwSetKeyCallback
+#undef glfwSetMouseButtonCallback
+#undef glfwSetScrollCallback
+#undef glfwSetWindowMonitor
+#undef glfwSetWindowPos
+#undef glfwSwapBuffers
+#undef glfwSwapInterval
+#undef glfwTerminate
+#undef glfwWindowHint
+#undef glfwWindowShouldClose
+#undef glewInit
+#undef glewGetErrorString
+
+namespace graphics_framework {
+namespace null_gl {
+// OpenGL entry points
+void glActiveTexture(GLenum texture);
+void glAttachShader(GLuint program, GLuint shader);
+void glBeginQuery(GLenum target, GLuint id);
+void glBindBuffer(GLenum target, GLuint buffer);
+void glBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void glBindFramebuffer(GLenum target, GLuint framebuffer);
+void glBindTexture(GLenum target, GLuint texture);
+void glBindVertexArray(GLuint array);
+void glBlendFunc(GLenum sfactor, GLenum dfactor);
+void glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+void glBufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+GLenum glCheckFramebufferStatus(GLenum target);
+void glClear(GLbitfield mask);
+void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void glClearDepth(GLdouble depth);
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+void glCompileShader(GLuint shader);
+void glCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset,
+                         GLsizeiptr size);
+GLuint glCreateProgram();
+GLuint glCreateShader(GLenum type);
+void glCullFace(GLenum mode);
+void glDebugMessageCallback(GLDEBUGPROC callback, const void *user_param);
+void glDebugMessageControl(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint *ids,
+                           GLboolean enabled);
+void glDeleteBuffers(GLsizei n, const GLuint *buffers);
+void glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers);
+void glDeleteProgram(GLuint program);
+void glDeleteQueries(GLsizei n, const GLuint *ids);
+void glDeleteShader(GLuint shader);
+void glDeleteSync(GLsync sync);
+void glDeleteTextures(GLsizei n, const GLuint *textures);
+void glDeleteVertexArrays(GLsizei n, const GLuint *arrays);
+void glDepthFunc(GLenum func);
+void glDepthMask(GLboolean flag);
+void glDetachShader(GLuint program, GLuint shader);
+void glDisable(GLenum cap);
+void glDispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+void glDrawArrays(GLenum mode, GLint first, GLsizei count);
+void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count_, GLsizei instancecount);
+void glDrawBuffer(GLenum buf);
+void glDrawBuffers(GLsizei n, const GLenum *bufs);
+void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices);
+void glDrawElementsBaseVertex(GLenum mode, GLsizei count_, GLenum type, const void *indices, GLint basevertex);
+void glEnable(GLenum cap);
+void glEnableVertexAttribArray(GLuint index);
+void glEndQuery(GLenum target);
+GLsync glFenceSync(GLenum condition, GLbitfield flags);
+void glFinish();
+void glFramebufferTexture(GLenum target, GLenum attachment, GLuint texture, GLint level);
+void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+void glGenBuffers(GLsizei n, GLuint *buffers);
+void glGenFramebuffers(GLsizei n, GLuint *framebuffers);
+void glGenQueries(GLsizei n, GLuint *ids);
+void glGenTextures(GLsizei n, GLuint *textures);
+void glGenVertexArrays(GLsizei n, GLuint *arrays);
+void glGenerateMipmap(GLenum target);
+void glGetActiveUniform(GLuint program, GLuint index, GLsizei buf_size, GLsizei *length, GLint *size, GLenum *type,
+                        GLchar *name);
+void glGetAttachedShaders(GLuint program, GLsizei max_count, GLsizei *count, GLuint *shaders);
+void glGetBooleanv(GLenum pname, GLboolean *data);
+void glGetBufferParameteriv(GLenum target, GLenum pname, GLint *params);
+void glGetBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void *data);
+GLenum glGetError();
+void glGetFloatv(GLenum pname, GLfloat *data);
+void glGetFramebufferAttachmentParameteriv(GLenum target, GLenum attachment, GLenum pname, GLint *params);
+void glGetIntegerv(GLenum pname, GLint *data);
+void glGetProgramInfoLog(GLuint program, GLsizei buf_size, GLsizei *length, GLchar *info_log);
+void glGetProgramiv(GLuint program, GLenum pname, GLint *params);
+void glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params);
+void glGetShaderInfoLog(GLuint shader, GLsizei buf_size, GLsizei *length, GLchar *info_log);
+void glGetShaderSource(GLuint shader, GLsizei buf_size, GLsizei *length, GLchar *source);
+void glGetShaderiv(GLuint shader, GLenum pname, GLint *params);
+const GLubyte *glGetString(GLenum name);
+void glGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void *pixels);
+void glGetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint *params);
+void glGetTexParameteriv(GLenum target, GLenum pname, GLint *params);
+GLint glGetUniformLocation(GLuint program, const GLchar *name);
+void glGetUniformfv(GLuint program, GLint location, GLfloat *params);
+void glGetUniformiv(GLuint program, GLint location, GLint *params);
+void glGetUniformuiv(GLuint program, GLint location, GLuint *params);
+void glGetVertexAttribiv(GLuint index, GLenum pname, GLint *params);
+void glHint(GLenum target, GLenum mode);
+GLboolean glIsEnabled(GLenum cap);
+void glLinkProgram(GLuint program);
+void *glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+void glMemoryBarrier(GLbitfield barriers);
+void glMultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count_, GLsizei drawcount);
+void glMultiDrawElements(GLenum mode, const GLsizei *count_, GLenum type, const void *const *indices,
+                         GLsizei drawcount);
+void glMultiDrawElementsBaseVertex(GLenum mode, const GLsizei *count_, GLenum type, const void *const *indices,
+                                   GLsizei drawcount, const GLint *basevertex);
+void glMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+void glPixelStorei(GLenum pname, GLint param);
+void glPolygonOffset(GLfloat factor, GLfloat units);
+void glReadBuffer(GLenum src);
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels);
+void glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length);
+void glTexImage1D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLint border, GLenum format,
+                  GLenum type, const void *pixels);
+void glTexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border,
+                  GLenum format, GLenum type, const void *pixels);
+void glTexParameterf(GLenum target, GLenum pname, GLfloat param);
+void glTexParameterfv(GLenum target, GLenum pname, const GLfloat *params);
+void glTexParameteri(GLenum target, GLenum pname, GLint param);
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                     GLenum format, GLenum type, const void *pixels);
+void glUniform1f(GLint location, GLfloat v0);
+void glUniform1fv(GLint location, GLsizei count, const GLfloat *value);
+void glUniform1i(GLint location, GLint v0);
+void glUniform1iv(GLint location, GLsizei count, const GLint *value);
+void glUniform1uiv(GLint location, GLsizei count, const GLuint *value);
+void glUniform2fv(GLint location, GLsizei count, const GLfloat *value);
+void glUniform2iv(GLint location, GLsizei count, const GLint *value);
+void glUniform2uiv(GLint location, GLsizei count, const GLuint *value);
+void glUniform3fv(GLint location, GLsizei count, const GLfloat *value);
+void glUniform3iv(GLint location, GLsizei count, const GLint *value);
+void glUniform3uiv(GLint location, GLsizei count, const GLuint *value);
+void glUniform4fv(GLint location, GLsizei count, const GLfloat *value);
+void glUniform4iv(GLint location, GLsizei count, const GLint *value);
+void glUniform4uiv(GLint location, GLsizei count, const GLuint *value);
+void glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+void glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+GLboolean glUnmapBuffer(GLenum target);
+void glUseProgram(GLuint program);
+void glVertexAttribDivisor(GLuint index, GLuint divisor);
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                           const void *pointer);
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+// GLFW and GLEW entry points
+GLFWwindow *glfwCreateWindow(int width, int height, const char *title, GLFWmonitor *monitor, GLFWwindow *share);
+int glfwGetKey(GLFWwindow *window, int key);
+GLFWmonitor *glfwGetPrimaryMonitor();
+const GLFWvidmode *glfwGetVideoMode(GLFWmonitor *monitor);
+int glfwInit();
+void glfwInitHint(int hint, int value);
+void glfwMakeContextCurrent(GLFWwindow *window);
+void glfwPollEvents();
+GLFWcursorposfun glfwSetCursorPosCallback(GLFWwindow *window, GLFWcursorposfun callback);
+GLFWerrorfun glfwSetErrorCallback(GLFWerrorfun callback);
+GLFWkeyfun glfwSetKeyCallback(GLFWwindow *window, GLFWkeyfun callback);
+GLFWmousebuttonfun glfwSetMouseButtonCallback(GLFWwindow *window, GLFWmousebuttonfun callback);
+GLFWscrollfun glfwSetScrollCallback(GLFWwindow *window, GLFWscrollfun callback);
+void glfwSetWindowMonitor(GLFWwindow *window, GLFWmonitor *monitor, int xpos, int ypos, int width, int height,
+                          int refresh_rate);
+void glfwSetWindowPos(GLFWwindow *window, int xpos, int ypos);
+void glfwSwapBuffers(GLFWwindow *window);
+void glfwSwapInterval(int interval);
+void glfwTerminate();
+void glfwWindowHint(int hint, int value);
+int glfwWindowShouldClose(GLFWwindow *window);
+GLenum glewInit();
+const GLubyte *glewGetErrorString(GLenum error);
+}
+}
+
+// Route the entry points to the null implementation.  The implementation itself defines ENU_NULL_GL_NO_REDIRECT
+#ifndef ENU_NULL_GL_NO_REDIRECT
+#define glActiveTexture ::graphics_framework::null_gl::glActiveTexture
+#define glAttachShader ::graphics_framework::null_gl::glAttachShader
+#define glBeginQuery ::graphics_framework::null_gl::glBeginQuery
+#define glBindBuffer ::graphics_framework::null_gl::glBindBuffer
+#define glBindBufferBase ::graphics_framework::null_gl::glBindBufferBase
+#define glBindFramebuffer ::graphics_framework::null_gl::glBindFramebuffer
+#define glBindTexture ::graphics_framework::null_gl::glBindTexture
+#define glBindVertexArray ::graphics_framework::null_gl::glBindVertexArray
+#define glBlendFunc ::graphics_framework::null_gl::glBlendFunc
+#define glBufferData ::graphics_framework::null_gl::glBufferData
+#define glBufferStorage ::graphics_framework::null_gl::glBufferStorage
+#define glBufferSubData ::graphics_framework::null_gl::glBufferSubData
+#define glCheckFramebufferStatus ::graphics_framework::null_gl::glCheckFramebufferStatus
+#define glClear ::graphics_framework::null_gl::glClear
+#define glClearColor ::graphics_framework::null_gl::glClearColor
+#define glClearDepth ::graphics_framework::null_gl::glClearDepth
+#define glClientWaitSync ::graphics_framework::null_gl::glClientWaitSync
+#define glCompileShader ::graphics_framework::null_gl::glCompileShader
+#define glCopyBufferSubData ::graphics_framework::null_gl::glCopyBufferSubData
+#define glCreateProgram ::graphics_framework::null_gl::glCreateProgram
+#define glCreateShader ::graphics_framework::null_gl::glCreateShader
+#define glCullFace ::graphics_framework::null_gl::glCullFace
+#define glDebugMessageCallback ::graphics_framework::null_gl::glDebugMessageCallback
+#define glDebugMessageControl ::graphics_framework::null_gl::glDebugMessageControl
+#define glDeleteBuffers ::graphics_framework::null_gl::glDeleteBuffers
+#define glDeleteFramebuffers ::graphics_framework::null_gl::glDeleteFramebuffers
+#define glDeleteProgram ::graphics_framework::null_gl::glDeleteProgram
+#define glDeleteQueries ::graphics_framework::null_gl::glDeleteQueries
+#define glDeleteShader ::graphics_framework::null_gl::glDeleteShader
+#define glDeleteSync ::graphics_framework::null_gl::glDeleteSync
+#define glDeleteTextures ::graphics_framework::null_gl::glDeleteTextures
+#define glDeleteVertexArrays ::graphics_framework::null_gl::glDeleteVertexArrays
+#define glDepthFunc ::graphics_framework::null_gl::glDepthFunc
+#define glDepthMask ::graphics_framework::null_gl::glDepthMask
+#define glDetachShader ::graphics_framework::null_gl::glDetachShader
+#define glDisable ::graphics_framework::null_gl::glDisable
+#define glDispatchCompute ::graphics_framework::null_gl::glDispatchCompute
+#define glDrawArrays ::graphics_framework::null_gl::glDrawArrays
+#define glDrawArraysInstanced ::graphics_framework::null_gl::glDrawArraysInstanced
+#define glDrawBuffer ::graphics_framework::null_gl::glDrawBuffer
+#define glDrawBuffers ::graphics_framework::null_gl::glDrawBuffers
+#define glDrawElements ::graphics_framework::null_gl::glDrawElements
+#define glDrawElementsBaseVertex ::graphics_framework::null_gl::glDrawElementsBaseVertex
+#define glEnable ::graphics_framework::null_gl::glEnable
+#define glEnableVertexAttribArray ::graphics_framework::null_gl::glEnableVertexAttribArray
+#define glEndQuery ::graphics_framework::null_gl::glEndQuery
+#define glFenceSync ::graphics_framework::null_gl::glFenceSync
+#define glFinish ::graphics_framework::null_gl::glFinish
+#define glFramebufferTexture ::graphics_framework::null_gl::glFramebufferTexture
+#define glFramebufferTexture2D ::graphics_framework::null_gl::glFramebufferTexture2D
+#define glGenBuffers ::graphics_framework::null_gl::glGenBuffers
+#define glGenFramebuffers ::graphics_framework::null_gl::glGenFramebuffers
+#define glGenQueries ::graphics_framework::null_gl::glGenQueries
+#define glGenTextures ::graphics_framework::null_gl::glGenTextures
+#define glGenVertexArrays ::graphics_framework::null_gl::glGenVertexArrays
+#define glGenerateMipmap ::graphics_framework::null_gl::glGenerateMipmap
+#define glGetActiveUniform ::graphics_framework::null_gl::glGetActiveUniform
+#define glGetAttachedShaders ::graphics_framework::null_gl::glGetAttachedShaders
+#define glGetBooleanv ::graphics_framework::null_gl::glGetBooleanv
+#define glGetBufferParameteriv ::graphics_framework::null_gl::glGetBufferParameteriv
+#define glGetBufferSubData ::graphics_framework::null_gl::glGetBufferSubData
+#define glGetError ::graphics_framework::null_gl::glGetError
+#define glGetFloatv ::graphics_framework::null_gl::glGetFloatv
+#define glGetFramebufferAttachmentParameteriv ::graphics_framework::null_gl::glGetFramebufferAttachmentParameteriv
+#define glGetIntegerv ::graphics_framework::null_gl::glGetIntegerv
+#define glGetProgramInfoLog ::graphics_framework::null_gl::glGetProgramInfoLog
+#define glGetProgramiv ::graphics_framework::null_gl::glGetProgramiv
+#define glGetQueryObjectui64v ::graphics_framework::null_gl::glGetQueryObjectui64v
+#define glGetShaderInfoLog ::graphics_framework::null_gl::glGetShaderInfoLog
+#define glGetShaderSource ::graphics_framework::null_gl::glGetShaderSource
+#define glGetShaderiv ::graphics_framework::null_gl::glGetShaderiv
+#define glGetString ::graphics_framework::null_gl::glGetString
+#define glGetTexImage ::graphics_framework::null_gl::glGetTexImage
+#define glGetTexLevelParameteriv ::graphics_framework::null_gl::glGetTexLevelParameteriv
+#define glGetTexParameteriv ::graphics_framework::null_gl::glGetTexParameteriv
+#define glGetUniformLocation ::graphics_framework::null_gl::glGetUniformLocation
+#define glGetUniformfv ::graphics_framework::null_gl::glGetUniformfv
+#define glGetUniformiv ::graphics_framework::null_gl::glGetUniformiv
+#define glGetUniformuiv ::graphics_framework::null_gl::glGetUniformuiv
+#define glGetVertexAttribiv ::graphics_framework::null_gl::glGetVertexAttribiv
+#define glHint ::graphics_framework::null_gl::glHint
+#define glIsEnabled ::graphics_framework::null_gl::glIsEnabled
+#define glLinkProgram ::graphics_framework::null_gl::glLinkProgram
+#define glMapBufferRange ::graphics_framework::null_gl::glMapBufferRange
+#define glMemoryBarrier ::graphics_framework::null_gl::glMemoryBarrier
+#define glMultiDrawArrays ::graphics_framework::null_gl::glMultiDrawArrays
+#define glMultiDrawElements ::graphics_framework::null_gl::glMultiDrawElements
+#define glMultiDrawElementsBaseVertex ::graphics_framework::null_gl::glMultiDrawElementsBaseVertex
+#define glMultiDrawElementsIndirect ::graphics_framework::null_gl::glMultiDrawElementsIndirect
+#define glPixelStorei ::graphics_framework::null_gl::glPixelStorei
+#define glPolygonOffset ::graphics_framework::null_gl::glPolygonOffset
+#define glReadBuffer ::graphics_framework::null_gl::glReadBuffer
+#define glReadPixels ::graphics_framework::null_gl::glReadPixels
+#define glShaderSource ::graphics_framework::null_gl::glShaderSource
+#define glTexImage1D ::graphics_framework::null_gl::glTexImage1D
+#define glTexImage2D ::graphics_framework::null_gl::glTexImage2D
+#define glTexParameterf ::graphics_framework::null_gl::glTexParameterf
+#define glTexParameterfv ::graphics_framework::null_gl::glTexParameterfv
+#define glTexParameteri ::graphics_framework::null_gl::glTexParameteri
+#define glTexSubImage2D ::graphics_framework::null_gl::glTexSubImage2D
+#define glUniform1f ::graphics_framework::null_gl::glUniform1f
+#define glUniform1fv ::graphics_framework::null_gl::glUniform1fv
+#define glUniform1i ::graphics_framework::null_gl::glUniform1i
+#define glUniform1iv ::graphics_framework::null_gl::glUniform1iv
+#define glUniform1uiv ::graphics_framework::null_gl::glUniform1uiv
+#define glUniform2fv ::graphics_framework::null_gl::glUniform2fv
+#define glUniform2iv ::graphics_framework::null_gl::glUniform2iv
+#define glUniform2uiv ::graphics_framework::null_gl::glUniform2uiv
+#define glUniform3fv ::graphics_framework::null_gl::glUniform3fv
+#define glUniform3iv ::graphics_framework::null_gl::glUniform3iv
+#define glUniform3uiv ::graphics_framework::null_gl::glUniform3uiv
+#define glUniform4fv ::graphics_framework::null_gl::glUniform4fv
+#define glUniform4iv ::graphics_framework::null_gl::glUniform4iv
+#define glUniform4uiv ::graphics_framework::null_gl::glUniform4uiv
+#define glUniformMatrix2fv ::graphics_framework::null_gl::glUniformMatrix2fv
+#define glUniformMatrix3fv ::graphics_framework::null_gl::glUniformMatrix3fv
+#define glUniformMatrix4fv ::graphics_framework::null_gl::glUniformMatrix4fv
+#define glUnmapBuffer ::graphics_framework::null_gl::glUnmapBuffer
+#define glUseProgram ::graphics_framework::null_gl::glUseProgram
+#define glVertexAttribDivisor ::graphics_framework::null_gl::glVertexAttribDivisor
+#define glVertexAttribPointer ::graphics_framework::null_gl::glVertexAttribPointer
+#define glViewport ::graphics_framework::null_gl::glViewport
+#define glfwCreateWindow ::graphics_framework::null_gl::glfwCreateWindow
+#define glfwGetKey ::graphics_framework::null_gl::glfwGetKey
+#define glfwGetPrimaryMonitor ::graphics_framework::null_gl::glfwGetPrimaryMonitor
+#define glfwGetVideoMode ::graphics_framework::null_gl::glfwGetVideoMode
+#define glfwInit ::graphics_framework::null_gl::glfwInit
+#define glfwInitHint ::graphics_framework::null_gl::glfwInitHint
+#define glfwMakeContextCurrent ::graphics_framework::null_gl::glfwMakeContextCurrent
+#define glfwPollEvents ::graphics_framework::null_gl::glfwPollEvents
+#define glfwSetCursorPosCallback ::graphics_framework::null_gl::glfwSetCursorPosCallback
+#define glfwSetErrorCallback ::graphics_framework::null_gl::glfwSetErrorCallback
+#define glfwSetKeyCallback ::graphics_framework::null_gl::glfwSetKeyCallback
+#define glfwSetMouseButtonCallback ::graphics_framework::null_gl::glfwSetMouseButtonCallback
+#define glfwSetScrollCallback ::graphics_framework::null_gl::glfwSetScrollCallback
+#define glfwSetWindowMonitor ::graphics_framework::null_gl::glfwSetWindowMonitor
+#define glfwSetWindowPos ::graphics_framework::null_gl::glfwSetWindowPos
+#define glfwSwapBuffers ::graphics_framework::null_gl::glfwSwapBuffers
+#define glfwSwapInterval ::graphics_framework::null_gl::glfwSwapInterval
+#define glfwTerminate ::graphics_framework::null_gl::glfwTerminate
+#define glfwWindowHint ::graphics_framework::null_gl::glfwWindowHint
+#define glfwWindowShouldClose ::graphics_framework::null_gl::glfwWindowShouldClose
+#define glewInit ::graphics_framework::null_gl::glewInit
+#define glewGetErrorString ::graphics_framework::null_gl::glewGetErrorString
+#endif
@@ -0,0 +1,710 @@
+#include "stdafx.h"
+
+#include "asset_stream.h"
+#include "gl_capture.h"
+#include "gpu_memory.h"
+#include "paged_geometry.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+const uint32_t paged_geometry::version;
+
+// Marks a file as baked paged geometry.  "PGEO" when read as bytes
+static const uint32_t paged_magic = 0x4f454750;
+// Pages start on a multiple of this
+static const size_t page_alignment = 16;
+// The first coarser level's cells are the average chunk size divided by this
+static const float base_cells_per_chunk = 64.0f;
+
+// The fixed header at the start of a baked file.  Followed by the attribute table, the chunk table and the pages
+struct paged_header {
+  // Always paged_magic
+  uint32_t magic;
+  // The format version
+  uint32_t version;
+  // The number of chunks
+  uint32_t chunk_count;
+  // The number of level records after each chunk record
+  uint32_t level_count;
+  // The number of attributes
+  uint32_t attribute_count;
+  // The most vertices of any page
+  uint32_t slot_vertices;
+  // The most indices of any page
+  uint32_t slot_indices;
+  // Unused, keeps the tables aligned
+  uint32_t reserved;
+};
+
+// Describes one attribute.  Pages hold each attribute's values in table order, then the indices
+struct paged_attribute {
+  // The attribute index
+  uint32_t index;
+  // The number of float components
+  uint32_t components;
+};
+
+// Describes one chunk.  Followed by level_count level records
+struct paged_chunk {
+  // The minimal point of the chunk
+  float minimal[3];
+  // The maximal point of the chunk
+  float maximal[3];
+};
+
+// Describes one level of a chunk.  Levels a chunk does not have are left empty
+struct paged_level {
+  // The offset of the page
+  uint64_t offset;
+  // The number of vertices
+  uint32_t vertices;
+  // The number of indices, relative to the page's first vertex
+  uint32_t indices;
+  // The largest distance the level strays from the full mesh
+  float error;
+  // Unused, keeps the records aligned
+  uint32_t reserved;
+};
+
+static_assert(sizeof(paged_header) == 32 && sizeof(paged_attribute) == 8 && sizeof(paged_chunk) == 24 &&
+                  sizeof(paged_level) == 24,
+              "Paged geometry structures must not be padded");
+
+// Rounds an offset up to the page alignment
+static uint64_t align_page(uint64_t offset) { return (offset + page_alignment - 1) & ~uint64_t(page_alignment - 1); }
+
+// The vertices and indices of one page while baking
+struct baked_page {
+  // The values of each attribute, in attribute table order
+  std::vector<std::vector<float>> streams;
+  // The triangle indices, relative to the page
+  std::vector<GLuint> indices;
+  // The number of vertices
+  GLuint vertices = 0;
+};
+
+// Drops the vertices no triangle refers to
+static void compact_page(baked_page &page, const std::vector<std::pair<GLuint, GLint>> &attributes) {
+  std::vector<GLuint> remap(page.vertices, UINT_MAX);
+  GLuint used = 0;
+  for (auto &i : page.indices) {
+    if (remap[i] == UINT_MAX)
+      remap[i] = used++;
+    i = remap[i];
+  }
+  std::vector<std::vector<float>> streams(attributes.size());
+  for (size_t a = 0; a < attributes.size(); ++a) {
+    auto components = attributes[a].second;
+    streams[a].resize(size_t(used) * components);
+    for (GLuint v = 0; v < page.vertices; ++v)
+      if (remap[v] != UINT_MAX)
+        std::copy_n(&page.streams[a][size_t(v) * components], components,
+                    &streams[a][size_t(remap[v]) * components]);
+  }
+  page.streams = std::move(streams);
+  page.vertices = used;
+}
+
+// Merges the vertices within each grid cell into their average, dropping the triangles that collapse.  The grid is
+// anchored to the mesh, so neighbouring chunks merge alike
+static baked_page simplify(const baked_page &source, const std::vector<std::pair<GLuint, GLint>> &attributes,
+                           size_t position, const glm::vec3 &origin, float cell) {
+  baked_page result;
+  result.streams.resize(attributes.size());
+  std::unordered_map<uint64_t, GLuint> clusters;
+  std::vector<GLuint> remap(source.vertices), counts;
+  for (GLuint v = 0; v < source.vertices; ++v) {
+    auto p = &source.streams[position][size_t(v) * 3];
+    uint64_t key = 0;
+    for (int k = 0; k < 3; ++k) {
+      // 21 bits per axis
+      auto coordinate = static_cast<int64_t>(std::floor((p[k] - origin[k]) / cell));
+      key = (key << 21) | static_cast<uint64_t>(std::min<int64_t>(std::max<int64_t>(coordinate, 0), (1 << 21) - 1));
+    }
+    auto found = clusters.emplace(key, result.vertices);
+    if (found.second) {
+      ++result.vertices;
+      counts.push_back(0);
+      for (size_t a = 0; a < attributes.size(); ++a)
+        result.streams[a].resize(size_t(result.vertices) * attributes[a].second, 0.0f);
+    }
+    auto c = found.first->second;
+    remap[v] = c;
+    ++counts[c];
+    for (size_t a = 0; a < attributes.size(); ++a) {
+      auto components = attributes[a].second;
+      for (GLint k = 0; k < components; ++k)
+        result.streams[a][size_t(c) * components + k] += source.streams[a][size_t(v) * components + k];
+    }
+  }
+  for (size_t a = 0; a < attributes.size(); ++a) {
+    auto components = attributes[a].second;
+    auto index = attributes[a].first;
+    // Averaged directions are made unit length again
+    auto direction =
+        components == 3 && (index == NORMAL_BUFFER || index == TANGENT_BUFFER || index == BINORMAL_BUFFER);
+    for (GLuint c = 0; c < result.vertices; ++c) {
+      auto values = &result.streams[a][size_t(c) * components];
+      for (GLint k = 0; k < components; ++k)
+        values[k] /= static_cast<float>(counts[c]);
+      if (direction) {
+        auto length = std::sqrt(values[0] * values[0] + values[1] * values[1] + values[2] * values[2]);
+        if (length > 0.0f)
+          for (GLint k = 0; k < 3; ++k)
+            values[k] /= length;
+      }
+    }
+  }
+  for (size_t i = 0; i + 2 < source.indices.size(); i += 3) {
+    auto a = remap[source.indices[i]], b = remap[source.indices[i + 1]], c = remap[source.indices[i + 2]];
+    if (a != b && b != c && a != c)
+      result.indices.insert(result.indices.end(), {a, b, c});
+  }
+  compact_page(result, attributes);
+  return result;
+}
+
+// Bakes an indexed triangle list into chunks and levels
+bool paged_geometry::write(const std::string &path, const mesh_data &data, GLuint chunk_triangles, GLuint levels) {
+  assert(chunk_triangles > 0 && levels > 0);
+  std::vector<std::pair<GLuint, GLint>> attributes;
+  size_t position = SIZE_MAX;
+  for (auto &s : data.get_streams()) {
+    if (s.first == POSITION_BUFFER && s.second.components == 3)
+      position = attributes.size();
+    attributes.emplace_back(s.first, s.second.components);
+  }
+  if (data.get_type() != GL_TRIANGLES || data.get_index_count() < 3 || position == SIZE_MAX) {
+    LOG_ERROR << "baking paged geometry " << path << ": Mesh must be an indexed triangle list with positions";
+    return false;
+  }
+  auto indices = data.get_index_data();
+  auto positions = data.get_streams().at(POSITION_BUFFER).get();
+  auto vertex_count = data.get_vertex_count();
+  auto triangle_count = data.get_index_count() / 3;
+  for (GLuint i = 0; i < triangle_count * 3; ++i) {
+    if (indices[i] >= vertex_count) {
+      LOG_ERROR << "baking paged geometry " << path << ": Index out of range";
+      return false;
+    }
+  }
+  auto vertex = [&](GLuint v) { return glm::vec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]); };
+
+  // Split the triangles at the median of their centres along the longest axis until each part fits a chunk.  Parts
+  // are kept in the order they are split, so chunks near each other in space are near each other in the file
+  std::vector<glm::vec3> centres(triangle_count);
+  for (GLuint t = 0; t < triangle_count; ++t)
+    centres[t] = (vertex(indices[t * 3]) + vertex(indices[t * 3 + 1]) + vertex(indices[t * 3 + 2])) / 3.0f;
+  std::vector<GLuint> order(triangle_count);
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<std::pair<size_t, size_t>> parts;
+  std::function<void(size_t, size_t)> split = [&](size_t begin, size_t end) {
+    if (end - begin <= chunk_triangles) {
+      parts.emplace_back(begin, end);
+      return;
+    }
+    auto minimal = centres[order[begin]], maximal = minimal;
+    for (auto i = begin; i < end; ++i) {
+      minimal = glm::min(minimal, centres[order[i]]);
+      maximal = glm::max(maximal, centres[order[i]]);
+    }
+    auto extent = maximal - minimal;
+    auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    auto middle = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                     [&](GLuint a, GLuint b) { return centres[a][axis] < centres[b][axis]; });
+    split(begin, middle);
+    split(middle, end);
+  };
+  split(0, triangle_count);
+  centres.clear();
+  centres.shrink_to_fit();
+
+  // Coarser levels use cells sized from the average chunk
+  auto mesh_minimal = vertex(indices[0]), mesh_maximal = mesh_minimal;
+  float average_extent = 0.0f;
+  for (auto &part : parts) {
+    auto minimal = vertex(indices[order[part.first] * 3]), maximal = minimal;
+    for (auto i = part.first; i < part.second; ++i)
+      for (GLuint k = 0; k < 3; ++k) {
+        minimal = glm::min(minimal, vertex(indices[order[i] * 3 + k]));
+        maximal = glm::max(maximal, vertex(indices[order[i] * 3 + k]));
+      }
+    mesh_minimal = glm::min(mesh_minimal, minimal);
+    mesh_maximal = glm::max(mesh_maximal, maximal);
+    auto extent = maximal - minimal;
+    average_extent += std::max(extent.x, std::max(extent.y, extent.z)) / parts.size();
+  }
+  auto base_cell = std::max(average_extent / base_cells_per_chunk, std::numeric_limits<float>::min());
+
+  // The tables are written last, once the pages are placed
+  paged_header header = {};
+  header.magic = paged_magic;
+  header.version = version;
+  header.chunk_count = static_cast<uint32_t>(parts.size());
+  header.level_count = levels;
+  header.attribute_count = static_cast<uint32_t>(attributes.size());
+  std::vector<paged_attribute> attribute_table;
+  for (auto &a : attributes)
+    attribute_table.push_back({a.first, static_cast<uint32_t>(a.second)});
+  auto chunk_record = sizeof(paged_chunk) + levels * sizeof(paged_level);
+  size_t vertex_bytes = 0;
+  std::vector<const float *> sources;
+  for (auto &a : attributes) {
+    vertex_bytes += a.second * sizeof(float);
+    sources.push_back(data.get_streams().at(a.first).get());
+  }
+  std::vector<unsigned char> chunk_table(parts.size() * chunk_record, 0);
+  auto offset = align_page(sizeof(header) + attribute_table.size() * sizeof(paged_attribute) + chunk_table.size());
+
+  // Write to a temporary file first, so a reader never maps a partial file
+  std::stringstream temp;
+  temp << path << "." << std::this_thread::get_id() << ".tmp";
+  {
+    std::ofstream file(temp.str(), std::ios::binary);
+    static const char zeros[page_alignment] = {};
+    for (auto remaining = offset; remaining > 0; remaining -= std::min<uint64_t>(remaining, page_alignment))
+      file.write(zeros, static_cast<std::streamsize>(std::min<uint64_t>(remaining, page_alignment)));
+    std::vector<GLuint> remap(vertex_count, UINT_MAX);
+    for (size_t c = 0; c < parts.size() && file.good(); ++c) {
+      // Level 0 holds the chunk's triangles with the vertices they use
+      baked_page page;
+      page.streams.resize(attributes.size());
+      std::vector<GLuint> used;
+      for (auto i = parts[c].first; i < parts[c].second; ++i) {
+        for (GLuint k = 0; k < 3; ++k) {
+          auto v = indices[order[i] * 3 + k];
+          if (remap[v] == UINT_MAX) {
+            remap[v] = page.vertices++;
+            used.push_back(v);
+            for (size_t a = 0; a < attributes.size(); ++a) {
+              auto components = attributes[a].second;
+              auto values = sources[a] + size_t(v) * components;
+              page.streams[a].insert(page.streams[a].end(), values, values + components);
+            }
+          }
+          page.indices.push_back(remap[v]);
+        }
+      }
+      for (auto v : used)
+        remap[v] = UINT_MAX;
+      paged_chunk record = {};
+      auto minimal = vertex(used[0]), maximal = minimal;
+      for (auto v : used) {
+        minimal = glm::min(minimal, vertex(v));
+        maximal = glm::max(maximal, vertex(v));
+      }
+      for (int k = 0; k < 3; ++k) {
+        record.minimal[k] = minimal[k];
+        record.maximal[k] = maximal[k];
+      }
+      memcpy(&chunk_table[c * chunk_record], &record, sizeof(record));
+      auto cell = base_cell;
+
+      // Each coarser level doubles the cell size, and is kept only if it saves at least a tenth of the triangles.
+      // Levels are merged from the one before, so their errors add up
+      auto level_page = std::move(page);
+      float error = 0.0f;
+      for (GLuint l = 0; l < levels && !level_page.indices.empty(); ++l) {
+        paged_level entry = {};
+        entry.offset = offset;
+        entry.vertices = level_page.vertices;
+        entry.indices = static_cast<uint32_t>(level_page.indices.size());
+        entry.error = error;
+        memcpy(&chunk_table[c * chunk_record + sizeof(paged_chunk) + l * sizeof(paged_level)], &entry, sizeof(entry));
+        header.slot_vertices = std::max(header.slot_vertices, entry.vertices);
+        header.slot_indices = std::max(header.slot_indices, entry.indices);
+        for (auto &s : level_page.streams)
+          file.write(reinterpret_cast<const char *>(s.data()), s.size() * sizeof(float));
+        file.write(reinterpret_cast<const char *>(level_page.indices.data()),
+                   level_page.indices.size() * sizeof(GLuint));
+        auto end = offset + level_page.vertices * vertex_bytes + level_page.indices.size() * sizeof(GLuint);
+        offset = align_page(end);
+        file.write(zeros, static_cast<std::streamsize>(offset - end));
+        if (l + 1 == levels)
+          break;
+        baked_page coarser;
+        auto enough = false;
+        for (; !enough && cell < average_extent * 2.0f; cell *= 2.0f) {
+          coarser = simplify(level_page, attributes, position, mesh_minimal, cell);
+          enough = coarser.indices.size() * 10 <= level_page.indices.size() * 9;
+          if (enough)
+            error += cell * std::sqrt(3.0f);
+        }
+        if (!enough)
+          break;
+        level_page = std::move(coarser);
+      }
+    }
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(attribute_table.data()),
+               attribute_table.size() * sizeof(paged_attribute));
+    file.write(reinterpret_cast<const char *>(chunk_table.data()), chunk_table.size());
+    if (!file.good()) {
+      file.close();
+      std::remove(temp.str().c_str());
+      LOG_ERROR << "baking paged geometry " << path << ": Could not write file";
+      return false;
+    }
+  }
+  // Replace any older file
+  if (std::rename(temp.str().c_str(), path.c_str()) != 0) {
+    std::remove(path.c_str());
+    if (std::rename(temp.str().c_str(), path.c_str()) != 0) {
+      std::remove(temp.str().c_str());
+      LOG_ERROR << "baking paged geometry " << path << ": Could not replace file";
+      return false;
+    }
+  }
+  LOG_INFO << "paged geometry " << path << " baked with " << parts.size() << " chunks";
+  return true;
+}
+
+// Opens a baked file
+paged_geometry::paged_geometry(const std::string &filename, size_t pool_bytes) : _name(filename) {
+  // Check that file exists
+  if (!check_file_exists(filename)) {
+    // Failed to read file.  Display error
+    LOG_ERROR << "could not load paged geometry " << filename << ": File Does Not Exist";
+    // Throw exception
+    throw std::runtime_error("Error loading paged geometry");
+  }
+  _file = virtual_file(filename);
+  auto bytes = _file.get_data();
+  auto size = static_cast<uint64_t>(_file.get_size());
+  // Checks a table or page lies inside the file
+  auto inside = [=](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+  auto corrupt = [&]() {
+    LOG_ERROR << "could not load paged geometry " << filename << ": File is corrupt";
+    throw std::runtime_error("Error loading paged geometry");
+  };
+
+  paged_header header;
+  if (!inside(0, sizeof(header)))
+    corrupt();
+  memcpy(&header, bytes, sizeof(header));
+  if (header.magic != paged_magic || header.version != version) {
+    LOG_ERROR << "could not load paged geometry " << filename << ": Wrong format version.  Bake the model again";
+    throw std::runtime_error("Error loading paged geometry");
+  }
+  auto chunk_record = sizeof(paged_chunk) + uint64_t(header.level_count) * sizeof(paged_level);
+  auto tables = sizeof(header) + uint64_t(header.attribute_count) * sizeof(paged_attribute);
+  if (header.chunk_count == 0 || header.level_count == 0 || header.level_count > 32 || header.attribute_count == 0 ||
+      header.attribute_count > 16 || header.slot_indices == 0 || !inside(tables, header.chunk_count * chunk_record))
+    corrupt();
+
+  // The attributes, with the float size of one vertex
+  uint64_t vertex_floats = 0;
+  for (uint32_t i = 0; i < header.attribute_count; ++i) {
+    paged_attribute a;
+    memcpy(&a, bytes + sizeof(header) + i * sizeof(a), sizeof(a));
+    if (a.index >= 16 || a.components == 0 || a.components > 4 || _components.count(a.index))
+      corrupt();
+    _components[a.index] = static_cast<GLint>(a.components);
+    vertex_floats += a.components;
+  }
+  if (!_components.count(POSITION_BUFFER))
+    corrupt();
+
+  // The chunks.  A chunk's levels end at the first empty one
+  _level_count = header.level_count;
+  _chunks.resize(header.chunk_count);
+  for (uint32_t c = 0; c < header.chunk_count; ++c) {
+    auto record = bytes + tables + c * chunk_record;
+    paged_chunk bounds;
+    memcpy(&bounds, record, sizeof(bounds));
+    _chunks[c].minimal = glm::vec3(bounds.minimal[0], bounds.minimal[1], bounds.minimal[2]);
+    _chunks[c].maximal = glm::vec3(bounds.maximal[0], bounds.maximal[1], bounds.maximal[2]);
+    for (uint32_t l = 0; l < header.level_count; ++l) {
+      paged_level entry;
+      memcpy(&entry, record + sizeof(paged_chunk) + l * sizeof(paged_level), sizeof(entry));
+      if (entry.indices == 0)
+        break;
+      if (entry.offset % page_alignment != 0 || entry.vertices > header.slot_vertices ||
+          entry.indices > header.slot_indices || entry.indices % 3 != 0 ||
+          !inside(entry.offset, entry.vertices * vertex_floats * sizeof(float) + entry.indices * sizeof(GLuint)))
+        corrupt();
+      _chunks[c].levels.push_back({entry.offset, entry.vertices, entry.indices, entry.error});
+    }
+    if (_chunks[c].levels.empty())
+      corrupt();
+  }
+
+  _residency = std::make_shared<residency>();
+  _residency->pages.resize(_chunks.size() * _level_count);
+  _residency->level_in_flight.resize(_level_count);
+  create_pool(pool_bytes);
+  LOG_INFO << "paged geometry " << filename << " opened with " << _chunks.size() << " chunks and "
+           << _residency->slots.size() << " slots";
+}
+
+// Creates the pool buffers and vertex array object
+void paged_geometry::create_pool(size_t pool_bytes) {
+  size_t vertex_bytes = 0;
+  for (auto &c : _components)
+    vertex_bytes += c.second * sizeof(float);
+  // Each level's largest page, and the number of chunks that have the level
+  std::vector<GLuint> level_vertices(_level_count, 0), level_indices(_level_count, 0);
+  std::vector<size_t> level_chunks(_level_count, 0);
+  for (auto &c : _chunks)
+    for (size_t l = 0; l < c.levels.size(); ++l) {
+      level_vertices[l] = std::max(level_vertices[l], c.levels[l].vertices);
+      level_indices[l] = std::max(level_indices[l], c.levels[l].indices);
+      ++level_chunks[l];
+    }
+  auto levels_used = static_cast<size_t>(std::count_if(level_chunks.begin(), level_chunks.end(),
+                                                       [](size_t count) { return count > 0; }));
+  // Each level gets an equal share of the pool, so coarse levels, drawn for the many chunks far away, get more slots
+  size_t total_vertices = 0, total_indices = 0;
+  auto &slots = _residency->slots;
+  for (GLuint l = 0; l < _level_count; ++l) {
+    if (level_chunks[l] == 0)
+      continue;
+    auto slot_bytes = level_vertices[l] * vertex_bytes + level_indices[l] * sizeof(GLuint);
+    auto count = std::min(std::max(pool_bytes / levels_used / slot_bytes, size_t(1)), level_chunks[l]);
+    for (size_t s = 0; s < count; ++s) {
+      slot_state slot;
+      slot.level = l;
+      slot.first_vertex = static_cast<GLuint>(total_vertices);
+      slot.first_index = static_cast<GLuint>(total_indices);
+      slots.push_back(slot);
+      total_vertices += level_vertices[l];
+      total_indices += level_indices[l];
+    }
+  }
+  glGenVertexArrays(1, &_vao);
+  glBindVertexArray(_vao);
+  for (auto &c : _components) {
+    GLuint id;
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_ARRAY_BUFFER, id);
+    glBufferData(GL_ARRAY_BUFFER, total_vertices * c.second * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(c.first, c.second, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(c.first);
+    _residency->buffers[c.first] = id;
+  }
+  glGenBuffers(1, &_residency->index_buffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _residency->index_buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, total_indices * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "creating paged geometry pool for " << _name << ": Could not create buffers with OpenGL";
+    release();
+    throw std::runtime_error("Error creating paged geometry pool");
+  }
+  for (auto &b : _residency->buffers)
+    gpu_memory::track_buffer(b.second, total_vertices * _components[b.first] * sizeof(float),
+                             gpu_memory::vertex_buffer, _name);
+  gpu_memory::track_buffer(_residency->index_buffer, total_indices * sizeof(GLuint), gpu_memory::index_buffer, _name);
+}
+
+// Requests a page from the asset stream
+void paged_geometry::request(size_t page) {
+  auto res = _residency;
+  auto file = _file;
+  auto components = _components;
+  auto level = static_cast<GLuint>(page % _level_count);
+  auto entry = _chunks[page / _level_count].levels[level];
+  auto name = _name;
+  auto data = std::make_shared<std::vector<unsigned char>>();
+  res->pages[page].requested = true;
+  ++res->in_flight;
+  ++res->level_in_flight[level];
+  // Marks the request as done.  Runs on the renderer thread
+  auto done = [=]() {
+    if (res->pages.size() > page && res->pages[page].requested) {
+      res->pages[page].requested = false;
+      --res->in_flight;
+      --res->level_in_flight[level];
+    }
+  };
+  asset_stream::load_task(
+      name,
+      [=]() {
+        // Reading the mapping here pages the data in from disk off the renderer thread
+        try {
+          size_t vertex_bytes = 0;
+          for (auto &c : components)
+            vertex_bytes += c.second * sizeof(float);
+          auto begin = file.get_data() + entry.offset;
+          auto indices_offset = entry.vertices * vertex_bytes;
+          data->assign(begin, begin + indices_offset + entry.indices * sizeof(GLuint));
+          auto indices = reinterpret_cast<const GLuint *>(data->data() + indices_offset);
+          // An index outside the page would read another slot's vertices
+          if (std::any_of(indices, indices + entry.indices, [&](GLuint i) { return i >= entry.vertices; }))
+            data->clear();
+        } catch (std::exception &) {
+          data->clear();
+        }
+      },
+      [=]() {
+        done();
+        // Released while in flight
+        if (res->slots.empty())
+          return;
+        auto &p = res->pages[page];
+        if (data->empty()) {
+          LOG_ERROR << "paging " << name << ": Page " << page << " is corrupt";
+          p.failed = true;
+          return;
+        }
+        // Take a free slot of the page's level, or the least recently drawn that was not drawn this frame
+        int slot = -1;
+        for (size_t s = 0; s < res->slots.size(); ++s) {
+          auto &candidate = res->slots[s];
+          if (candidate.level != level)
+            continue;
+          if (candidate.page < 0) {
+            slot = static_cast<int>(s);
+            break;
+          }
+          if (candidate.last_used < res->frame && (slot < 0 || candidate.last_used < res->slots[slot].last_used))
+            slot = static_cast<int>(s);
+        }
+        // Every slot is in use.  The page is requested again while it is still wanted
+        if (slot < 0)
+          return;
+        auto &target = res->slots[slot];
+        if (target.page >= 0)
+          res->pages[target.page].slot = -1;
+        target.page = -1;
+        // Copy through the copy target, so no vertex array object's index binding is disturbed
+        size_t offset = 0;
+        for (auto &c : components) {
+          auto bytes = entry.vertices * c.second * sizeof(float);
+          glBindBuffer(GL_COPY_WRITE_BUFFER, res->buffers[c.first]);
+          glBufferSubData(GL_COPY_WRITE_BUFFER, size_t(target.first_vertex) * c.second * sizeof(float), bytes,
+                          data->data() + offset);
+          offset += bytes;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, res->index_buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, size_t(target.first_index) * sizeof(GLuint),
+                        entry.indices * sizeof(GLuint), data->data() + offset);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (CHECK_GL_ERROR) {
+          LOG_ERROR << "paging " << name << ": Could not upload page " << page;
+          throw std::runtime_error("Error uploading paged geometry");
+        }
+        for (auto &c : components)
+          gl_capture::record_buffer_update(res->buffers[c.first]);
+        gl_capture::record_buffer_update(res->index_buffer);
+        target.page = static_cast<int>(page);
+        target.last_used = res->frame;
+        p.slot = slot;
+        res->bytes_paged += data->size();
+      },
+      done);
+}
+
+// Chooses each chunk's level, requests missing pages and lays out this frame's draws
+void paged_geometry::update(const glm::vec3 &eye) {
+  _counts.clear();
+  _offsets.clear();
+  _base_vertices.clear();
+  _wanted.clear();
+  if (!_residency || _residency->slots.empty())
+    return;
+  auto &res = *_residency;
+  ++res.frame;
+  for (size_t c = 0; c < _chunks.size(); ++c) {
+    auto &levels = _chunks[c].levels;
+    auto base = c * _level_count;
+    // The coarsest level whose error is within tolerance at the distance to the chunk's box
+    auto distance = glm::distance(eye, glm::clamp(eye, _chunks[c].minimal, _chunks[c].maximal));
+    size_t target = 0;
+    for (auto l = levels.size() - 1; l > 0; --l) {
+      if (levels[l].error <= _error_tolerance * distance) {
+        target = l;
+        break;
+      }
+    }
+    // Draw the wanted level if resident, otherwise the nearest resident level, finer first
+    int drawn = -1;
+    for (size_t d = 0; d < levels.size() && drawn < 0; ++d) {
+      if (d <= target && res.pages[base + target - d].slot >= 0)
+        drawn = static_cast<int>(target - d);
+      else if (target + d < levels.size() && res.pages[base + target + d].slot >= 0)
+        drawn = static_cast<int>(target + d);
+    }
+    if (drawn >= 0) {
+      auto &slot = res.slots[res.pages[base + drawn].slot];
+      slot.last_used = res.frame;
+      _counts.push_back(static_cast<GLsizei>(levels[drawn].indices));
+      _offsets.push_back(reinterpret_cast<const void *>(size_t(slot.first_index) * sizeof(GLuint)));
+      _base_vertices.push_back(static_cast<GLint>(slot.first_vertex));
+    }
+    // A chunk with nothing resident asks for its coarsest level first, so it appears quickly
+    auto want = base + (drawn < 0 ? levels.size() - 1 : target);
+    auto &p = res.pages[want];
+    if (p.slot < 0 && !p.requested && !p.failed)
+      _wanted.emplace_back(distance, want);
+  }
+  // Nearest first.  Each load takes a slot of its level not drawn this frame, so no more are requested at a level
+  // than it has such slots.  Levels are at most 32
+  std::sort(_wanted.begin(), _wanted.end());
+  size_t spare[32] = {};
+  for (auto &s : res.slots)
+    if (s.page < 0 || s.last_used < res.frame)
+      ++spare[s.level];
+  for (auto &w : _wanted) {
+    if (res.in_flight >= _max_in_flight)
+      break;
+    auto level = w.second % _level_count;
+    if (res.level_in_flight[level] < spare[level])
+      request(w.second);
+  }
+}
+
+// Draws the chunks resident at the last update
+void paged_geometry::draw() const {
+  if (_counts.empty())
+    return;
+  glBindVertexArray(_vao);
+  // Record each chunk as a draw if capturing.  Pages streamed in later frames of a capture are not recorded
+  if (gl_capture::is_recording())
+    for (size_t i = 0; i < _counts.size(); ++i)
+      gl_capture::record_draw(_vao, _residency->buffers, _residency->index_buffer, GL_TRIANGLES,
+                              static_cast<GLuint>(reinterpret_cast<size_t>(_offsets[i]) / sizeof(GLuint)),
+                              static_cast<GLuint>(_counts[i]), _base_vertices[i]);
+  glMultiDrawElementsBaseVertex(GL_TRIANGLES, _counts.data(), GL_UNSIGNED_INT, _offsets.data(),
+                                static_cast<GLsizei>(_counts.size()), _base_vertices.data());
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rendering paged geometry " << _name << ": Could not draw chunks";
+    throw std::runtime_error("Error rendering paged geometry");
+  }
+}
+
+// Deletes the pool
+void paged_geometry::release() {
+  if (!_residency)
+    return;
+  for (auto &b : _residency->buffers) {
+    glDeleteBuffers(1, &b.second);
+    gpu_memory::release_buffer(b.second);
+  }
+  if (_residency->index_buffer != 0) {
+    glDeleteBuffers(1, &_residency->index_buffer);
+    gpu_memory::release_buffer(_residency->index_buffer);
+  }
+  if (_vao != 0)
+    glDeleteVertexArrays(1, &_vao);
+  _residency->buffers.clear();
+  _residency->index_buffer = 0;
+  _residency->slots.clear();
+  for (auto &p : _residency->pages)
+    p.slot = -1;
+  _vao = 0;
+  _counts.clear();
+  _offsets.clear();
+  _base_vertices.clear();
+}
+
+// Gets the number of pages resident
+size_t paged_geometry::get_resident_count() const {
+  if (!_residency)
+    return 0;
+  return std::count_if(_residency->slots.begin(), _residency->slots.end(),
+                       [](const slot_state &s) { return s.page >= 0; });
+}
+}
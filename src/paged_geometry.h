@@ -0,0 +1,171 @@
+#pragma once
+
+#include "mesh_data.h"
+#include "stdafx.h"
+#include "virtual_file.h"
+
+namespace graphics_framework {
+/*
+Geometry too large to hold in memory, paged in from disk as the camera moves.
+The mesh is baked offline into spatially ordered chunks, each stored at
+several levels of detail, and the baked file is mapped rather than read.  Each
+frame the chunks choose a level by their distance from the eye, and missing
+pages are copied out of the mapping by the asset stream's workers, nearest
+first.  Pages are uploaded within the stream's frame budget into slots of one
+GPU pool, evicting the least recently drawn.  Each level has its own slots,
+sized for its largest page, so coarse pages do not take up the room of fine
+ones.  A chunk is drawn at the nearest level resident until the one it wants
+arrives, and every drawn chunk goes into one multi-draw.  Coordinates are in
+mesh space
+*/
+class paged_geometry {
+public:
+  // The baked file format version.  Files of another version are rejected
+  static const uint32_t version = 1;
+
+  // One level of detail of a chunk
+  struct level {
+    // The offset of the page in the file
+    uint64_t offset;
+    // The number of vertices
+    GLuint vertices;
+    // The number of indices
+    GLuint indices;
+    // The largest distance the level strays from the full mesh
+    float error;
+  };
+
+  // A spatial piece of the mesh
+  struct chunk {
+    // The minimal point of the chunk
+    glm::vec3 minimal;
+    // The maximal point of the chunk
+    glm::vec3 maximal;
+    // The levels of detail, finest first
+    std::vector<level> levels;
+  };
+
+private:
+  // A page's place in the pool
+  struct page_state {
+    // The slot holding the page.  -1 if not resident
+    int slot = -1;
+    // Flag determining if the page is being paged in
+    bool requested = false;
+    // Flag determining if the page was found corrupt, so is never requested again
+    bool failed = false;
+  };
+
+  // A slot of the pool
+  struct slot_state {
+    // The page held.  -1 if free
+    int page = -1;
+    // The frame the slot was last drawn
+    unsigned long long last_used = 0;
+    // The level of detail of the pages the slot holds
+    GLuint level = 0;
+    // The first vertex of the slot in the pool
+    GLuint first_vertex = 0;
+    // The first index of the slot in the pool
+    GLuint first_index = 0;
+  };
+
+  // The paging state, shared with the loads in flight so they can finish after the geometry has gone
+  struct residency {
+    // The state of each page, indexed by chunk then level
+    std::vector<page_state> pages;
+    // The slots of the pool
+    std::vector<slot_state> slots;
+    // The OpenGL IDs of the pool's attribute buffers, keyed by attribute index
+    std::map<GLuint, GLuint> buffers;
+    // The OpenGL ID of the pool's index buffer
+    GLuint index_buffer = 0;
+    // The number of pages being paged in
+    size_t in_flight = 0;
+    // The number of pages being paged in at each level
+    std::vector<size_t> level_in_flight;
+    // The frame counter, advanced by each update
+    unsigned long long frame = 0;
+    // The number of bytes paged in
+    size_t bytes_paged = 0;
+  };
+
+  // The mapped baked file
+  virtual_file _file;
+  // The number of float components of each attribute, keyed by attribute index
+  std::map<GLuint, GLint> _components;
+  // The chunks, in spatial order
+  std::vector<chunk> _chunks;
+  // The most levels of any chunk
+  GLuint _level_count = 0;
+  // The OpenGL ID of the vertex array object over the pool
+  GLuint _vao = 0;
+  // The paging state
+  std::shared_ptr<residency> _residency;
+  // The largest error drawn per unit of distance from the eye
+  float _error_tolerance = 0.002f;
+  // The most pages paged in at once
+  size_t _max_in_flight = 8;
+  // The index counts of this frame's draws
+  std::vector<GLsizei> _counts;
+  // The index offsets of this frame's draws
+  std::vector<const void *> _offsets;
+  // The base vertices of this frame's draws
+  std::vector<GLint> _base_vertices;
+  // The pages missing this frame with their chunk's distance from the eye
+  std::vector<std::pair<float, size_t>> _wanted;
+  // The file the geometry was opened from
+  std::string _name;
+  // Creates the pool buffers and vertex array object
+  void create_pool(size_t pool_bytes);
+  // Requests a page from the asset stream
+  void request(size_t page);
+
+public:
+  // Creates empty paged geometry
+  paged_geometry() {}
+  // Opens a baked file, creating a GPU pool of about the given size.  Nothing is paged in until update.  The pool is
+  // shared equally between the levels, and each level's share should hold more slots than there are chunks in view
+  // at that level, or levels cannot change until some leave it
+  explicit paged_geometry(const std::string &filename, size_t pool_bytes = size_t(256) << 20);
+  // Default copy constructor and assignment operator.  Copies share the pool
+  paged_geometry(const paged_geometry &other) = default;
+  paged_geometry &operator=(const paged_geometry &rhs) = default;
+  // Destroys the paged geometry.  The pool is kept until release
+  ~paged_geometry() {}
+  // Chooses each chunk's level for the eye position, requests missing pages and lays out this frame's draws.  Call
+  // once a frame before rendering
+  void update(const glm::vec3 &eye);
+  // Draws the chunks resident at the last update with one multi-draw
+  void draw() const;
+  // Deletes the pool.  Loads in flight are discarded when they arrive
+  void release();
+  // Gets the chunks, in spatial order
+  const std::vector<chunk> &get_chunks() const { return _chunks; }
+  // Gets the number of float components of each attribute, keyed by attribute index
+  const std::map<GLuint, GLint> &get_components() const { return _components; }
+  // Gets the number of slots in the pool
+  size_t get_slot_count() const { return _residency ? _residency->slots.size() : 0; }
+  // Gets the number of pages resident
+  size_t get_resident_count() const;
+  // Gets the number of pages being paged in
+  size_t get_in_flight() const { return _residency ? _residency->in_flight : 0; }
+  // Gets the number of bytes paged in since opening
+  size_t get_bytes_paged() const { return _residency ? _residency->bytes_paged : 0; }
+  // Gets the number of chunks drawn at the last update
+  size_t get_draw_count() const { return _counts.size(); }
+  // Gets the largest error drawn per unit of distance from the eye
+  float get_error_tolerance() const { return _error_tolerance; }
+  // Sets the largest error drawn per unit of distance from the eye.  Larger values draw coarser levels
+  void set_error_tolerance(float value) { _error_tolerance = value; }
+  // Sets the most pages paged in at once
+  void set_max_in_flight(size_t value) { _max_in_flight = std::max(value, size_t(1)); }
+  // Gets the file the geometry was opened from
+  const std::string &get_name() const { return _name; }
+  // Bakes an indexed triangle list into chunks of about the given number of triangles, each with up to the given
+  // number of levels.  Coarser levels merge the vertices within a grid cell that doubles in size each level.  Needs
+  // no OpenGL context
+  static bool write(const std::string &path, const mesh_data &data, GLuint chunk_triangles = 32768,
+                    GLuint levels = 4);
+};
+}
@@ -0,0 +1,162 @@
+#include "stdafx.h"
+
+#include "gpu_memory.h"
+#include "pixel_upload.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+GLuint pixel_upload::_buffer = 0;
+unsigned char *pixel_upload::_mapped = nullptr;
+size_t pixel_upload::_region_size = 0;
+std::vector<GLsync> pixel_upload::_fences;
+size_t pixel_upload::_region = 0;
+size_t pixel_upload::_offset = 0;
+size_t pixel_upload::_reserved = 0;
+size_t pixel_upload::_stalls = 0;
+size_t pixel_upload::_staged_bytes = 0;
+size_t pixel_upload::_direct_uploads = 0;
+
+// Offsets are kept to a multiple of the largest texel so any format can be read from them
+static const size_t offset_alignment = 16;
+
+// Gets the size of pixel data as read with the default unpack alignment of 4
+static size_t pixel_bytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+  size_t components = 4;
+  switch (format) {
+  case GL_RED:
+  case GL_DEPTH_COMPONENT:
+    components = 1;
+    break;
+  case GL_RG:
+    components = 2;
+    break;
+  case GL_RGB:
+  case GL_BGR:
+    components = 3;
+    break;
+  }
+  size_t bytes = type == GL_UNSIGNED_BYTE || type == GL_BYTE ? 1 : (type == GL_HALF_FLOAT ? 2 : 4);
+  auto row = (static_cast<size_t>(width) * components * bytes + 3) & ~static_cast<size_t>(3);
+  return row * height;
+}
+
+// Creates the staging buffer
+bool pixel_upload::initialise(size_t region_size, unsigned int regions) {
+  shutdown();
+  if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage) {
+    LOG_INFO << "buffer storage not available.  Textures upload from client memory";
+    return false;
+  }
+  assert(region_size > 0 && regions > 1);
+  auto size = region_size * regions;
+  auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &_buffer);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+  glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+  _mapped = static_cast<unsigned char *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if (CHECK_GL_ERROR || !_mapped) {
+    // Not fatal.  Uploads fall back to client memory
+    LOG_ERROR << "creating pixel upload buffer: Could not map buffer storage";
+    glDeleteBuffers(1, &_buffer);
+    _buffer = 0;
+    _mapped = nullptr;
+    return false;
+  }
+  gpu_memory::track_buffer(_buffer, size, gpu_memory::staging_buffer, "pixel upload");
+  _region_size = region_size;
+  _fences.assign(regions, nullptr);
+  _region = 0;
+  _offset = 0;
+  LOG_INFO << "pixel upload buffer created, " << regions << " regions of " << region_size / 1024 << " KB";
+  return true;
+}
+
+// Deletes the staging buffer
+void pixel_upload::shutdown() {
+  for (auto &fence : _fences) {
+    if (fence)
+      glDeleteSync(fence);
+  }
+  _fences.clear();
+  if (_buffer) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &_buffer);
+    gpu_memory::release_buffer(_buffer);
+    CHECK_GL_ERROR; // Non-fatal
+  }
+  _buffer = 0;
+  _mapped = nullptr;
+}
+
+// Moves to the next region, waiting for the GPU to finish reading it
+void pixel_upload::next_region() {
+  _region = (_region + 1) % _fences.size();
+  _offset = 0;
+  auto &fence = _fences[_region];
+  if (!fence)
+    return;
+  // Only wait when the GPU is still reading the region, which means uploads are outpacing it
+  if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+    ++_stalls;
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+      ;
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+// Reserves mapped memory for the next upload
+void *pixel_upload::reserve(size_t bytes) {
+  if (!_mapped || bytes > _region_size)
+    return nullptr;
+  _offset = (_offset + offset_alignment - 1) & ~(offset_alignment - 1);
+  if (_offset + bytes > _region_size)
+    next_region();
+  _reserved = _region * _region_size + _offset;
+  _offset += bytes;
+  return _mapped + _reserved;
+}
+
+// Uploads the reserved memory to the bound texture
+void pixel_upload::submit(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+                          GLenum type) {
+  assert(_mapped);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+  glTexSubImage2D(target, level, x, y, width, height, format, type, reinterpret_cast<const void *>(_reserved));
+  // Other uploads read from client memory
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  // A later fence covers every earlier upload from the region
+  auto &fence = _fences[_region];
+  if (fence)
+    glDeleteSync(fence);
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  _staged_bytes += pixel_bytes(width, height, format, type);
+  CHECK_GL_ERROR; // Non-fatal
+}
+
+// Uploads pixels to the bound texture, staging them if possible
+void pixel_upload::upload(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+                          GLenum type, const void *pixels) {
+  // Uploads larger than a region are staged in strips of as many rows as a region holds
+  auto row = pixel_bytes(width, 1, format, type);
+  GLsizei rows = 0;
+  if (_mapped && row > 0)
+    rows = static_cast<GLsizei>(std::min(_region_size / row, static_cast<size_t>(height)));
+  if (rows == 0) {
+    glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+    ++_direct_uploads;
+    return;
+  }
+  auto source = static_cast<const unsigned char *>(pixels);
+  for (GLsizei first = 0; first < height; first += rows) {
+    auto count = std::min(rows, height - first);
+    auto staging = reserve(row * count);
+    memcpy(staging, source + row * first, row * count);
+    submit(target, level, x, y + first, width, count, format, type);
+  }
+}
+}
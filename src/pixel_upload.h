@@ -0,0 +1,69 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Static class that stages texture uploads through a pixel unpack buffer.  One
+buffer is created with persistent, coherent mapping and split into regions
+that are filled in turn.  Pixels are written into mapped memory and the
+texture is filled with glTexSubImage2D from the buffer offset, so the driver
+neither copies from client memory nor waits for the GPU.  A fence follows the
+uploads from each region, and a region is only refilled once its fence has
+signalled.  Uploads larger than a region are split into strips of rows that
+are staged in turn, so large textures are staged too.  Without GL 4.4 or
+ARB_buffer_storage pixels are uploaded from client memory as before.
+reserve and submit let a writer on the GL thread fill the mapping directly,
+but no loader uses them yet.  Images are decoded on workers into their own
+memory, so every texture path still goes through upload's copy
+*/
+class pixel_upload {
+private:
+  // The staging buffer
+  static GLuint _buffer;
+  // The persistently mapped contents of the staging buffer
+  static unsigned char *_mapped;
+  // The size of each region in bytes
+  static size_t _region_size;
+  // The fence following the latest upload from each region
+  static std::vector<GLsync> _fences;
+  // The region being filled
+  static size_t _region;
+  // The next free byte in the region being filled
+  static size_t _offset;
+  // The offset of the memory handed out by reserve, from the start of the buffer
+  static size_t _reserved;
+  // The number of times a region was still in use when needed
+  static size_t _stalls;
+  // The number of bytes uploaded through the staging buffer
+  static size_t _staged_bytes;
+  // The number of uploads made from client memory
+  static size_t _direct_uploads;
+  // Moves to the next region, waiting for the GPU to finish reading it
+  static void next_region();
+
+public:
+  // Creates the staging buffer.  Called by the renderer.  Returns false if buffer storage is not available
+  static bool initialise(size_t region_size = 16 * 1024 * 1024, unsigned int regions = 3);
+  // Deletes the staging buffer.  Called by the renderer on shutdown
+  static void shutdown();
+  // Checks if uploads are staged
+  static bool is_available() { return _mapped != nullptr; }
+  // Reserves mapped memory for the next upload, such as for a generator to write into directly.  GL thread only.
+  // Returns null if the upload cannot be staged.  The memory is only valid until submit
+  static void *reserve(size_t bytes);
+  // Uploads the reserved memory to the texture bound to the target
+  static void submit(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+                     GLenum type);
+  // Uploads pixels to the texture bound to the target, staging them if possible.  Uploads larger than a region are
+  // staged in strips of rows.  Storage must already exist
+  static void upload(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+                     GLenum type, const void *pixels);
+  // Gets the number of times an upload waited for the GPU to release a region
+  static size_t get_stalls() { return _stalls; }
+  // Gets the number of bytes uploaded through the staging buffer
+  static size_t get_staged_bytes() { return _staged_bytes; }
+  // Gets the number of uploads made from client memory
+  static size_t get_direct_uploads() { return _direct_uploads; }
+};
+}
@@ -0,0 +1,588 @@
+#include "stdafx.h"
+
+#include "asset_stream.h"
+#include "gl_capture.h"
+#include "gpu_memory.h"
+#include "mapped_file.h"
+#include "mesh_data.h"
+#include "point_cloud.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+const uint32_t point_cloud::version;
+
+// Marks a file as a built point cloud.  "PCLD" when read as bytes
+static const uint32_t cloud_magic = 0x444c4350;
+// Nodes this deep keep every point left, so coincident points cannot split forever
+static const int max_depth = 20;
+// Subtrees this shallow are built on threads of their own while the build has threads to spare
+static const int parallel_depth = 2;
+
+// The fixed header at the start of a built file.  Followed by the node table and the points
+struct cloud_header {
+  // Always cloud_magic
+  uint32_t magic;
+  // The format version
+  uint32_t version;
+  // The number of nodes
+  uint32_t node_count;
+  // The most points of any node
+  uint32_t slot_points;
+  // The number of points in the file
+  uint64_t point_count;
+};
+
+// Describes one node.  Nodes are stored breadth first from the root
+struct cloud_node {
+  // The offset of the node's points
+  uint64_t offset;
+  // The number of points
+  uint32_t points;
+  // The index of the first child
+  uint32_t first_child;
+  // One bit for each octant that has a child
+  uint32_t child_mask;
+  // The average distance between the node's points
+  float spacing;
+  // The minimal point of the node's cube
+  float minimal[3];
+  // The maximal point of the node's cube
+  float maximal[3];
+};
+
+static_assert(sizeof(cloud_header) == 24 && sizeof(cloud_node) == 48 && sizeof(point_cloud::point) == 16,
+              "Point cloud structures must not be padded");
+
+// A point as parsed, before its colour is packed
+struct parsed_point {
+  // The position
+  float position[3];
+  // The colour, in the range it was written.  Negative if the line had none
+  float colour[3];
+};
+
+// A node while building.  The node's points are the first of its range, and its children's follow
+struct built_node {
+  // The range of points of the node and its children
+  size_t begin, end;
+  // The number of points the node keeps
+  size_t own;
+  // The minimal point of the node's cube
+  glm::vec3 minimal;
+  // The edge length of the node's cube
+  float size;
+  // The children, by octant
+  std::unique_ptr<built_node> children[8];
+};
+
+// Parses the lines of a text file between two offsets.  A range starting mid-line begins at the next line
+static void parse_points(const char *text, size_t size, size_t begin, size_t end, std::vector<parsed_point> &out) {
+  if (begin > 0) {
+    auto newline = static_cast<const char *>(memchr(text + begin - 1, '\n', size - (begin - 1)));
+    begin = newline ? newline - text + 1 : size;
+  }
+  // Lines are copied out before parsing, as the mapping is not terminated
+  char line[256];
+  while (begin < end) {
+    auto newline = static_cast<const char *>(memchr(text + begin, '\n', size - begin));
+    auto length = (newline ? newline - text : size) - begin;
+    auto copied = std::min(length, sizeof(line) - 1);
+    memcpy(line, text + begin, copied);
+    line[copied] = '\0';
+    begin += length + 1;
+    float values[7];
+    int count = 0;
+    auto c = line;
+    while (count < 7) {
+      while (*c == ' ' || *c == '\t' || *c == ',' || *c == ';' || *c == '\r')
+        ++c;
+      char *next;
+      values[count] = strtof(c, &next);
+      if (next == c)
+        break;
+      ++count;
+      c = next;
+    }
+    if (count < 3)
+      continue;
+    parsed_point p = {{values[0], values[1], values[2]}, {-1.0f, -1.0f, -1.0f}};
+    // x y z r g b, or x y z intensity r g b
+    if (count >= 6) {
+      auto first = count == 7 ? 4 : 3;
+      for (int k = 0; k < 3; ++k)
+        p.colour[k] = std::max(values[first + k], 0.0f);
+    }
+    out.push_back(p);
+  }
+}
+
+// Splits a node's remaining points into octants, then builds the children.  Shallow subtrees take a thread from the
+// spare count while it is above 0, and give it back when built.  Others are built on the calling thread
+static void build_node(built_node &n, std::vector<point_cloud::point> &points, GLuint node_points, int depth,
+                       std::atomic<int> &spare) {
+  auto count = n.end - n.begin;
+  if (count <= node_points || depth >= max_depth) {
+    n.own = count;
+    return;
+  }
+  // The points are shuffled, so the first of any range are a random sample of it
+  n.own = node_points;
+  auto centre = n.minimal + glm::vec3(n.size * 0.5f);
+  auto first = points.begin();
+  auto split = [&](size_t from, size_t to, int axis) {
+    return static_cast<size_t>(std::partition(first + from, first + to, [&](const point_cloud::point &p) {
+                                 return p.position[axis] < centre[axis];
+                               }) -
+                               first);
+  };
+  // Octant i has bit 0 set above the centre in x, bit 1 in y and bit 2 in z
+  size_t bounds[9];
+  bounds[0] = n.begin + n.own;
+  bounds[8] = n.end;
+  bounds[4] = split(bounds[0], bounds[8], 2);
+  bounds[2] = split(bounds[0], bounds[4], 1);
+  bounds[6] = split(bounds[4], bounds[8], 1);
+  for (int i = 1; i < 8; i += 2)
+    bounds[i] = split(bounds[i - 1], bounds[i + 1], 0);
+  std::vector<std::thread> threads;
+  std::atomic<bool> failed(false);
+  for (int i = 0; i < 8; ++i) {
+    if (bounds[i] == bounds[i + 1])
+      continue;
+    n.children[i].reset(new built_node());
+    auto &child = *n.children[i];
+    child.begin = bounds[i];
+    child.end = bounds[i + 1];
+    child.size = n.size * 0.5f;
+    child.minimal = n.minimal + glm::vec3(i & 1 ? child.size : 0.0f, i & 2 ? child.size : 0.0f,
+                                          i & 4 ? child.size : 0.0f);
+    if (depth < parallel_depth && spare.fetch_sub(1) > 0)
+      threads.emplace_back([&points, &failed, &child, &spare, node_points, depth] {
+        try {
+          build_node(child, points, node_points, depth + 1, spare);
+        } catch (std::exception &) {
+          failed = true;
+        }
+        ++spare;
+      });
+    else {
+      if (depth < parallel_depth)
+        ++spare;
+      build_node(child, points, node_points, depth + 1, spare);
+    }
+  }
+  for (auto &t : threads)
+    t.join();
+  if (failed)
+    throw std::runtime_error("Error building point cloud subtree");
+}
+
+// Builds a text file of points into an octree file
+bool point_cloud::build(const std::string &input, const std::string &output, GLuint node_points,
+                        unsigned int threads) {
+  assert(node_points > 0);
+  if (threads == 0)
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<point> points;
+  glm::vec3 minimal(std::numeric_limits<float>::max()), maximal(-std::numeric_limits<float>::max());
+  try {
+    // Parse ranges of the file in parallel
+    mapped_file file(input);
+    auto text = reinterpret_cast<const char *>(file.get_data());
+    auto size = file.get_size();
+    std::vector<std::vector<parsed_point>> parsed(threads);
+    std::vector<std::thread> workers;
+    std::atomic<bool> failed(false);
+    for (unsigned int t = 0; t < threads; ++t)
+      workers.emplace_back([&, t] {
+        try {
+          parse_points(text, size, size * t / threads, size * (t + 1) / threads, parsed[t]);
+        } catch (std::exception &) {
+          failed = true;
+        }
+      });
+    for (auto &w : workers)
+      w.join();
+    if (failed)
+      throw std::runtime_error("Error parsing points");
+
+    // Colours are bytes unless no value is above 1
+    float largest = 0.0f;
+    size_t total = 0;
+    for (auto &part : parsed) {
+      total += part.size();
+      for (auto &p : part) {
+        largest = std::max(largest, std::max(p.colour[0], std::max(p.colour[1], p.colour[2])));
+        for (int k = 0; k < 3; ++k) {
+          minimal[k] = std::min(minimal[k], p.position[k]);
+          maximal[k] = std::max(maximal[k], p.position[k]);
+        }
+      }
+    }
+    if (total == 0) {
+      LOG_ERROR << "building point cloud " << output << ": " << input << " has no points";
+      return false;
+    }
+    auto scale = largest <= 1.0f ? 255.0f : 1.0f;
+    points.reserve(total);
+    for (auto &part : parsed) {
+      for (auto &p : part) {
+        uint32_t colour = 0xffffffff;
+        if (p.colour[0] >= 0.0f) {
+          colour = 0xff000000;
+          for (int k = 0; k < 3; ++k)
+            colour |= static_cast<uint32_t>(std::min(p.colour[k] * scale + 0.5f, 255.0f)) << (k * 8);
+        }
+        points.push_back({{p.position[0], p.position[1], p.position[2]}, colour});
+      }
+      std::vector<parsed_point>().swap(part);
+    }
+  } catch (std::exception &e) {
+    LOG_ERROR << "building point cloud " << output << ": Could not read " << input << ": " << e.what();
+    return false;
+  }
+
+  // Shuffle once, so every node's sample is spread evenly over its cube, then split the cube down
+  std::shuffle(points.begin(), points.end(), std::mt19937(0x5eed));
+  auto extent = maximal - minimal;
+  built_node root;
+  root.begin = 0;
+  root.end = points.size();
+  root.minimal = minimal;
+  root.size = std::max(std::max(extent.x, extent.y), std::max(extent.z, std::numeric_limits<float>::min()));
+  // The calling thread is one of the threads
+  std::atomic<int> spare(static_cast<int>(threads) - 1);
+  try {
+    build_node(root, points, node_points, 0, spare);
+  } catch (std::exception &e) {
+    LOG_ERROR << "building point cloud " << output << ": " << e.what();
+    return false;
+  }
+
+  // Number the nodes breadth first, so each node's children are together
+  std::vector<const built_node *> order(1, &root);
+  std::vector<cloud_node> table;
+  for (size_t i = 0; i < order.size(); ++i) {
+    auto &n = *order[i];
+    cloud_node record = {};
+    record.points = static_cast<uint32_t>(n.own);
+    record.first_child = static_cast<uint32_t>(order.size());
+    record.spacing = n.size / std::sqrt(static_cast<float>(std::max(n.own, size_t(1))));
+    for (int k = 0; k < 3; ++k) {
+      record.minimal[k] = n.minimal[k];
+      record.maximal[k] = n.minimal[k] + n.size;
+    }
+    for (int c = 0; c < 8; ++c) {
+      if (n.children[c]) {
+        record.child_mask |= 1u << c;
+        order.push_back(n.children[c].get());
+      }
+    }
+    table.push_back(record);
+  }
+  cloud_header header = {cloud_magic, version, static_cast<uint32_t>(table.size()), 0, points.size()};
+  // The points start on a whole point after the tables
+  auto tables = sizeof(header) + table.size() * sizeof(cloud_node);
+  uint64_t offset = (tables + sizeof(point) - 1) / sizeof(point) * sizeof(point);
+  for (size_t i = 0; i < table.size(); ++i) {
+    table[i].offset = offset;
+    offset += order[i]->own * sizeof(point);
+    header.slot_points = std::max(header.slot_points, table[i].points);
+  }
+
+  // Write to a temporary file first, so a reader never maps a partial file
+  std::stringstream temp;
+  temp << output << "." << std::this_thread::get_id() << ".tmp";
+  {
+    std::ofstream file(temp.str(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(cloud_node));
+    static const char zeros[sizeof(point)] = {};
+    file.write(zeros, static_cast<std::streamsize>(table[0].offset - tables));
+    for (auto n : order)
+      file.write(reinterpret_cast<const char *>(&points[n->begin]), n->own * sizeof(point));
+    if (!file.good()) {
+      file.close();
+      std::remove(temp.str().c_str());
+      LOG_ERROR << "building point cloud " << output << ": Could not write file";
+      return false;
+    }
+  }
+  // Replace any older file
+  if (std::rename(temp.str().c_str(), output.c_str()) != 0) {
+    std::remove(output.c_str());
+    if (std::rename(temp.str().c_str(), output.c_str()) != 0) {
+      std::remove(temp.str().c_str());
+      LOG_ERROR << "building point cloud " << output << ": Could not replace file";
+      return false;
+    }
+  }
+  LOG_INFO << "point cloud " << output << " built with " << points.size() << " points in " << table.size()
+           << " nodes";
+  return true;
+}
+
+// Opens a built file
+point_cloud::point_cloud(const std::string &filename, size_t pool_bytes) : _name(filename) {
+  // Check that file exists
+  if (!check_file_exists(filename)) {
+    // Failed to read file.  Display error
+    LOG_ERROR << "could not load point cloud " << filename << ": File Does Not Exist";
+    // Throw exception
+    throw std::runtime_error("Error loading point cloud");
+  }
+  _file = virtual_file(filename);
+  auto bytes = _file.get_data();
+  auto size = static_cast<uint64_t>(_file.get_size());
+  // Checks a table or node lies inside the file
+  auto inside = [=](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+  auto corrupt = [&]() {
+    LOG_ERROR << "could not load point cloud " << filename << ": File is corrupt";
+    throw std::runtime_error("Error loading point cloud");
+  };
+
+  cloud_header header;
+  if (!inside(0, sizeof(header)))
+    corrupt();
+  memcpy(&header, bytes, sizeof(header));
+  if (header.magic != cloud_magic || header.version != version) {
+    LOG_ERROR << "could not load point cloud " << filename << ": Wrong format version.  Build the points again";
+    throw std::runtime_error("Error loading point cloud");
+  }
+  if (header.node_count == 0 || header.slot_points == 0 ||
+      !inside(sizeof(header), uint64_t(header.node_count) * sizeof(cloud_node)))
+    corrupt();
+
+  // Children always follow their parent, so the tree has no cycles
+  _slot_points = header.slot_points;
+  _nodes.resize(header.node_count);
+  for (uint32_t i = 0; i < header.node_count; ++i) {
+    cloud_node record;
+    memcpy(&record, bytes + sizeof(header) + i * sizeof(record), sizeof(record));
+    auto children = 0u;
+    for (auto mask = record.child_mask; mask != 0; mask &= mask - 1)
+      ++children;
+    if (record.points > _slot_points || record.offset % sizeof(point) != 0 || record.child_mask > 0xff ||
+        !inside(record.offset, uint64_t(record.points) * sizeof(point)) ||
+        (children > 0 && (record.first_child <= i || uint64_t(record.first_child) + children > header.node_count)))
+      corrupt();
+    auto &n = _nodes[i];
+    n.offset = record.offset;
+    n.points = record.points;
+    n.first_child = record.first_child;
+    n.child_mask = record.child_mask;
+    n.spacing = record.spacing;
+    n.minimal = glm::vec3(record.minimal[0], record.minimal[1], record.minimal[2]);
+    n.maximal = glm::vec3(record.maximal[0], record.maximal[1], record.maximal[2]);
+  }
+
+  _residency = std::make_shared<residency>();
+  _residency->pages.resize(_nodes.size());
+  create_pool(pool_bytes);
+  LOG_INFO << "point cloud " << filename << " opened with " << header.point_count << " points in " << _nodes.size()
+           << " nodes and " << _residency->slots.size() << " slots";
+}
+
+// Creates the pool buffer and vertex array object
+void point_cloud::create_pool(size_t pool_bytes) {
+  auto slot_bytes = _slot_points * sizeof(point);
+  auto slots = std::min(std::max(pool_bytes / slot_bytes, size_t(1)), _nodes.size());
+  glGenVertexArrays(1, &_vao);
+  glBindVertexArray(_vao);
+  glGenBuffers(1, &_residency->buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, _residency->buffer);
+  glBufferData(GL_ARRAY_BUFFER, slots * slot_bytes, nullptr, GL_DYNAMIC_DRAW);
+  glVertexAttribPointer(POSITION_BUFFER, 3, GL_FLOAT, GL_FALSE, sizeof(point), 0);
+  glEnableVertexAttribArray(POSITION_BUFFER);
+  glVertexAttribPointer(COLOUR_BUFFER, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(point),
+                        reinterpret_cast<const void *>(offsetof(point, colour)));
+  glEnableVertexAttribArray(COLOUR_BUFFER);
+  glBindVertexArray(0);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "creating point cloud pool for " << _name << ": Could not create buffers with OpenGL";
+    release();
+    throw std::runtime_error("Error creating point cloud pool");
+  }
+  gpu_memory::track_buffer(_residency->buffer, slots * slot_bytes, gpu_memory::vertex_buffer, _name);
+  _residency->slots.resize(slots);
+}
+
+// Requests a node from the asset stream
+void point_cloud::request(GLuint index) {
+  auto res = _residency;
+  auto file = _file;
+  auto entry = _nodes[index];
+  auto slot_points = _slot_points;
+  auto name = _name;
+  auto data = std::make_shared<std::vector<unsigned char>>();
+  res->pages[index].requested = true;
+  ++res->in_flight;
+  // Marks the request as done.  Runs on the renderer thread
+  auto done = [=]() {
+    if (res->pages.size() > index && res->pages[index].requested) {
+      res->pages[index].requested = false;
+      --res->in_flight;
+    }
+  };
+  asset_stream::load_task(
+      name,
+      [=]() {
+        // Reading the mapping here pages the points in from disk off the renderer thread
+        auto begin = file.get_data() + entry.offset;
+        data->assign(begin, begin + size_t(entry.points) * sizeof(point));
+      },
+      [=]() {
+        done();
+        // Released while in flight
+        if (res->slots.empty())
+          return;
+        // Take a free slot, or the least recently drawn that was not drawn this frame
+        int slot = -1;
+        for (size_t s = 0; s < res->slots.size(); ++s) {
+          auto &candidate = res->slots[s];
+          if (candidate.node < 0) {
+            slot = static_cast<int>(s);
+            break;
+          }
+          if (candidate.last_used < res->frame && (slot < 0 || candidate.last_used < res->slots[slot].last_used))
+            slot = static_cast<int>(s);
+        }
+        // Every slot is in use.  The node is requested again while it is still wanted
+        if (slot < 0)
+          return;
+        auto &target = res->slots[slot];
+        if (target.node >= 0)
+          res->pages[target.node].slot = -1;
+        target.node = -1;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, res->buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, size_t(slot) * slot_points * sizeof(point), data->size(), data->data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (CHECK_GL_ERROR) {
+          LOG_ERROR << "paging " << name << ": Could not upload node " << index;
+          throw std::runtime_error("Error uploading point cloud");
+        }
+        target.node = static_cast<int>(index);
+        target.last_used = res->frame;
+        res->pages[index].slot = slot;
+        res->bytes_paged += data->size();
+      },
+      done);
+}
+
+// Chooses the nodes to draw, requests missing nodes and lays out this frame's draws
+void point_cloud::update(const camera &cam, float viewport_height) {
+  _firsts.clear();
+  _counts.clear();
+  _points_drawn = 0;
+  if (!_residency || _residency->slots.empty())
+    return;
+  auto &res = *_residency;
+  ++res.frame;
+  glm::vec4 planes[6];
+  get_frustum_planes(cam.get_projection() * cam.get_view(), planes);
+  auto eye = cam.get_position();
+  // The pixels covered by one unit at a distance of one
+  auto pixels = viewport_height * 0.5f * cam.get_projection()[1][1];
+  // The pixels a node's point gap covers.  Infinite with the eye inside the node
+  auto projected = [&](const node &n) {
+    auto distance = glm::distance(eye, glm::clamp(eye, n.minimal, n.maximal));
+    return distance > 0.0f ? n.spacing * pixels / distance : std::numeric_limits<float>::max();
+  };
+
+  // Visit the nodes largest on screen first.  A node's children only add to it, so they are visited once it is drawn
+  _heap.clear();
+  _heap.emplace_back(projected(_nodes[0]), 0u);
+  _wanted.clear();
+  while (!_heap.empty()) {
+    std::pop_heap(_heap.begin(), _heap.end());
+    auto index = _heap.back().second;
+    auto size = _heap.back().first;
+    _heap.pop_back();
+    auto &n = _nodes[index];
+    // Outside if the box's corner furthest along any plane's normal is behind it
+    auto outside = false;
+    for (auto &p : planes) {
+      glm::vec3 corner(p.x >= 0.0f ? n.maximal.x : n.minimal.x, p.y >= 0.0f ? n.maximal.y : n.minimal.y,
+                       p.z >= 0.0f ? n.maximal.z : n.minimal.z);
+      outside = outside || glm::dot(glm::vec3(p), corner) + p.w < 0.0f;
+    }
+    if (outside)
+      continue;
+    if (_points_drawn + n.points > _point_budget)
+      break;
+    auto &page = res.pages[index];
+    if (page.slot < 0) {
+      if (!page.requested)
+        _wanted.push_back(index);
+      continue;
+    }
+    res.slots[page.slot].last_used = res.frame;
+    _firsts.push_back(static_cast<GLint>(size_t(page.slot) * _slot_points));
+    _counts.push_back(static_cast<GLsizei>(n.points));
+    _points_drawn += n.points;
+    if (size <= _error_pixels)
+      continue;
+    auto child = n.first_child;
+    for (int c = 0; c < 8; ++c) {
+      if (n.child_mask & (1u << c)) {
+        _heap.emplace_back(projected(_nodes[child]), child);
+        std::push_heap(_heap.begin(), _heap.end());
+        ++child;
+      }
+    }
+  }
+  // Largest first.  Each load takes a slot not drawn this frame, so no more are requested than there are such slots
+  auto spare = static_cast<size_t>(std::count_if(res.slots.begin(), res.slots.end(), [&](const slot_state &s) {
+    return s.node < 0 || s.last_used < res.frame;
+  }));
+  for (auto index : _wanted) {
+    if (res.in_flight >= std::min(_max_in_flight, spare))
+      break;
+    request(index);
+  }
+}
+
+// Draws the nodes chosen at the last update
+void point_cloud::draw() const {
+  if (_counts.empty())
+    return;
+  // Captures only describe separate float buffers, not the interleaved points
+  if (gl_capture::is_recording())
+    gl_capture::record_unsupported("point cloud " + _name);
+  glBindVertexArray(_vao);
+  glMultiDrawArrays(GL_POINTS, _firsts.data(), _counts.data(), static_cast<GLsizei>(_counts.size()));
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rendering point cloud " << _name << ": Could not draw nodes";
+    throw std::runtime_error("Error rendering point cloud");
+  }
+}
+
+// Deletes the pool
+void point_cloud::release() {
+  if (!_residency)
+    return;
+  if (_residency->buffer != 0) {
+    glDeleteBuffers(1, &_residency->buffer);
+    gpu_memory::release_buffer(_residency->buffer);
+  }
+  if (_vao != 0)
+    glDeleteVertexArrays(1, &_vao);
+  _residency->buffer = 0;
+  _residency->slots.clear();
+  for (auto &p : _residency->pages)
+    p.slot = -1;
+  _vao = 0;
+  _firsts.clear();
+  _counts.clear();
+  _points_drawn = 0;
+}
+
+// Gets the number of nodes resident
+size_t point_cloud::get_resident_count() const {
+  if (!_residency)
+    return 0;
+  return std::count_if(_residency->slots.begin(), _residency->slots.end(),
+                       [](const slot_state &s) { return s.node >= 0; });
+}
+}
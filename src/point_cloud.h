@@ -0,0 +1,169 @@
+#pragma once
+
+#include "camera.h"
+#include "stdafx.h"
+#include "virtual_file.h"
+
+namespace graphics_framework {
+/*
+A point set too large to draw or hold at once, such as a laser scan.  The
+points are built offline into an octree, where each node keeps a random
+sample of the points inside it and passes the rest to its children, so
+drawing a node's children adds detail to it.  The built file is mapped
+rather than read.  Each frame the nodes are visited largest on screen first,
+refining while the gap between a node's points would cover more than a few
+pixels and stopping at a budget of points.  Missing nodes are copied out of
+the mapping by the asset stream's workers and uploaded into fixed size slots
+of one GPU pool, evicting the least recently drawn.  Every drawn node goes
+into one multi-draw of GL_POINTS, with positions at attribute 0 and colours
+at attribute 1, so the effect sets gl_PointSize.  Coordinates are in cloud
+space
+*/
+class point_cloud {
+public:
+  // The built file format version.  Files of another version are rejected
+  static const uint32_t version = 1;
+
+  // A point as stored in the file and in the pool
+  struct point {
+    // The position
+    float position[3];
+    // The colour as RGBA bytes, red first
+    uint32_t colour;
+  };
+
+  // A node of the octree
+  struct node {
+    // The offset of the node's points in the file
+    uint64_t offset;
+    // The number of points
+    GLuint points;
+    // The index of the first child.  Children are stored together, in octant order
+    GLuint first_child;
+    // One bit for each octant that has a child
+    GLuint child_mask;
+    // The average distance between the node's points
+    float spacing;
+    // The minimal point of the node's cube
+    glm::vec3 minimal;
+    // The maximal point of the node's cube
+    glm::vec3 maximal;
+  };
+
+private:
+  // A node's place in the pool
+  struct page_state {
+    // The slot holding the node.  -1 if not resident
+    int slot = -1;
+    // Flag determining if the node is being paged in
+    bool requested = false;
+  };
+
+  // A slot of the pool
+  struct slot_state {
+    // The node held.  -1 if free
+    int node = -1;
+    // The frame the slot was last drawn
+    unsigned long long last_used = 0;
+  };
+
+  // The paging state, shared with the loads in flight so they can finish after the point cloud has gone
+  struct residency {
+    // The state of each node
+    std::vector<page_state> pages;
+    // The slots of the pool
+    std::vector<slot_state> slots;
+    // The OpenGL ID of the pool's vertex buffer
+    GLuint buffer = 0;
+    // The number of nodes being paged in
+    size_t in_flight = 0;
+    // The frame counter, advanced by each update
+    unsigned long long frame = 0;
+    // The number of bytes paged in
+    size_t bytes_paged = 0;
+  };
+
+  // The mapped built file
+  virtual_file _file;
+  // The nodes, breadth first from the root
+  std::vector<node> _nodes;
+  // The points each slot holds
+  GLuint _slot_points = 0;
+  // The OpenGL ID of the vertex array object over the pool
+  GLuint _vao = 0;
+  // The paging state
+  std::shared_ptr<residency> _residency;
+  // The largest gap between points, in pixels, drawn without refining
+  float _error_pixels = 2.0f;
+  // The most points drawn each frame
+  size_t _point_budget = 2000000;
+  // The most nodes paged in at once
+  size_t _max_in_flight = 8;
+  // The first points of this frame's draws
+  std::vector<GLint> _firsts;
+  // The point counts of this frame's draws
+  std::vector<GLsizei> _counts;
+  // The nodes still to visit this frame, keyed by the pixels their point gap covers
+  std::vector<std::pair<float, GLuint>> _heap;
+  // The nodes missing this frame, largest on screen first
+  std::vector<GLuint> _wanted;
+  // The number of points drawn at the last update
+  size_t _points_drawn = 0;
+  // The file the point cloud was opened from
+  std::string _name;
+  // Creates the pool buffer and vertex array object
+  void create_pool(size_t pool_bytes);
+  // Requests a node from the asset stream
+  void request(GLuint index);
+
+public:
+  // Creates an empty point cloud
+  point_cloud() {}
+  // Opens a built file, creating a GPU pool of about the given size.  Nothing is paged in until update
+  explicit point_cloud(const std::string &filename, size_t pool_bytes = size_t(256) << 20);
+  // Default copy constructor and assignment operator.  Copies share the pool
+  point_cloud(const point_cloud &other) = default;
+  point_cloud &operator=(const point_cloud &rhs) = default;
+  // Destroys the point cloud.  The pool is kept until release
+  ~point_cloud() {}
+  // Chooses the nodes to draw from the camera and the viewport height in pixels, requests missing nodes and lays out
+  // this frame's draws.  Call once a frame before rendering
+  void update(const camera &cam, float viewport_height);
+  // Draws the nodes chosen at the last update with one multi-draw
+  void draw() const;
+  // Deletes the pool.  Loads in flight are discarded when they arrive
+  void release();
+  // Gets the nodes, breadth first from the root
+  const std::vector<node> &get_nodes() const { return _nodes; }
+  // Gets the number of slots in the pool
+  size_t get_slot_count() const { return _residency ? _residency->slots.size() : 0; }
+  // Gets the number of nodes resident
+  size_t get_resident_count() const;
+  // Gets the number of nodes being paged in
+  size_t get_in_flight() const { return _residency ? _residency->in_flight : 0; }
+  // Gets the number of bytes paged in since opening
+  size_t get_bytes_paged() const { return _residency ? _residency->bytes_paged : 0; }
+  // Gets the number of nodes drawn at the last update
+  size_t get_draw_count() const { return _counts.size(); }
+  // Gets the number of points drawn at the last update
+  size_t get_points_drawn() const { return _points_drawn; }
+  // Gets the largest gap between points, in pixels, drawn without refining
+  float get_error_pixels() const { return _error_pixels; }
+  // Sets the largest gap between points, in pixels, drawn without refining.  Larger values draw fewer points
+  void set_error_pixels(float value) { _error_pixels = value; }
+  // Gets the most points drawn each frame
+  size_t get_point_budget() const { return _point_budget; }
+  // Sets the most points drawn each frame
+  void set_point_budget(size_t value) { _point_budget = value; }
+  // Sets the most nodes paged in at once
+  void set_max_in_flight(size_t value) { _max_in_flight = std::max(value, size_t(1)); }
+  // Gets the file the point cloud was opened from
+  const std::string &get_name() const { return _name; }
+  // Builds a text file of points into an octree file, with at most the given number of points in a node.  Each line
+  // holds x y z, optionally followed by r g b in 0 to 255 or 0 to 1, or by an intensity and then r g b as in .pts
+  // files.  Lines without three numbers are skipped.  The file is parsed and the subtrees are built on the given
+  // number of threads, or one per hardware thread if 0.  Needs no OpenGL context
+  static bool build(const std::string &input, const std::string &output, GLuint node_points = 20000,
+                    unsigned int threads = 0);
+};
+}
@@ -0,0 +1,190 @@
+#include "stdafx.h"
+
+#include "gl_capture.h"
+#include "gpu_memory.h"
+#include "procedural_shapes.h"
+#include "util.h"
+
+namespace graphics_framework {
+// The attribute location of the first model matrix column.  The columns take four locations
+static const GLuint transform_location = 5;
+// The attribute location of the kind, stacks, slices and ring ratio
+static const GLuint parameters_location = 9;
+// The attribute location of the first normal matrix column.  The columns take three locations
+static const GLuint normal_location = 10;
+
+// Rounds up to a power of two
+static GLuint round_up_power_of_two(GLuint value) {
+  GLuint result = 1;
+  while (result < value)
+    result *= 2;
+  return result;
+}
+
+// Adds a shape
+size_t procedural_shapes::add(const glm::mat4 &transform, kind type, GLuint stacks, GLuint slices,
+                              float ring_ratio) {
+  _shapes.push_back({transform, type, stacks, slices, ring_ratio});
+  return _shapes.size() - 1;
+}
+
+// Gets the number of vertices one shape is drawn with
+GLsizei procedural_shapes::get_vertex_count(kind type, GLuint stacks, GLuint slices) {
+  // Cylinders have a row of quads for each cap
+  return static_cast<GLsizei>(6 * (type == cylinder ? stacks + 2 : stacks) * slices);
+}
+
+// Sets the fewest and most slices of an adapted shape
+void procedural_shapes::set_slice_range(GLuint minimum, GLuint maximum) {
+  _min_slices = round_up_power_of_two(std::max(minimum, 4u));
+  _max_slices = std::max(round_up_power_of_two(maximum), _min_slices);
+}
+
+// Culls the shapes, adapts their tessellation and uploads the parameter blocks
+void procedural_shapes::update(const camera &cam, float viewport_height) {
+  _groups.clear();
+  _shapes_drawn = 0;
+  _vertices_drawn = 0;
+  if (_shapes.empty())
+    return;
+  glm::vec4 planes[6];
+  get_frustum_planes(cam.get_projection() * cam.get_view(), planes);
+  auto eye = cam.get_position();
+  // The pixels covered by one unit at a distance of one
+  auto pixels = viewport_height * 0.5f * cam.get_projection()[1][1];
+
+  // Each visible shape with its tessellation, sorted so shapes drawn together are together
+  _visible.clear();
+  for (size_t i = 0; i < _shapes.size(); ++i) {
+    auto &s = _shapes[i];
+    // The bounding sphere.  The unit shapes fit in spheres of radius 1, 1 plus the tube, or half a unit diagonal
+    auto scale = std::max(glm::length(glm::vec3(s.transform[0])),
+                          std::max(glm::length(glm::vec3(s.transform[1])), glm::length(glm::vec3(s.transform[2]))));
+    auto radius = scale * (s.type == sphere ? 1.0f : (s.type == torus ? 1.0f + s.ring_ratio : 0.7072f));
+    auto centre = glm::vec3(s.transform[3]);
+    auto outside = false;
+    for (auto &p : planes)
+      outside = outside || glm::dot(glm::vec3(p), centre) + p.w < -radius;
+    if (outside)
+      continue;
+    auto stacks = s.stacks, slices = s.slices;
+    if (slices == 0) {
+      // Enough slices around the shape's outline on screen for each edge to be about the set length
+      auto distance = glm::length(centre - eye) - radius;
+      auto outline = distance > 0.0f ? 2.0f * glm::pi<float>() * radius * pixels / distance
+                                     : std::numeric_limits<float>::max();
+      auto wanted = std::min(outline / _edge_pixels, static_cast<float>(_max_slices));
+      slices = std::min(std::max(round_up_power_of_two(static_cast<GLuint>(wanted)), _min_slices), _max_slices);
+      if (s.type == plane)
+        slices = 1;
+    }
+    if (stacks == 0) {
+      switch (s.type) {
+      case sphere:
+        stacks = std::max(slices / 2, 2u);
+        break;
+      case torus:
+        // The tube is smaller around than the ring
+        stacks = std::min(std::max(round_up_power_of_two(static_cast<GLuint>(slices * s.ring_ratio)), 4u), slices);
+        break;
+      default:
+        stacks = 1;
+      }
+    }
+    _visible.emplace_back(std::make_tuple(static_cast<int>(s.type), stacks, slices), i);
+  }
+  std::sort(_visible.begin(), _visible.end());
+
+  // Lay out the parameter blocks and the groups.  The normal matrix is worked out once per shape here rather than
+  // for every vertex
+  _instances.resize(_visible.size());
+  for (size_t i = 0; i < _visible.size(); ++i) {
+    auto &s = _shapes[_visible[i].second];
+    auto &key = _visible[i].first;
+    auto &block = _instances[i];
+    memcpy(block.transform, glm::value_ptr(s.transform), sizeof(block.transform));
+    block.parameters[0] = static_cast<float>(std::get<0>(key));
+    block.parameters[1] = static_cast<float>(std::get<1>(key));
+    block.parameters[2] = static_cast<float>(std::get<2>(key));
+    block.parameters[3] = s.ring_ratio;
+    auto normal = glm::transpose(glm::inverse(glm::mat3(s.transform)));
+    memcpy(block.normal, glm::value_ptr(normal), sizeof(block.normal));
+    if (i == 0 || key != _visible[i - 1].first)
+      _groups.push_back({s.type, get_vertex_count(s.type, std::get<1>(key), std::get<2>(key)), i, 0});
+    ++_groups.back().count;
+    _vertices_drawn += _groups.back().vertices;
+  }
+  _shapes_drawn = _instances.size();
+  if (_instances.empty())
+    return;
+
+  // Create the vertex array object on first use.  It has no vertex buffers, only the instance attributes
+  if (_vao == 0) {
+    glGenVertexArrays(1, &_vao);
+    glGenBuffers(1, &_buffer);
+    glBindVertexArray(_vao);
+    for (GLuint location = transform_location; location < normal_location + 3; ++location) {
+      glEnableVertexAttribArray(location);
+      glVertexAttribDivisor(location, 1);
+    }
+    glBindVertexArray(0);
+  }
+  // Grow the buffer by doubling, or orphan it so this frame's blocks do not wait on the last frame's draws
+  glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+  if (_instances.size() > _capacity) {
+    _capacity = std::max(_instances.size(), _capacity * 2);
+    gpu_memory::track_buffer(_buffer, _capacity * sizeof(instance), gpu_memory::vertex_buffer, "procedural shapes");
+  }
+  glBufferData(GL_ARRAY_BUFFER, _capacity * sizeof(instance), nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, _instances.size() * sizeof(instance), _instances.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "updating procedural shapes: Could not upload the shape parameters";
+    throw std::runtime_error("Error updating procedural shapes");
+  }
+}
+
+// Draws the shapes kept at the last update
+void procedural_shapes::draw() const {
+  if (_groups.empty())
+    return;
+  // Captures only describe per vertex float buffers, not instance attributes
+  if (gl_capture::is_recording())
+    gl_capture::record_unsupported("procedural shapes");
+  glBindVertexArray(_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+  for (auto &g : _groups) {
+    // Point the instance attributes at the group's first block, as a base instance needs OpenGL 4.2
+    auto base = g.first * sizeof(instance);
+    for (GLuint c = 0; c < 4; ++c)
+      glVertexAttribPointer(transform_location + c, 4, GL_FLOAT, GL_FALSE, sizeof(instance),
+                            reinterpret_cast<const void *>(base + c * 4 * sizeof(float)));
+    glVertexAttribPointer(parameters_location, 4, GL_FLOAT, GL_FALSE, sizeof(instance),
+                          reinterpret_cast<const void *>(base + offsetof(instance, parameters)));
+    for (GLuint c = 0; c < 3; ++c)
+      glVertexAttribPointer(normal_location + c, 3, GL_FLOAT, GL_FALSE, sizeof(instance),
+                            reinterpret_cast<const void *>(base + offsetof(instance, normal) + c * 3 * sizeof(float)));
+    glDrawArraysInstanced(GL_TRIANGLES, 0, g.vertices, g.count);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rendering procedural shapes: Could not draw shapes";
+    throw std::runtime_error("Error rendering procedural shapes");
+  }
+}
+
+// Deletes the buffers
+void procedural_shapes::release() {
+  if (_buffer != 0) {
+    glDeleteBuffers(1, &_buffer);
+    gpu_memory::release_buffer(_buffer);
+  }
+  if (_vao != 0)
+    glDeleteVertexArrays(1, &_vao);
+  _buffer = 0;
+  _vao = 0;
+  _capacity = 0;
+  _groups.clear();
+  _instances.clear();
+}
+}
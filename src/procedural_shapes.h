@@ -0,0 +1,142 @@
+#pragma once
+
+#include "camera.h"
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Spheres, tori, cylinders and planes generated in the vertex shader, with no
+vertex buffers.  Each shape is a small parameter block of its transform, its
+normal matrix, its kind and its tessellation, and shaders/procedural.vert
+works out every vertex from gl_VertexID and the block of gl_InstanceID, so
+thousands of differently tessellated shapes cost no per-shape vertex memory.
+Shapes left at 0 stacks and slices adapt their tessellation each update to
+their size on screen, in powers of two, and shapes outside the view are
+culled.  Shapes of one kind and tessellation are drawn with one instanced
+draw.  The shapes match those of geometry_builder at their default dimensions
+*/
+class procedural_shapes {
+public:
+  // The kinds of shape, as numbered in the vertex shader
+  enum kind { sphere, torus, cylinder, plane };
+
+  // One shape
+  struct shape {
+    // The transformation into world space
+    glm::mat4 transform;
+    // The kind of shape
+    kind type;
+    // The quads from top to bottom, or around a torus's tube.  0 to adapt to the size on screen
+    GLuint stacks;
+    // The quads around the shape's axis.  0 to adapt to the size on screen
+    GLuint slices;
+    // A torus's tube radius over its ring radius
+    float ring_ratio;
+  };
+
+private:
+  // Shapes of one kind and tessellation, drawn with one instanced draw
+  struct group {
+    // The kind of shape
+    kind type;
+    // The number of vertices of each shape
+    GLsizei vertices;
+    // The first instance of the group
+    size_t first;
+    // The number of instances
+    GLsizei count;
+  };
+
+  // A shape's parameter block as the vertex shader reads it
+  struct instance {
+    // The model matrix, column by column
+    float transform[16];
+    // The kind, stacks, slices and ring ratio
+    float parameters[4];
+    // The inverse transpose of the model matrix's upper 3x3, column by column, so normals stay perpendicular under
+    // uneven scaling
+    float normal[9];
+  };
+
+  // The shapes
+  std::vector<shape> _shapes;
+  // The groups drawn at the last update
+  std::vector<group> _groups;
+  // The visible shapes with their kind and tessellation, reused each update
+  std::vector<std::pair<std::tuple<int, GLuint, GLuint>, size_t>> _visible;
+  // The parameter blocks uploaded at the last update
+  std::vector<instance> _instances;
+  // The OpenGL ID of the vertex array object.  It holds only the instance attributes
+  GLuint _vao = 0;
+  // The OpenGL ID of the instance buffer
+  GLuint _buffer = 0;
+  // The instances the buffer holds
+  size_t _capacity = 0;
+  // The length of an edge, in pixels, adapted shapes are tessellated to
+  float _edge_pixels = 8.0f;
+  // The fewest slices of an adapted shape
+  GLuint _min_slices = 8;
+  // The most slices of an adapted shape
+  GLuint _max_slices = 256;
+  // The number of shapes drawn at the last update
+  size_t _shapes_drawn = 0;
+  // The number of vertices drawn at the last update
+  size_t _vertices_drawn = 0;
+  // Adds a shape
+  size_t add(const glm::mat4 &transform, kind type, GLuint stacks, GLuint slices, float ring_ratio);
+
+public:
+  // Creates an empty set of shapes
+  procedural_shapes() {}
+  // Default copy constructor and assignment operator.  Copies share the buffers
+  procedural_shapes(const procedural_shapes &other) = default;
+  procedural_shapes &operator=(const procedural_shapes &rhs) = default;
+  // Destroys the shapes.  The buffers are kept until release
+  ~procedural_shapes() {}
+  // Adds a sphere of radius 1.  Returns its index
+  size_t add_sphere(const glm::mat4 &transform, GLuint stacks = 0, GLuint slices = 0) {
+    return add(transform, sphere, stacks, slices, 0.0f);
+  }
+  // Adds a torus around the y axis.  Returns its index
+  size_t add_torus(const glm::mat4 &transform, float ring_radius = 1.0f, float outer_radius = 3.0f,
+                   GLuint stacks = 0, GLuint slices = 0) {
+    return add(transform * glm::scale(glm::mat4(1.0f), glm::vec3(outer_radius)), torus, stacks, slices,
+               ring_radius / outer_radius);
+  }
+  // Adds a cylinder of radius 0.5 and height 1 around the y axis.  Returns its index
+  size_t add_cylinder(const glm::mat4 &transform, GLuint stacks = 0, GLuint slices = 0) {
+    return add(transform, cylinder, stacks, slices, 0.0f);
+  }
+  // Adds a plane of size 1 facing up, split into the given number of quads each way.  Returns its index
+  size_t add_plane(const glm::mat4 &transform, GLuint subdivisions = 1) {
+    return add(transform, plane, std::max(subdivisions, 1u), std::max(subdivisions, 1u), 0.0f);
+  }
+  // Gets the shapes, to move or retessellate them
+  std::vector<shape> &get_shapes() { return _shapes; }
+  // Gets the shapes
+  const std::vector<shape> &get_shapes() const { return _shapes; }
+  // Removes every shape
+  void clear() { _shapes.clear(); }
+  // Culls the shapes against the camera, adapts their tessellation to the viewport height in pixels and uploads
+  // the parameter blocks.  Call once a frame before rendering
+  void update(const camera &cam, float viewport_height);
+  // Draws the shapes kept at the last update, with the bound effect
+  void draw() const;
+  // Deletes the buffers
+  void release();
+  // Gets the number of instanced draws at the last update
+  size_t get_draw_count() const { return _groups.size(); }
+  // Gets the number of shapes drawn at the last update
+  size_t get_shapes_drawn() const { return _shapes_drawn; }
+  // Gets the number of vertices drawn at the last update
+  size_t get_vertices_drawn() const { return _vertices_drawn; }
+  // Gets the length of an edge, in pixels, adapted shapes are tessellated to
+  float get_edge_pixels() const { return _edge_pixels; }
+  // Sets the length of an edge, in pixels, adapted shapes are tessellated to.  Smaller values tessellate more
+  void set_edge_pixels(float value) { _edge_pixels = std::max(value, 1.0f); }
+  // Sets the fewest and most slices of an adapted shape.  Rounded up to powers of two
+  void set_slice_range(GLuint minimum, GLuint maximum);
+  // Gets the number of vertices one shape is drawn with
+  static GLsizei get_vertex_count(kind type, GLuint stacks, GLuint slices);
+};
+}
@@ -1,9 +1,19 @@
 #include "stdafx.h"
 
+#include "asset_stream.h"
+#include "gl_capture.h"
+#include "pixel_upload.h"
 #include "renderer.h"
+#include "texture_manager.h"
 #include "util.h"
+#include "vertex_stream.h"
 //#include <IL/il.h>
 
+// Headless rendering without a display uses the null platform added in GLFW 3.4
+#if GLFW_VERSION_MAJOR < 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR < 4)
+#error "The framework needs GLFW 3.4 or later"
+#endif
+
 namespace graphics_framework {
 float renderer::_clear_r;
 float renderer::_clear_g;
@@ -13,10 +23,10 @@ renderer *renderer::_instance = nullptr;
 
 // Helper function to display OpenGL information
 void print_GL_info() {
-  std::clog << "GL Vendor: " << glGetString(GL_VENDOR) << std::endl;
-  std::clog << "GL Renderer: " << glGetString(GL_RENDERER) << std::endl;
-  std::clog << "GL Version: " << glGetString(GL_VERSION) << std::endl;
-  std::clog << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
+  LOG_INFO << "GL Vendor: " << glGetString(GL_VENDOR);
+  LOG_INFO << "GL Renderer: " << glGetString(GL_RENDERER);
+  LOG_INFO << "GL Version: " << glGetString(GL_VERSION);
+  LOG_INFO << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION);
 }
 
 // Builds any necessary content for the render framework
@@ -25,10 +35,20 @@ void build_content() {}
 void renderer::set_screen_dimensions(unsigned int w, unsigned int h) {
   _instance->_width = w;
   _instance->_height = h;
-  set_screen_mode(windowed);
+  set_screen_mode(_instance->_headless ? headless : windowed);
 }
 
 void renderer::set_screen_mode(ScreenMode sm) {
+  // A headless renderer has no window or monitor.  Resize the offscreen target instead
+  if (_instance->_headless || sm == headless) {
+    if (_instance->_headless && (_instance->_headless_target.get_width() != _instance->_width ||
+                                 _instance->_headless_target.get_height() != _instance->_height)) {
+      _instance->_headless_target = frame_buffer(_instance->_width, _instance->_height);
+      set_render_target();
+    }
+    glViewport(0, 0, _instance->_width, _instance->_height);
+    return;
+  }
   auto monitor = glfwGetPrimaryMonitor();
   auto mode = glfwGetVideoMode(monitor);
   glfwWindowHint(GLFW_RED_BITS, mode->redBits);
@@ -73,20 +93,38 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   renderer::_clear_b = 1.0f;
   // Set running to false
   _instance->_running = false;
+  _instance->_headless = (sm == headless);
 
   glewExperimental = GL_TRUE;
+#if !defined(_WIN32) && !defined(ENU_GFX_NULL_GL)
+  if (_instance->_headless && std::getenv("DISPLAY") == nullptr && std::getenv("WAYLAND_DISPLAY") == nullptr) {
+#if !defined(GLEW_OSMESA) && !defined(GLEW_EGL)
+    // GLEW loads through GLX, which needs a display
+    LOG_ERROR << "initialising renderer: No display.  Build with ENU_GFX_OSMESA or ENU_GFX_EGL to render without one";
+    return false;
+#endif
+    // With no display to connect to, use GLFW's null platform so a context can still be created
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
+#endif
   // Try and initialise GLFW
   if (!glfwInit()) {
     // Display error
-    std::cerr << "ERROR - initialisting renderer" << std::endl;
-    std::cerr << "Could not initialise GLFW" << std::endl;
+    LOG_ERROR << "initialisting renderer: Could not initialise GLFW";
     return false;
   }
 
-  // Get the primary monitor
-  auto monitor = glfwGetPrimaryMonitor();
+  // Get the primary monitor.  A headless renderer does not need one
+  auto monitor = _instance->_headless ? nullptr : glfwGetPrimaryMonitor();
   // Get its current video mode
-  auto video_mode = glfwGetVideoMode(monitor);
+  auto video_mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+  if (!_instance->_headless && video_mode == nullptr) {
+    // Display error
+    LOG_ERROR << "initialising renderer: Could not find a monitor.  Use renderer::headless to run without a display";
+    // Terminate GLFW
+    glfwTerminate();
+    return false;
+  }
 
   // Set window hints for GLFW
 
@@ -100,17 +138,32 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-  glfwWindowHint(GLFW_RED_BITS, video_mode->redBits);
-  glfwWindowHint(GLFW_GREEN_BITS, video_mode->greenBits);
-  glfwWindowHint(GLFW_BLUE_BITS, video_mode->blueBits);
-  glfwWindowHint(GLFW_REFRESH_RATE, video_mode->refreshRate);
+  // GLEW can only load entry points from a context created through the API it was built for
+#if defined(GLEW_OSMESA)
+  glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#elif defined(GLEW_EGL)
+  glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#endif
+  if (video_mode) {
+    glfwWindowHint(GLFW_RED_BITS, video_mode->redBits);
+    glfwWindowHint(GLFW_GREEN_BITS, video_mode->greenBits);
+    glfwWindowHint(GLFW_BLUE_BITS, video_mode->blueBits);
+    glfwWindowHint(GLFW_REFRESH_RATE, video_mode->refreshRate);
+  }
 
 // If in debug mode, set window dimensions to 800 x 600
 #if defined(DEBUG) | defined(_DEBUG)
   glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #endif
 
-  if (sm == windowed) {
+  if (sm == headless) {
+    // Hidden window used only to own the context.  Rendering goes to a frame buffer
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_SAMPLES, 0);
+    _instance->_window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+    _instance->_width = width;
+    _instance->_height = height;
+  } else if (sm == windowed) {
     glfwWindowHint(GLFW_DECORATED, GL_TRUE);
     _instance->_window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
     glfwSetWindowPos(_instance->_window, video_mode->width / 2 - (width / 2), video_mode->height / 2 - (height / 2));
@@ -133,8 +186,7 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check if window was created
   if (_instance->_window == nullptr) {
     // Display error
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Could not create window with GLFW" << std::endl;
+    LOG_ERROR << "initialising renderer: Could not create window with GLFW";
     // Terminate GLFW
     glfwTerminate();
     return false;
@@ -143,18 +195,17 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Make the window's context current
   glfwMakeContextCurrent(_instance->_window);
 
-  // Set swap interval - make the window refresh with the monitor
-  glfwSwapInterval(1);
+  // Set swap interval - make the window refresh with the monitor.  Headless renders as fast as possible
+  glfwSwapInterval(_instance->_headless ? 0 : 1);
 
   // Print OpenGL info
   print_GL_info();
 
-  // Initialise GLEW
+  // Initialise GLEW.  Entry points load through GLX, EGL or OSMesa, whichever GLEW was built for
   auto status = glewInit();
   if (status != GLEW_OK) {
     // Display error
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error initialising GLEW: " << glewGetErrorString(status) << std::endl;
+    LOG_ERROR << "initialising renderer: Error initialising GLEW: " << glewGetErrorString(status);
     // Terminate GLFW
     glfwTerminate();
     return false;
@@ -165,6 +216,13 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
 #if defined(DEBUG) | defined(_DEBUG)
   SET_DEBUG;
 #endif
+  // Set up OpenGL error checking for the selected mode
+  gl_debug::initialise();
+
+  // Stage texture uploads through a persistently mapped buffer where supported
+  pixel_upload::initialise();
+  // Ring buffer for streaming geometry
+  vertex_stream::initialise();
 
   // Set clear colour to cyan
   glClearColor(_clear_r, _clear_g, _clear_b, 1.0f);
@@ -172,8 +230,7 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check for any errors
   if (CHECK_GL_ERROR) {
     // Display error - not fatal
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error enabling clients states textures" << std::endl;
+    LOG_ERROR << "initialising renderer: Error enabling clients states textures";
   }
 
   // Enable blending
@@ -183,8 +240,7 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check for any errors
   if (CHECK_GL_ERROR) {
     // Display error - not fatal
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error enabling blending" << std::endl;
+    LOG_ERROR << "initialising renderer: Error enabling blending";
   }
 
   // Enable depth testing
@@ -193,8 +249,7 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check for any errors
   if (CHECK_GL_ERROR) {
     // Display error - not fatal
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error enabling depth testing" << std::endl;
+    LOG_ERROR << "initialising renderer: Error enabling depth testing";
   }
 
   // Enable back face culling
@@ -204,8 +259,7 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check for any errors
   if (CHECK_GL_ERROR) {
     // Display error - not fatal
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error enabling back face culling" << std::endl;
+    LOG_ERROR << "initialising renderer: Error enabling back face culling";
   }
 
   // Enable smoothing
@@ -217,8 +271,7 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check for any errors
   if (CHECK_GL_ERROR) {
     // Display error - not fatal
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error enabling smoothing / multi-sampling" << std::endl;
+    LOG_ERROR << "initialising renderer: Error enabling smoothing / multi-sampling";
   }
 
   // Enable offsetting - avoids depth conflicts
@@ -230,8 +283,7 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check for any errors
   if (CHECK_GL_ERROR) {
     // Display error - not fatal
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error enabling polygon offsetting" << std::endl;
+    LOG_ERROR << "initialising renderer: Error enabling polygon offsetting";
   }
 
   // Enable seamless cube maps
@@ -240,8 +292,7 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check for any errors
   if (CHECK_GL_ERROR) {
     // Display error - not fatal
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error enabling seamless cube maps" << std::endl;
+    LOG_ERROR << "initialising renderer: Error enabling seamless cube maps";
   }
 
   // Enable point size manipulation in effects
@@ -250,21 +301,33 @@ bool renderer::initialise(const std::string &title, renderer::ScreenMode sm, uns
   // Check for any errors
   if (CHECK_GL_ERROR) {
     // Display error - not fatal
-    std::cerr << "ERROR - initialising renderer" << std::endl;
-    std::cerr << "Error enabling point sizes in shaders" << std::endl;
+    LOG_ERROR << "initialising renderer: Error enabling point sizes in shaders";
+  }
+
+  // When headless, create the frame buffer that stands in for the screen
+  if (_instance->_headless) {
+    try {
+      _instance->_headless_target = frame_buffer(_instance->_width, _instance->_height);
+      glBindFramebuffer(GL_FRAMEBUFFER, _instance->_headless_target.get_buffer());
+      glViewport(0, 0, _instance->_width, _instance->_height);
+    } catch (std::exception &e) {
+      LOG_ERROR << "initialising renderer: Could not create headless render target: " << e.what();
+      glfwTerminate();
+      return false;
+    }
   }
 
   // Set running to true
   _instance->_running = true;
 
   // Log
-  std::clog << "LOG - renderer initialised" << std::endl;
+  LOG_INFO << "renderer initialised";
 
   // Create reusable content
   build_content();
 
   // Log
-  std::clog << "LOG - common content built" << std::endl;
+  LOG_INFO << "common content built";
 
   // Return true
   return true;
@@ -275,11 +338,19 @@ bool renderer::begin_render() {
   // If not running return false
   if (!_instance->_running) {
     // Display error
-    std::cerr << "ERROR - beginning render" << std::endl;
-    std::cerr << "Renderer is not running" << std::endl;
+    LOG_ERROR << "beginning render: Renderer is not running";
     return false;
   }
 
+  // Upload streamed assets within the frame budget
+  asset_stream::update();
+
+  // Catch errors from OpenGL calls made between frames
+  gl_debug::check_pass("work between frames");
+
+  // Start recording the frame if a capture has been requested
+  gl_capture::record_begin_frame();
+
   // Clear the screen
   clear();
 
@@ -295,11 +366,24 @@ void renderer::end_render() {
     return;
   }
 
+  // Catch errors from the final pass before presenting
+  gl_debug::check_pass("frame");
+
+  // Keep managed textures within their memory budget
+  texture_manager::enforce_budget();
+
+  // Fence this frame's streamed vertices
+  vertex_stream::end_frame();
+
   // Swap the buffers
   swap_buffers();
 
   // Poll events
   glfwPollEvents();
+
+  // Frame complete
+  gl_capture::record_end_frame();
+  ++_instance->_frame_count;
 }
 
 // Clears the screen and associated buffers
@@ -307,13 +391,14 @@ void renderer::clear() {
   // Check that we are running
   if (!_instance->_running) {
     // Display error
-    std::cerr << "ERROR - clearing screen" << std::endl;
-    std::cerr << "Renderer is not running" << std::endl;
+    LOG_ERROR << "clearing screen: Renderer is not running";
     return;
   }
 
   // Clear the buffers
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  if (gl_capture::is_recording())
+    gl_capture::record_clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 }
 
 // Swaps the front and back buffers
@@ -322,6 +407,10 @@ void renderer::swap_buffers() {
   if (!_instance->_running)
     return;
 
+  // Nothing is presented when headless
+  if (_instance->_headless)
+    return;
+
   // Swap the buffers via GLFW
   glfwSwapBuffers(_instance->_window);
 }
@@ -331,53 +420,67 @@ void renderer::toggle_vsync(const bool toggle) { glfwSwapInterval((int)toggle);
 // Shuts down the renderer
 void renderer::shutdown() {
   // Log
-  std::clog << "LOG - shutdown called on renderer" << std::endl;
+  LOG_INFO << "shutdown called on renderer";
+  // Stop streaming before the context goes
+  asset_stream::shutdown();
+  pixel_upload::shutdown();
+  vertex_stream::shutdown();
+  geometry_pool::shutdown();
+  meshlet_geometry::shutdown();
   // Set running to false
   _instance->_running = false;
   // Terminated GLFW
   glfwTerminate();
   // Log
-  std::clog << "LOG - renderer shutdown" << std::endl;
+  LOG_INFO << "renderer shutdown";
+}
+
+// Forgets the cached uniform locations of a program
+void renderer::clear_uniform_cache(GLuint program) {
+  // Effects may be built before the renderer starts
+  if (_instance != nullptr)
+    _instance->_uniform_cache.erase(program);
 }
 
 // Binds an effect to the renderer
-void renderer::bind(const effect &eff) throw(...) {
+void renderer::bind(const effect &eff) {
   // Check that program is valid
   assert(eff.get_program() != 0);
-  // Set effect
+  // Set effect.  Copied, so a temporary can be bound.  The shader list's storage is reused, so rebinding does not
+  // allocate
   _instance->_effect = eff;
   // Use the program
   glUseProgram(eff.get_program());
   // Check for any errors
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding effect to renderer" << std::endl;
-    std::cerr << "OpenGL could not use the program" << std::endl;
+    LOG_ERROR << "binding effect to renderer: OpenGL could not use the program";
     // Throw exception
     throw std::runtime_error("Error using effect with OpenGL");
   }
 }
 
 // Binds a texture to the renderer at the given index
-void renderer::bind(const texture &tex, int index) throw(...) {
+void renderer::bind(const texture &tex, int index) {
   // Check texture is valid
   assert(tex.get_id() != 0);
   // Check that index is valid
   assert(index >= 0);
+  // Record the use with the texture manager.  Reduced textures are reloaded here
+  texture_manager::touch(tex);
   // Set active texture
   glActiveTexture(GL_TEXTURE0 + index);
   // Bind texture
   glBindTexture(tex.get_type(), tex.get_id());
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding texture to renderer" << std::endl;
-    std::cerr << "OpenGL could not bind the texture" << std::endl;
+    LOG_ERROR << "binding texture to renderer: OpenGL could not bind the texture";
     // Throw exception
     throw std::runtime_error("Error using texture with OpenGL");
   }
 }
 
 // Binds a cubemap to the renderer at the given index
-void renderer::bind(const cubemap &tex, int index) throw(...) {
+void renderer::bind(const cubemap &tex, int index) {
   // Check texture is valid
   assert(tex.get_id() != 0);
   // Check that index is valid
@@ -388,223 +491,183 @@ void renderer::bind(const cubemap &tex, int index) throw(...) {
   glBindTexture(GL_TEXTURE_CUBE_MAP, tex.get_id());
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding cubemap to renderer" << std::endl;
-    std::cerr << "OpenGL could not bind the texture" << std::endl;
+    LOG_ERROR << "binding cubemap to renderer: OpenGL could not bind the texture";
     // Throw exception
     throw std::runtime_error("Error using cubemap with OpenGL");
   }
 }
 
+// Member names of the material struct
+static const char *const material_members[] = {"emissive", "diffuse_reflection", "specular_reflection", "shininess"};
+// Member names of the directional light struct
+static const char *const directional_members[] = {"ambient_intensity", "light_colour", "light_dir"};
+// Member names of the point light struct
+static const char *const point_members[] = {"light_colour", "position", "constant", "linear", "quadratic"};
+// Member names of the spot light struct
+static const char *const spot_members[] = {"light_colour", "position", "direction", "constant",
+                                           "linear",       "quadratic", "power"};
+
+// Gets the cached member locations of a struct uniform, querying any not yet seen
+const renderer::member_locations *renderer::get_member_locations(const std::string &name, const char *const *members,
+                                                                 size_t member_count, size_t elements, bool array) {
+  assert(member_count <= std::tuple_size<member_locations>::value);
+  auto &program = _instance->_uniform_cache[_instance->_effect.get_program()];
+  // Find the name without building a new string
+  auto found = program.find(name);
+  if (found == program.end())
+    found = program.emplace(name, uniform_forms()).first;
+  auto &locations = found->second[std::make_pair(array, elements)];
+  // Query the elements the first time this form is seen
+  for (auto n = locations.size(); n < elements; ++n) {
+    auto prefix = array ? name + "[" + std::to_string(n) + "]." : name + ".";
+    member_locations loc;
+    loc.fill(-1);
+    for (size_t m = 0; m < member_count; ++m)
+      loc[m] = _instance->_effect.get_uniform_location(prefix + members[m]);
+    locations.push_back(loc);
+  }
+  return locations.data();
+}
+
 // Binds a material to the currently bound effect
-void renderer::bind(const material &mat, const std::string &name) throw(...) {
+void renderer::bind(const material &mat, const std::string &name) {
+  auto &idx = *get_member_locations(name, material_members, 4, 1, false);
   // Check for emissive
-  auto idx = _instance->_effect.get_uniform_location(name + ".emissive");
-  if (idx != -1)
-    glUniform4fv(idx, 1, glm::value_ptr(mat.get_emissive()));
+  if (idx[0] != -1)
+    glUniform4fv(idx[0], 1, glm::value_ptr(mat.get_emissive()));
   // Check for diffuse reflection
-  idx = _instance->_effect.get_uniform_location(name + ".diffuse_reflection");
-  if (idx != -1)
-    glUniform4fv(idx, 1, glm::value_ptr(mat.get_diffuse()));
+  if (idx[1] != -1)
+    glUniform4fv(idx[1], 1, glm::value_ptr(mat.get_diffuse()));
   // Check for specular reflection
-  idx = _instance->_effect.get_uniform_location(name + ".specular_reflection");
-  if (idx != -1)
-    glUniform4fv(idx, 1, glm::value_ptr(mat.get_specular()));
+  if (idx[2] != -1)
+    glUniform4fv(idx[2], 1, glm::value_ptr(mat.get_specular()));
   // Check for shininess
-  idx = _instance->_effect.get_uniform_location(name + ".shininess");
-  if (idx != -1)
-    glUniform1f(idx, mat.get_shininess());
+  if (idx[3] != -1)
+    glUniform1f(idx[3], mat.get_shininess());
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding material to renderer" << std::endl;
-    std::cerr << "OpenGL could not set the uniforms" << std::endl;
+    LOG_ERROR << "binding material to renderer: OpenGL could not set the uniforms";
     // Throw exception
     throw std::runtime_error("Error using material with renderer");
   }
 }
 
 // Binds a directional light to the currently bound effect
-void renderer::bind(const directional_light &light, const std::string &name) throw(...) {
+void renderer::bind(const directional_light &light, const std::string &name) {
+  auto &idx = *get_member_locations(name, directional_members, 3, 1, false);
   // Check for ambient intensity
-  auto idx = _instance->_effect.get_uniform_location(name + ".ambient_intensity");
-  if (idx != -1)
-    glUniform4fv(idx, 1, glm::value_ptr(light.get_ambient_intensity()));
+  if (idx[0] != -1)
+    glUniform4fv(idx[0], 1, glm::value_ptr(light.get_ambient_intensity()));
   // Check for light colour
-  idx = _instance->_effect.get_uniform_location(name + ".light_colour");
-  if (idx != -1)
-    glUniform4fv(idx, 1, glm::value_ptr(light.get_light_colour()));
+  if (idx[1] != -1)
+    glUniform4fv(idx[1], 1, glm::value_ptr(light.get_light_colour()));
   // Check for light direction
-  idx = _instance->_effect.get_uniform_location(name + ".light_dir");
-  if (idx != -1)
-    glUniform3fv(idx, 1, glm::value_ptr(light.get_direction()));
+  if (idx[2] != -1)
+    glUniform3fv(idx[2], 1, glm::value_ptr(light.get_direction()));
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding directional light to renderer" << std::endl;
-    std::cerr << "OpenGL could not set the uniforms" << std::endl;
+    LOG_ERROR << "binding directional light to renderer: OpenGL could not set the uniforms";
     // Throw exception
     throw std::runtime_error("Error using directional light with renderer");
   }
 }
 
-// Binds a point light to the currently bound effect
-void renderer::bind(const point_light &point, const std::string &name) throw(...) {
+// Sets the uniforms of a point light from its member locations
+static void set_point_light(const point_light &point, const std::array<GLint, 7> &idx) {
   // Check for light colour
-  auto idx = _instance->_effect.get_uniform_location(name + ".light_colour");
-  if (idx != -1)
-    glUniform4fv(idx, 1, glm::value_ptr(point.get_light_colour()));
+  if (idx[0] != -1)
+    glUniform4fv(idx[0], 1, glm::value_ptr(point.get_light_colour()));
   // Check for position
-  idx = _instance->_effect.get_uniform_location(name + ".position");
-  if (idx != -1)
-    glUniform3fv(idx, 1, glm::value_ptr(point.get_position()));
+  if (idx[1] != -1)
+    glUniform3fv(idx[1], 1, glm::value_ptr(point.get_position()));
   // Check for constant
-  idx = _instance->_effect.get_uniform_location(name + ".constant");
-  if (idx != -1)
-    glUniform1f(idx, point.get_constant_attenuation());
+  if (idx[2] != -1)
+    glUniform1f(idx[2], point.get_constant_attenuation());
   // Check for linear
-  idx = _instance->_effect.get_uniform_location(name + ".linear");
-  if (idx != -1)
-    glUniform1f(idx, point.get_linear_attenuation());
+  if (idx[3] != -1)
+    glUniform1f(idx[3], point.get_linear_attenuation());
   // Check for quadratic
-  idx = _instance->_effect.get_uniform_location(name + ".quadratic");
-  if (idx != -1)
-    glUniform1f(idx, point.get_quadratic_attenuation());
+  if (idx[4] != -1)
+    glUniform1f(idx[4], point.get_quadratic_attenuation());
+}
+
+// Binds a point light to the currently bound effect
+void renderer::bind(const point_light &point, const std::string &name) {
+  set_point_light(point, *get_member_locations(name, point_members, 5, 1, false));
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding point light to renderer" << std::endl;
-    std::cerr << "OpenGL could not set the uniforms" << std::endl;
+    LOG_ERROR << "binding point light to renderer: OpenGL could not set the uniforms";
     // Throw exception
     throw std::runtime_error("Error using point light with renderer");
   }
 }
 
 // Binds a vector of point lights to the currently bound effect
-void renderer::bind(const std::vector<point_light> &points, const std::string &name) throw(...) {
+void renderer::bind(const std::vector<point_light> &points, const std::string &name) {
   // Iterate through each light, setting values as required
-  unsigned int n = 0;
-  for (auto &p : points) {
-    std::stringstream stream;
-    stream << name << "[" << n << "]";
-    auto point_name = stream.str();
-    // Check for light colour
-    auto idx = _instance->_effect.get_uniform_location(point_name + ".light_colour");
-    if (idx != -1)
-      glUniform4fv(idx, 1, glm::value_ptr(p.get_light_colour()));
-    // Check for position
-    idx = _instance->_effect.get_uniform_location(point_name + ".position");
-    if (idx != -1)
-      glUniform3fv(idx, 1, glm::value_ptr(p.get_position()));
-    // Check for constant
-    idx = _instance->_effect.get_uniform_location(point_name + ".constant");
-    if (idx != -1)
-      glUniform1f(idx, p.get_constant_attenuation());
-    // Check for linear
-    idx = _instance->_effect.get_uniform_location(point_name + ".linear");
-    if (idx != -1)
-      glUniform1f(idx, p.get_linear_attenuation());
-    // Check for quadratic
-    idx = _instance->_effect.get_uniform_location(point_name + ".quadratic");
-    if (idx != -1)
-      glUniform1f(idx, p.get_quadratic_attenuation());
-    // Increment light number
-    ++n;
-  }
+  auto idx = get_member_locations(name, point_members, 5, points.size(), true);
+  for (size_t n = 0; n < points.size(); ++n)
+    set_point_light(points[n], idx[n]);
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding vector of point lights to renderer" << std::endl;
-    std::cerr << "OpenGL could not set the uniforms" << std::endl;
+    LOG_ERROR << "binding vector of point lights to renderer: OpenGL could not set the uniforms";
     // Throw exception
     throw std::runtime_error("Error using point light with renderer");
   }
 }
 
-// Binds a spot light to the currently bound effect
-void renderer::bind(const spot_light &spot, const std::string &name) throw(...) {
+// Sets the uniforms of a spot light from its member locations
+static void set_spot_light(const spot_light &spot, const std::array<GLint, 7> &idx) {
   // Check for light colour
-  auto idx = _instance->_effect.get_uniform_location(name + ".light_colour");
-  if (idx != -1)
-    glUniform4fv(idx, 1, glm::value_ptr(spot.get_light_colour()));
+  if (idx[0] != -1)
+    glUniform4fv(idx[0], 1, glm::value_ptr(spot.get_light_colour()));
   // Check for position
-  idx = _instance->_effect.get_uniform_location(name + ".position");
-  if (idx != -1)
-    glUniform3fv(idx, 1, glm::value_ptr(spot.get_position()));
+  if (idx[1] != -1)
+    glUniform3fv(idx[1], 1, glm::value_ptr(spot.get_position()));
   // Check for direction
-  idx = _instance->_effect.get_uniform_location(name + ".direction");
-  if (idx != -1)
-    glUniform3fv(idx, 1, glm::value_ptr(spot.get_direction()));
+  if (idx[2] != -1)
+    glUniform3fv(idx[2], 1, glm::value_ptr(spot.get_direction()));
   // Check for constant
-  idx = _instance->_effect.get_uniform_location(name + ".constant");
-  if (idx != -1)
-    glUniform1f(idx, spot.get_constant_attenuation());
+  if (idx[3] != -1)
+    glUniform1f(idx[3], spot.get_constant_attenuation());
   // Check for linear
-  idx = _instance->_effect.get_uniform_location(name + ".linear");
-  if (idx != -1)
-    glUniform1f(idx, spot.get_linear_attenuation());
+  if (idx[4] != -1)
+    glUniform1f(idx[4], spot.get_linear_attenuation());
   // Check for quadratic
-  idx = _instance->_effect.get_uniform_location(name + ".quadratic");
-  if (idx != -1)
-    glUniform1f(idx, spot.get_quadratic_attenuation());
+  if (idx[5] != -1)
+    glUniform1f(idx[5], spot.get_quadratic_attenuation());
   // Check for power
-  idx = _instance->_effect.get_uniform_location(name + ".power");
-  if (idx != -1)
-    glUniform1f(idx, spot.get_power());
+  if (idx[6] != -1)
+    glUniform1f(idx[6], spot.get_power());
+}
+
+// Binds a spot light to the currently bound effect
+void renderer::bind(const spot_light &spot, const std::string &name) {
+  set_spot_light(spot, *get_member_locations(name, spot_members, 7, 1, false));
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding spot light to renderer" << std::endl;
-    std::cerr << "OpenGL could not set the uniforms" << std::endl;
+    LOG_ERROR << "binding spot light to renderer: OpenGL could not set the uniforms";
     // Throw exception
     throw std::runtime_error("Error using spot light with renderer");
   }
 }
 
 // Binds a vector of spot lights to the renderer
-void renderer::bind(const std::vector<spot_light> &spots, const std::string &name) throw(...) {
+void renderer::bind(const std::vector<spot_light> &spots, const std::string &name) {
   // Iterate through each light, setting values as required
-  unsigned int n = 0;
-  for (auto &s : spots) {
-    std::stringstream stream;
-    stream << name << "[" << n << "]";
-    auto spot_name = stream.str();
-    // Check for light colour
-    auto idx = _instance->_effect.get_uniform_location(spot_name + ".light_colour");
-    if (idx != -1)
-      glUniform4fv(idx, 1, glm::value_ptr(s.get_light_colour()));
-    // Check for position
-    idx = _instance->_effect.get_uniform_location(spot_name + ".position");
-    if (idx != -1)
-      glUniform3fv(idx, 1, glm::value_ptr(s.get_position()));
-    // Check for direction
-    idx = _instance->_effect.get_uniform_location(spot_name + ".direction");
-    if (idx != -1)
-      glUniform3fv(idx, 1, glm::value_ptr(s.get_direction()));
-    // Check for constant
-    idx = _instance->_effect.get_uniform_location(spot_name + ".constant");
-    if (idx != -1)
-      glUniform1f(idx, s.get_constant_attenuation());
-    // Check for linear
-    idx = _instance->_effect.get_uniform_location(spot_name + ".linear");
-    if (idx != -1)
-      glUniform1f(idx, s.get_linear_attenuation());
-    // Check for quadratic
-    idx = _instance->_effect.get_uniform_location(spot_name + ".quadratic");
-    if (idx != -1)
-      glUniform1f(idx, s.get_quadratic_attenuation());
-    // Check for power
-    idx = _instance->_effect.get_uniform_location(spot_name + ".power");
-    if (idx != -1)
-      glUniform1f(idx, s.get_power());
-    // Increment light number
-    ++n;
-  }
+  auto idx = get_member_locations(name, spot_members, 7, spots.size(), true);
+  for (size_t n = 0; n < spots.size(); ++n)
+    set_spot_light(spots[n], idx[n]);
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - binding vector of spot lights to renderer" << std::endl;
-    std::cerr << "OpenGL could not set the uniforms" << std::endl;
+    LOG_ERROR << "binding vector of spot lights to renderer: OpenGL could not set the uniforms";
     // Throw exception
     throw std::runtime_error("Error using spot light with renderer");
   }
 }
 
 // Renders a piece of geometry
-void renderer::render(const geometry &geom) throw(...) {
+void renderer::render(const geometry &geom) {
   assert(geom.get_array_object() != 0);
   // Check renderer is running
   assert(_instance->_running);
@@ -613,19 +676,20 @@ void renderer::render(const geometry &geom) throw(...) {
   // Check for any OpenGL errors
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - rendering geometry" << std::endl;
-    std::cerr << "Could not bind vertex array object" << std::endl;
+    LOG_ERROR << "rendering geometry: Could not bind vertex array object";
     // Throw exception
     throw std::runtime_error("Error rendering geometry");
   }
+  // Record the draw if capturing
+  if (gl_capture::is_recording())
+    gl_capture::record_draw(geom);
   // If there is an index buffer then use to render
   if (geom.get_idx_buffer() != 0) {
     // Bind index buffer
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geom.get_idx_buffer());
     // Check for error
     if (CHECK_GL_ERROR) {
-      std::cerr << "ERROR - rendering geometry" << std::endl;
-      std::cerr << "Could not bind index buffer" << std::endl;
+      LOG_ERROR << "rendering geometry: Could not bind index buffer";
       // Throw exception
       throw std::runtime_error("Error rendering geometry");
     }
@@ -634,8 +698,7 @@ void renderer::render(const geometry &geom) throw(...) {
     // Check for error
     if (CHECK_GL_ERROR) {
       // Display error
-      std::cerr << "ERROR - rendering geometry" << std::endl;
-      std::cerr << "Could not draw elements from indices" << std::endl;
+      LOG_ERROR << "rendering geometry: Could not draw elements from indices";
       // Throw exception
       throw std::runtime_error("Error rendering geometry");
     }
@@ -644,8 +707,7 @@ void renderer::render(const geometry &geom) throw(...) {
     glDrawArrays(geom.get_type(), 0, geom.get_vertex_count());
     // Check for error
     if (CHECK_GL_ERROR) {
-      std::cerr << "ERROR - rendering geometry" << std::endl;
-      std::cerr << "Could not draw arrays" << std::endl;
+      LOG_ERROR << "rendering geometry: Could not draw arrays";
       // Throw exception
       throw std::runtime_error("Error rendering geometry");
     }
@@ -653,61 +715,228 @@ void renderer::render(const geometry &geom) throw(...) {
 }
 
 // Renders a piece of geometry
-void renderer::render(const mesh &m) throw(...) {
+void renderer::render(const mesh &m) {
   // Render geometry
   render(m.get_geometry());
 }
 
+// Renders a model with one multi-draw per material
+void renderer::render(const model &m, const std::string &material_name, int texture_unit) {
+  auto &geom = m.get_geometry();
+  assert(geom.get_array_object() != 0 && geom.get_idx_buffer() != 0);
+  // Check renderer is running
+  assert(_instance->_running);
+  // Every range shares the one vertex array object and index buffer
+  glBindVertexArray(geom.get_array_object());
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geom.get_idx_buffer());
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rendering model " << m.get_name() << ": Could not bind vertex array object";
+    // Throw exception
+    throw std::runtime_error("Error rendering model");
+  }
+  for (auto &group : m.get_draw_groups()) {
+    auto &slot = m.get_materials()[group.material];
+    if (!material_name.empty())
+      bind(slot.properties, material_name);
+    if (texture_unit >= 0 && slot.diffuse_texture >= 0)
+      bind(m.get_textures()[slot.diffuse_texture], texture_unit);
+    // Record each range as a draw if capturing
+    if (gl_capture::is_recording())
+      for (size_t i = 0; i < group.counts.size(); ++i)
+        gl_capture::record_draw(geom.get_array_object(), geom.get_buffers(), geom.get_idx_buffer(), geom.get_type(),
+                                static_cast<GLuint>(reinterpret_cast<size_t>(group.offsets[i]) / sizeof(GLuint)),
+                                static_cast<GLuint>(group.counts[i]));
+    glMultiDrawElements(geom.get_type(), group.counts.data(), GL_UNSIGNED_INT, group.offsets.data(),
+                        static_cast<GLsizei>(group.counts.size()));
+  }
+  // Check for error
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rendering model " << m.get_name() << ": Could not draw ranges";
+    // Throw exception
+    throw std::runtime_error("Error rendering model");
+  }
+}
+
+// Renders the chunks of a static batch
+void renderer::render(const static_batch &batch, const std::string &material_name,
+                      const std::function<bool(const glm::vec3 &, const glm::vec3 &)> &visible) {
+  // Chunks are sorted by material, so each material is bound once
+  auto bound = batch.get_materials().size();
+  for (auto &c : batch.get_chunks()) {
+    if (visible && !visible(c.minimal, c.maximal))
+      continue;
+    if (!material_name.empty() && c.material != bound) {
+      bind(batch.get_materials()[c.material], material_name);
+      bound = c.material;
+    }
+    render(c.geom);
+  }
+}
+
+// Renders meshlet geometry, culling meshlets against the frustum and eye
+void renderer::render(const meshlet_geometry &m, const glm::mat4 &model, const glm::mat4 &view_projection,
+                      const glm::vec3 &eye) {
+  auto &geom = m.get_geometry();
+  assert(geom.get_array_object() != 0 && geom.get_idx_buffer() != 0);
+  // Check renderer is running
+  assert(_instance->_running);
+  // The meshlet bounds are in mesh space, so the frustum and eye are taken there
+  auto mvp = view_projection * model;
+  auto local_eye = glm::vec3(glm::inverse(model) * glm::vec4(eye, 1.0f));
+  if (m.has_gpu_culling()) {
+    m.cull_on_gpu(mvp, local_eye);
+    glUseProgram(get_bound_effect().get_program());
+    glBindVertexArray(geom.get_array_object());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geom.get_idx_buffer());
+    // The commands stay on the GPU, so record the meshlets the same test keeps on the CPU if capturing
+    if (gl_capture::is_recording()) {
+      auto &visible = _instance->_meshlet_visible;
+      m.cull(mvp, local_eye, visible);
+      for (auto i : visible) {
+        auto &meshlet = m.get_meshlets()[i];
+        gl_capture::record_draw(geom.get_array_object(), geom.get_buffers(), geom.get_idx_buffer(), geom.get_type(),
+                                meshlet.first_index, meshlet.triangle_count * 3);
+      }
+    }
+    // One command per meshlet.  Culled meshlets have no instances
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m.get_command_buffer());
+    glMultiDrawElementsIndirect(geom.get_type(), GL_UNSIGNED_INT, nullptr,
+                                static_cast<GLsizei>(m.get_meshlets().size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  } else {
+    auto &visible = _instance->_meshlet_visible;
+    if (m.cull(mvp, local_eye, visible) == 0)
+      return;
+    auto &counts = _instance->_meshlet_counts;
+    auto &offsets = _instance->_meshlet_offsets;
+    counts.clear();
+    offsets.clear();
+    for (auto i : visible) {
+      auto &meshlet = m.get_meshlets()[i];
+      counts.push_back(static_cast<GLsizei>(meshlet.triangle_count * 3));
+      offsets.push_back(reinterpret_cast<const void *>(size_t(meshlet.first_index) * sizeof(GLuint)));
+    }
+    glBindVertexArray(geom.get_array_object());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geom.get_idx_buffer());
+    // Record each meshlet as a draw if capturing
+    if (gl_capture::is_recording())
+      for (auto i : visible) {
+        auto &meshlet = m.get_meshlets()[i];
+        gl_capture::record_draw(geom.get_array_object(), geom.get_buffers(), geom.get_idx_buffer(), geom.get_type(),
+                                meshlet.first_index, meshlet.triangle_count * 3);
+      }
+    glMultiDrawElements(geom.get_type(), counts.data(), GL_UNSIGNED_INT, offsets.data(),
+                        static_cast<GLsizei>(counts.size()));
+  }
+  // Check for error
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "rendering meshlet geometry " << m.get_name() << ": Could not draw meshlets";
+    // Throw exception
+    throw std::runtime_error("Error rendering meshlet geometry");
+  }
+}
+
+// Renders the chunks of paged geometry resident at its last update
+void renderer::render(const paged_geometry &g) {
+  // Check renderer is running
+  assert(_instance->_running);
+  g.draw();
+}
+
+// Renders the nodes of a point cloud chosen at its last update
+void renderer::render(const point_cloud &c) {
+  // Check renderer is running
+  assert(_instance->_running);
+  c.draw();
+}
+
+// Renders procedural shapes kept at their last update
+void renderer::render(const procedural_shapes &s) {
+  // Check renderer is running
+  assert(_instance->_running);
+  s.draw();
+}
+
+// Renders a piece of geometry from the geometry pool
+void renderer::render(const geometry_pool::handle &h) {
+  // Check renderer is running
+  assert(_instance->_running);
+  geometry_pool::draw(h);
+}
+
+// Renders many pieces of geometry from the geometry pool
+void renderer::render(const std::vector<geometry_pool::handle> &handles) {
+  // Check renderer is running
+  assert(_instance->_running);
+  geometry_pool::draw(handles);
+}
+
 // Sets the render target of the renderer to the screen
-void renderer::set_render_target() throw(...) {
-  // Set framebuffer to screen (0)
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void renderer::set_render_target() {
+  // The previous pass is complete
+  gl_debug::check_pass("render pass");
+  // Set framebuffer to screen (0), or the offscreen target when headless
+  glBindFramebuffer(GL_FRAMEBUFFER, _instance->_headless ? _instance->_headless_target.get_buffer() : 0);
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - setting render target" << std::endl;
-    std::cerr << "Could not set render target to screen!" << std::endl;
+    LOG_ERROR << "setting render target: Could not set render target to screen!";
     // Throw exception
     throw std::runtime_error("Error setting render target");
   }
+  // Record the change if capturing
+  if (gl_capture::is_recording())
+    gl_capture::record_target(_instance->_headless ? _instance->_headless_target.get_buffer() : 0);
 }
 
 // Sets the render target of the renderer to a shadow map
-void renderer::set_render_target(const shadow_map &shadow) throw(...) {
+void renderer::set_render_target(const shadow_map &shadow) {
+  // The previous pass is complete
+  gl_debug::check_pass("render pass");
   // Set framebuffer to shadow map's depth buffer
   glBindFramebuffer(GL_FRAMEBUFFER, shadow.buffer->get_buffer());
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - setting render target" << std::endl;
-    std::cerr << "Could not set render target to shadow map buffer" << std::endl;
+    LOG_ERROR << "setting render target: Could not set render target to shadow map buffer";
     // Throw exception
     throw std::runtime_error("Error setting render target");
   }
+  // Record the change if capturing
+  if (gl_capture::is_recording())
+    gl_capture::record_target(shadow.buffer->get_buffer());
 }
 
 // Sets the render target of the renderer to a depth buffer
-void renderer::set_render_target(const depth_buffer &depth) throw(...) {
+void renderer::set_render_target(const depth_buffer &depth) {
+  // The previous pass is complete
+  gl_debug::check_pass("render pass");
   // Set framebuffer to internal buffer
   glBindFramebuffer(GL_FRAMEBUFFER, depth.get_buffer());
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - setting render target" << std::endl;
-    std::cerr << "Could not set render target to depth buffer" << std::endl;
+    LOG_ERROR << "setting render target: Could not set render target to depth buffer";
     // Throw exception
     throw std::runtime_error("Error setting render target");
   }
+  // Record the change if capturing
+  if (gl_capture::is_recording())
+    gl_capture::record_target(depth.get_buffer());
 }
 
 // Sets the render target of the renderer to a depth buffer
-void renderer::set_render_target(const frame_buffer &frame) throw(...) {
+void renderer::set_render_target(const frame_buffer &frame) {
+  // The previous pass is complete
+  gl_debug::check_pass("render pass");
   // Set framebuffer
   glBindFramebuffer(GL_FRAMEBUFFER, frame.get_buffer());
   // Check for error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - setting render target" << std::endl;
-    std::cerr << "Could not set render target to frame buffer" << std::endl;
+    LOG_ERROR << "setting render target: Could not set render target to frame buffer";
     // Throw exception
     throw std::runtime_error("Error setting render target");
   }
+  // Record the change if capturing
+  if (gl_capture::is_recording())
+    gl_capture::record_target(frame.get_buffer());
 }
 
 void renderer::setClearColour(const float r, const float g, const float b) {
@@ -5,10 +5,17 @@
 #include "effect.h"
 #include "frame_buffer.h"
 #include "geometry.h"
+#include "geometry_pool.h"
 #include "mesh.h"
+#include "meshlet_geometry.h"
+#include "model.h"
+#include "paged_geometry.h"
+#include "point_cloud.h"
 #include "point_light.h"
+#include "procedural_shapes.h"
 #include "shadow_map.h"
 #include "spot_light.h"
+#include "static_batch.h"
 #include "stdafx.h"
 #include "texture.h"
 
@@ -32,8 +39,27 @@ private:
   unsigned int _width;
   // The height of the window used by the renderer
   unsigned int _height;
+  // The locations of the members of a struct uniform
+  typedef std::array<GLint, 7> member_locations;
+  // The member locations of each form a uniform name is bound as, keyed by whether it is an array and the number of
+  // elements.  One entry per element
+  typedef std::map<std::pair<bool, size_t>, std::vector<member_locations>> uniform_forms;
   // The currently bound effect to the renderer
   effect _effect;
+  // Struct uniform member locations, keyed by program then uniform name
+  std::unordered_map<GLuint, std::unordered_map<std::string, uniform_forms>> _uniform_cache;
+  // The number of frames rendered since initialisation
+  unsigned long long _frame_count = 0;
+  // Flag determining if the renderer is running without a visible window
+  bool _headless = false;
+  // The frame buffer used in place of the screen when headless
+  frame_buffer _headless_target;
+  // The meshlets kept by the last meshlet geometry culled, reused between draws
+  std::vector<GLuint> _meshlet_visible;
+  // The index counts of the last meshlet multi-draw
+  std::vector<GLsizei> _meshlet_counts;
+  // The index offsets of the last meshlet multi-draw
+  std::vector<const void *> _meshlet_offsets;
   // The singleton instance of the renderer
   static renderer *_instance;
   // Creates a renderer object.  Should not be called.  Singleton instance
@@ -44,9 +70,13 @@ private:
   float static _clear_r;
   float static _clear_g;
   float static _clear_b;
+  // Gets the member locations of a struct uniform in the bound effect, or of the first elements of a struct array.
+  // OpenGL is only queried the first time a name is seen as a single struct or as an array of that many elements
+  static const member_locations *get_member_locations(const std::string &name, const char *const *members,
+                                                      size_t member_count, size_t elements, bool array);
 
 public:
-  enum ScreenMode { windowed, borderless, fullscreen };
+  enum ScreenMode { windowed, borderless, fullscreen, headless };
 
   // Destroys the renderer object.  Calls shutdown
   ~renderer() { shutdown(); }
@@ -64,6 +94,12 @@ public:
   static double get_screen_aspect();
   // Gets the effect currently bound by the renderer
   static const effect &get_bound_effect() { return _instance->_effect; }
+  // Gets the number of frames rendered since initialisation
+  static unsigned long long get_frame_count() { return _instance->_frame_count; }
+  // Gets if the renderer is running headless, rendering to a frame buffer rather than a window
+  static bool is_headless() { return _instance->_headless; }
+  // Gets the frame buffer used in place of the screen when headless
+  static const frame_buffer &get_headless_target() { return _instance->_headless_target; }
   // Initialises the renderer
   static bool initialise(const std::string &title, renderer::ScreenMode sm = renderer::windowed,
                          unsigned int width = 1280, unsigned int height = 720);
@@ -81,36 +117,60 @@ public:
   static void toggle_vsync(const bool toggle);
   // Shuts down the renderer
   static void shutdown();
+  // Forgets the cached uniform locations of a program.  Called when an effect is built, as OpenGL may give a new
+  // program the ID of a deleted one
+  static void clear_uniform_cache(GLuint program);
   // Binds an effect with the renderer
-  static void bind(const effect &eff) throw(...);
+  static void bind(const effect &eff);
   // Binds a texture with the renderer
-  static void bind(const texture &tex, int index) throw(...);
+  static void bind(const texture &tex, int index);
   // Binds a cubemap with the renderer
-  static void bind(const cubemap &tex, int index) throw(...);
+  static void bind(const cubemap &tex, int index);
   // Binds a material with the renderer
-  static void bind(const material &mat, const std::string &name) throw(...);
+  static void bind(const material &mat, const std::string &name);
   // Binds a directional light with the renderer
-  static void bind(const directional_light &light, const std::string &name) throw(...);
+  static void bind(const directional_light &light, const std::string &name);
   // Binds a point light with the renderer
-  static void bind(const point_light &point, const std::string &name) throw(...);
+  static void bind(const point_light &point, const std::string &name);
   // Binds a vector of point lights to the renderer
-  static void bind(const std::vector<point_light> &points, const std::string &name) throw(...);
+  static void bind(const std::vector<point_light> &points, const std::string &name);
   // Binds a spot light with the renderer
-  static void bind(const spot_light &spot, const std::string &name) throw(...);
+  static void bind(const spot_light &spot, const std::string &name);
   // Binds a vector of spot lights to the renderer
-  static void bind(const std::vector<spot_light> &spots, const std::string &name) throw(...);
+  static void bind(const std::vector<spot_light> &spots, const std::string &name);
   // Renders a piece of geometry
-  static void render(const geometry &geom) throw(...);
+  static void render(const geometry &geom);
   // Renders a mesh object
-  static void render(const mesh &m) throw(...);
+  static void render(const mesh &m);
+  // Renders a model with one multi-draw per material.  Each material is bound to the named uniform, and its diffuse
+  // texture to the texture unit, unless the name is empty or the unit negative
+  static void render(const model &m, const std::string &material_name = "", int texture_unit = -1);
+  // Renders the chunks of a static batch, binding each material to the named uniform unless the name is empty.  Chunks
+  // whose world space bounds fail the visibility test are skipped
+  static void render(const static_batch &batch, const std::string &material_name = "",
+                     const std::function<bool(const glm::vec3 &, const glm::vec3 &)> &visible = nullptr);
+  // Renders meshlet geometry placed by the model matrix, skipping meshlets outside the view frustum or facing away
+  // from the eye.  Culled in a compute shader when supported, after which the bound effect is used again
+  static void render(const meshlet_geometry &m, const glm::mat4 &model, const glm::mat4 &view_projection,
+                     const glm::vec3 &eye);
+  // Renders the chunks of paged geometry resident at its last update
+  static void render(const paged_geometry &g);
+  // Renders the nodes of a point cloud chosen at its last update
+  static void render(const point_cloud &c);
+  // Renders procedural shapes kept at their last update, generated in the bound effect's vertex shader
+  static void render(const procedural_shapes &s);
+  // Renders a piece of geometry from the geometry pool
+  static void render(const geometry_pool::handle &h);
+  // Renders many pieces of geometry from the geometry pool with the current uniforms, batched into multi-draws
+  static void render(const std::vector<geometry_pool::handle> &handles);
   // Sets the render target of the renderer to the screen
-  static void set_render_target() throw(...);
+  static void set_render_target();
   // Sets the render target of the renderer to a shadow map
-  static void set_render_target(const shadow_map &shadow) throw(...);
+  static void set_render_target(const shadow_map &shadow);
   // Sets the render target of the renderer to a depth buffer
-  static void set_render_target(const depth_buffer &depth) throw(...);
+  static void set_render_target(const depth_buffer &depth);
   // Sets the render target of the renderer to a frame buffer
-  static void set_render_target(const frame_buffer &frame) throw(...);
+  static void set_render_target(const frame_buffer &frame);
 
   static void setClearColour(const float r, const float g, const float b);
 };
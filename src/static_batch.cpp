@@ -0,0 +1,183 @@
+#include "stdafx.h"
+
+#include "static_batch.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Checks if two materials have the same properties
+static bool same_material(const material &a, const material &b) {
+  return a.get_emissive() == b.get_emissive() && a.get_diffuse() == b.get_diffuse() &&
+         a.get_specular() == b.get_specular() && a.get_shininess() == b.get_shininess();
+}
+
+// Converts the vertices of a primitive type to a triangle list.  Degenerate triangles in strips are dropped
+static bool to_triangles(GLenum type, const std::vector<GLuint> &in, std::vector<GLuint> &out) {
+  switch (type) {
+  case GL_TRIANGLES:
+    out.insert(out.end(), in.begin(), in.begin() + in.size() / 3 * 3);
+    return true;
+  case GL_TRIANGLE_STRIP:
+    for (size_t i = 2; i < in.size(); ++i) {
+      // Every other triangle is wound the other way
+      auto a = in[i % 2 ? i - 1 : i - 2], b = in[i % 2 ? i - 2 : i - 1], c = in[i];
+      if (a != b && b != c && a != c)
+        out.insert(out.end(), {a, b, c});
+    }
+    return true;
+  case GL_TRIANGLE_FAN:
+    for (size_t i = 2; i < in.size(); ++i)
+      out.insert(out.end(), {in[0], in[i - 1], in[i]});
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Finds or adds a material
+size_t static_batch::add_material(const material &mat) {
+  for (size_t i = 0; i < _materials.size(); ++i)
+    if (same_material(_materials[i], mat))
+      return i;
+  _materials.push_back(mat);
+  return _materials.size() - 1;
+}
+
+// Adds mesh data with its world transform and material
+bool static_batch::add(const mesh_data &data, const glm::mat4 &world, const material &mat) {
+  // Every source becomes an indexed triangle list
+  std::vector<GLuint> source_indices, triangles;
+  if (data.get_index_count() > 0)
+    source_indices.assign(data.get_index_data(), data.get_index_data() + data.get_index_count());
+  else {
+    source_indices.resize(data.get_vertex_count());
+    std::iota(source_indices.begin(), source_indices.end(), 0);
+  }
+  if (!to_triangles(data.get_type(), source_indices, triangles)) {
+    LOG_WARNING << "static batch: " << data.get_name() << " has a primitive type that cannot be merged";
+    return false;
+  }
+  if (data.get_vertex_count() == 0 || triangles.empty())
+    return true;
+
+  // The world space bounds decide the cell
+  auto vertices = data.get_vertex_count();
+  std::vector<std::pair<GLuint, GLint>> format;
+  for (auto &s : data.get_streams())
+    format.emplace_back(s.first, s.second.components);
+  auto position = data.get_streams().find(POSITION_BUFFER);
+  if (position == data.get_streams().end() || position->second.components != 3) {
+    LOG_WARNING << "static batch: " << data.get_name() << " has no three component positions";
+    return false;
+  }
+  std::vector<glm::vec3> positions(vertices);
+  auto minimal = glm::vec3(std::numeric_limits<float>::max()), maximal = -minimal;
+  for (GLuint i = 0; i < vertices; ++i) {
+    auto p = position->second.get() + i * 3;
+    positions[i] = glm::vec3(world * glm::vec4(p[0], p[1], p[2], 1.0f));
+    minimal = glm::min(minimal, positions[i]);
+    maximal = glm::max(maximal, positions[i]);
+  }
+  auto cell = glm::floor((minimal + maximal) * 0.5f / _cell_size);
+  auto key = std::make_tuple(add_material(mat), format, static_cast<int>(cell.x), static_cast<int>(cell.y),
+                             static_cast<int>(cell.z));
+
+  // Start another chunk for the key if the current one would overflow
+  auto &chunks = _pending[key];
+  if (chunks.empty() || (chunks.back().vertices > 0 && chunks.back().vertices + vertices > _max_vertices))
+    chunks.emplace_back();
+  auto &target = chunks.back();
+
+  // Transform directions by the rotation and scale, and normals by the inverse transpose so non-uniform scales
+  // keep them perpendicular
+  auto directions = glm::mat3(world);
+  auto normals = glm::transpose(glm::inverse(directions));
+  for (auto &s : data.get_streams()) {
+    auto &out = target.streams[s.first];
+    auto components = s.second.components;
+    auto in = s.second.get();
+    if (s.first == POSITION_BUFFER) {
+      for (auto &p : positions)
+        out.insert(out.end(), {p.x, p.y, p.z});
+    } else if (components == 3 &&
+               (s.first == NORMAL_BUFFER || s.first == TANGENT_BUFFER || s.first == BINORMAL_BUFFER)) {
+      auto &m = s.first == NORMAL_BUFFER ? normals : directions;
+      for (GLuint i = 0; i < vertices; ++i) {
+        auto d = m * glm::vec3(in[i * 3], in[i * 3 + 1], in[i * 3 + 2]);
+        auto length = glm::length(d);
+        if (length > 0.0f)
+          d /= length;
+        out.insert(out.end(), {d.x, d.y, d.z});
+      }
+    } else
+      out.insert(out.end(), in, in + size_t(vertices) * components);
+  }
+  // A mirroring transform flips the winding, so swap two corners of each triangle to keep it front facing
+  if (glm::determinant(world) < 0.0f)
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3)
+      std::swap(triangles[t + 1], triangles[t + 2]);
+  for (auto i : triangles)
+    target.indices.push_back(target.vertices + i);
+  target.vertices += vertices;
+  target.minimal = glm::min(target.minimal, minimal);
+  target.maximal = glm::max(target.maximal, maximal);
+  ++target.sources;
+  return true;
+}
+
+// Adds a mesh, reading its geometry back from the GPU
+bool static_batch::add(const mesh &m) {
+  auto &geom = m.get_geometry();
+  if (geom.is_streaming() || geom.get_vertex_count() == 0) {
+    LOG_WARNING << "static batch: " << geom.get_debug_name() << " has no static buffers to merge";
+    return false;
+  }
+  mesh_data data;
+  data.set_type(geom.get_type());
+  data.set_name(geom.get_debug_name());
+  // Read through the copy target, so no vertex array object's index binding is disturbed
+  for (auto &b : geom.get_buffers()) {
+    auto components = geom.get_components().at(b.first);
+    std::vector<float> values(size_t(geom.get_vertex_count()) * components);
+    glBindBuffer(GL_COPY_READ_BUFFER, b.second);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, values.size() * sizeof(float), values.data());
+    data.add_buffer(b.first, values.data(), components, geom.get_vertex_count());
+  }
+  if (geom.get_idx_buffer() != 0) {
+    std::vector<GLuint> indices(geom.get_index_count());
+    glBindBuffer(GL_COPY_READ_BUFFER, geom.get_idx_buffer());
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+    data.add_index_buffer(std::move(indices));
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "static batch: Could not read back the buffers of " << geom.get_debug_name();
+    throw std::runtime_error("Error reading geometry for static batch");
+  }
+  return add(data, m.get_transform().get_transform_matrix(), m.get_material());
+}
+
+// Uploads the chunks filled so far
+void static_batch::build() {
+  // The map is ordered by material first, so the chunks come out sorted by material
+  for (auto &entry : _pending) {
+    for (auto &p : entry.second) {
+      mesh_data data;
+      data.set_type(GL_TRIANGLES);
+      for (auto &s : std::get<1>(entry.first))
+        data.add_buffer(s.first, p.streams[s.first].data(), s.second, p.vertices);
+      data.add_index_buffer(std::move(p.indices));
+      data.set_minimal_point(p.minimal);
+      data.set_maximal_point(p.maximal);
+      data.set_name("static batch");
+      _chunks.push_back({geometry(std::move(data)), std::get<0>(entry.first), p.minimal, p.maximal, p.sources});
+    }
+  }
+  _pending.clear();
+  std::stable_sort(_chunks.begin(), _chunks.end(),
+                   [](const chunk &a, const chunk &b) { return a.material < b.material; });
+  size_t sources = 0;
+  for (auto &c : _chunks)
+    sources += c.sources;
+  LOG_INFO << "static batch built " << _chunks.size() << " chunks from " << sources << " meshes";
+}
+}
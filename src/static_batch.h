@@ -0,0 +1,86 @@
+#pragma once
+
+#include "geometry.h"
+#include "material.h"
+#include "mesh.h"
+#include "mesh_data.h"
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Merges meshes that never move into a few large pieces of geometry.  Each
+mesh added is transformed into world space on the CPU, then appended to the
+chunk for its material, its vertex format and the spatial cell its centre
+lies in.  Building uploads every chunk as one geometry with world space
+bounds, so a level made of thousands of small primitives is drawn with one
+draw per chunk and the chunks can be culled.  Meshes are drawn with an
+identity model matrix once batched
+*/
+class static_batch {
+public:
+  // One merged piece of geometry
+  struct chunk {
+    // The merged geometry, in world space
+    geometry geom;
+    // The index of the material shared by the chunk
+    size_t material;
+    // The minimal point of the chunk's bounds
+    glm::vec3 minimal;
+    // The maximal point of the chunk's bounds
+    glm::vec3 maximal;
+    // The number of meshes merged into the chunk
+    size_t sources;
+  };
+
+private:
+  // A chunk still being filled
+  struct pending {
+    // The attribute data, keyed by attribute index
+    std::map<GLuint, std::vector<float>> streams;
+    // The triangle indices
+    std::vector<GLuint> indices;
+    // The number of vertices
+    GLuint vertices = 0;
+    // The minimal point of the bounds
+    glm::vec3 minimal = glm::vec3(std::numeric_limits<float>::max());
+    // The maximal point of the bounds
+    glm::vec3 maximal = glm::vec3(-std::numeric_limits<float>::max());
+    // The number of meshes added
+    size_t sources = 0;
+  };
+  // Identifies the chunk a mesh joins: its material, vertex format and cell
+  typedef std::tuple<size_t, std::vector<std::pair<GLuint, GLint>>, int, int, int> chunk_key;
+  // The edge length of the cells chunks are split by
+  float _cell_size;
+  // The most vertices one chunk may hold
+  GLuint _max_vertices;
+  // The distinct materials of the meshes added
+  std::vector<material> _materials;
+  // The chunks being filled.  A key holds more than one once the first is full
+  std::map<chunk_key, std::vector<pending>> _pending;
+  // The built chunks, sorted by material
+  std::vector<chunk> _chunks;
+  // Finds or adds a material, returning its index
+  size_t add_material(const material &mat);
+
+public:
+  // Creates an empty batch that splits chunks into cells of the given size
+  explicit static_batch(float cell_size = 50.0f, GLuint max_vertices = 1 << 20)
+      : _cell_size(cell_size), _max_vertices(max_vertices) {}
+  // Default copy constructor and assignment operator
+  static_batch(const static_batch &other) = default;
+  static_batch &operator=(const static_batch &rhs) = default;
+  // Destroys the batch
+  ~static_batch() {}
+  // Adds mesh data with its world transform and material.  Returns false if the primitive type cannot be merged
+  bool add(const mesh_data &data, const glm::mat4 &world, const material &mat);
+  // Adds a mesh, reading its geometry back from the GPU.  Returns false if the geometry cannot be merged
+  bool add(const mesh &m);
+  // Uploads the chunks filled so far.  Meshes added afterwards go into new chunks
+  void build();
+  // Gets the built chunks, sorted by material
+  const std::vector<chunk> &get_chunks() const { return _chunks; }
+  // Gets the distinct materials of the meshes added
+  const std::vector<material> &get_materials() const { return _materials; }
+};
+}
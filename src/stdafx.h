@@ -25,9 +25,16 @@
 #include <GLFW/glfw3.h>
 #include <algorithm>
 #include <array>
+#include <atomic>
 
 #include <cassert>
 #include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <glm/glm.hpp>
@@ -37,10 +44,21 @@
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <initializer_list>
+#include <iomanip>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <random>
+#include <set>
 #include <sstream>
 #include <string>
-#include <vector>
\ No newline at end of file
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Route OpenGL calls to the null backend when requested
+#ifdef ENU_GFX_NULL_GL
+#include "null_gl.h"
+#endif
\ No newline at end of file
@@ -24,6 +24,13 @@ terrain::terrain(const std::string &heightmap) : terrain() {
   auto data = new glm::vec4[tex.get_width() * tex.get_height()];
   glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, (void *)data);
 
+  // Reserve the vertex and index data for the grid
+  size_t vertex_total = tex.get_width() * tex.get_height();
+  positions.reserve(vertex_total);
+  tex_coords.reserve(vertex_total);
+  tex_weights.reserve(vertex_total);
+  indices.reserve(6 * (tex.get_width() - 1) * (tex.get_height() - 1));
+
   // Determine ratio of height map to geometry
   float width_point = 1.0f;
   float depth_point = 1.0f;
@@ -121,6 +128,7 @@ terrain::terrain(const std::string &heightmap) : terrain() {
   _geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
   _geom.add_buffer(tex_weights, BUFFER_INDEXES::TEXTURE_COORDS_1);
   _geom.add_index_buffer(indices);
+  _geom.set_debug_name(heightmap);
 
   // Delete data
   delete[] data;
@@ -1,5 +1,8 @@
 #include "stdafx.h"
 
+#include "gpu_memory.h"
+#include "image_data.h"
+#include "pixel_upload.h"
 #include "texture.h"
 #include "util.h"
 
@@ -8,15 +11,8 @@
 
 namespace graphics_framework {
 
-  static auto stbi_load_smart = [](auto... args) {
-  auto closer_lambda = [](stbi_uc *rgbd) { stbi_image_free(rgbd); };
-  std::unique_ptr<stbi_uc, decltype(closer_lambda)> rgb(stbi_load(args...),
-                                                        closer_lambda);
-  return rgb;
-};
-
 // Creates a new texture object with the given dimensions
-texture::texture(GLuint width, GLuint height) throw(...)
+texture::texture(GLuint width, GLuint height)
     : _width(width), _height(height) {
   // Initialise texture with OpenGL
   glGenTextures(1, &_id);
@@ -24,8 +20,7 @@ texture::texture(GLuint width, GLuint height) throw(...)
   // Check if error
   if (CHECK_GL_ERROR) {
     // Problem creating texture object
-    std::cerr << "ERROR - creating texture" << std::endl;
-    std::cerr << "Could not allocate texture with OpenGL" << std::endl;
+    LOG_ERROR << "creating texture: Could not allocate texture with OpenGL";
     // Set id to 0
     _id = 0;
     // Throw exception
@@ -34,29 +29,43 @@ texture::texture(GLuint width, GLuint height) throw(...)
 }
 
 // Creates a new texture object from the given file
-texture::texture(const std::string &filename) throw(...)
+texture::texture(const std::string &filename)
     : texture(filename, true, true) {}
 
 // Creates a new texture object from the given file with mipmaps and anisotropic
 // filtering defined
 texture::texture(const std::string &filename, bool mipmaps,
-                 bool anisotropic) throw(...) {
+                 bool anisotropic) {
   // Check if file exists
   if (!check_file_exists(filename)) {
+    // Deployments ship baked containers in place of the source images
+    if (check_file_exists(filename + ".tex")) {
+      load_baked(filename + ".tex", mipmaps, anisotropic, filename);
+      return;
+    }
     // Failed to read file.  Display error
-    std::cerr << "ERROR - could not load texture " << filename << std::endl;
-    std::cerr << "File Does Not Exist" << std::endl;
+    LOG_ERROR << "could not load texture " << filename << ": File Does Not Exist";
     // Throw exception
     throw std::runtime_error("Error reading texture");
   }
 
-  int width, height, bpp;
-  auto rgb = stbi_load_smart(filename.c_str(), &width, &height, &bpp, 4);
+  // Decode, then upload the pixels
+  image_data image(filename);
+  create(image.get_pixels(), image.get_width(), image.get_height(), mipmaps, anisotropic, filename);
 
-  if (rgb == NULL || width == 0 || height == 0) {
-    throw std::runtime_error("Error reading texture");
-  }
+  // Log
+  LOG_INFO << "texture " << filename << " loaded, " << _width << 'x' << _height;
+}
+
+// Creates a texture from decoded RGBA pixels
+texture::texture(const unsigned char *pixels, GLuint width, GLuint height, bool mipmaps, bool anisotropic,
+                 const std::string &name) {
+  create(pixels, width, height, mipmaps, anisotropic, name);
+}
 
+// Creates the OpenGL texture from decoded RGBA pixels
+void texture::create(const unsigned char *pixels, GLuint width, GLuint height, bool mipmaps, bool anisotropic,
+                     const std::string &name) {
   // Generate texture with OpenGL
   glGenTextures(1, &_id);
   glBindTexture(GL_TEXTURE_2D, _id);
@@ -65,8 +74,7 @@ texture::texture(const std::string &filename, bool mipmaps,
   if (CHECK_GL_ERROR) {
     _id = 0;
     // Problem creating texture object
-    std::cerr << "ERROR - creating texture " << filename << std::endl;
-    std::cerr << "Could not allocate texture with OpenGL" << std::endl;
+    LOG_ERROR << "creating texture " << name << ": Could not allocate texture with OpenGL";
     // Throw exception
     throw std::runtime_error("Error creating texture");
   }
@@ -94,17 +102,18 @@ texture::texture(const std::string &filename, bool mipmaps,
     CHECK_GL_ERROR; // Non-fatal
   }
 
-  // Now set texture data
+  // Allocate storage, then fill it through the staging buffer so the copy does not stall
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, rgb.get());
+               GL_UNSIGNED_BYTE, nullptr);
+  pixel_upload::upload(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
   // Check if error
   if (CHECK_GL_ERROR) {
     // Error loading texture data into OpenGL
-    std::cerr << "ERROR - loading texture " << filename << std::endl;
-    std::cerr << "Could not load texture data in OpenGL" << std::endl;
+    LOG_ERROR << "loading texture " << name << ": Could not load texture data in OpenGL";
     // Unallocate image with OpenGL
     glDeleteTextures(1, &_id);
+    gpu_memory::release_texture(_id);
     _id = 0;
     // Throw exception
     throw std::runtime_error("Error creating texture");
@@ -114,26 +123,67 @@ texture::texture(const std::string &filename, bool mipmaps,
   if (mipmaps)
     glGenerateMipmap(GL_TEXTURE_2D);
 
+  // Record the texture storage
+  gpu_memory::track_texture(_id, gpu_memory::calculate_texture_bytes(width, height, GL_RGBA, mipmaps),
+                            gpu_memory::texture_2d, name);
+
   // Set attributes
   _height = height;
   _width = width;
   _type = GL_TEXTURE_2D;
-
-  // Unload image data
-  // FreeImage_Unload(image);
   CHECK_GL_ERROR; // Non-fatal - just info
-
-  // Log
-  std::clog << "LOG - texture " << filename << " loaded, " << width << 'x'
-            << height << std::endl;
 }
 
 texture::texture(const std::vector<std::string> &filenames,
-                 bool anisotropic) throw(...) {
+                 bool anisotropic) {
   if (filenames.size() < 2) {
     throw std::runtime_error(
         "Use The standard Texture fucniton if you don't have any mip levels!");
   }
+  // Decode every level before touching OpenGL
+  std::vector<image_data> levels;
+  levels.reserve(filenames.size());
+  for (auto &name : filenames)
+    levels.emplace_back(name);
+
+  // Upload the decoded levels
+  create_mipped(to_levels(levels), anisotropic, filenames[0]);
+}
+
+// Creates a texture from a decoded mip chain
+texture::texture(const std::vector<image_data> &levels, bool anisotropic, const std::string &name) {
+  if (levels.size() < 2) {
+    throw std::runtime_error(
+        "Use The standard Texture fucniton if you don't have any mip levels!");
+  }
+  create_mipped(to_levels(levels), anisotropic, name);
+}
+
+// Creates the texture from a baked container
+void texture::load_baked(const std::string &path, bool mipmaps, bool anisotropic, const std::string &name) {
+  virtual_file file;
+  std::vector<texture_container::level> levels;
+  if (!texture_container::read(path, file, levels))
+    throw std::runtime_error("Error reading texture");
+  // A 1x1 image is a complete chain on its own
+  if (mipmaps && levels.size() > 1)
+    create_mipped(levels, anisotropic, name);
+  else
+    create(levels[0].pixels, levels[0].width, levels[0].height, mipmaps, anisotropic, name);
+  LOG_INFO << "texture " << name << " loaded from " << path << ", " << _width << 'x' << _height;
+}
+
+// Views decoded images as a mip chain
+std::vector<texture_container::level> texture::to_levels(const std::vector<image_data> &images) {
+  std::vector<texture_container::level> levels;
+  for (auto &image : images)
+    levels.push_back({image.get_width(), image.get_height(), image.get_pixels()});
+  return levels;
+}
+
+// Creates the OpenGL texture from a decoded mip chain
+void texture::create_mipped(const std::vector<texture_container::level> &levels, bool anisotropic,
+                            const std::string &name) {
   // Generate texture with OpenGL
   glGenTextures(1, &_id);
   glBindTexture(GL_TEXTURE_2D, _id);
@@ -155,54 +205,68 @@ texture::texture(const std::vector<std::string> &filenames,
 
   // Check for any errors with OpenGL
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - loading mipped texture " << filenames[0] << std::endl;
-    std::cerr << "Could not allocate texture with OpenGL" << std::endl;
+    LOG_ERROR << "loading mipped texture " << name << ": Could not allocate texture with OpenGL";
     throw std::runtime_error("Error creating texture");
   }
 
-  for (size_t i = 0; i < filenames.size(); i++) {
-    if (!check_file_exists(filenames[i])) {
-      // Failed to read file.  Display error
-      std::cerr << "ERROR - could not load texture " << filenames[i]
-                << std::endl;
-      std::cerr << "File Does Not Exist" << std::endl;
-      // Throw exception
-      throw std::runtime_error("Error adding texture");
-    }
-
-    int width, height, bpp;
-    auto rgb = stbi_load_smart(filenames[i].c_str(), &width, &height, &bpp, 4);
-
+  // Size of the mip chain
+  size_t bytes = 0;
+  for (size_t i = 0; i < levels.size(); i++) {
+    auto width = levels[i].width, height = levels[i].height;
     glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, width, height, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, rgb.get());
+                 GL_UNSIGNED_BYTE, nullptr);
+    pixel_upload::upload(GL_TEXTURE_2D, i, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].pixels);
+    bytes += gpu_memory::calculate_texture_bytes(width, height, GL_RGBA, false);
+    // Top level defines the size of the texture
+    if (i == 0) {
+      _width = width;
+      _height = height;
+    }
   }
 
   // Check error
   if (CHECK_GL_ERROR) {
-    std::cerr << "ERROR - loading mipped texture " << filenames[0] << std::endl;
-    std::cerr << "Could not allocate texture with OpenGL" << std::endl;
+    LOG_ERROR << "loading mipped texture " << name << ": Could not allocate texture with OpenGL";
     throw std::runtime_error("Error creating texture");
   }
 
   // Set attributes
   _type = GL_TEXTURE_2D;
 
+  // Record the texture storage
+  gpu_memory::track_texture(_id, bytes, gpu_memory::texture_2d, name);
+
   CHECK_GL_ERROR; // Non-fatal - just info
 
   // Log
-  std::clog << "LOG - texture With Mips " << filenames[0] << " loaded"
-            << std::endl;
+  LOG_INFO << "texture With Mips " << name << " loaded";
+}
+
+// Replaces a region of level 0
+void texture::update(const unsigned char *pixels, GLuint x, GLuint y, GLuint width, GLuint height,
+                     bool mipmaps) {
+  // Only 2D textures with storage can be updated
+  assert(_id != 0 && _type == GL_TEXTURE_2D && x + width <= _width && y + height <= _height);
+  glBindTexture(GL_TEXTURE_2D, _id);
+  pixel_upload::upload(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  if (mipmaps)
+    glGenerateMipmap(GL_TEXTURE_2D);
+  // Check error
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "updating texture: Could not upload texture data";
+    throw std::runtime_error("Error updating texture");
+  }
 }
 
 // Creates a new texture from the given colour data
 texture::texture(const std::vector<glm::vec4> &data, GLuint width,
-                 GLuint height) throw(...)
+                 GLuint height)
     : texture(data, width, height, true, true) {}
 
 // Creates a new texture from the given colour data and mipmap and anisotropic
 // filtering defined
 texture::texture(const std::vector<glm::vec4> &data, GLuint width,
-                 GLuint height, bool mipmaps, bool anisotropic) throw(...) {
+                 GLuint height, bool mipmaps, bool anisotropic) {
   // Check if dimensions are correct
   assert(data.size() == width * height);
 
@@ -211,8 +275,7 @@ texture::texture(const std::vector<glm::vec4> &data, GLuint width,
   // Check error
   if (CHECK_GL_ERROR) {
     // Display error
-    std::cerr << "ERROR - building texture" << std::endl;
-    std::cerr << "Could not allocate texture with OpenGL" << std::endl;
+    LOG_ERROR << "building texture: Could not allocate texture with OpenGL";
     // Throw exception
     throw std::runtime_error("Error creating texture");
   }
@@ -247,10 +310,10 @@ texture::texture(const std::vector<glm::vec4> &data, GLuint width,
     // Check error
     if (CHECK_GL_ERROR) {
       // Display error
-      std::cerr << "ERROR - building texture" << std::endl;
-      std::cerr << "Could not allocate image data with OpenGL" << std::endl;
+      LOG_ERROR << "building texture: Could not allocate image data with OpenGL";
       // Delete texture
       glDeleteTextures(1, &_id);
+      gpu_memory::release_texture(_id);
       _id = 0;
       // Throw exception
       throw std::runtime_error("Error creating texture");
@@ -287,10 +350,10 @@ texture::texture(const std::vector<glm::vec4> &data, GLuint width,
     // Check error
     if (CHECK_GL_ERROR) {
       // Display error
-      std::cerr << "ERROR - building texture" << std::endl;
-      std::cerr << "Could not allocate image data with OpenGL" << std::endl;
+      LOG_ERROR << "building texture: Could not allocate image data with OpenGL";
       // Delete texture
       glDeleteTextures(1, &_id);
+      gpu_memory::release_texture(_id);
       _id = 0;
       // Throw exception
       throw std::runtime_error("Error creating texture");
@@ -308,7 +371,11 @@ texture::texture(const std::vector<glm::vec4> &data, GLuint width,
   else
     _type = GL_TEXTURE_2D;
 
+  // Record the texture storage
+  gpu_memory::track_texture(_id, gpu_memory::calculate_texture_bytes(width, height, GL_RGBA, mipmaps),
+                            gpu_memory::texture_2d, "texture data");
+
   // Log
-  std::clog << "LOG - texture built" << std::endl;
+  LOG_INFO << "texture built";
 }
 } // namespace graphics_framework
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "image_data.h"
 #include "stdafx.h"
+#include "texture_container.h"
 
 namespace graphics_framework {
 /*
@@ -16,22 +18,37 @@ private:
   GLuint _height = 0;
   // The type of the texture
   GLenum _type = 0;
+  // Creates the OpenGL texture from decoded RGBA pixels
+  void create(const unsigned char *pixels, GLuint width, GLuint height, bool mipmaps, bool anisotropic,
+              const std::string &name);
+  // Creates the OpenGL texture from a decoded mip chain
+  void create_mipped(const std::vector<texture_container::level> &levels, bool anisotropic,
+                     const std::string &name);
+  // Creates the texture from a baked container
+  void load_baked(const std::string &path, bool mipmaps, bool anisotropic, const std::string &name);
+  // Views decoded images as a mip chain
+  static std::vector<texture_container::level> to_levels(const std::vector<image_data> &images);
 
 public:
   // Default constructor
   texture() {}
   // Creates an empty texture of the given width and height
-  texture(GLuint width, GLuint height) throw(...);
+  texture(GLuint width, GLuint height);
   // Loads a texture from the given filename
-  explicit texture(const std::string &filename) throw(...);
+  explicit texture(const std::string &filename);
   // Loads a texture from the given filename with mipmaps and anisotropicfiltering determined by the user.
-  texture(const std::string &filename, bool mipmaps, bool anisotropic) throw(...);
+  texture(const std::string &filename, bool mipmaps, bool anisotropic);
+  // Creates a texture from decoded 8 bit RGBA pixels, such as those read by stb_image on a worker thread
+  texture(const unsigned char *pixels, GLuint width, GLuint height, bool mipmaps, bool anisotropic,
+          const std::string &name = "");
   // Loads a texture with mips
-  texture(const std::vector<std::string> &filenames, bool anisotropic) throw(...);
+  texture(const std::vector<std::string> &filenames, bool anisotropic);
+  // Creates a texture from a decoded mip chain, largest level first
+  texture(const std::vector<image_data> &levels, bool anisotropic, const std::string &name = "");
   // Creates a texture from the colour data provided
-  texture(const std::vector<glm::vec4> &data, GLuint width, GLuint height) throw(...);
+  texture(const std::vector<glm::vec4> &data, GLuint width, GLuint height);
   // Creates a texture from the colour data provided and with user defined mipmaps and anisotropic filtering
-  texture(const std::vector<glm::vec4> &data, GLuint width, GLuint height, bool mipmaps, bool anisotropic) throw(...);
+  texture(const std::vector<glm::vec4> &data, GLuint width, GLuint height, bool mipmaps, bool anisotropic);
   // Default copy constructor and assignment operator
   texture(const texture &other) = default;
   texture &operator=(const texture &rhs) = default;
@@ -39,6 +56,14 @@ public:
   ~texture() {}
   // Gets the OpenGL ID of the texture
   GLuint get_id() const { return _id; }
+  // Replaces a region of level 0 with 8 bit RGBA pixels, such as a video frame.  Uploads through the staging buffer
+  // so the frame does not wait on the copy.  Mipmaps are rebuilt if requested
+  void update(const unsigned char *pixels, GLuint x, GLuint y, GLuint width, GLuint height,
+              bool mipmaps = false);
+  // Replaces the whole of level 0 with 8 bit RGBA pixels
+  void update(const unsigned char *pixels, bool mipmaps = false) {
+    update(pixels, 0, 0, _width, _height, mipmaps);
+  }
   // Gets the width of the texture
   GLuint get_width() const { return _width; }
   // Gets the height of the texture
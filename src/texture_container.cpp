@@ -0,0 +1,172 @@
+#include "stdafx.h"
+
+#include "texture_container.h"
+#include "util.h"
+
+namespace graphics_framework {
+// Initialise static members
+const uint32_t texture_container::version;
+
+// Marks a file as a texture container.  "TEXR" when read as bytes
+static const uint32_t container_magic = 0x52584554;
+// Levels start on a multiple of this
+static const size_t level_alignment = 16;
+
+// The fixed header at the start of a container.  Followed by the level table and the pixel blobs
+struct container_header {
+  // Always container_magic
+  uint32_t magic;
+  // The container format version
+  uint32_t version;
+  // The hash of the source image
+  uint64_t source_hash;
+  // The width of the largest level
+  uint32_t width;
+  // The height of the largest level
+  uint32_t height;
+  // The number of levels
+  uint32_t level_count;
+  // Unused, keeps the table aligned
+  uint32_t reserved;
+};
+
+// Describes one level in a container
+struct container_level {
+  // The width of the level
+  uint32_t width;
+  // The height of the level
+  uint32_t height;
+  // The offset of the pixel blob
+  uint64_t offset;
+};
+
+static_assert(sizeof(container_header) == 32 && sizeof(container_level) == 16,
+              "Texture container structures must not be padded");
+
+// Rounds an offset up to the level alignment
+static uint64_t align_level(uint64_t offset) { return (offset + level_alignment - 1) & ~uint64_t(level_alignment - 1); }
+
+// Halves an RGBA image
+std::vector<unsigned char> texture_container::downsample(const unsigned char *pixels, GLuint width, GLuint height) {
+  auto w = std::max(1u, width / 2), h = std::max(1u, height / 2);
+  std::vector<unsigned char> result(size_t(w) * h * 4);
+  for (GLuint y = 0; y < h; ++y) {
+    auto y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+    for (GLuint x = 0; x < w; ++x) {
+      auto x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+      for (GLuint c = 0; c < 4; ++c) {
+        auto sum = pixels[(size_t(y0) * width + x0) * 4 + c] + pixels[(size_t(y0) * width + x1) * 4 + c] +
+                   pixels[(size_t(y1) * width + x0) * 4 + c] + pixels[(size_t(y1) * width + x1) * 4 + c];
+        // Round to nearest
+        result[(size_t(y) * w + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+      }
+    }
+  }
+  return result;
+}
+
+// Writes an RGBA image and its mip chain
+bool texture_container::write(const std::string &path, uint64_t source_hash, const unsigned char *pixels, GLuint width,
+                              GLuint height) {
+  assert(pixels && width > 0 && height > 0);
+  // Build the chain down to 1x1.  Level 0 is written from the caller's pixels
+  std::vector<std::vector<unsigned char>> chain;
+  std::vector<container_level> table;
+  table.push_back({width, height, 0});
+  auto current = pixels;
+  auto w = width, h = height;
+  while (w > 1 || h > 1) {
+    chain.push_back(downsample(current, w, h));
+    current = chain.back().data();
+    w = std::max(1u, w / 2);
+    h = std::max(1u, h / 2);
+    table.push_back({w, h, 0});
+  }
+
+  container_header header = {};
+  header.magic = container_magic;
+  header.version = version;
+  header.source_hash = source_hash;
+  header.width = width;
+  header.height = height;
+  header.level_count = static_cast<uint32_t>(table.size());
+  auto offset = sizeof(header) + table.size() * sizeof(container_level);
+  for (auto &l : table) {
+    l.offset = align_level(offset);
+    offset = l.offset + uint64_t(l.width) * l.height * 4;
+  }
+
+  // Write to a temporary file first, so a reader never maps a partial container
+  std::stringstream temp;
+  temp << path << "." << std::this_thread::get_id() << ".tmp";
+  {
+    std::ofstream file(temp.str(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(&table[0]), table.size() * sizeof(container_level));
+    for (size_t i = 0; i < table.size(); ++i) {
+      static const char zeros[level_alignment] = {};
+      auto position = static_cast<uint64_t>(file.tellp());
+      file.write(zeros, static_cast<std::streamsize>(table[i].offset - position));
+      auto data = i == 0 ? pixels : chain[i - 1].data();
+      file.write(reinterpret_cast<const char *>(data), size_t(table[i].width) * table[i].height * 4);
+    }
+    if (!file.good()) {
+      file.close();
+      std::remove(temp.str().c_str());
+      LOG_WARNING << "could not write texture container " << path;
+      return false;
+    }
+  }
+  // Replace any older container
+  if (std::rename(temp.str().c_str(), path.c_str()) != 0) {
+    std::remove(path.c_str());
+    if (std::rename(temp.str().c_str(), path.c_str()) != 0) {
+      std::remove(temp.str().c_str());
+      LOG_WARNING << "could not replace texture container " << path;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Opens a container and finds its levels
+bool texture_container::read(const std::string &path, virtual_file &file, std::vector<level> &levels) {
+  try {
+    file = virtual_file(path);
+  } catch (std::exception &) {
+    return false;
+  }
+  auto bytes = file.get_data();
+  auto size = static_cast<uint64_t>(file.get_size());
+  // Checks a table or blob lies inside the file
+  auto inside = [=](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+
+  container_header header;
+  if (!inside(0, sizeof(header))) {
+    LOG_ERROR << "reading texture container " << path << ": File is corrupt";
+    return false;
+  }
+  memcpy(&header, bytes, sizeof(header));
+  if (header.magic != container_magic || header.version != version) {
+    LOG_ERROR << "reading texture container " << path << ": Wrong format version.  Bake the texture again";
+    return false;
+  }
+  if (header.level_count == 0 || header.level_count > 32 ||
+      !inside(sizeof(header), uint64_t(header.level_count) * sizeof(container_level))) {
+    LOG_ERROR << "reading texture container " << path << ": File is corrupt";
+    return false;
+  }
+  auto table = reinterpret_cast<const container_level *>(bytes + sizeof(header));
+  levels.clear();
+  for (uint32_t i = 0; i < header.level_count; ++i) {
+    auto &l = table[i];
+    if (l.width == 0 || l.height == 0 || !inside(l.offset, uint64_t(l.width) * l.height * 4)) {
+      LOG_ERROR << "reading texture container " << path << ": File is corrupt";
+      levels.clear();
+      return false;
+    }
+    levels.push_back({l.width, l.height, bytes + l.offset});
+  }
+  return true;
+}
+}
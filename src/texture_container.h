@@ -0,0 +1,39 @@
+#pragma once
+
+#include "stdafx.h"
+#include "virtual_file.h"
+
+namespace graphics_framework {
+/*
+Static class reading and writing baked textures.  A container holds an 8 bit
+RGBA image and its full mip chain, generated offline by the asset baker, so
+loading one needs no image decoding and no mipmap generation.  The levels
+are uploaded straight from the mapped file.  Levels are stored uncompressed,
+as block compression is not done yet.  Containers are versioned, and one with
+the wrong version or a truncated level is rejected
+*/
+class texture_container {
+public:
+  // The version of the container format.  Increase when the format or the mip filtering changes
+  static const uint32_t version = 1;
+
+  // One level of the mip chain within an open container
+  struct level {
+    // The width of the level
+    GLuint width;
+    // The height of the level
+    GLuint height;
+    // The RGBA pixels of the level
+    const unsigned char *pixels;
+  };
+
+  // Writes an RGBA image and its box filtered mip chain.  Returns false if the container could not be written
+  static bool write(const std::string &path, uint64_t source_hash, const unsigned char *pixels, GLuint width,
+                    GLuint height);
+  // Opens a container and finds its levels, largest first.  The levels are valid while the file is open.  Returns
+  // false if the container is not valid
+  static bool read(const std::string &path, virtual_file &file, std::vector<level> &levels);
+  // Halves an RGBA image, averaging each 2x2 block.  Odd edges repeat the last row or column
+  static std::vector<unsigned char> downsample(const unsigned char *pixels, GLuint width, GLuint height);
+};
+}
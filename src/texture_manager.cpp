@@ -0,0 +1,219 @@
+#include "stdafx.h"
+
+#include "asset_stream.h"
+#include "gpu_memory.h"
+#include "image_data.h"
+#include "pixel_upload.h"
+#include "renderer.h"
+#include "texture_container.h"
+#include "texture_manager.h"
+#include "util.h"
+
+namespace graphics_framework {
+
+// Initialise the static manager data
+std::unordered_map<GLuint, texture_manager::entry> texture_manager::_textures;
+size_t texture_manager::_budget = 0;
+size_t texture_manager::_resident_bytes = 0;
+unsigned int texture_manager::_max_dropped_levels = 2;
+unsigned int texture_manager::_idle_frames = 60;
+
+// Loads a texture and places it under management
+texture texture_manager::load(const std::string &filename, bool mipmaps, bool anisotropic) {
+  texture tex(filename, mipmaps, anisotropic);
+  auto bytes = gpu_memory::calculate_texture_bytes(tex.get_width(), tex.get_height(), GL_RGBA, mipmaps);
+  _textures[tex.get_id()] = entry{filename, mipmaps, anisotropic, tex.get_width(), tex.get_height(), 0, true, false,
+                                  renderer::get_frame_count(), bytes};
+  _resident_bytes += bytes;
+  return tex;
+}
+
+// Removes a texture from management and deletes it
+void texture_manager::release(const texture &tex) {
+  auto found = _textures.find(tex.get_id());
+  if (found == _textures.end())
+    return;
+  _resident_bytes -= found->second.bytes;
+  _textures.erase(found);
+  auto id = tex.get_id();
+  glDeleteTextures(1, &id);
+  gpu_memory::release_texture(id);
+}
+
+// Updates the size of a texture
+void texture_manager::set_bytes(GLuint id, entry &e, size_t bytes) {
+  _resident_bytes = _resident_bytes - e.bytes + bytes;
+  e.bytes = bytes;
+  gpu_memory::track_texture(id, bytes, gpu_memory::texture_2d, e.filename);
+}
+
+// Queues a reload of a texture at full resolution
+void texture_manager::restore(GLuint id, entry &e) {
+  e.restoring = true;
+  auto filename = e.filename;
+  // The decoded file.  Baked containers keep their mip chain, read straight from the pack or the mapped file
+  struct source {
+    image_data image;
+    virtual_file file;
+    std::vector<texture_container::level> levels;
+  };
+  auto data = std::make_shared<source>();
+  // Finds the entry again, as the texture may have been released while the reload was queued
+  auto find = [=]() -> entry * {
+    auto found = _textures.find(id);
+    if (found == _textures.end() || !found->second.restoring || found->second.filename != filename)
+      return nullptr;
+    return &found->second;
+  };
+  asset_stream::load_task(
+      filename,
+      [=]() {
+        // Failures are reported by the upload, on the renderer thread
+        try {
+          if (!check_file_exists(filename) && check_file_exists(filename + ".tex")) {
+            if (!texture_container::read(filename + ".tex", data->file, data->levels))
+              data->levels.clear();
+            return;
+          }
+          data->image = image_data(filename);
+          data->levels.push_back({data->image.get_width(), data->image.get_height(), data->image.get_pixels()});
+        } catch (std::exception &) {
+          data->levels.clear();
+        }
+      },
+      [=]() {
+        auto e = find();
+        if (e == nullptr)
+          return;
+        e->restoring = false;
+        if (data->levels.empty()) {
+          LOG_ERROR << "reloading managed texture " << filename << ": Could not read texture file";
+          return;
+        }
+        // Reloads happen mid frame, so keep the current binding and send the pixels through the staging buffer
+        GLint bound;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+        glBindTexture(GL_TEXTURE_2D, id);
+        // Upload the baked levels if there are any, otherwise generate the chain
+        auto levels = e->mipmaps ? data->levels.size() : 1;
+        for (size_t l = 0; l < levels; ++l) {
+          auto &level = data->levels[l];
+          auto index = static_cast<GLint>(l);
+          glTexImage2D(GL_TEXTURE_2D, index, GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+          pixel_upload::upload(GL_TEXTURE_2D, index, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                               level.pixels);
+        }
+        if (e->mipmaps && levels == 1)
+          glGenerateMipmap(GL_TEXTURE_2D);
+        // Eviction limits the texture to its base level
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(bound));
+        if (CHECK_GL_ERROR) {
+          LOG_ERROR << "reloading managed texture " << filename << ": Could not load texture data in OpenGL";
+          return;
+        }
+        e->width = data->levels[0].width;
+        e->height = data->levels[0].height;
+        e->dropped_levels = 0;
+        e->resident = true;
+        set_bytes(id, *e, gpu_memory::calculate_texture_bytes(e->width, e->height, GL_RGBA, e->mipmaps));
+        // Free the pixels and close the file
+        *data = source();
+      },
+      [=]() {
+        auto e = find();
+        if (e != nullptr)
+          e->restoring = false;
+      });
+}
+
+// Drops the top mip level of a texture by making level 1 the new level 0
+bool texture_manager::drop_level(GLuint id, entry &e) {
+  // Only textures with a mip chain and room to shrink can be reduced
+  if (!e.mipmaps || !e.resident || e.dropped_levels >= _max_dropped_levels)
+    return false;
+  GLuint width = std::max(1u, e.width >> (e.dropped_levels + 1));
+  GLuint height = std::max(1u, e.height >> (e.dropped_levels + 1));
+  if (width == 1 && height == 1)
+    return false;
+  // Read back the next level down
+  std::vector<unsigned char> data(width * height * 4);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D, 1, GL_RGBA, GL_UNSIGNED_BYTE, &data[0]);
+  // Respecify the chain from it
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &data[0]);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  if (CHECK_GL_ERROR) {
+    LOG_ERROR << "reducing managed texture " << e.filename;
+    return false;
+  }
+  ++e.dropped_levels;
+  set_bytes(id, e, gpu_memory::calculate_texture_bytes(width, height, GL_RGBA, true));
+  return true;
+}
+
+// Replaces the texture data with a single grey texel
+void texture_manager::evict(GLuint id, entry &e) {
+  static const unsigned char texel[4] = {128, 128, 128, 255};
+  glBindTexture(GL_TEXTURE_2D, id);
+  // Free every level below the base, then limit sampling to the base so the texture stays complete
+  if (e.mipmaps)
+    for (GLint level = 1; (e.width >> level) > 0 || (e.height >> level) > 0; ++level)
+      glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  CHECK_GL_ERROR; // Non-fatal
+  e.resident = false;
+  set_bytes(id, e, 4);
+}
+
+// Marks a texture as used this frame
+void texture_manager::touch(const texture &tex) {
+  // Nothing to do if no textures are managed
+  if (_textures.empty())
+    return;
+  auto found = _textures.find(tex.get_id());
+  if (found == _textures.end())
+    return;
+  found->second.last_used = renderer::get_frame_count();
+  // Reload reduced textures in the background.  The reduced data is drawn until the reload is uploaded
+  if ((!found->second.resident || found->second.dropped_levels > 0) && !found->second.restoring)
+    restore(found->first, found->second);
+}
+
+// Reduces least recently used textures until the budget is met
+void texture_manager::enforce_budget() {
+  if (_budget == 0 || _resident_bytes <= _budget)
+    return;
+  // Order candidates by last use, skipping anything used within the idle frames
+  auto frame = renderer::get_frame_count();
+  std::vector<std::pair<unsigned long long, GLuint>> lru;
+  for (auto &t : _textures)
+    if (t.second.resident && t.second.last_used + _idle_frames < frame)
+      lru.push_back(std::make_pair(t.second.last_used, t.first));
+  std::sort(lru.begin(), lru.end());
+  // Reducing textures rebinds them, so remember the current binding
+  GLint bound;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+  // First drop top mip levels, oldest first
+  for (auto &l : lru) {
+    auto &e = _textures[l.second];
+    while (_resident_bytes > _budget && drop_level(l.second, e))
+      ;
+    if (_resident_bytes <= _budget)
+      break;
+  }
+  // Still over budget - evict whole textures, oldest first
+  for (auto &l : lru) {
+    if (_resident_bytes <= _budget)
+      break;
+    evict(l.second, _textures[l.second]);
+  }
+  // Restore the binding
+  glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(bound));
+}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "stdafx.h"
+#include "texture.h"
+
+namespace graphics_framework {
+/*
+Static class that keeps file backed textures within a memory budget.  Textures
+loaded through the manager record the frame they were last bound on.  When the
+budget is exceeded the least recently used textures first have their top mip
+levels dropped and are then evicted entirely.  Only textures left unbound for
+a number of frames are reduced, so textures used every few frames are not
+evicted and reloaded over and over.  Reduced textures are reloaded in the
+background through the asset stream once they are bound again
+*/
+class texture_manager {
+private:
+  // Residency information about a managed texture
+  struct entry {
+    // The file the texture was loaded from
+    std::string filename;
+    // Whether the texture has a mip chain
+    bool mipmaps;
+    // Whether the texture uses anisotropic filtering
+    bool anisotropic;
+    // The full width of the texture
+    GLuint width;
+    // The full height of the texture
+    GLuint height;
+    // The number of top mip levels currently dropped
+    unsigned int dropped_levels;
+    // Whether the texture data is resident.  Evicted textures hold a single texel
+    bool resident;
+    // Whether a reload is queued on the asset stream
+    bool restoring;
+    // The frame the texture was last bound on
+    unsigned long long last_used;
+    // The number of bytes the texture currently occupies
+    size_t bytes;
+  };
+  // The managed textures, keyed by OpenGL ID
+  static std::unordered_map<GLuint, entry> _textures;
+  // The memory budget in bytes.  0 means unlimited
+  static size_t _budget;
+  // The number of bytes used by the managed textures
+  static size_t _resident_bytes;
+  // The number of top mip levels that may be dropped before a texture is evicted
+  static unsigned int _max_dropped_levels;
+  // The number of frames a texture must go unbound before it is reduced
+  static unsigned int _idle_frames;
+  // Queues a reload of a texture at full resolution on the asset stream
+  static void restore(GLuint id, entry &e);
+  // Drops the top mip level of a texture
+  static bool drop_level(GLuint id, entry &e);
+  // Replaces the texture data, including the mip chain, with a single texel
+  static void evict(GLuint id, entry &e);
+  // Updates the size of a texture in the tracker
+  static void set_bytes(GLuint id, entry &e, size_t bytes);
+
+public:
+  // Loads a texture from file and places it under management
+  static texture load(const std::string &filename, bool mipmaps = true, bool anisotropic = true);
+  // Removes a texture from management and deletes it
+  static void release(const texture &tex);
+  // Gets the memory budget in bytes
+  static size_t get_budget() { return _budget; }
+  // Sets the memory budget in bytes.  0 disables the budget
+  static void set_budget(size_t bytes) { _budget = bytes; }
+  // Gets the number of top mip levels that may be dropped before eviction
+  static unsigned int get_max_dropped_levels() { return _max_dropped_levels; }
+  // Sets the number of top mip levels that may be dropped before eviction
+  static void set_max_dropped_levels(unsigned int value) { _max_dropped_levels = value; }
+  // Gets the number of frames a texture must go unbound before it is reduced
+  static unsigned int get_idle_frames() { return _idle_frames; }
+  // Sets the number of frames a texture must go unbound before it is reduced
+  static void set_idle_frames(unsigned int value) { _idle_frames = value; }
+  // Gets the number of bytes used by the managed textures
+  static size_t get_resident_bytes() { return _resident_bytes; }
+  // Gets the number of managed textures
+  static size_t get_count() { return _textures.size(); }
+  // Marks a texture as used this frame, queuing a reload if it has been reduced.  Called by the renderer on bind
+  static void touch(const texture &tex);
+  // Reduces least recently used textures until the budget is met.  Called by the renderer each frame
+  static void enforce_budget();
+};
+}
@@ -33,7 +33,7 @@ struct transform {
   }
 
   // Gets the transformation matrix representing the defined transform
-  glm::mat4 get_transform_matrix() {
+  glm::mat4 get_transform_matrix() const {
     auto T = glm::translate(glm::mat4(1.0f), position);
     auto S = glm::scale(glm::mat4(1.0f), scale);
     auto R = glm::mat4_cast(orientation);
@@ -42,6 +42,6 @@ struct transform {
   }
 
   // Gets the normal matrix representing the defined transform
-  glm::mat3 get_normal_matrix() { return glm::mat3_cast(orientation); }
+  glm::mat3 get_normal_matrix() const { return glm::mat3_cast(orientation); }
 };
 }
\ No newline at end of file
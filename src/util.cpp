@@ -12,13 +12,13 @@ bool get_devil_error() {
   if (error != IL_NO_ERROR) {
     do {
       ret = true;
-      std::cerr << "DevIL error: " << iluErrorString(error) << std::endl;
+      LOG_ERROR << "DevIL error: " << iluErrorString(error);
     } while ((error = ilGetError()));
   }
   return ret;
 }*/
 
-inline std::string get_severity(GLenum severity) {
+inline const char *get_severity(GLenum severity) {
   switch (severity) {
   case GL_DEBUG_SEVERITY_LOW:
     return "LOW SEVERITY";
@@ -32,7 +32,7 @@ inline std::string get_severity(GLenum severity) {
   return "UNKNOWN SEVERITY";
 }
 
-inline std::string get_source(GLenum source) {
+inline const char *get_source(GLenum source) {
   switch (source) {
   case GL_DEBUG_SOURCE_API:
     return "Source: API";
@@ -57,44 +57,38 @@ inline std::string get_source(GLenum source) {
 
 // Debug message callback for OpenGL
 // Thanks to Sam Serrels for this one
-void __stdcall opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
-                                     const GLchar *message, const void *user_param) {
+void GLAPIENTRY opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                      const GLchar *message, const void *user_param) {
   switch (type) {
   case GL_DEBUG_TYPE_ERROR:
-    std::cerr << "An OpenGL debug error has been detected: " << message << std::endl;
-    std::cerr << get_severity(severity) << std::endl;
-    std::cerr << get_source(source) << std::endl;
+    LOG_ERROR << "An OpenGL debug error has been detected: " << message << " (" << get_severity(severity) << ", "
+              << get_source(source) << ")";
     break;
 
   case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
-    std::cerr << "OpenGL deprecated behaviour detected: " << message << std::endl;
-    std::cerr << get_severity(severity) << std::endl;
-    std::cerr << get_source(source) << std::endl;
+    LOG_WARNING << "OpenGL deprecated behaviour detected: " << message << " (" << get_severity(severity) << ", "
+                << get_source(source) << ")";
     break;
 
   case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
-    std::cerr << "OpenGL undefined behaviour detected: " << message << std::endl;
-    std::cerr << get_severity(severity) << std::endl;
-    std::cerr << get_source(source) << std::endl;
+    LOG_ERROR << "OpenGL undefined behaviour detected: " << message << " (" << get_severity(severity) << ", "
+              << get_source(source) << ")";
     break;
 
   case GL_DEBUG_TYPE_PORTABILITY:
-    std::cerr << "OpenGL portability problem detected: " << message << std::endl;
-    std::cerr << get_severity(severity) << std::endl;
-    std::cerr << get_source(source) << std::endl;
+    LOG_WARNING << "OpenGL portability problem detected: " << message << " (" << get_severity(severity) << ", "
+                << get_source(source) << ")";
     break;
 
   case GL_DEBUG_TYPE_PERFORMANCE:
-    std::cerr << "OpenGL performance problem detected: " << message << std::endl;
-    std::cerr << get_severity(severity) << std::endl;
-    std::cerr << get_source(source) << std::endl;
+    LOG_WARNING << "OpenGL performance problem detected: " << message << " (" << get_severity(severity) << ", "
+                << get_source(source) << ")";
     break;
 
 #ifdef OGL_DEBUG_OTHER
   case GL_DEBUG_TYPE_OTHER:
-    std::cerr << "Other OpenGL error detected: " << message << std::endl;
-    std::cerr << get_severity(severity) << std::endl;
-    std::cerr << get_source(source) << std::endl;
+    LOG_WARNING << "Other OpenGL error detected: " << message << " (" << get_severity(severity) << ", "
+                << get_source(source) << ")";
     break;
 #endif
   }
@@ -102,7 +96,7 @@ void __stdcall opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLen
 
 // GLFW error callback
 void glfw_debug_callback(int error, const char *message) {
-  std::cerr << "A GLFW error has occurred: " << message << std::endl;
+  LOG_ERROR << "A GLFW error has occurred: " << message;
 }
 
 // Utility function to convert screen pos to world ray
@@ -252,4 +246,15 @@ bool test_ray_oobb(const glm::vec3 &origin, const glm::vec3 &direction, const gl
   distance = t_min;
   return true;
 }
+
+// Finds the frustum planes of a model-view-projection matrix
+void get_frustum_planes(const glm::mat4 &mvp, glm::vec4 planes[6]) {
+  auto row = [&](int i) { return glm::vec4(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]); };
+  for (int i = 0; i < 3; ++i) {
+    planes[i * 2] = row(3) + row(i);
+    planes[i * 2 + 1] = row(3) - row(i);
+  }
+  for (int i = 0; i < 6; ++i)
+    planes[i] /= glm::length(glm::vec3(planes[i]));
+}
 }
\ No newline at end of file
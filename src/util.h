@@ -1,54 +1,44 @@
 #pragma once
 
+#include "gl_debug.h"
+#include "log.h"
 #include "stdafx.h"
+#include "virtual_file.h"
 
 namespace graphics_framework {
-#if defined(DEBUG) | defined(_DEBUG)
-
 // Debug message callback for OpenGL
 // Thanks to Sam Serrels for this one
-void __stdcall opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
-                                     const GLchar *message, const void *user_param);
+void GLAPIENTRY opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                      const GLchar *message, const void *user_param);
 
 // GLFW error callback
 void glfw_debug_callback(int error, const char *message);
 
-// Enables memory leak checking
+#if defined(DEBUG) | defined(_DEBUG)
+// Enables memory leak checking where the CRT supports it.  OpenGL debug output is set up by gl_debug
 inline void set_debug() {
+#if defined(_MSC_VER)
   _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
-  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
   glfwSetErrorCallback(glfw_debug_callback);
-  glDebugMessageCallback(opengl_debug_callback, 0);
-  glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, 0, GL_TRUE);
-}
-
-// Checks for any OpenGL errors
-inline bool get_GL_error(int line, const std::string &file) {
-  // Get the current error
-  GLenum error = glGetError();
-  // If there is an error display message
-  if (error) {
-    // Display error
-    std::cerr << "OpenGL Error: " << error << std::endl;
-    std::cerr << "At line " << line << " in file " << file << std::endl;
-    return true;
-  }
-  return false;
 }
 
-#define CHECK_GL_ERROR get_GL_error(__LINE__, __FILE__)
 #define SET_DEBUG set_debug()
+#if defined(_MSC_VER)
 #define _CRTDBG_MAP_ALLOC
 #include <crtdbg.h>
+#endif
 #else
-#define CHECK_GL_ERROR false
 #define SET_DEBUG
 #endif
-// Utility function to check if a file exists
-inline bool check_file_exists(const std::string &filename) {
-  std::ifstream file(filename);
-  return file.good();
-}
+// Records the call site and checks for OpenGL errors as set by gl_debug::set_mode.  Only true in synchronous mode
+#define CHECK_GL_ERROR ::graphics_framework::gl_debug::check(__FUNCTION__, __FILE__, __LINE__)
+// Utility function to check if a file exists, in a mounted asset pack or on disk
+inline bool check_file_exists(const std::string &filename) { return virtual_file::exists(filename); }
+
+// Utility function to read the contents of a text file, from a mounted asset pack or from disk.  Returns false if it
+// could not be read
+bool read_file(const std::string &filename, std::string &content);
 
 // Utility function to convert screen pos to world ray
 void screen_pos_to_world_ray(float mouse_X, float mouse_Y, unsigned int screen_width, unsigned int screen_height,
@@ -57,5 +47,9 @@ void screen_pos_to_world_ray(float mouse_X, float mouse_Y, unsigned int screen_w
 // Utility function to test intersection between ray and mesh bounding box
 bool test_ray_oobb(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 &aabb_min,
                    const glm::vec3 &aabb_max, const glm::mat4 &model, float &distance);
+
+// Utility function to find the frustum planes of a model-view-projection matrix, in model space.  Each plane is
+// normalised, so its dot product with a point is the point's distance inside
+void get_frustum_planes(const glm::mat4 &mvp, glm::vec4 planes[6]);
 bool get_devil_error();
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "stdafx.h"
+
+#include "gpu_memory.h"
+#include "util.h"
+#include "vertex_stream.h"
+
+namespace graphics_framework {
+// Initialise static members
+GLuint vertex_stream::_buffer = 0;
+unsigned char *vertex_stream::_mapped = nullptr;
+size_t vertex_stream::_section_size = 0;
+std::vector<GLsync> vertex_stream::_fences;
+size_t vertex_stream::_section = 0;
+size_t vertex_stream::_offset = 0;
+size_t vertex_stream::_peak = 0;
+size_t vertex_stream::_stalls = 0;
+
+// Attribute offsets are kept to a multiple of a vec4
+static const size_t offset_alignment = 16;
+
+// Creates the ring buffer
+bool vertex_stream::initialise(size_t section_size, unsigned int sections) {
+  shutdown();
+  if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage) {
+    LOG_INFO << "buffer storage not available.  Streaming geometry orphans its own buffers";
+    return false;
+  }
+  assert(section_size > 0 && sections > 1);
+  auto size = section_size * sections;
+  auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &_buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+  glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+  _mapped = static_cast<unsigned char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  if (CHECK_GL_ERROR || !_mapped) {
+    // Not fatal.  Streaming geometry falls back to its own buffers
+    LOG_ERROR << "creating vertex stream: Could not map buffer storage";
+    glDeleteBuffers(1, &_buffer);
+    _buffer = 0;
+    _mapped = nullptr;
+    return false;
+  }
+  gpu_memory::track_buffer(_buffer, size, gpu_memory::staging_buffer, "vertex stream");
+  _section_size = section_size;
+  _fences.assign(sections, nullptr);
+  _section = 0;
+  _offset = 0;
+  LOG_INFO << "vertex stream created, " << sections << " frames of " << section_size / 1024 << " KB";
+  return true;
+}
+
+// Deletes the ring buffer
+void vertex_stream::shutdown() {
+  for (auto &fence : _fences) {
+    if (fence)
+      glDeleteSync(fence);
+  }
+  _fences.clear();
+  if (_buffer) {
+    glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(1, &_buffer);
+    gpu_memory::release_buffer(_buffer);
+    CHECK_GL_ERROR; // Non-fatal
+  }
+  _buffer = 0;
+  _mapped = nullptr;
+}
+
+// Allocates mapped memory for this frame
+void *vertex_stream::allocate(size_t bytes, GLuint &buffer, size_t &offset) {
+  if (!_mapped)
+    return nullptr;
+  auto start = (_offset + offset_alignment - 1) & ~(offset_alignment - 1);
+  if (start + bytes > _section_size)
+    return nullptr;
+  _offset = start + bytes;
+  buffer = _buffer;
+  offset = _section * _section_size + start;
+  return _mapped + offset;
+}
+
+// Fences the current section and moves to the next
+void vertex_stream::end_frame() {
+  if (!_mapped || _offset == 0)
+    return;
+  _peak = std::max(_peak, _offset);
+  _fences[_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  _section = (_section + 1) % _fences.size();
+  _offset = 0;
+  auto &fence = _fences[_section];
+  if (!fence)
+    return;
+  // The GPU is more than the ring behind, so the CPU has to wait
+  if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+    ++_stalls;
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+      ;
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Static class holding a ring buffer for vertex data rewritten every frame,
+such as particles, debug lines and deformed meshes.  One buffer is created
+with persistent, coherent mapping and split into a section per frame in
+flight.  Each frame writes into its own section, which the renderer fences
+when the frame ends.  A section is only rewritten once its fence has
+signalled, so the CPU never overwrites data the GPU is still reading.  Used
+through streaming geometry
+*/
+class vertex_stream {
+private:
+  // The ring buffer
+  static GLuint _buffer;
+  // The persistently mapped contents of the ring buffer
+  static unsigned char *_mapped;
+  // The size of each frame's section in bytes
+  static size_t _section_size;
+  // The fence following the frame that last used each section
+  static std::vector<GLsync> _fences;
+  // The section used by the current frame
+  static size_t _section;
+  // The next free byte in the current section
+  static size_t _offset;
+  // The most bytes used in a single frame
+  static size_t _peak;
+  // The number of frames that waited for the GPU to release a section
+  static size_t _stalls;
+
+public:
+  // Creates the ring buffer.  Called by the renderer.  Returns false if buffer storage is not available
+  static bool initialise(size_t section_size = 4 * 1024 * 1024, unsigned int sections = 3);
+  // Deletes the ring buffer.  Called by the renderer on shutdown
+  static void shutdown();
+  // Checks if the ring buffer is available
+  static bool is_available() { return _mapped != nullptr; }
+  // Allocates mapped memory for this frame.  Sets the buffer and byte offset the data is read from.  Returns null if
+  // the section is full
+  static void *allocate(size_t bytes, GLuint &buffer, size_t &offset);
+  // Fences the current section and moves to the next.  Called by the renderer at the end of each frame
+  static void end_frame();
+  // Gets the size of each frame's section in bytes
+  static size_t get_section_size() { return _section_size; }
+  // Gets the most bytes used in a single frame, for sizing the sections
+  static size_t get_peak_bytes() { return _peak; }
+  // Gets the number of frames that waited for the GPU to release a section
+  static size_t get_stalls() { return _stalls; }
+};
+}
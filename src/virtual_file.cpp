@@ -0,0 +1,26 @@
+#include "stdafx.h"
+#include <sys/stat.h>
+
+#include "asset_pack.h"
+#include "virtual_file.h"
+
+namespace graphics_framework {
+// Opens a file from the mounted packs or from disk
+virtual_file::virtual_file(const std::string &filename) {
+  if (asset_pack::find(filename, *this))
+    return;
+  auto mapping = std::make_shared<const mapped_file>(filename);
+  _data = mapping->get_data();
+  _size = mapping->get_size();
+  _mapping = std::move(mapping);
+}
+
+// Checks if a file is in a mounted pack or on disk
+bool virtual_file::exists(const std::string &filename) {
+  if (asset_pack::contains(filename))
+    return true;
+  // A single stat rather than opening the file
+  struct stat info;
+  return stat(filename.c_str(), &info) == 0 && (info.st_mode & S_IFMT) == S_IFREG;
+}
+}
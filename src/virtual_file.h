@@ -0,0 +1,48 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "stdafx.h"
+
+namespace graphics_framework {
+/*
+Read-only access to a resource file, wherever it is stored.  A file found in
+a mounted asset pack is a view into the pack's mapping, so opening it costs
+a hash lookup and no system calls.  Any other file is mapped from disk.  The
+contents are never copied, and a virtual file keeps its mapping alive, so
+the data stays valid however long the file is held.  Virtual files are
+cheap to copy
+*/
+class virtual_file {
+private:
+  // The mapping the contents lie in
+  std::shared_ptr<const mapped_file> _mapping;
+  // The contents.  Null if empty
+  const unsigned char *_data = nullptr;
+  // The size of the contents in bytes
+  size_t _size = 0;
+
+public:
+  // Creates an empty file
+  virtual_file() {}
+  // Opens a file from the mounted packs, or from disk if no pack holds it.  Thread safe
+  explicit virtual_file(const std::string &filename);
+  // Creates a view of part of a mapping
+  virtual_file(std::shared_ptr<const mapped_file> mapping, const unsigned char *data, size_t size)
+      : _mapping(std::move(mapping)), _data(data), _size(size) {}
+  // Default copy and move constructors and assignment operators
+  virtual_file(const virtual_file &other) = default;
+  virtual_file(virtual_file &&other) = default;
+  virtual_file &operator=(const virtual_file &rhs) = default;
+  virtual_file &operator=(virtual_file &&rhs) = default;
+  // Destroys the view, unmapping the file if nothing else uses the mapping
+  ~virtual_file() {}
+  // Gets the contents.  Null if empty
+  const unsigned char *get_data() const { return _data; }
+  // Gets the size of the contents in bytes
+  size_t get_size() const { return _size; }
+  // Checks if the file is open
+  bool is_open() const { return _mapping != nullptr; }
+  // Checks if a file is in a mounted pack or on disk.  Thread safe
+  static bool exists(const std::string &filename);
+};
+}
@@ -19,8 +19,10 @@ target_camera cam;
 cubemap cube_map;
 shadow_map shadow;
 float theta = 0.0f;
+// Number of frames to render when running headless.  0 runs until closed
+unsigned int headless_frames = 0;
 
-bool load_content() {
+bool load_content(load_graph &loader) {
   // Create triangle data
   // Positions
   geom.set_type(GL_TRIANGLE_STRIP);
@@ -34,41 +36,32 @@ bool load_content() {
 
   geom.add_buffer(tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
 
-  geom2 = geometry_builder::create_plane(10, 10);
-  geom4 = geometry_builder::create_box();
-
-
+  // File content and generated geometry are declared here and loaded in parallel once load_content returns
+  loader.add_geometry(geom2, "plane", [] { return geometry_builder::build_plane(10, 10); });
+  loader.add_geometry(geom4, "box", [] { return geometry_builder::build_box(); });
   // Load in model
-  auto src = "models/box.obj";
-  geom3 = geometry(src);
+  loader.add_geometry(geom3, "models/box.obj");
 
-  src = "textures/sahara_lf.jpg";
-  tpng = texture(src, true, false);
-  src = "textures/sahara_lf.jpg";
-  tjpg = texture(src, false, false);
+  loader.add_texture(tpng, "textures/sahara_lf.jpg", true, false);
+  loader.add_texture(tjpg, "textures/sahara_lf.jpg", false, false);
 
   array<string, 6> filenames = {
       "textures/sahara_ft.jpg", "textures/sahara_bk.jpg",
       "textures/sahara_up.jpg", "textures/sahara_dn.jpg",
       "textures/sahara_rt.jpg", "textures/sahara_lf.jpg"};
-  cube_map = cubemap(filenames);
+  loader.add_cubemap(cube_map, filenames);
 
   vector<string> mipnames = {"textures/uv_32.png", "textures/uv_16.png",
                              "textures/uv_8.png",  "textures/uv_4.png",
                              "textures/uv_2.png",  "textures/uv_1.png"};
 
-  tmipped = texture(mipnames, false);
-
-  // Load in shaders
-  eff.add_shader("shaders/basic.vert", GL_VERTEX_SHADER);
-  eff.add_shader("shaders/basic.frag", GL_FRAGMENT_SHADER);
-  eff.build();
-  teff.add_shader("shaders/basic_textured.vert", GL_VERTEX_SHADER);
-  teff.add_shader("shaders/basic_textured.frag", GL_FRAGMENT_SHADER);
-  teff.build();
-  sbeff.add_shader("shaders/skybox.vert", GL_VERTEX_SHADER);
-  sbeff.add_shader("shaders/skybox.frag", GL_FRAGMENT_SHADER);
-  sbeff.build();
+  loader.add_texture(tmipped, mipnames, false);
+
+  // Load in shaders.  Each build waits on its own shader sources only
+  loader.add_effect(eff, {{"shaders/basic.vert", GL_VERTEX_SHADER}, {"shaders/basic.frag", GL_FRAGMENT_SHADER}});
+  loader.add_effect(teff, {{"shaders/basic_textured.vert", GL_VERTEX_SHADER},
+                           {"shaders/basic_textured.frag", GL_FRAGMENT_SHADER}});
+  loader.add_effect(sbeff, {{"shaders/skybox.vert", GL_VERTEX_SHADER}, {"shaders/skybox.frag", GL_FRAGMENT_SHADER}});
   // Set camera properties
   cam.set_position(vec3(10.0f, 10.0f, 10.0f));
   cam.set_target(vec3(0.0f, 0.0f, 0.0f));
@@ -80,6 +73,11 @@ bool load_content() {
 }
 
 bool update(float delta_time) {
+  // Headless runs stop after a fixed number of frames, saving the last one
+  if (headless_frames > 0 && renderer::get_frame_count() >= headless_frames) {
+    renderer::get_headless_target().save("headless.png");
+    return false;
+  }
   // Update the angle - half rotation per second
   theta += pi<float>() * delta_time;
   // Update the camera
@@ -87,6 +85,10 @@ bool update(float delta_time) {
       rotate(vec3(15.0f, 12.0f, 15.0f), theta * 0.05f, vec3(0, 1.0f, 0)));
   cam.update(delta_time);
 
+  // Capture the next ten frames for framework_replay
+  if (glfwGetKey(renderer::get_window(), GLFW_KEY_C) && !gl_capture::is_active())
+    gl_capture::start("capture.bin", 10);
+
   if (glfwGetKey(renderer::get_window(), GLFW_KEY_F)) {
     renderer::set_screen_dimensions(1280, 720);
     auto aspect = static_cast<float>(renderer::get_screen_width()) /
@@ -121,6 +123,10 @@ bool update(float delta_time) {
   if (glfwGetKey(renderer::get_window(), 'L') == GLFW_PRESS) {
     shadow.buffer->save("testl.png",false);
   }
+  // Press m to dump the GPU memory report
+  if (glfwGetKey(renderer::get_window(), 'M') == GLFW_PRESS) {
+    gpu_memory::dump(clog);
+  }
 
   return true;
 }
@@ -198,13 +204,29 @@ bool render() {
   return true;
 }
 
-int main() {
+int main(int argc, char **argv) {
+  // --headless renders offscreen for a fixed number of frames
+  // --benchmark flies the camera along a fixed path and writes frame times to benchmark.txt
+  auto mode = renderer::windowed;
+  bool benchmark = false;
+  for (int i = 1; i < argc; ++i) {
+    if (string(argv[i]) == "--headless") {
+      mode = renderer::headless;
+      headless_frames = 100;
+    } else if (string(argv[i]) == "--benchmark")
+      benchmark = true;
+  }
+  // The benchmark decides when to stop
+  if (benchmark)
+    headless_frames = 0;
   // Create application
-  app application("Framework test", renderer::windowed);
+  app application("Framework test", mode);
   // Set load content, update and render methods
-  application.set_load_content(load_content);
+  application.set_load_content([&application] { return load_content(application.get_load_graph()); });
   application.set_update(update);
   application.set_render(render);
+  if (benchmark)
+    application.set_benchmark(camera_path::create_orbit(vec3(0.0f), 20.0f, 12.0f), cam, 1000, "benchmark.txt");
   // Run application
   application.run();
   return 0;
@@ -0,0 +1,407 @@
+#include "graphics_framework.h"
+#ifdef _WIN32
+#include <direct.h>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+using namespace std;
+using namespace graphics_framework;
+
+/*
+Bakes a resource tree, such as res/, into the formats the framework loads
+without Assimp or stb_image.  Models become mesh entries (name.obj.mesh),
+images become pre-mipped texture containers (name.png.tex), point sets
+become point cloud octrees (name.xyz.points), and shaders are stripped of
+comments and validated by building each set of stages sharing a name in a
+headless context.  Anything else is copied.  The output mirrors
+the source tree, and the loaders fall back to the baked file whenever the
+source is missing, so a deployment ships the output directory in place of
+res/.  Files are baked in parallel, and a manifest of content hashes means
+only changed files are baked again.  With --pack the output is also written
+to a single asset pack, to be mounted with asset_pack::mount at the prefix
+the resources were loaded from.  With --paged, models of at least the given
+number of triangles are also baked into chunks and levels of detail
+(name.obj.paged) for paged_geometry.  Textures are baked as uncompressed
+RGBA8, as block compression is not done yet.
+
+Usage: asset_baker res_dir out_dir [--threads N] [--force] [--no-validate] [--pack file] [--paged triangles]
+*/
+
+// How a source file is baked
+enum bake_kind { bake_model, bake_texture, bake_points, bake_shader, bake_copy };
+
+// One source file to bake
+struct bake_job {
+  // The path relative to the source and output directories
+  string relative;
+  // How the file is baked
+  bake_kind kind;
+  // The hash of the file contents
+  uint64_t hash;
+  // Set once the file has baked successfully
+  bool succeeded;
+};
+
+// Serialises the baker's own output between threads
+static mutex output_mutex;
+
+// Gets the lower case extension of a path, without the dot
+static string get_extension(const string &path) {
+  auto dot = path.find_last_of('.');
+  auto slash = path.find_last_of('/');
+  if (dot == string::npos || (slash != string::npos && dot < slash))
+    return "";
+  auto ext = path.substr(dot + 1);
+  std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+  return ext;
+}
+
+// Decides how a file is baked from its extension
+static bake_kind classify(const string &path) {
+  static const set<string> models = {"obj", "3ds", "md2", "md3", "md5mesh", "mdl", "gltf", "glb"};
+  static const set<string> textures = {"png", "jpg", "jpeg", "bmp", "tga", "psd", "gif", "hdr"};
+  static const set<string> point_sets = {"xyz", "pts"};
+  static const set<string> shaders = {"vert", "frag", "geom", "tesc", "tese", "comp"};
+  auto ext = get_extension(path);
+  if (models.count(ext))
+    return bake_model;
+  if (textures.count(ext))
+    return bake_texture;
+  if (point_sets.count(ext))
+    return bake_points;
+  if (shaders.count(ext))
+    return bake_shader;
+  return bake_copy;
+}
+
+// Gets the shader type for a shader extension
+static GLenum get_shader_type(const string &path) {
+  static const map<string, GLenum> types = {
+      {"vert", GL_VERTEX_SHADER},       {"frag", GL_FRAGMENT_SHADER},        {"geom", GL_GEOMETRY_SHADER},
+      {"tesc", GL_TESS_CONTROL_SHADER}, {"tese", GL_TESS_EVALUATION_SHADER}, {"comp", GL_COMPUTE_SHADER}};
+  return types.at(get_extension(path));
+}
+
+// Gets the path a source file is baked to, relative to the output directory
+static string get_baked_name(const bake_job &job) {
+  switch (job.kind) {
+  case bake_model:
+    return job.relative + ".mesh";
+  case bake_texture:
+    return job.relative + ".tex";
+  case bake_points:
+    return job.relative + ".points";
+  default:
+    return job.relative;
+  }
+}
+
+// Lists the files below a directory, relative to the root
+static void list_files(const string &root, const string &relative, vector<string> &files) {
+  auto directory = relative.empty() ? root : root + "/" + relative;
+  auto join = [&](const string &name) { return relative.empty() ? name : relative + "/" + name; };
+#ifdef _WIN32
+  WIN32_FIND_DATAA entry;
+  auto find = FindFirstFileA((directory + "/*").c_str(), &entry);
+  if (find == INVALID_HANDLE_VALUE)
+    return;
+  do {
+    string name(entry.cFileName);
+    if (name == "." || name == "..")
+      continue;
+    if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      list_files(root, join(name), files);
+    else
+      files.push_back(join(name));
+  } while (FindNextFileA(find, &entry));
+  FindClose(find);
+#else
+  auto dir = opendir(directory.c_str());
+  if (!dir)
+    return;
+  while (auto entry = readdir(dir)) {
+    string name(entry->d_name);
+    if (name == "." || name == "..")
+      continue;
+    struct stat info;
+    if (stat((directory + "/" + name).c_str(), &info) != 0)
+      continue;
+    if (S_ISDIR(info.st_mode))
+      list_files(root, join(name), files);
+    else
+      files.push_back(join(name));
+  }
+  closedir(dir);
+#endif
+}
+
+// Creates every directory leading to a file
+static void make_parent_directories(const string &path) {
+  for (auto slash = path.find('/', 1); slash != string::npos; slash = path.find('/', slash + 1)) {
+#ifdef _WIN32
+    _mkdir(path.substr(0, slash).c_str());
+#else
+    mkdir(path.substr(0, slash).c_str(), 0755);
+#endif
+  }
+}
+
+// Removes comments, trailing whitespace and blank lines from GLSL.  GLSL has no string literals, so every // and /*
+// starts a comment
+static string preprocess_shader(const string &source) {
+  string stripped;
+  for (size_t i = 0; i < source.size(); ++i) {
+    if (source.compare(i, 2, "//") == 0) {
+      while (i < source.size() && source[i] != '\n')
+        ++i;
+      if (i < source.size())
+        stripped += '\n';
+    } else if (source.compare(i, 2, "/*") == 0) {
+      auto end = source.find("*/", i + 2);
+      // Keep the line break a comment spans, so directives stay on their own lines, or else a space between tokens
+      stripped += source.find('\n', i) < end ? '\n' : ' ';
+      i = end == string::npos ? source.size() : end + 1;
+    } else
+      stripped += source[i];
+  }
+  string result, line;
+  istringstream lines(stripped);
+  while (getline(lines, line)) {
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (!line.empty())
+      result += line + '\n';
+  }
+  return result;
+}
+
+// Bakes one model, texture, point set or plain file.  Models of at least the given number of triangles are also
+// paged, unless it is 0.  Returns false on failure
+static bool bake_file(const bake_job &job, const string &source_dir, const string &output_dir,
+                      GLuint paged_triangles) {
+  auto source = source_dir + "/" + job.relative;
+  auto output = output_dir + "/" + get_baked_name(job);
+  make_parent_directories(output);
+  try {
+    switch (job.kind) {
+    case bake_model: {
+      mesh_data data(source);
+      if (!mesh_cache::write_entry(output, job.hash, data))
+        return false;
+      if (paged_triangles == 0 || data.get_index_count() / 3 < paged_triangles)
+        return true;
+      return paged_geometry::write(output_dir + "/" + job.relative + ".paged", data);
+    }
+    case bake_texture: {
+      image_data image(source);
+      return texture_container::write(output, job.hash, image.get_pixels(), image.get_width(), image.get_height());
+    }
+    case bake_points:
+      return point_cloud::build(source, output);
+    default: {
+      ifstream in(source, ios_base::in | ios_base::binary);
+      ofstream out(output, ios_base::out | ios_base::binary);
+      // Streaming an empty file would set the fail bit
+      if (in.peek() != EOF)
+        out << in.rdbuf();
+      return in.is_open() && out.good();
+    }
+    }
+  } catch (exception &e) {
+    lock_guard<mutex> lock(output_mutex);
+    cerr << "ERROR - could not bake " << job.relative << ": " << e.what() << endl;
+    return false;
+  }
+}
+
+// Bakes a set of shader stages sharing a name.  The preprocessed stages are built into an effect first if validating
+static bool bake_shader_set(const vector<bake_job *> &stages, const string &source_dir, const string &output_dir,
+                            bool validate) {
+  vector<string> sources;
+  for (auto job : stages) {
+    string content;
+    if (!read_file(source_dir + "/" + job->relative, content)) {
+      cerr << "ERROR - could not read shader " << job->relative << endl;
+      return false;
+    }
+    sources.push_back(preprocess_shader(content));
+  }
+  if (validate) {
+    try {
+      effect eff;
+      for (size_t i = 0; i < stages.size(); ++i)
+        eff.add_shader_source(sources[i], get_shader_type(stages[i]->relative), stages[i]->relative);
+      eff.build();
+      glDeleteProgram(eff.get_program());
+    } catch (exception &e) {
+      lock_guard<mutex> lock(output_mutex);
+      cerr << "ERROR - shader set " << stages[0]->relative << " is not valid: " << e.what() << endl;
+      return false;
+    }
+  }
+  for (size_t i = 0; i < stages.size(); ++i) {
+    auto output = output_dir + "/" + stages[i]->relative;
+    make_parent_directories(output);
+    ofstream file(output, ios_base::out | ios_base::binary);
+    file << sources[i];
+    if (!file.good())
+      return false;
+  }
+  return true;
+}
+
+// Gets the first line of the manifest.  A change of format version or paging threshold invalidates every entry
+static string get_manifest_version(GLuint paged_triangles) {
+  stringstream version;
+  version << "asset_baker " << mesh_cache::version << " " << texture_container::version << " "
+          << paged_geometry::version << " " << point_cloud::version << " " << paged_triangles;
+  return version.str();
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    cerr << "Usage: asset_baker res_dir out_dir [--threads N] [--force] [--no-validate] [--pack file] "
+            "[--paged triangles]"
+         << endl;
+    return 1;
+  }
+  string source_dir(argv[1]), output_dir(argv[2]), pack_path;
+  auto threads = std::max(thread::hardware_concurrency(), 1u);
+  auto force = false, validate = true;
+  GLuint paged_triangles = 0;
+  for (int i = 3; i < argc; ++i) {
+    string arg(argv[i]);
+    if (arg == "--threads" && i + 1 < argc)
+      threads = std::max(1, atoi(argv[++i]));
+    else if (arg == "--force")
+      force = true;
+    else if (arg == "--no-validate")
+      validate = false;
+    else if (arg == "--pack" && i + 1 < argc)
+      pack_path = argv[++i];
+    else if (arg == "--paged" && i + 1 < argc)
+      paged_triangles = static_cast<GLuint>(std::max(0, atoi(argv[++i])));
+  }
+  // The baker writes its own entries, so imports must not fill a runtime cache as well
+  mesh_cache::set_enabled(false);
+
+  // Find the sources and their hashes
+  vector<string> files;
+  list_files(source_dir, "", files);
+  if (files.empty()) {
+    cerr << "ERROR - no files found in " << source_dir << endl;
+    return 1;
+  }
+  sort(files.begin(), files.end());
+  vector<bake_job> jobs;
+  for (auto &name : files)
+    jobs.push_back({name, classify(name), mesh_cache::hash_file(source_dir + "/" + name), false});
+
+  // Read what was baked last time
+  auto manifest_path = output_dir + "/bake.manifest";
+  map<string, uint64_t> baked;
+  {
+    ifstream manifest(manifest_path);
+    string version, name;
+    uint64_t hash;
+    if (getline(manifest, version) && version == get_manifest_version(paged_triangles) && !force)
+      while (manifest >> hex >> hash && getline(manifest >> ws, name))
+        baked[name] = hash;
+  }
+  // Checks if a file is unchanged since it was baked
+  auto is_current = [&](const bake_job &job) {
+    auto entry = baked.find(job.relative);
+    return entry != baked.end() && entry->second == job.hash && job.hash != 0 &&
+           check_file_exists(output_dir + "/" + get_baked_name(job));
+  };
+
+  // Gather the work.  Shader stages are grouped by name, and a set is baked again if any stage changed
+  vector<bake_job *> work;
+  map<string, vector<bake_job *>> shader_sets;
+  size_t skipped = 0;
+  for (auto &job : jobs) {
+    if (job.kind == bake_shader) {
+      shader_sets[job.relative.substr(0, job.relative.find_last_of('.'))].push_back(&job);
+    } else if (is_current(job)) {
+      job.succeeded = true;
+      ++skipped;
+    } else
+      work.push_back(&job);
+  }
+  vector<vector<bake_job *>> shader_work;
+  for (auto &stages : shader_sets) {
+    if (all_of(stages.second.begin(), stages.second.end(), [&](bake_job *job) { return is_current(*job); })) {
+      for (auto job : stages.second)
+        job->succeeded = true;
+      skipped += stages.second.size();
+    } else
+      shader_work.push_back(stages.second);
+  }
+
+  // Shaders are validated on this thread, which owns the context, while workers bake everything else
+  unique_ptr<app> application;
+  if (validate && !shader_work.empty()) {
+    application.reset(new app("Asset baker", renderer::headless, 64, 64));
+    if (!renderer::is_running()) {
+      cerr << "WARNING - no OpenGL context.  Shaders are not validated" << endl;
+      validate = false;
+    }
+  }
+  auto start = chrono::high_resolution_clock::now();
+  atomic<size_t> next(0);
+  vector<thread> workers;
+  for (unsigned int t = 0; t < threads; ++t)
+    workers.emplace_back([&] {
+      for (auto i = next++; i < work.size(); i = next++) {
+        work[i]->succeeded = bake_file(*work[i], source_dir, output_dir, paged_triangles);
+        lock_guard<mutex> lock(output_mutex);
+        cout << (work[i]->succeeded ? "  baked " : "  FAILED ") << work[i]->relative << endl;
+      }
+    });
+  for (auto &stages : shader_work) {
+    auto succeeded = bake_shader_set(stages, source_dir, output_dir, validate);
+    for (auto job : stages)
+      job->succeeded = succeeded;
+    lock_guard<mutex> lock(output_mutex);
+    cout << (succeeded ? "  baked shader set " : "  FAILED shader set ")
+         << stages[0]->relative.substr(0, stages[0]->relative.find_last_of('.')) << endl;
+  }
+  for (auto &w : workers)
+    w.join();
+  application.reset();
+
+  // Record what is now baked.  Failed files are left out so they are tried again
+  size_t failed = 0;
+  {
+    ofstream manifest(manifest_path);
+    manifest << get_manifest_version(paged_triangles) << endl;
+    for (auto &job : jobs) {
+      if (job.succeeded)
+        manifest << hex << job.hash << " " << job.relative << endl;
+      else
+        ++failed;
+    }
+  }
+  // Pack everything baked so far.  The manifest is only needed by the baker
+  auto packed = true;
+  if (!pack_path.empty()) {
+    vector<string> baked_files;
+    for (auto &job : jobs) {
+      if (!job.succeeded)
+        continue;
+      baked_files.push_back(get_baked_name(job));
+      if (job.kind == bake_model && check_file_exists(output_dir + "/" + job.relative + ".paged"))
+        baked_files.push_back(job.relative + ".paged");
+    }
+    if (!asset_pack::write(pack_path, output_dir, baked_files)) {
+      cerr << "ERROR - could not write asset pack " << pack_path << endl;
+      packed = false;
+    }
+  }
+  auto elapsed = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+  cout << fixed << setprecision(1) << "Baked " << jobs.size() - skipped - failed << " files, " << skipped
+       << " unchanged, " << failed << " failed in " << elapsed << " ms on " << threads << " threads" << endl;
+  return failed == 0 && packed ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#include "graphics_framework.h"
+using namespace std;
+using namespace std::chrono;
+using namespace graphics_framework;
+
+/*
+Replays a capture written by gl_capture headless, as fast as possible, and
+reports the time taken by each frame.  Isolates renderer and driver cost from
+application logic.
+
+Usage: framework_replay capture.bin [--reps N]
+*/
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    cerr << "Usage: framework_replay capture.bin [--reps N]" << endl;
+    return 1;
+  }
+  string filename(argv[1]);
+  unsigned int reps = 100;
+  for (int i = 2; i < argc; ++i)
+    if (string(argv[i]) == "--reps" && i + 1 < argc)
+      reps = std::max(1, atoi(argv[++i]));
+
+  // Read the capture dimensions so the replay renders at the same size
+  GLuint header[4] = {0, 0, 1280, 720};
+  {
+    ifstream file(filename, ios_base::in | ios_base::binary);
+    file.seekg(sizeof(gl_capture::magic));
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+  }
+  app application("Framework replay", renderer::headless, header[2], header[3]);
+  if (!renderer::is_running())
+    return 1;
+  renderer::toggle_vsync(false);
+  try {
+    gl_replay replay(filename);
+    auto frames = replay.get_frame_count();
+    if (frames == 0) {
+      cerr << "ERROR - capture contains no frames" << endl;
+      return 1;
+    }
+    // Warm up so shader compilation and first use costs are excluded
+    for (size_t f = 0; f < frames; ++f)
+      replay.play_frame(f);
+    glFinish();
+    // Time each frame, waiting for the GPU so the driver cost is included
+    vector<double> times(frames, 0.0), worst(frames, 0.0);
+    auto start = high_resolution_clock::now();
+    for (unsigned int r = 0; r < reps; ++r) {
+      for (size_t f = 0; f < frames; ++f) {
+        auto frame_start = high_resolution_clock::now();
+        replay.play_frame(f);
+        glFinish();
+        auto elapsed = duration<double, milli>(high_resolution_clock::now() - frame_start).count();
+        times[f] += elapsed;
+        worst[f] = std::max(worst[f], elapsed);
+      }
+    }
+    auto total = duration<double, milli>(high_resolution_clock::now() - start).count();
+    // Report
+    cout << fixed << setprecision(3);
+    cout << "Replayed " << frames << " frames (" << replay.get_draw_count() << " draws) " << reps << " times on "
+         << glGetString(GL_RENDERER) << endl;
+    for (size_t f = 0; f < frames; ++f)
+      cout << "  frame " << f << ": avg " << times[f] / reps << " ms  max " << worst[f] << " ms" << endl;
+    cout << "Total " << total << " ms, " << total / (reps * frames) << " ms per frame, "
+         << (reps * frames) * 1000.0 / total << " frames per second" << endl;
+  } catch (exception &e) {
+    cerr << "ERROR - replay failed: " << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}